@@ -11,10 +11,120 @@
 /** How many levels the recursive internal stack has. */
 #define CORE_STACK_SIZE 8
 
+/** The oscillator frequency of the Text Games System (in Hz). */
+#define CORE_DEFAULT_OSCILLATOR_FREQUENCY 4000000
+/** The highest oscillator frequency the PIC16F876 supports (in Hz). */
+#define CORE_MAXIMUM_OSCILLATOR_FREQUENCY 20000000
+
+/** The fastest allowed time scale, faster simulations must use an unlimited time scale. */
+#define CORE_MAXIMUM_TIME_SCALE 1000
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** A function called by the core before executing an instruction.
+ * @param Address The instruction address.
+ * @param Instruction The instruction code.
+ */
+typedef void (*TCoreTraceCallback)(unsigned short Address, unsigned short Instruction);
+
+/** All available ways to execute the instructions. */
+typedef enum
+{
+	CORE_ENGINE_INTERPRETER, //! Decode each instruction when it is executed, this is the reference engine (and the default one).
+	CORE_ENGINE_PREDECODED, //! Decode each program memory location once and execute its decoded form, decoding again the locations the program memory writes modify.
+	CORE_ENGINE_LOCKSTEP //! Execute each instruction with both the interpreter and the predecoded engine and compare their results (W, program counter, stack, STATUS and all register file writes). The first divergence is written to the log file with the last executed instructions, then only the interpreter is used.
+} TCoreEngine;
+
+/** The whole core state, which is needed to inspect or restore the program execution. */
+typedef struct
+{
+	unsigned char Register_W; //! The working register.
+	unsigned short Program_Counter; //! The next instruction address.
+	unsigned short Stack[CORE_STACK_SIZE]; //! The return addresses.
+	int Stack_Pointer; //! How many return addresses are on the stack.
+	unsigned int Lost_Cycles_Count; //! How many extra instruction cycles the executed instruction costs, this is always 0 between two instructions.
+	unsigned long long Cycles_Count; //! How many instruction cycles have been executed.
+} TCoreState;
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
-/** Decode and execute the next instruction. All needed register file registers will be accordingly modified. */
-void CoreExecuteNextInstruction(void);
+/** Decode and execute the next instruction. All needed register file registers will be accordingly modified. The cycles count is advanced by the whole instruction duration, so each call ends at an instruction boundary.
+ * @return How many instruction cycles the instruction lasted (1, or 2 for a branch, a taken skip or a PCL write, plus the cycles the peripherals stalled the core for). The peripherals must be clocked by the same amount.
+ */
+unsigned int CoreExecuteNextInstruction(void);
+
+/** Restart the program from the reset vector. The register file must be reset separately. */
+void CoreReset(void);
+
+/** Choose whether instructions are executed at the real PIC speed or as fast as the host can.
+ * @param Is_Enabled Set to 1 to wait for the real instruction cycle duration after each instruction (this is the default), set to 0 to run unthrottled.
+ */
+void CoreEnableThrottling(int Is_Enabled);
+
+/** Set the simulated oscillator frequency. An instruction cycle lasts 4 oscillator periods, the peripherals durations given in microseconds are converted to instruction cycles with this frequency.
+ * @param Frequency The frequency in Hz (from 1 to CORE_MAXIMUM_OSCILLATOR_FREQUENCY). The default is CORE_DEFAULT_OSCILLATOR_FREQUENCY.
+ * @return 0 if the frequency was successfully set,
+ * @return 1 if the frequency is out of range.
+ */
+int CoreSetOscillatorFrequency(unsigned int Frequency);
+
+/** Set how fast the simulated time goes compared to the real time when instructions execution is throttled. Only the pacing changes, the program sees the same instruction cycles whatever the time scale is.
+ * @param Time_Scale 1 runs at the real PIC speed (this is the default), 10 runs ten times faster, 0.25 four times slower (up to CORE_MAXIMUM_TIME_SCALE). Set to 0 to run as fast as the host can.
+ * @return 0 if the time scale was successfully set,
+ * @return 1 if the time scale is out of range.
+ */
+int CoreSetTimeScale(double Time_Scale);
+
+/** Halt instructions execution, the peripherals keep running meanwhile. Must be called while an instruction is executed, the stall is added to the instruction duration.
+ * @param Cycles How many instruction cycles to wait before executing the next instruction.
+ */
+void CoreStall(unsigned int Cycles);
+
+/** Get the address of the next instruction to execute.
+ * @return The 13-bit program counter.
+ */
+unsigned short CoreGetProgramCounter(void);
+
+/** Copy the core state. The CPU thread must not be executing an instruction meanwhile.
+ * @param Pointer_State On output, contain the core state.
+ */
+void CoreGetState(TCoreState *Pointer_State);
+
+/** Replace the core state. The CPU thread must not be executing an instruction meanwhile.
+ * @param Pointer_State The new core state.
+ */
+void CoreSetState(const TCoreState *Pointer_State);
+
+/** Tell how many instruction cycles have elapsed since the simulation start. Peripherals use this value to time their operations.
+ * @return The instruction cycles count.
+ */
+unsigned long long CoreGetCyclesCount(void);
+
+/** Convert a duration to the corresponding amount of instruction cycles at the simulated oscillator frequency.
+ * @param Microseconds The duration in microseconds.
+ * @return The instruction cycles count (rounded up).
+ */
+unsigned int CoreConvertMicrosecondsToCycles(unsigned int Microseconds);
+
+/** Call a function before each instruction is executed, this allows to trace the program execution without slowing down the core when tracing is disabled.
+ * @param Trace_Callback The function to call, set to NULL to stop tracing.
+ */
+void CoreSetTraceCallback(TCoreTraceCallback Trace_Callback);
+
+/** Choose how the instructions are executed. The CPU thread must not be executing an instruction meanwhile.
+ * @param Engine The engine to use.
+ */
+void CoreSetEngine(TCoreEngine Engine);
+
+/** Tell whether the engines executed an instruction differently since the simulation start, when the lockstep engine is used.
+ * @return 0 if the engines always agreed,
+ * @return 1 if a divergence has been written to the log file.
+ */
+int CoreIsDivergenceFound(void);
+
+/** Write the program counter, the working register and the stack content to the log file (whatever the log level is). */
+void CoreDump(void);
 
 #endif
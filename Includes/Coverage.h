@@ -0,0 +1,91 @@
+/** @file Coverage.h
+ * Record which program memory instructions were executed and which way the conditional skip instructions went, so the parts of a program never exercised by a test can be found.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_COVERAGE_H
+#define H_COVERAGE_H
+
+#include <Program_Memory.h>
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** How many bytes a bitmap holding one bit per program memory location needs. */
+#define COVERAGE_BITMAP_SIZE (PROGRAM_MEMORY_SIZE / 8)
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** All coverage information gathered during a simulation. Each bitmap holds one bit per program memory location, bit (Address % 8) of byte (Address / 8). */
+typedef struct
+{
+	unsigned char Executed_Instructions_Bitmap[COVERAGE_BITMAP_SIZE]; //! The instructions that have been executed at least once.
+	unsigned char Taken_Skips_Bitmap[COVERAGE_BITMAP_SIZE]; //! The BTFSC, BTFSS, DECFSZ and INCFSZ instructions that skipped the next instruction at least once.
+	unsigned char Not_Taken_Skips_Bitmap[COVERAGE_BITMAP_SIZE]; //! The BTFSC, BTFSS, DECFSZ and INCFSZ instructions that executed the next instruction at least once.
+} TCoverageMap;
+
+//-------------------------------------------------------------------------------------------------
+// Variables
+//-------------------------------------------------------------------------------------------------
+/** The coverage gathered by the core since the program was loaded (a reloaded program starts from an empty coverage). Use the CoverageRecordXxx() functions to update it. */
+extern TCoverageMap Coverage_Map;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Tell whether a program memory location bit is set in a coverage bitmap.
+ * @param Bitmap The bitmap.
+ * @param Address The program memory location.
+ * @return 0 if the bit is cleared,
+ * @return 1 if the bit is set.
+ */
+static inline int CoverageIsAddressSet(const unsigned char *Bitmap, unsigned short Address)
+{
+	return (Bitmap[Address >> 3] >> (Address & 7)) & 1;
+}
+
+/** Record the execution of an instruction. This is cheap enough to be always done.
+ * @param Address The executed instruction address.
+ */
+static inline void CoverageRecordInstruction(unsigned short Address)
+{
+	Address &= PROGRAM_MEMORY_SIZE - 1; // The program counter can run past the program memory end
+	Coverage_Map.Executed_Instructions_Bitmap[Address >> 3] |= 1 << (Address & 7);
+}
+
+/** Record the outcome of a conditional skip instruction.
+ * @param Address The skip instruction address.
+ * @param Is_Skip_Taken Set to 1 if the next instruction is skipped, set to 0 if it is executed.
+ */
+static inline void CoverageRecordSkip(unsigned short Address, int Is_Skip_Taken)
+{
+	Address &= PROGRAM_MEMORY_SIZE - 1;
+	if (Is_Skip_Taken) Coverage_Map.Taken_Skips_Bitmap[Address >> 3] |= 1 << (Address & 7);
+	else Coverage_Map.Not_Taken_Skips_Bitmap[Address >> 3] |= 1 << (Address & 7);
+}
+
+/** Add the coverage of another run to a coverage map.
+ * @param Pointer_Destination_Map The map receiving the coverage.
+ * @param Pointer_Source_Map The coverage to add.
+ */
+void CoverageMergeMaps(TCoverageMap *Pointer_Destination_Map, const TCoverageMap *Pointer_Source_Map);
+
+/** Load a coverage file written by CoverageStoreFile().
+ * @param String_File The file to read.
+ * @param Pointer_Map On output, contain the file coverage.
+ * @param Pointer_Program_Hash On output, contain the hash of the program the coverage has been recorded with. The coverage must not be used with a program having another hash.
+ * @return 0 if the file was successfully loaded,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+int CoverageLoadFile(char *String_File, TCoverageMap *Pointer_Map, unsigned long long *Pointer_Program_Hash);
+
+/** Write a coverage map to a file (the file is overwritten).
+ * @param String_File The file to write.
+ * @param Pointer_Map The coverage to store.
+ * @param Program_Hash The hash of the program the coverage has been recorded with (see ProgramMemoryGetHexFileHash()).
+ * @return 0 if the file was successfully written,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+int CoverageStoreFile(char *String_File, const TCoverageMap *Pointer_Map, unsigned long long Program_Hash);
+
+#endif
@@ -0,0 +1,106 @@
+/** @file Debugger.h
+ * Halt and resume the simulated board at instruction boundaries on behalf of a debugging front end. The CPU thread pays a single flag test per instruction while the debugger is not armed. When snapshots are enabled (see Snapshot.h), the board can also be executed backward.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_DEBUGGER_H
+#define H_DEBUGGER_H
+
+#include <stdatomic.h>
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** Why the board has been halted. */
+typedef enum
+{
+	DEBUGGER_STOP_REASON_HALT_REQUEST, //! DebuggerHalt() has been called.
+	DEBUGGER_STOP_REASON_BREAKPOINT, //! A breakpoint has been reached.
+	DEBUGGER_STOP_REASON_SINGLE_STEP, //! One instruction has been executed after a single-step resume.
+	DEBUGGER_STOP_REASON_WATCHPOINT, //! The last executed instruction triggered a watchpoint.
+	DEBUGGER_STOP_REASON_HISTORY_START //! The board has been executed backward up to the oldest snapshot.
+} TDebuggerStopReason;
+
+//-------------------------------------------------------------------------------------------------
+// Variables
+//-------------------------------------------------------------------------------------------------
+/** Tell whether the CPU thread must call DebuggerCheck() before executing the next instruction. Use DebuggerIsArmed() to access it. */
+extern atomic_int Debugger_Is_Armed;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Create the halt notification event.
+ * @return 0 if the debugger was successfully initialized,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+int DebuggerInitialize(void);
+
+/** Tell whether the debugger needs to check the next instruction. This is cheap enough to be called before each instruction.
+ * @return 0 if the next instruction can be executed right away,
+ * @return 1 if DebuggerCheck() must be called first.
+ */
+static inline int DebuggerIsArmed(void)
+{
+	return atomic_load_explicit(&Debugger_Is_Armed, memory_order_relaxed);
+}
+
+/** Halt the board if a breakpoint, a single-step or a halt request is reached, and wait for the board to be resumed. Must be called by the CPU thread only, before executing an instruction.
+ * @note The whole board is halted, peripherals do not evolve while the CPU thread waits here.
+ */
+void DebuggerCheck(void);
+
+/** Ask the CPU thread to halt at the next instruction boundary. The function returns immediately, wait for the halt event to know when the board is halted.
+ * @see DebuggerGetHaltEventFileDescriptor().
+ */
+void DebuggerHalt(void);
+
+/** Ask the CPU thread to halt after the instruction being executed, because it triggered a watchpoint.
+ * @note This function can be called from register callbacks.
+ */
+void DebuggerHaltOnWatchpoint(void);
+
+/** Let the halted board run again.
+ * @param Is_Single_Step Set to 1 to halt again after the next instruction, set to 0 to run until a breakpoint or a halt request.
+ */
+void DebuggerResume(int Is_Single_Step);
+
+/** Tell whether the board is executing again instructions it has already executed, to go back to a previous instruction boundary. The snapshots are being used meanwhile. Must be called by the CPU thread only.
+ * @return 0 if the board executes instructions for the first time,
+ * @return 1 if an execution backward is in progress.
+ */
+int DebuggerIsExecutingBackward(void);
+
+/** Clear all breakpoints and let the board run freely, whatever its state is. This is used when the debugging front end goes away or when the simulator exits. */
+void DebuggerRelease(void);
+
+/** Get the file descriptor that becomes readable each time the board halts. Read an 8-byte value from it to acknowledge the halt.
+ * @return The event file descriptor, it can be used with poll().
+ */
+int DebuggerGetHaltEventFileDescriptor(void);
+
+/** Tell why the board halted the last time.
+ * @return The stop reason.
+ */
+TDebuggerStopReason DebuggerGetStopReason(void);
+
+/** Set or remove a breakpoint. Breakpoints must be modified only while the board is halted.
+ * @param Address The program memory address (in words).
+ * @param Is_Enabled Set to 1 to set the breakpoint, set to 0 to remove it.
+ * @return 0 if the breakpoint was modified,
+ * @return 1 if the address is out of the program memory bounds.
+ */
+int DebuggerSetBreakpoint(unsigned short Address, int Is_Enabled);
+
+/** Set the board back to the previous instruction boundary, by restoring the previous snapshot and executing the same instructions again up to this boundary. The board must be halted, it is still halted when the function returns.
+ * @return 0 if the board has been set back one instruction,
+ * @return 1 if there is no recorded history before the current instruction (the stop reason is then DEBUGGER_STOP_REASON_HISTORY_START) or if the board has been released meanwhile.
+ */
+int DebuggerReverseStep(void);
+
+/** Set the board back to the last breakpoint reached or watchpoint triggered before the current cycle. The snapshots intervals are executed again from the newest to the oldest one until a breakpoint or a watchpoint is found. The board must be halted, it is still halted when the function returns.
+ * @return 0 if the board has been set back to a breakpoint or a watchpoint,
+ * @return 1 if none was found in the recorded history (the board is then set back to the oldest snapshot and the stop reason is DEBUGGER_STOP_REASON_HISTORY_START) or if the board has been released meanwhile.
+ */
+int DebuggerReverseContinue(void);
+
+#endif
@@ -0,0 +1,57 @@
+/** @file Disassembler.h
+ * Convert PIC16F876 instructions to text and give program memory addresses a name from the assembler listing symbols. This is kept out of the core so instructions execution never formats strings.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_DISASSEMBLER_H
+#define H_DISASSEMBLER_H
+
+#include <stddef.h>
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** The size of a buffer able to hold any disassembled instruction. */
+#define DISASSEMBLER_INSTRUCTION_STRING_SIZE 64
+/** The size of a buffer able to hold any formatted program memory address. */
+#define DISASSEMBLER_ADDRESS_STRING_SIZE 64
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Load the program labels from the listing file generated by the assembler (MPASM or gpasm ".lst" file). Previously loaded labels are discarded.
+ * @param String_Listing_File The listing file.
+ * @return 0 if the labels were successfully loaded,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+int DisassemblerLoadSymbols(char *String_Listing_File);
+
+/** Get the label located at a program memory address.
+ * @param Address The program memory address.
+ * @return The label name,
+ * @return NULL if there is no label at this address.
+ */
+const char *DisassemblerGetSymbol(unsigned short Address);
+
+/** Convert a program memory address to text, relative to the closest preceding label if labels have been loaded (for instance "Main+0x3 (0x0008)").
+ * @param Address The program memory address.
+ * @param String_Address On output, contain the formatted address.
+ * @param Size The output buffer size, DISASSEMBLER_ADDRESS_STRING_SIZE is always enough.
+ */
+void DisassemblerFormatAddress(unsigned short Address, char *String_Address, size_t Size);
+
+/** Convert an instruction to its assembly language form. Instructions are decoded exactly like the core does, so an instruction the core executes as NOP is displayed as a "DW" directive.
+ * @param Address The instruction address, used to compute CALL and GOTO targets in the same program memory page.
+ * @param Instruction The 14-bit instruction code.
+ * @param String_Instruction On output, contain the disassembled instruction.
+ * @param Size The output buffer size, DISASSEMBLER_INSTRUCTION_STRING_SIZE is always enough.
+ */
+void DisassemblerDecodeInstruction(unsigned short Address, unsigned short Instruction, char *String_Instruction, size_t Size);
+
+/** Tell whether an instruction is BTFSC, BTFSS, DECFSZ or INCFSZ.
+ * @param Instruction The instruction code.
+ * @return 0 if the instruction is not a conditional skip,
+ * @return 1 if the instruction is a conditional skip.
+ */
+int DisassemblerIsConditionalSkip(unsigned short Instruction);
+
+#endif
@@ -0,0 +1,22 @@
+/** @file GDB_Server.h
+ * Let GDB debug the simulated program through the remote serial protocol. The board is halted when GDB connects.
+ * GDB sees the W, STATUS, PC, FSR and stack pointer registers and the 8 stack levels. Addresses are byte addresses like GDB expects : the program memory words are located from 0x000000 to 0x003FFF (little-endian, so the program counter and stack values are word addresses multiplied by 2), the register file bank N is located at 0x800000 + N * 0x80. Watchpoints can be set on the register file, they are reported with the address of the register storing the data (mirrored registers are reported in bank 0 or 1). When snapshots are enabled, GDB can also execute the program backward (reverse-stepi and reverse-continue commands).
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_GDB_SERVER_H
+#define H_GDB_SERVER_H
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Start listening for a GDB connection.
+ * @param String_Address "unix:Path" to create a Unix domain socket server at Path, or "tcp:Port" to listen on the loopback interface TCP port Port.
+ * @return 0 if the server was successfully started,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+int GDBServerInitialize(char *String_Address);
+
+/** Disconnect GDB, let the board run freely and stop the server. */
+void GDBServerUninitialize(void);
+
+#endif
@@ -8,8 +8,8 @@
 //-------------------------------------------------------------------------------------------------
 // Constants
 //-------------------------------------------------------------------------------------------------
-/** How many instructions can be contained in one hex file line. */
-#define HEX_PARSER_MAXIMUM_INSTRUCTIONS_PER_LINE 32
+/** How many instructions can be contained in one hex record (a record holds up to 255 data bytes). */
+#define HEX_PARSER_MAXIMUM_INSTRUCTIONS_PER_LINE 127
 
 //-------------------------------------------------------------------------------------------------
 // Types
@@ -17,7 +17,7 @@
 /** A decoded hex instruction. */
 typedef struct
 {
-	unsigned short Address; //! Address of the instruction.
+	unsigned int Address; //! Address of the instruction.
 	unsigned short Code; //! Instruction code.
 	char Is_Instruction_Valid; //! Tell if the instruction is valid (can be sent to the board) or not.
 	char Is_End_Of_File; //! Tell if EOF is reached or not.
@@ -26,11 +26,15 @@ typedef struct
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
-/** Parse a whole line read from the hex file.
- * @param String_Hex_Line The line from the hex file (like ":A012345678").
+/** Parse a record from the hex file and validate its checksum. Extended segment address (type 02) and extended linear address (type 04) records update the base address, start address records are ignored.
+ * @param Pointer_Record The record beginning (the ':' start code), the record does not need to be terminated.
+ * @param Available_Characters How many characters can be read from Pointer_Record.
+ * @param Pointer_Base_Address On input, the base address (in bytes) set by the previous extended address records. On output, the base address to use for the next records.
  * @param Instructions An array holding all parsed instructions when the function returns (the array must be HEX_PARSER_MAXIMUM_INSTRUCTIONS_PER_LINE wide).
- * @return The instructions count contained in String_Hex_Line.
+ * @param Pointer_Instructions_Count On output, the instructions count contained in the record.
+ * @return The record length in characters (line ending excluded),
+ * @return -1 if the record is malformed, truncated or if its checksum is wrong.
  */
-int HexParserDecodeLine(char *String_Hex_Line, THexParserInstruction Instructions[]);
+int HexParserDecodeRecord(const char *Pointer_Record, unsigned int Available_Characters, unsigned int *Pointer_Base_Address, THexParserInstruction Instructions[], int *Pointer_Instructions_Count);
 
 #endif
@@ -0,0 +1,129 @@
+/** @file Instrumentation.h
+ * Measure where the host time goes when the simulator runs. Each subsystem entry and exit is timestamped with the processor time stamp counter, and the CPU thread is watched by the host hardware performance counters.
+ * Instrumentation is compiled in only when INSTRUMENTATION_ENABLED is defined (use "make INSTRUMENTATION=1"), otherwise all macros expand to nothing.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_INSTRUMENTATION_H
+#define H_INSTRUMENTATION_H
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** All timed subsystems. */
+typedef enum
+{
+	INSTRUMENTATION_SUBSYSTEM_MAIN_LOOP, //! Time not spent in any other subsystem.
+	INSTRUMENTATION_SUBSYSTEM_CORE, //! Instructions fetch, decoding and execution.
+	INSTRUMENTATION_SUBSYSTEM_THROTTLING, //! Waiting to execute instructions at the real PIC speed.
+	INSTRUMENTATION_SUBSYSTEM_REGISTER_FILE, //! Register file accesses, including the locking.
+	INSTRUMENTATION_SUBSYSTEM_INTERRUPT_CONTROLLER,
+	INSTRUMENTATION_SUBSYSTEM_TIMER,
+	INSTRUMENTATION_SUBSYSTEM_UART,
+	INSTRUMENTATION_SUBSYSTEM_I2C_EEPROM,
+	INSTRUMENTATION_SUBSYSTEM_ADC,
+	INSTRUMENTATION_SUBSYSTEM_MEMORY_ACCESS,
+	INSTRUMENTATION_SUBSYSTEM_LOGGING,
+	INSTRUMENTATION_SUBSYSTEMS_COUNT
+} TInstrumentationSubsystem;
+
+#ifdef INSTRUMENTATION_ENABLED
+	#if defined(__x86_64__) || defined(__i386__)
+		#include <x86intrin.h>
+	#else
+		#include <time.h>
+	#endif
+
+	//-------------------------------------------------------------------------------------------------
+	// Constants and macros
+	//-------------------------------------------------------------------------------------------------
+	/** How deep subsystems can call each other. */
+	#define INSTRUMENTATION_MAXIMUM_NESTING_LEVEL 16
+
+	/** Start timing a subsystem, the time is not accounted to the calling subsystem anymore.
+	 * @param Subsystem The subsystem (use a value from TInstrumentationSubsystem).
+	 */
+	#define INSTRUMENTATION_ENTER(Subsystem) InstrumentationEnter(Subsystem)
+	/** Stop timing the last entered subsystem and resume timing the calling subsystem. */
+	#define INSTRUMENTATION_LEAVE() InstrumentationLeave()
+
+	//-------------------------------------------------------------------------------------------------
+	// Variables
+	//-------------------------------------------------------------------------------------------------
+	/** Only the thread that called InstrumentationStart() is timed. */
+	extern __thread int Instrumentation_Is_Thread_Instrumented;
+	/** The entered subsystems, the last one is the currently timed one. */
+	extern TInstrumentationSubsystem Instrumentation_Subsystems_Stack[INSTRUMENTATION_MAXIMUM_NESTING_LEVEL];
+	/** The currently timed subsystem location in the subsystems stack. */
+	extern int Instrumentation_Subsystems_Stack_Top;
+	/** Each subsystem exclusive time (in time stamp counter ticks). */
+	extern unsigned long long Instrumentation_Subsystem_Ticks[INSTRUMENTATION_SUBSYSTEMS_COUNT];
+	/** The time stamp of the last subsystem change. */
+	extern unsigned long long Instrumentation_Last_Timestamp;
+
+	//-------------------------------------------------------------------------------------------------
+	// Functions
+	//-------------------------------------------------------------------------------------------------
+	/** Read the processor time stamp counter, or the monotonic clock in nanoseconds if there is none.
+	 * @return The current time stamp.
+	 */
+	static inline unsigned long long InstrumentationReadTimestamp(void)
+	{
+		#if defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+		#else
+			struct timespec Time;
+			
+			clock_gettime(CLOCK_MONOTONIC, &Time);
+			return (unsigned long long) Time.tv_sec * 1000000000ULL + Time.tv_nsec;
+		#endif
+	}
+
+	/** Add the time elapsed since the last subsystem change to the currently timed subsystem. Subsystems nested too deeply are accounted to the deepest recorded one. */
+	static inline void InstrumentationAccountElapsedTime(void)
+	{
+		unsigned long long Timestamp;
+		int Stack_Top;
+		
+		Stack_Top = Instrumentation_Subsystems_Stack_Top;
+		if (Stack_Top >= INSTRUMENTATION_MAXIMUM_NESTING_LEVEL) Stack_Top = INSTRUMENTATION_MAXIMUM_NESTING_LEVEL - 1;
+		
+		Timestamp = InstrumentationReadTimestamp();
+		Instrumentation_Subsystem_Ticks[Instrumentation_Subsystems_Stack[Stack_Top]] += Timestamp - Instrumentation_Last_Timestamp;
+		Instrumentation_Last_Timestamp = Timestamp;
+	}
+
+	/** Account the elapsed time to the current subsystem and start timing another one.
+	 * @param Subsystem The entered subsystem.
+	 */
+	static inline void InstrumentationEnter(TInstrumentationSubsystem Subsystem)
+	{
+		if (!Instrumentation_Is_Thread_Instrumented) return;
+		
+		InstrumentationAccountElapsedTime();
+		Instrumentation_Subsystems_Stack_Top++;
+		if (Instrumentation_Subsystems_Stack_Top < INSTRUMENTATION_MAXIMUM_NESTING_LEVEL) Instrumentation_Subsystems_Stack[Instrumentation_Subsystems_Stack_Top] = Subsystem;
+	}
+
+	/** Account the elapsed time to the current subsystem and resume timing the calling one. */
+	static inline void InstrumentationLeave(void)
+	{
+		if (!Instrumentation_Is_Thread_Instrumented || (Instrumentation_Subsystems_Stack_Top <= 0)) return;
+		
+		InstrumentationAccountElapsedTime();
+		Instrumentation_Subsystems_Stack_Top--;
+	}
+
+	/** Start instrumenting the calling thread (only one thread can be instrumented). The hardware performance counters are started if the host allows it. */
+	void InstrumentationStart(void);
+
+	/** Write the gathered statistics to the log file. This function can be called from any thread. */
+	void InstrumentationDump(void);
+#else
+	#define INSTRUMENTATION_ENTER(Subsystem)
+	#define INSTRUMENTATION_LEAVE()
+	
+	static inline void InstrumentationStart(void) {}
+	static inline void InstrumentationDump(void) {}
+#endif
+
+#endif
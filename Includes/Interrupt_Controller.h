@@ -0,0 +1,55 @@
+/** @file Interrupt_Controller.h
+ * Gather all PIC16F876 interrupt sources and tell the core when an interrupt must be serviced.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_INTERRUPT_CONTROLLER_H
+#define H_INTERRUPT_CONTROLLER_H
+
+#include <Register_File.h>
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** The pending INTCON interrupt flags location in the pending interrupts word. */
+#define INTERRUPT_CONTROLLER_PENDING_INTERRUPTS_SHIFT_INTCON 0
+/** The pending PIR1 interrupt flags location in the pending interrupts word. */
+#define INTERRUPT_CONTROLLER_PENDING_INTERRUPTS_SHIFT_PIR1 8
+/** The pending PIR2 interrupt flags location in the pending interrupts word. */
+#define INTERRUPT_CONTROLLER_PENDING_INTERRUPTS_SHIFT_PIR2 16
+
+//-------------------------------------------------------------------------------------------------
+// Variables
+//-------------------------------------------------------------------------------------------------
+/** The enabled interrupts which flag is set, or zero if no interrupt must be serviced. Use InterruptControllerGetPendingInterrupts() to access it. */
+extern unsigned int Interrupt_Controller_Pending_Interrupts;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** The callback that must be called when INTCON, PIE1, PIR1, PIE2 or PIR2 register is written.
+ * @param Pointer_Content The register content.
+ * @param Data The new register value.
+ */
+void InterruptControllerWriteRegister(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data);
+
+/** The callback that must be called when an INTCON mirror located in banks 1 to 3 is written.
+ * @param Pointer_Content The register content, pointing to the real INTCON register.
+ * @param Data The new register value.
+ */
+void InterruptControllerWriteRemappedRegister(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data);
+
+/** Compute the pending interrupts again from the interrupt registers value. This must be called when these registers are modified without using their callback.
+ * @note This function is not protected against concurrent access and should be used only in register callback functions.
+ */
+void InterruptControllerUpdate(void);
+
+/** Tell if an interrupt must be serviced or not. The pending interrupts are computed each time an interrupt register is written, so this can be called after each instruction at no cost.
+ * @return 0 if no interrupt has fired,
+ * @return A non-zero value if the core must branch to the interrupt handler (see INTERRUPT_CONTROLLER_PENDING_INTERRUPTS_SHIFT_xxx constants to locate each register pending flags).
+ */
+static inline unsigned int InterruptControllerGetPendingInterrupts(void)
+{
+	return Interrupt_Controller_Pending_Interrupts;
+}
+
+#endif
@@ -0,0 +1,73 @@
+/** @file Memory_File.h
+ * Back a simulated non-volatile memory with a file, so its content survives the simulator exit or crash.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_MEMORY_FILE_H
+#define H_MEMORY_FILE_H
+
+#include <sys/mman.h>
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** The smallest host memory page size, used to size the dirty pages bitmap. */
+#define MEMORY_FILE_MINIMUM_HOST_PAGE_SIZE 1024
+/** The biggest memory that can be backed by a file, the dirty pages bitmap must hold all memory pages. */
+#define MEMORY_FILE_MAXIMUM_SIZE (MEMORY_FILE_MINIMUM_HOST_PAGE_SIZE * 32)
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** A memory mapped from a file. */
+typedef struct
+{
+	unsigned char *Pointer_Memory; //! The memory content, read it directly but modify it with MemoryFileWriteByte() only.
+	unsigned int Size; //! The memory size in bytes.
+	int Is_Persistent; //! Tell whether the writes are stored to the file.
+	long Host_Page_Size; //! The granularity of the file synchronization.
+	unsigned int Dirty_Pages_Mask; //! Each bit tells whether a host page has been modified since the last synchronization.
+} TMemoryFile;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Map a file content to memory. The missing bytes of a too short file are considered erased.
+ * @param Pointer_Memory_File The memory to initialize.
+ * @param String_File The file containing the memory content.
+ * @param Size The memory size in bytes, it can't be greater than MEMORY_FILE_MAXIMUM_SIZE.
+ * @param Erased_Value The value of the bytes not present in the file.
+ * @param Is_Missing_File_Created Set to 1 to consider a missing file as a blank memory (the file is then created if writes are stored to it), set to 0 to fail when the file does not exist.
+ * @param Is_Base_Image_Shared Set to 0 to store all writes to the file as soon as they happen (the file is created or extended if needed). Set to 1 to use the file as a read-only base image that can be shared by several simulators, writes are then kept private and are lost on exit.
+ * @return 0 if the file content was successfully mapped,
+ * @return 1 if an error occurred.
+ */
+int MemoryFileMap(TMemoryFile *Pointer_Memory_File, char *String_File, unsigned int Size, unsigned char Erased_Value, int Is_Missing_File_Created, int Is_Base_Image_Shared);
+
+/** Schedule the write back of all modified pages to the file.
+ * @param Pointer_Memory_File The memory.
+ * @param Flags MS_ASYNC to return immediately, MS_SYNC to wait for the data to be on the storage.
+ * @return 0 if the synchronization succeeded,
+ * @return 1 if an error occurred.
+ * @note With a persistent memory, modifications are in the host page cache as soon as they are written, so they survive a simulator crash or kill. Synchronizing only shortens the time before they reach the storage.
+ */
+int MemoryFileSynchronize(TMemoryFile *Pointer_Memory_File, int Flags);
+
+/** Wait for the memory modifications to be written to the file and release the memory.
+ * @param Pointer_Memory_File The memory.
+ * @return 0 if the memory content was successfully written to the file,
+ * @return 1 if an error occurred.
+ */
+int MemoryFileUnmap(TMemoryFile *Pointer_Memory_File);
+
+/** Write a byte to the memory and remember which host page must be written back to the file.
+ * @param Pointer_Memory_File The memory.
+ * @param Address The byte address, it must be lower than the memory size.
+ * @param Data The byte to write.
+ */
+static inline void MemoryFileWriteByte(TMemoryFile *Pointer_Memory_File, unsigned int Address, unsigned char Data)
+{
+	Pointer_Memory_File->Pointer_Memory[Address] = Data;
+	Pointer_Memory_File->Dirty_Pages_Mask |= 1u << (Address / Pointer_Memory_File->Host_Page_Size);
+}
+
+#endif
@@ -7,11 +7,46 @@
 
 #include <Register_File.h>
 
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** How many analog channels. */
+#define PERIPHERAL_ADC_CHANNELS_COUNT 8
+
+/** The pseudo-random source seed used when none is provided, so all runs convert the same values. */
+#define PERIPHERAL_ADC_DEFAULT_PSEUDO_RANDOM_SEED 1
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** Where the converted analog values come from. */
+typedef enum
+{
+	PERIPHERAL_ADC_SAMPLE_SOURCE_PSEUDO_RANDOM, //! Each channel has its own pseudo-random generator, all seeded from the same value.
+	PERIPHERAL_ADC_SAMPLE_SOURCE_FILE, //! Samples are read from a text file holding one value per line, the file is read again from its beginning when its end is reached.
+	PERIPHERAL_ADC_SAMPLE_SOURCE_CONSTANT //! All conversions return the same value.
+} TPeripheralADCSampleSource;
+
+/** The ADC module state that is not stored in the register file. */
+typedef struct
+{
+	unsigned long long Pseudo_Random_States[PERIPHERAL_ADC_CHANNELS_COUNT]; //! Each channel pseudo-random generator state.
+	long Samples_File_Offset; //! Where the next sample is read from the samples file.
+	int Is_Conversion_In_Progress; //! Tell whether a conversion is in progress.
+	int Sampled_Value; //! The value sampled when the conversion started.
+	unsigned long long Conversion_End_Cycle; //! The instruction cycle at which the current conversion will be terminated.
+} TPeripheralADCSnapshot;
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
-/** Initialize the pseudo-random generator that will feed the ADC sampled values. */
-void PeripheralADCInitialize(void);
+/** Select the source that will feed the ADC sampled values.
+ * @param Sample_Source The source type.
+ * @param String_Parameter The source parameter : the seed for the pseudo-random source (NULL to use PERIPHERAL_ADC_DEFAULT_PSEUDO_RANDOM_SEED), the samples file for the file source, the sampled value for the constant source.
+ * @return 0 if the source was successfully initialized,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+int PeripheralADCInitialize(TPeripheralADCSampleSource Sample_Source, char *String_Parameter);
 
 /** The callback that must be called when the ADCON0 register is written.
  * @param Pointer_Content The register content.
@@ -19,4 +54,17 @@ void PeripheralADCInitialize(void);
  */
 void PeripheralADCWriteADCON0(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data);
 
-#endif
\ No newline at end of file
+/** Terminate the current conversion when its duration is elapsed. This must be called after each instruction. */
+void PeripheralADCUpdate(void);
+
+/** Save the ADC module internal state.
+ * @param Pointer_Snapshot On output, contain the state.
+ */
+void PeripheralADCSaveSnapshot(TPeripheralADCSnapshot *Pointer_Snapshot);
+
+/** Restore a previously saved ADC module internal state, the samples file is read again from the same position.
+ * @param Pointer_Snapshot The state to restore.
+ */
+void PeripheralADCRestoreSnapshot(const TPeripheralADCSnapshot *Pointer_Snapshot);
+
+#endif
@@ -0,0 +1,62 @@
+/** @file Peripheral_Data_EEPROM.h
+ * Emulate the PIC16F876 on-chip 256-byte data EEPROM. The firmware accesses it through the EECON registers (see Peripheral_Memory_Access.h).
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_PERIPHERAL_DATA_EEPROM_H
+#define H_PERIPHERAL_DATA_EEPROM_H
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** The data EEPROM size in bytes. */
+#define PERIPHERAL_DATA_EEPROM_SIZE 256
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** The data EEPROM content. */
+typedef struct
+{
+	unsigned char Memory[PERIPHERAL_DATA_EEPROM_SIZE]; //! All data EEPROM bytes.
+} TPeripheralDataEEPROMSnapshot;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Map a file content to the data EEPROM memory. The data EEPROM is erased (all bytes are 0xFF) if the file does not exist.
+ * @param String_Data_EEPROM_File The file containing the data EEPROM memory.
+ * @param Is_Base_Image_Shared Set to 0 to store all data EEPROM writes to the file as soon as they happen. Set to 1 to use the file as a read-only base image that can be shared by several simulators, data EEPROM writes are then kept private and are lost on exit.
+ * @return 0 if the file content was successfully mapped,
+ * @return 1 if an error occurred.
+ */
+int PeripheralDataEEPROMInitialize(char *String_Data_EEPROM_File, int Is_Base_Image_Shared);
+
+/** Wait for the data EEPROM modifications to be written to the data EEPROM file and release the data EEPROM memory.
+ * @return 0 if the memory content was successfully written to the file,
+ * @return 1 if an error occurred.
+ */
+int PeripheralDataEEPROMUninitialize(void);
+
+/** Read a data EEPROM byte.
+ * @param Address The byte address.
+ * @return The byte value.
+ */
+unsigned char PeripheralDataEEPROMRead(unsigned char Address);
+
+/** Program a data EEPROM byte and start storing it to the data EEPROM file.
+ * @param Address The byte address.
+ * @param Data The byte value.
+ */
+void PeripheralDataEEPROMWrite(unsigned char Address, unsigned char Data);
+
+/** Save the data EEPROM content.
+ * @param Pointer_Snapshot On output, contain the data EEPROM content.
+ */
+void PeripheralDataEEPROMSaveSnapshot(TPeripheralDataEEPROMSnapshot *Pointer_Snapshot);
+
+/** Restore a previously saved data EEPROM content. The modified bytes are stored to the data EEPROM file like firmware writes are.
+ * @param Pointer_Snapshot The content to restore.
+ */
+void PeripheralDataEEPROMRestoreSnapshot(const TPeripheralDataEEPROMSnapshot *Pointer_Snapshot);
+
+#endif
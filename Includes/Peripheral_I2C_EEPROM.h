@@ -7,22 +7,54 @@
 
 #include <Register_File.h>
 
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** The EEPROM memory size in bytes. */
+#define PERIPHERAL_I2C_EEPROM_MEMORY_SIZE 4096
+
+/** The EEPROM page write buffer size in bytes. */
+#define PERIPHERAL_I2C_EEPROM_PAGE_SIZE 32
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** The EEPROM content and its protocol state. */
+typedef struct
+{
+	unsigned char Memory[PERIPHERAL_I2C_EEPROM_MEMORY_SIZE]; //! All EEPROM bytes.
+	unsigned char Page_Buffer[PERIPHERAL_I2C_EEPROM_PAGE_SIZE]; //! The bytes received during the current write operation.
+	unsigned int Page_Buffer_Loaded_Bytes_Mask; //! Tell which page buffer bytes have been received.
+	unsigned short Address_Register; //! The EEPROM address register.
+	unsigned char SSPBUF_Value; //! The last byte sent or received on the bus.
+	unsigned char Reserved; //! Keep the next fields aligned.
+	int State; //! The protocol state machine current state.
+	int Is_Acknowledge_Missing; //! The SSPCON2 ACKSTAT bit value.
+	unsigned long long Write_Cycle_End_Cycle; //! The instruction cycle at which the current write cycle will be terminated.
+} TPeripheralI2CEEPROMSnapshot;
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
-/** Load a file content into the EEPROM memory.
+/** Map a file content to the EEPROM memory. The file must exist, a file shorter than the EEPROM is extended with zeros.
  * @param String_EEPROM_File The file containing the EEPROM memory.
- * @return 0 if the file content was successfully loaded,
+ * @param Is_Base_Image_Shared Set to 0 to store all EEPROM writes to the file as soon as they happen. Set to 1 to use the file as a read-only base image that can be shared by several simulators, EEPROM writes are then kept private and are lost on exit.
+ * @return 0 if the file content was successfully mapped,
  * @return 1 if an error occurred.
  */
-int PeripheralI2CEEPROMInitialize(char *String_EEPROM_File);
+int PeripheralI2CEEPROMInitialize(char *String_EEPROM_File, int Is_Base_Image_Shared);
 
-/** Store the EEPROM memory content to the specified EEPROM file.
- * @param String_EEPROM_File The destination file.
+/** Wait for the EEPROM modifications to be written to the EEPROM file and release the EEPROM memory.
  * @return 0 if the memory content was successfully written to the file,
  * @return 1 if an error occurred.
  */
-int PeripheralI2CEEPROMStoreMemoryToFile(char *String_EEPROM_File);
+int PeripheralI2CEEPROMUninitialize(void);
+
+/** The callback that must be called when the SSPBUF register is read.
+ * @param Pointer_Content The register content.
+ * @return The last byte sent or received on the I2C bus.
+ */
+unsigned char PeripheralI2CEEPROMReadSSPBUF(TRegisterFileRegisterContent *Pointer_Content);
 
 /** The callback that must be called when the SSPCON2 register is written.
  * @param Pointer_Content The register content.
@@ -36,4 +68,14 @@ void PeripheralI2CEEPROMWriteSSPCON2(TRegisterFileRegisterContent *Pointer_Conte
  */
 void PeripheralI2CEEPROMWriteSSPBUF(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data);
 
+/** Save the EEPROM content and protocol state.
+ * @param Pointer_Snapshot On output, contain the EEPROM state.
+ */
+void PeripheralI2CEEPROMSaveSnapshot(TPeripheralI2CEEPROMSnapshot *Pointer_Snapshot);
+
+/** Restore a previously saved EEPROM content and protocol state. The modified bytes are stored to the EEPROM file like programmed pages are.
+ * @param Pointer_Snapshot The state to restore.
+ */
+void PeripheralI2CEEPROMRestoreSnapshot(const TPeripheralI2CEEPROMSnapshot *Pointer_Snapshot);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+/** @file Peripheral_Memory_Access.h
+ * Simulate the EECON registers interface giving the firmware access to the on-chip data EEPROM and to the program Flash memory.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_PERIPHERAL_MEMORY_ACCESS_H
+#define H_PERIPHERAL_MEMORY_ACCESS_H
+
+#include <Register_File.h>
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** The unlock sequence and write operation state. */
+typedef struct
+{
+	int Unlock_State; //! Where the unlock sequence is.
+	int Is_Write_In_Progress; //! Tell whether a write operation is in progress.
+	unsigned long long Unlock_Step_Cycle; //! The instruction cycle of the last unlock sequence step.
+	int Is_Program_Memory_Write; //! Tell whether the write operation targets the program memory or the data EEPROM.
+	unsigned short Write_Address; //! The written location address.
+	unsigned short Write_Data; //! The data to write.
+	unsigned long long Write_End_Cycle; //! The instruction cycle at which the current write operation will be terminated.
+} TPeripheralMemoryAccessSnapshot;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** The callback that must be called when the EECON1 register is written.
+ * @param Pointer_Content The register content.
+ * @param Data The new register value.
+ */
+void PeripheralMemoryAccessWriteEECON1(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data);
+
+/** The callback that must be called when the EECON2 register is read.
+ * @param Pointer_Content The register content.
+ * @return Always 0 because EECON2 is not a physical register.
+ */
+unsigned char PeripheralMemoryAccessReadEECON2(TRegisterFileRegisterContent *Pointer_Content);
+
+/** The callback that must be called when the EECON2 register is written.
+ * @param Pointer_Content The register content.
+ * @param Data The unlock sequence byte.
+ */
+void PeripheralMemoryAccessWriteEECON2(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data);
+
+/** Terminate the current write operation when its duration is elapsed. This must be called after each instruction. */
+void PeripheralMemoryAccessUpdate(void);
+
+/** Save the unlock sequence and write operation state.
+ * @param Pointer_Snapshot On output, contain the state.
+ */
+void PeripheralMemoryAccessSaveSnapshot(TPeripheralMemoryAccessSnapshot *Pointer_Snapshot);
+
+/** Restore a previously saved unlock sequence and write operation state.
+ * @param Pointer_Snapshot The state to restore.
+ */
+void PeripheralMemoryAccessRestoreSnapshot(const TPeripheralMemoryAccessSnapshot *Pointer_Snapshot);
+
+#endif
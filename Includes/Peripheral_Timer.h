@@ -5,10 +5,47 @@
 #ifndef H_PERIPHERAL_TIMER_H
 #define H_PERIPHERAL_TIMER_H
 
+#include <Register_File.h>
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** The timer modules state that is not stored in the register file. */
+typedef struct
+{
+	int Timer_0_Prescaler; //! Timer 0 prescaler counter.
+	int Timer_2_Prescaler; //! Timer 2 prescaler counter.
+	int Timer_2_Postscaler; //! Timer 2 postscaler counter.
+} TPeripheralTimerSnapshot;
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
-/** Increment the timer modules according to their internal prescaler/postscaler. */
-void PeripheralTimerIncrement(void);
+/** Increment the timer modules according to their internal prescaler/postscaler.
+ * @param Cycles How many instruction cycles elapsed since the previous call.
+ */
+void PeripheralTimerIncrement(unsigned int Cycles);
+
+/** The callback that must be called when the TMR2 register is written. The timer 2 prescaler and postscaler counters are cleared.
+ * @param Pointer_Content The register content.
+ * @param Data The new register value.
+ */
+void PeripheralTimerWriteTMR2(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data);
+
+/** The callback that must be called when the T2CON register is written. The timer 2 prescaler and postscaler counters are cleared.
+ * @param Pointer_Content The register content.
+ * @param Data The new register value.
+ */
+void PeripheralTimerWriteT2CON(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data);
+
+/** Save the timer modules internal state.
+ * @param Pointer_Snapshot On output, contain the state.
+ */
+void PeripheralTimerSaveSnapshot(TPeripheralTimerSnapshot *Pointer_Snapshot);
+
+/** Restore a previously saved timer modules internal state.
+ * @param Pointer_Snapshot The state to restore.
+ */
+void PeripheralTimerRestoreSnapshot(const TPeripheralTimerSnapshot *Pointer_Snapshot);
 
 #endif
\ No newline at end of file
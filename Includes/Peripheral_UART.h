@@ -1,5 +1,5 @@
 /** @file Peripheral_UART.h
- * Emulate the 19200 bit/s UART by reading/writing to the system console.
+ * Emulate the UART by exchanging data with the selected UART backend. Bytes are transmitted and received at the baud rate the firmware programmed with SPBRG and BRGH, counted in instruction cycles.
  * @author Adrien RICCIARDI
  */
 #ifndef H_PERIPHERAL_UART_H
@@ -7,6 +7,18 @@
 
 #include <Register_File.h>
 
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** The transmitter and receiver timing state. */
+typedef struct
+{
+	unsigned long long Transmission_End_Cycle; //! The instruction cycle at which the transmit shift register has sent its byte, 0 when it is empty.
+	int Is_TXREG_Full; //! Tell whether a byte waits in TXREG for the transmit shift register.
+	unsigned char TXREG_Data; //! The byte waiting in TXREG.
+	unsigned long long Reception_End_Cycle; //! The first instruction cycle at which the next received byte can be moved to RCREG.
+} TPeripheralUARTSnapshot;
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
@@ -28,9 +40,36 @@ void PeripheralUARTWriteTXREG(TRegisterFileRegisterContent *Pointer_Content, uns
  */
 void PeripheralUARTWriteTXSTA(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data);
 
-/** Send a byte to the PIC UART.
- * @param Data The received data.
+/** Move TXREG to the transmit shift register when the previous byte has been sent, and move the next byte received by the UART backend to RCREG when the firmware has read the previous one and a whole frame has elapsed. Must be called by the CPU thread after each instruction. */
+void PeripheralUARTUpdate(void);
+
+/** Start recording the bytes received by the firmware and the cycle they were received at, so they can be replayed. */
+void PeripheralUARTEnableJournal(void);
+
+/** Tell that the board state has been set back to a previous cycle. Until the board executes instructions it has not executed yet, the firmware receives the recorded bytes at the cycles it received them the first time, and the bytes it sends are not given again to the UART backend.
+ * @param Cycles_Count The cycles count the board has been set back to.
+ * @param Replay_End_Cycle The last cycle the board has already executed.
+ */
+void PeripheralUARTStartReplay(unsigned long long Cycles_Count, unsigned long long Replay_End_Cycle);
+
+/** Remove the oldest recorded bytes, because the board can't be set back to their reception cycle anymore.
+ * @param Cycles_Count Remove the bytes received up to this cycle (included).
+ */
+void PeripheralUARTForgetJournal(unsigned long long Cycles_Count);
+
+/** Remove the bytes recorded after a cycle and stop the replay, because the board state has been modified and the next instructions will not behave like the first time they were executed.
+ * @param Cycles_Count Remove the bytes received after this cycle.
+ */
+void PeripheralUARTTruncateJournal(unsigned long long Cycles_Count);
+
+/** Save the transmitter and receiver timing state.
+ * @param Pointer_Snapshot On output, contain the state.
+ */
+void PeripheralUARTSaveSnapshot(TPeripheralUARTSnapshot *Pointer_Snapshot);
+
+/** Restore a previously saved transmitter and receiver timing state.
+ * @param Pointer_Snapshot The state to restore.
  */
-void PeripheralUARTReceiveByte(unsigned char Data);
+void PeripheralUARTRestoreSnapshot(const TPeripheralUARTSnapshot *Pointer_Snapshot);
 
 #endif
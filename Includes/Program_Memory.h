@@ -15,19 +15,50 @@
 // Functions
 //-------------------------------------------------------------------------------------------------
 /** Read a program memory location.
+ * @param Address The location address.
  * @return The 14-bit data.
  */
 unsigned short ProgramMemoryRead(unsigned short Address);
 
-/** Load an Intel Hex file content to the program memory.
+/** Get the configuration word programmed by the hex file.
+ * @return The 14-bit configuration word (0x3FFF if the hex file does not program it).
+ */
+unsigned short ProgramMemoryGetConfigurationWord(void);
+
+/** Get the hash of the loaded hex file content, which identifies the program.
+ * @return The 64-bit hash.
+ */
+unsigned long long ProgramMemoryGetHexFileHash(void);
+
+/** Load an Intel Hex file content to the program memory. A binary program image stored next to the hex file (with the ".image" extension appended) is directly mapped if it has been generated from the same hex file content.
+ * @param String_Hex_File The file to load.
+ * @param Is_Image_File_Written Set to 1 to store the program image when the hex file has to be parsed, so the next loadings are faster. Set to 0 to never write to the hex file directory (for read-only tools).
+ * @return 0 if the file was successfully loaded,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+int ProgramMemoryLoadHexFile(char *String_Hex_File, int Is_Image_File_Written);
+
+/** Replace the program memory content by an Intel Hex file content, while the simulator is running. The program image is stored like ProgramMemoryLoadHexFile() does. The program in use is kept if the new file can't be loaded. Must be called by the CPU thread only, between two instructions.
  * @param String_Hex_File The file to load.
  * @return 0 if the file was successfully loaded,
  * @return 1 if an error occurred. See logs for more information.
  */
-int ProgramMemoryLoadHexFile(char *String_Hex_File);
+int ProgramMemoryReloadHexFile(char *String_Hex_File);
+
+/** Write a program memory location. This is the only way the program memory can be modified after the program is loaded, so any cached form of the program must be updated here.
+ * @param Address The location address.
+ * @param Data The 14-bit data.
+ */
+void ProgramMemoryWrite(unsigned short Address, unsigned short Data);
 
-// TODO for flash access
-// programread
-// programwrite
+/** Copy the whole program memory content.
+ * @param Pointer_Buffer On output, contain the PROGRAM_MEMORY_SIZE program words.
+ */
+void ProgramMemorySaveSnapshot(unsigned short *Pointer_Buffer);
+
+/** Restore a previously saved program memory content. Only the words that differ are written.
+ * @param Pointer_Buffer A buffer filled by ProgramMemorySaveSnapshot().
+ */
+void ProgramMemoryRestoreSnapshot(const unsigned short *Pointer_Buffer);
 
 #endif
@@ -12,6 +12,8 @@
 #define REGISTER_FILE_BANKS_COUNT 4
 /** How many registers in a bank. */
 #define REGISTER_FILE_REGISTERS_IN_BANK_COUNT 128
+/** How many locations the whole register file has, a location is computed as Bank * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + Address. */
+#define REGISTER_FILE_LOCATIONS_COUNT (REGISTER_FILE_BANKS_COUNT * REGISTER_FILE_REGISTERS_IN_BANK_COUNT)
 
 // All register addresses (addresses are relative to the beginning of the register bank)
 // TODO define missing ones when needed
@@ -25,16 +27,27 @@
 #define REGISTER_FILE_REGISTER_ADDRESS_INTCON 0x0B // Replicated in all other banks
 #define REGISTER_FILE_REGISTER_ADDRESS_PIR1 0x0C
 #define REGISTER_FILE_REGISTER_ADDRESS_PIE1 0x0C
+#define REGISTER_FILE_REGISTER_ADDRESS_PIR2 0x0D
+#define REGISTER_FILE_REGISTER_ADDRESS_PIE2 0x0D
+#define REGISTER_FILE_REGISTER_ADDRESS_EEDATA 0x0C
+#define REGISTER_FILE_REGISTER_ADDRESS_EECON1 0x0C
+#define REGISTER_FILE_REGISTER_ADDRESS_EEADR 0x0D
+#define REGISTER_FILE_REGISTER_ADDRESS_EECON2 0x0D
+#define REGISTER_FILE_REGISTER_ADDRESS_EEDATH 0x0E
+#define REGISTER_FILE_REGISTER_ADDRESS_EEADRH 0x0F
 #define REGISTER_FILE_REGISTER_ADDRESS_TMR2 0x11
 #define REGISTER_FILE_REGISTER_ADDRESS_SSPCON2 0x11
 #define REGISTER_FILE_REGISTER_ADDRESS_T2CON 0x12
+#define REGISTER_FILE_REGISTER_ADDRESS_PR2 0x12
 #define REGISTER_FILE_REGISTER_ADDRESS_SSPBUF 0x13
 #define REGISTER_FILE_REGISTER_ADDRESS_TXSTA 0x18
 #define REGISTER_FILE_REGISTER_ADDRESS_TXREG 0x19
+#define REGISTER_FILE_REGISTER_ADDRESS_SPBRG 0x19
 #define REGISTER_FILE_REGISTER_ADDRESS_RCREG 0x1A
 #define REGISTER_FILE_REGISTER_ADDRESS_ADRESH 0x1E
 #define REGISTER_FILE_REGISTER_ADDRESS_ADCON0 0x1F
-#define REGISTER_FILE_REGISTER_ADDRESS_ADRESL 0x1F
+#define REGISTER_FILE_REGISTER_ADDRESS_ADRESL 0x1E
+#define REGISTER_FILE_REGISTER_ADDRESS_ADCON1 0x1F
 
 // All register banks
 // TODO define missing ones when needed
@@ -45,16 +58,27 @@
 #define REGISTER_FILE_REGISTER_BANK_INTCON 0 // The real data byte is stored in bank 0, the replicated registers all point to this bank
 #define REGISTER_FILE_REGISTER_BANK_PIR1 0
 #define REGISTER_FILE_REGISTER_BANK_PIE1 1
+#define REGISTER_FILE_REGISTER_BANK_PIR2 0
+#define REGISTER_FILE_REGISTER_BANK_PIE2 1
+#define REGISTER_FILE_REGISTER_BANK_EEDATA 2
+#define REGISTER_FILE_REGISTER_BANK_EECON1 3
+#define REGISTER_FILE_REGISTER_BANK_EEADR 2
+#define REGISTER_FILE_REGISTER_BANK_EECON2 3
+#define REGISTER_FILE_REGISTER_BANK_EEDATH 2
+#define REGISTER_FILE_REGISTER_BANK_EEADRH 2
 #define REGISTER_FILE_REGISTER_BANK_TMR2 0
 #define REGISTER_FILE_REGISTER_BANK_SSPCON2 1
 #define REGISTER_FILE_REGISTER_BANK_T2CON 0
+#define REGISTER_FILE_REGISTER_BANK_PR2 1
 #define REGISTER_FILE_REGISTER_BANK_SSPBUF 0
 #define REGISTER_FILE_REGISTER_BANK_TXSTA 1
 #define REGISTER_FILE_REGISTER_BANK_TXREG 0
+#define REGISTER_FILE_REGISTER_BANK_SPBRG 1
 #define REGISTER_FILE_REGISTER_BANK_RCREG 0
 #define REGISTER_FILE_REGISTER_BANK_ADRESH 0
 #define REGISTER_FILE_REGISTER_BANK_ADCON0 0
 #define REGISTER_FILE_REGISTER_BANK_ADRESL 1
+#define REGISTER_FILE_REGISTER_BANK_ADCON1 1
 
 /** OPTION_REG register Prescaler Assignment bit. */
 #define REGISTER_FILE_REGISTER_BIT_OPTION_REG_PSA (1 << 3)
@@ -85,18 +109,65 @@
 /** INTCON register RB Port Change Interrupt Flag bit. */
 #define REGISTER_FILE_REGISTER_BIT_INTCON_RBIF (1 << 0)
 
-/** PIR1 register USART Receive Interrupt Enable bit. */
+/** PIR1 register A/D Converter Interrupt Flag bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIR1_ADIF (1 << 6)
+/** PIR1 register USART Receive Interrupt Flag bit. */
 #define REGISTER_FILE_REGISTER_BIT_PIR1_RCIF (1 << 5)
-/** PIR1 register USART Transmit Interrupt Enable bit. */
+/** PIR1 register USART Transmit Interrupt Flag bit. */
 #define REGISTER_FILE_REGISTER_BIT_PIR1_TXIF (1 << 4)
 /** PIR1 register Synchronous Serial Port (SSP) Interrupt Flag. */
 #define REGISTER_FILE_REGISTER_BIT_PIR1_SSPIF (1 << 3)
+/** PIR1 register CCP1 Interrupt Flag bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIR1_CCP1IF (1 << 2)
+/** PIR1 register TMR2 to PR2 Match Interrupt Flag bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIR1_TMR2IF (1 << 1)
+/** PIR1 register TMR1 Overflow Interrupt Flag bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIR1_TMR1IF (1 << 0)
 
+/** PIE1 register A/D Converter Interrupt Enable bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIE1_ADIE (1 << 6)
 /** PIE1 register USART Receive Interrupt Enable bit. */
 #define REGISTER_FILE_REGISTER_BIT_PIE1_RCIE (1 << 5)
 /** PIE1 register USART Transmit Interrupt Enable bit. */
 #define REGISTER_FILE_REGISTER_BIT_PIE1_TXIE (1 << 4)
+/** PIE1 register Synchronous Serial Port Interrupt Enable bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIE1_SSPIE (1 << 3)
+/** PIE1 register CCP1 Interrupt Enable bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIE1_CCP1IE (1 << 2)
+/** PIE1 register TMR2 to PR2 Match Interrupt Enable bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIE1_TMR2IE (1 << 1)
+/** PIE1 register TMR1 Overflow Interrupt Enable bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIE1_TMR1IE (1 << 0)
 
+/** PIR2 register EEPROM Write Operation Interrupt Flag bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIR2_EEIF (1 << 4)
+/** PIR2 register Bus Collision Interrupt Flag bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIR2_BCLIF (1 << 3)
+/** PIR2 register CCP2 Interrupt Flag bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIR2_CCP2IF (1 << 0)
+
+/** PIE2 register EEPROM Write Operation Interrupt Enable bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIE2_EEIE (1 << 4)
+/** PIE2 register Bus Collision Interrupt Enable bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIE2_BCLIE (1 << 3)
+/** PIE2 register CCP2 Interrupt Enable bit. */
+#define REGISTER_FILE_REGISTER_BIT_PIE2_CCP2IE (1 << 0)
+
+/** EECON1 register Program/Data EEPROM Select bit. */
+#define REGISTER_FILE_REGISTER_BIT_EECON1_EEPGD (1 << 7)
+/** EECON1 register EEPROM Error Flag bit. */
+#define REGISTER_FILE_REGISTER_BIT_EECON1_WRERR (1 << 3)
+/** EECON1 register EEPROM Write Enable bit. */
+#define REGISTER_FILE_REGISTER_BIT_EECON1_WREN (1 << 2)
+/** EECON1 register Write Control bit. */
+#define REGISTER_FILE_REGISTER_BIT_EECON1_WR (1 << 1)
+/** EECON1 register Read Control bit. */
+#define REGISTER_FILE_REGISTER_BIT_EECON1_RD (1 << 0)
+
+/** SSPCON2 register Acknowledge Status bit (In I2C Master Transmit mode only). */
+#define REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKSTAT (1 << 6)
+/** SSPCON2 register Acknowledge Data bit (In I2C Master Receive mode only). */
+#define REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKDT (1 << 5)
 /** SSPCON2 register Acknowledge Sequence Enable bit (In I2C Master mode only). */
 #define REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKEN (1 << 4)
 /** SSPCON2 register Receive Enable bit (In I 2 C Master mode only). */
@@ -108,17 +179,36 @@
 /** SSPCON2 register START Condition Enable bit (In I2C Master mode only). */
 #define REGISTER_FILE_REGISTER_BIT_SSPCON2_SEN (1 << 0)
 
+/** T2CON register Timer2 Output Postscale Select bits location. */
+#define REGISTER_FILE_REGISTER_BIT_T2CON_TOUTPS_SHIFT 3
+/** T2CON register Timer2 Output Postscale Select bits. */
+#define REGISTER_FILE_REGISTER_BIT_T2CON_TOUTPS_MASK (0x0F << REGISTER_FILE_REGISTER_BIT_T2CON_TOUTPS_SHIFT)
 /** T2CON register Timer2 On bit. */
 #define REGISTER_FILE_REGISTER_BIT_T2CON_TMR2ON (1 << 2)
+/** T2CON register Timer2 Clock Prescale Select bits. */
+#define REGISTER_FILE_REGISTER_BIT_T2CON_T2CKPS_MASK 0x03
 
 /** TXSTA register Transmit Enable bit. */
 #define REGISTER_FILE_REGISTER_BIT_TXSTA_TXEN (1 << 5)
+/** TXSTA register High Baud Rate Select bit. */
+#define REGISTER_FILE_REGISTER_BIT_TXSTA_BRGH (1 << 2)
 
+/** ADCON0 register A/D Conversion Clock Select bits location. */
+#define REGISTER_FILE_REGISTER_BIT_ADCON0_ADCS_SHIFT 6
+/** ADCON0 register A/D Conversion Clock Select bits. */
+#define REGISTER_FILE_REGISTER_BIT_ADCON0_ADCS_MASK (0x03 << REGISTER_FILE_REGISTER_BIT_ADCON0_ADCS_SHIFT)
+/** ADCON0 register Analog Channel Select bits location. */
+#define REGISTER_FILE_REGISTER_BIT_ADCON0_CHS_SHIFT 3
+/** ADCON0 register Analog Channel Select bits. */
+#define REGISTER_FILE_REGISTER_BIT_ADCON0_CHS_MASK (0x07 << REGISTER_FILE_REGISTER_BIT_ADCON0_CHS_SHIFT)
 /** ADCON0 register A/D Conversion Status bit. */
 #define REGISTER_FILE_REGISTER_BIT_ADCON0_GO (1 << 2)
 /** ADCON0 register A/D On bit. */
 #define REGISTER_FILE_REGISTER_BIT_ADCON0_ADON (1 << 0)
 
+/** ADCON1 register A/D Result Format Select bit. */
+#define REGISTER_FILE_REGISTER_BIT_ADCON1_ADFM (1 << 7)
+
 //-------------------------------------------------------------------------------------------------
 // Types
 //-------------------------------------------------------------------------------------------------
@@ -128,6 +218,7 @@ typedef union
 	unsigned char *Pointer_Data; //! Locate another data from another register.
 } TRegisterFileRegisterContent;
 
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
@@ -148,6 +239,24 @@ unsigned char RegisterFileBankedRead(unsigned int Address);
  */
 void RegisterFileBankedWrite(unsigned int Address, unsigned char Data);
 
+/** Get the location pointed by the STATUS register IRP bit and the FSR register, which is the register an INDF access reaches.
+ * @return The location (Bank * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + Address).
+ * @note The FSR and STATUS registers are only written by the CPU thread, so the core can call this function without locking the register file.
+ */
+unsigned int RegisterFileGetIndirectLocation(void);
+
+/** Read the register pointed by the STATUS register IRP bit and the FSR register, like reading INDF does but without looking for the current bank. The pointed register is read like a direct access would (mirrors, peripheral registers), reading INDF itself gives 0.
+ * @return The read data.
+ * @note This function is protected against concurrent access and can be used everywhere but in register callback functions.
+ */
+unsigned char RegisterFileIndirectRead(void);
+
+/** Write the register pointed by the STATUS register IRP bit and the FSR register, like writing INDF does but without looking for the current bank. The pointed register is written like a direct access would (mirrors, peripheral registers), writing INDF itself does nothing.
+ * @param Data The data to write.
+ * @note This function is protected against concurrent access and can be used everywhere but in register callback functions.
+ */
+void RegisterFileIndirectWrite(unsigned char Data);
+
 /** Read a byte from the specified address in the specified bank.
  * @param Bank The bank number.
  * @param Address The address to read from.
@@ -156,6 +265,39 @@ void RegisterFileBankedWrite(unsigned int Address, unsigned char Data);
  */
 unsigned char RegisterFileDirectRead(unsigned int Bank, unsigned int Address);
 
+/** Read a byte from the specified address in the specified bank without triggering the peripheral behavior attached to the register (like receiving the next UART byte when RCREG is read). This is intended for debugging tools.
+ * @param Bank The bank number.
+ * @param Address The address to read from.
+ * @return The register value, or 0 if the location does not exist.
+ * @note This function is protected against concurrent access and can be used everywhere but in register callback functions.
+ */
+unsigned char RegisterFileDirectPeek(unsigned int Bank, unsigned int Address);
+
+/** Get the location that really stores a register data. Registers mirrored in several banks all share the location of their bank 0 (or bank 1) register.
+ * @param Bank The bank number.
+ * @param Address The register address in the bank.
+ * @return The location storing the register data (Bank * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + Address).
+ */
+unsigned int RegisterFileGetPhysicalLocation(unsigned int Bank, unsigned int Address);
+
+/** Have WatchpointRecordAccess() called each time the program reads or writes a location, whatever the bank it uses to access it (INDF included). The other locations accesses are not slowed down.
+ * @param Location The physical location (see RegisterFileGetPhysicalLocation()).
+ * @param Is_Enabled Set to 1 to report the location accesses, set to 0 to stop reporting them.
+ */
+void RegisterFileHookAccesses(unsigned int Location, int Is_Enabled);
+
+/** Copy the content of all locations to a buffer, so the register file can be restored later. Mirrored locations do not store data, they are copied as 0.
+ * @param Pointer_Buffer On output, contain REGISTER_FILE_LOCATIONS_COUNT bytes.
+ * @note This function is protected against concurrent access and can be used everywhere but in register callback functions.
+ */
+void RegisterFileSaveSnapshot(unsigned char *Pointer_Buffer);
+
+/** Restore the content of all locations without calling the registers callbacks, then update the pending interrupts.
+ * @param Pointer_Buffer A buffer filled by RegisterFileSaveSnapshot().
+ * @note This function is protected against concurrent access and can be used everywhere but in register callback functions.
+ */
+void RegisterFileRestoreSnapshot(const unsigned char *Pointer_Buffer);
+
 /** Write a byte of data to the specified address in the specified bank.
  * @param Bank The bank number.
  * @param Address The address to write to.
@@ -183,10 +325,4 @@ void RegisterFileDirectWriteFromCallback(unsigned int Bank, unsigned int Address
 /** Dump the whole register file content. */
 void RegisterFileDump(void);
 
-/** Tell if an interrupt must be serviced or not.
- * @return 0 if no interrupt has fired,
- * @return 1 if the core must branch to the interrupt handler.
- */
-int RegisterFileHasInterruptFired(void);
-
 #endif
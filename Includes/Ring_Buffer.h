@@ -0,0 +1,67 @@
+/** @file Ring_Buffer.h
+ * Lock-free single producer/single consumer byte queue used to exchange data between threads.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_RING_BUFFER_H
+#define H_RING_BUFFER_H
+
+#include <stdatomic.h>
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** How many bytes a ring buffer can hold. This must be a power of two. */
+#define RING_BUFFER_SIZE 4096
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** A ring buffer. Only one thread can write to it and only one thread can read from it. */
+typedef struct
+{
+	unsigned char Buffer[RING_BUFFER_SIZE]; //! The stored data.
+	atomic_uint Read_Index; //! Where to read the next byte from (only modified by the consumer thread).
+	atomic_uint Write_Index; //! Where to write the next byte to (only modified by the producer thread).
+} TRingBuffer;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Empty a ring buffer.
+ * @param Pointer_Ring_Buffer The ring buffer to initialize.
+ * @note This function must not be called while the ring buffer is in use.
+ */
+void RingBufferInitialize(TRingBuffer *Pointer_Ring_Buffer);
+
+/** Append a byte to the ring buffer. Must be called by the producer thread only.
+ * @param Pointer_Ring_Buffer The ring buffer.
+ * @param Data The byte to append.
+ * @return 0 if the byte was appended,
+ * @return 1 if the ring buffer is full.
+ */
+int RingBufferWriteByte(TRingBuffer *Pointer_Ring_Buffer, unsigned char Data);
+
+/** Remove the oldest byte from the ring buffer. Must be called by the consumer thread only.
+ * @param Pointer_Ring_Buffer The ring buffer.
+ * @param Pointer_Data On output, contain the removed byte.
+ * @return 0 if a byte was removed,
+ * @return 1 if the ring buffer is empty.
+ */
+int RingBufferReadByte(TRingBuffer *Pointer_Ring_Buffer, unsigned char *Pointer_Data);
+
+/** Remove as many bytes as possible from the ring buffer. Must be called by the consumer thread only.
+ * @param Pointer_Ring_Buffer The ring buffer.
+ * @param Pointer_Buffer On output, contain the removed bytes.
+ * @param Buffer_Size The maximum amount of bytes to remove.
+ * @return How many bytes were removed.
+ */
+unsigned int RingBufferRead(TRingBuffer *Pointer_Ring_Buffer, unsigned char *Pointer_Buffer, unsigned int Buffer_Size);
+
+/** Tell whether the ring buffer contains data. Can be called from both producer and consumer threads.
+ * @param Pointer_Ring_Buffer The ring buffer.
+ * @return 1 if the ring buffer is empty,
+ * @return 0 if there is at least one byte to read.
+ */
+int RingBufferIsEmpty(TRingBuffer *Pointer_Ring_Buffer);
+
+#endif
@@ -0,0 +1,68 @@
+/** @file Snapshot.h
+ * Periodically save the whole board state, so the debugger can set the board back to a previous cycle and execute the same instructions again. Only the newest snapshot is fully stored, each older snapshot keeps the bytes that differ from the next one, so the snapshots memory stays bounded by their count.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_SNAPSHOT_H
+#define H_SNAPSHOT_H
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** How many snapshots are kept when the count is not provided. */
+#define SNAPSHOT_DEFAULT_COUNT 64
+
+//-------------------------------------------------------------------------------------------------
+// Variables
+//-------------------------------------------------------------------------------------------------
+/** Tell whether snapshots are taken. Use SnapshotIsEnabled() to access it. */
+extern int Snapshot_Is_Enabled;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Start taking snapshots and recording the UART received bytes. The oldest snapshot is discarded when a snapshot is taken while the snapshots ring is full.
+ * @param String_Parameters "Interval[:Count]" : Interval is how many cycles separate two snapshots, Count is how many snapshots are kept (SNAPSHOT_DEFAULT_COUNT if it is not provided).
+ * @return 0 if the snapshots were successfully enabled,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+int SnapshotInitialize(char *String_Parameters);
+
+/** Tell whether SnapshotUpdate() must be called.
+ * @return 0 if snapshots are disabled,
+ * @return 1 if snapshots are enabled.
+ */
+static inline int SnapshotIsEnabled(void)
+{
+	return Snapshot_Is_Enabled;
+}
+
+/** Take a snapshot if enough cycles have elapsed since the newest one. Must be called by the CPU thread only, before executing an instruction. */
+void SnapshotUpdate(void);
+
+/** Find the newest snapshot taken before a cycle.
+ * @param Cycles_Count The cycle.
+ * @return -1 if no snapshot was taken before this cycle,
+ * @return the snapshot index (0 is the oldest snapshot).
+ */
+int SnapshotFind(unsigned long long Cycles_Count);
+
+/** Tell when a snapshot was taken.
+ * @param Index The snapshot index.
+ * @return The cycles count when the snapshot was taken.
+ */
+unsigned long long SnapshotGetCyclesCount(int Index);
+
+/** Set the whole board back to a snapshot. The UART receives again the same bytes at the same cycles until the board reaches the furthest cycle it has executed. The board must be halted.
+ * @param Index The snapshot index.
+ */
+void SnapshotRestore(int Index);
+
+/** Tell that the board state has been modified by the debugger, so the instructions following the current cycle will not be executed like the first time. The snapshots and the UART received bytes recorded after the current cycle are discarded. The board must be halted.
+ * @note Nothing is done when the board has not been set back to a previous cycle.
+ */
+void SnapshotDiscardFuture(void);
+
+/** Forget the whole board history, because the executed instructions can't be executed again the same way (the program has been replaced for instance). The snapshots and the UART received bytes are discarded, the next snapshot is taken before the next instruction. Must be called by the CPU thread only, between two instructions. */
+void SnapshotDiscardAll(void);
+
+#endif
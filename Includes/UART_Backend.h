@@ -0,0 +1,59 @@
+/** @file UART_Backend.h
+ * Connect the simulated UART to a host communication channel. Bytes are exchanged with the CPU thread through lock-free queues, a dedicated I/O thread does all host accesses.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_UART_BACKEND_H
+#define H_UART_BACKEND_H
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** All available host channels. */
+typedef enum
+{
+	UART_BACKEND_TYPE_CONSOLE, //! Transmitted bytes are displayed on the standard output, received bytes are injected by the user interface.
+	UART_BACKEND_TYPE_PSEUDO_TERMINAL, //! A pseudo-terminal is created, a terminal emulator like screen or minicom can attach to it.
+	UART_BACKEND_TYPE_UNIX_SOCKET, //! A Unix domain stream socket is created, one client at a time can connect to it.
+	UART_BACKEND_TYPE_PIPE, //! A pair of named pipes, the first one feeds the UART reception, the second one receives the UART transmitted data.
+	UART_BACKEND_TYPE_NULL //! Transmitted bytes are discarded and nothing is ever received.
+} TUARTBackendType;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Open the host channel and start the I/O thread.
+ * @param Backend_Type The channel type.
+ * @param String_Path The Unix socket path for a socket backend, the reception and transmission pipes paths separated by a comma for a pipe backend. Unused for other backends.
+ * @return 0 if the backend was successfully started,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+int UARTBackendInitialize(TUARTBackendType Backend_Type, char *String_Path);
+
+/** Send all pending transmitted bytes, stop the I/O thread and close the host channel. */
+void UARTBackendUninitialize(void);
+
+/** Queue a byte transmitted by the PIC. Must be called by the CPU thread only, or by the virtual terminal render thread only when the virtual terminal is enabled.
+ * @param Data The transmitted byte.
+ * @note The function never blocks, the byte is discarded if the transmission queue is full (nobody reads the host channel). The discarded bytes count is logged when the backend is uninitialized.
+ */
+void UARTBackendWriteByte(unsigned char Data);
+
+/** Tell whether a byte is waiting to be received by the PIC. Must be called by the CPU thread only.
+ * @return 1 if at least one byte can be read,
+ * @return 0 if there is no received byte.
+ */
+int UARTBackendIsReceivedDataAvailable(void);
+
+/** Retrieve the oldest byte received from the host channel. Must be called by the CPU thread only.
+ * @param Pointer_Data On output, contain the received byte.
+ * @return 0 if a byte was retrieved,
+ * @return 1 if there is no received byte.
+ */
+int UARTBackendReadByte(unsigned char *Pointer_Data);
+
+/** Queue a byte for the PIC reception when the console backend is used. Must be called by the user interface thread only.
+ * @param Data The byte typed by the user.
+ */
+void UARTBackendInjectByte(unsigned char Data);
+
+#endif
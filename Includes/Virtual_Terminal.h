@@ -0,0 +1,69 @@
+/** @file Virtual_Terminal.h
+ * Interpret the ANSI escape sequences transmitted by the UART with a VT100 screen model. Instead of forwarding every transmitted byte, a render thread periodically sends to the UART backend only the characters that changed since the previous frame. The screen content can also be inspected without any terminal attached.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_VIRTUAL_TERMINAL_H
+#define H_VIRTUAL_TERMINAL_H
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** How many character rows the screen has. */
+#define VIRTUAL_TERMINAL_ROWS_COUNT 24
+/** How many characters a row has. */
+#define VIRTUAL_TERMINAL_COLUMNS_COUNT 80
+
+/** The highest allowed frame rate. */
+#define VIRTUAL_TERMINAL_MAXIMUM_FRAMES_PER_SECOND 100
+
+//-------------------------------------------------------------------------------------------------
+// Variables
+//-------------------------------------------------------------------------------------------------
+/** Tell whether the transmitted bytes go through the screen model. Use VirtualTerminalIsEnabled() to access it. */
+extern int Virtual_Terminal_Is_Enabled;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Clear the screen and start the render thread. The UART backend must be initialized.
+ * @param Frames_Per_Second How many times per second the screen changes are sent to the UART backend (from 1 to VIRTUAL_TERMINAL_MAXIMUM_FRAMES_PER_SECOND). Set to 0 to send nothing, the screen is then only maintained.
+ * @return 0 if the virtual terminal was successfully started,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+int VirtualTerminalInitialize(int Frames_Per_Second);
+
+/** Stop the render thread and send the last screen changes. Must be called before the UART backend is uninitialized, when the CPU thread does not execute instructions anymore. */
+void VirtualTerminalUninitialize(void);
+
+/** Tell whether the transmitted bytes must be given to VirtualTerminalWriteByte().
+ * @return 0 if the virtual terminal is disabled,
+ * @return 1 if the virtual terminal is enabled.
+ */
+static inline int VirtualTerminalIsEnabled(void)
+{
+	return Virtual_Terminal_Is_Enabled;
+}
+
+/** Interpret a byte transmitted by the PIC. Must be called by the CPU thread only.
+ * @param Data The transmitted byte.
+ */
+void VirtualTerminalWriteByte(unsigned char Data);
+
+/** Retrieve the characters displayed on a screen row.
+ * @param Row The row index (0 is the topmost row).
+ * @param String_Row On output, contain the row characters (trailing spaces are kept) terminated by a zero. Must be VIRTUAL_TERMINAL_COLUMNS_COUNT + 1 bytes large.
+ */
+void VirtualTerminalReadRow(int Row, char *String_Row);
+
+/** Tell whether a text is displayed on a screen row.
+ * @param Row The row index (0 is the topmost row).
+ * @param String_Text The text to search for.
+ * @return -1 if the text is not displayed on this row,
+ * @return the column the text starts at.
+ */
+int VirtualTerminalFindText(int Row, const char *String_Text);
+
+/** Write the screen content to the log file. */
+void VirtualTerminalDump(void);
+
+#endif
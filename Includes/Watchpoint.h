@@ -0,0 +1,76 @@
+/** @file Watchpoint.h
+ * Tell when the program reads or writes chosen register file locations, to find which code modifies a variable. Only the accesses to watched locations are slowed down.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_WATCHPOINT_H
+#define H_WATCHPOINT_H
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** Match any accessed value. */
+#define WATCHPOINT_VALUE_ANY -1
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** Which accesses trigger a watchpoint. */
+typedef enum
+{
+	WATCHPOINT_TYPE_READ = 1, //! The program reads the location.
+	WATCHPOINT_TYPE_WRITE = 2, //! The program writes the location.
+	WATCHPOINT_TYPE_ACCESS = WATCHPOINT_TYPE_READ | WATCHPOINT_TYPE_WRITE //! The program reads or writes the location.
+} TWatchpointType;
+
+/** What to do when a watchpoint triggers. */
+typedef enum
+{
+	WATCHPOINT_ACTION_LOG, //! Write the program counter and the cycles count to the log file.
+	WATCHPOINT_ACTION_HALT //! Halt the board after the accessing instruction, the debugger must resume it.
+} TWatchpointAction;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Watch a register file location. A watchpoint with the same action and value on the same location is extended with the new type, otherwise it is replaced.
+ * @param Location The physical location (see RegisterFileGetPhysicalLocation()).
+ * @param Type Which accesses trigger the watchpoint.
+ * @param Value Trigger only when this value is read or written, use WATCHPOINT_VALUE_ANY to trigger on any value.
+ * @param Action What to do when the watchpoint triggers.
+ * @return 0 if the watchpoint was set,
+ * @return 1 if the location can't be watched (INDF is not a real register).
+ */
+int WatchpointSet(unsigned int Location, TWatchpointType Type, int Value, TWatchpointAction Action);
+
+/** Parse a watchpoint description given on the command line and set a logging watchpoint.
+ * @param String_Description "Address[:Type][=Value]" : Address is the 9-bit register file address (Bank * 0x80 + register address), Type is "r", "w" (the default) or "rw", Value is the value to match.
+ * @return 0 if the watchpoint was set,
+ * @return 1 if the description is invalid. See logs for more information.
+ */
+int WatchpointSetFromString(char *String_Description);
+
+/** Stop watching some accesses to a location.
+ * @param Location The physical location.
+ * @param Type The accesses to stop watching.
+ */
+void WatchpointRemove(unsigned int Location, TWatchpointType Type);
+
+/** Remove all watchpoints doing a specific action.
+ * @param Action The action.
+ */
+void WatchpointRemoveAll(TWatchpointAction Action);
+
+/** Tell which watchpoint halted the board the last time.
+ * @param Pointer_Location On output, contain the accessed physical location.
+ * @param Pointer_Type On output, contain WATCHPOINT_TYPE_READ or WATCHPOINT_TYPE_WRITE if only this kind of access is watched, or WATCHPOINT_TYPE_ACCESS.
+ */
+void WatchpointGetLastHit(unsigned int *Pointer_Location, TWatchpointType *Pointer_Type);
+
+/** Called by the register file when the program accesses a watched location.
+ * @param Location The physical location.
+ * @param Is_Write Set to 1 if the location is written, set to 0 if it is read.
+ * @param Data The read or written data.
+ */
+void WatchpointRecordAccess(unsigned int Location, int Is_Write, unsigned char Data);
+
+#endif
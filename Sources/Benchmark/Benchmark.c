@@ -0,0 +1,425 @@
+/** @file Benchmark.c
+ * Measure the simulator speed by running canned PIC programs unthrottled for a fixed instruction cycles budget.
+ * @author Adrien RICCIARDI
+ */
+#include <Core.h>
+#include <Log.h>
+#include <Peripheral_ADC.h>
+#include <Peripheral_Data_EEPROM.h>
+#include <Peripheral_I2C_EEPROM.h>
+#include <Peripheral_Memory_Access.h>
+#include <Peripheral_Timer.h>
+#include <Peripheral_UART.h>
+#include <Program_Memory.h>
+#include <Register_File.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <UART_Backend.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** How many instruction cycles each benchmark runs for when no budget is provided. */
+#define BENCHMARK_DEFAULT_CYCLES_COUNT 20000000ULL
+
+/** Only one main loop iteration out of this value is timed subsystem by subsystem, so reading the clock does not hide the measured code. This must be a power of two. */
+#define BENCHMARK_SAMPLING_PERIOD 64
+
+/** How many clock reads are averaged to find out the clock read duration. */
+#define BENCHMARK_CLOCK_CALIBRATION_READS_COUNT 100000
+
+/** The value of an erased program memory location. */
+#define BENCHMARK_ERASED_PROGRAM_MEMORY_VALUE 0x3FFF
+
+/** The real PIC instruction cycle duration (in nanoseconds), used to tell how much faster than the real hardware the simulator is. */
+#define BENCHMARK_REAL_INSTRUCTION_CYCLE_TIME 1000
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** All timed subsystems, in their main loop execution order. */
+typedef enum
+{
+	BENCHMARK_SUBSYSTEM_CORE,
+	BENCHMARK_SUBSYSTEM_TIMER,
+	BENCHMARK_SUBSYSTEM_UART,
+	BENCHMARK_SUBSYSTEM_ADC,
+	BENCHMARK_SUBSYSTEM_MEMORY_ACCESS,
+	BENCHMARK_SUBSYSTEMS_COUNT
+} TBenchmarkSubsystem;
+
+/** A canned program. */
+typedef struct
+{
+	char *String_Name; //! The name displayed in the report.
+	const unsigned short *Pointer_Instructions; //! The program, starting from the reset vector.
+	unsigned int Instructions_Count; //! How many instructions the program is made of.
+} TBenchmark;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** Arithmetic and logic instructions on RAM registers in a tight loop. */
+static const unsigned short Benchmark_Program_ALU[] =
+{
+	0x2805, // goto start
+	0x0000, // nop
+	0x0000, // nop
+	0x0000, // nop
+	0x0009, // retfie
+	0x3001, // start: movlw 1
+	0x07A0, // loop: addwf 0x20,f
+	0x0AA1, // incf 0x21,f
+	0x06A2, // xorwf 0x22,f
+	0x0DA3, // rlf 0x23,f
+	0x0BA4, // decfsz 0x24,f
+	0x2806, // goto loop
+	0x2806 // goto loop
+};
+
+/** Walk a 16-entry RETLW table through computed gotos on PCL. */
+static const unsigned short Benchmark_Program_RETLW_Table[] =
+{
+	0x2805, // goto start
+	0x0000, // nop
+	0x0000, // nop
+	0x0000, // nop
+	0x0009, // retfie
+	0x01A0, // start: clrf 0x20
+	0x0820, // loop: movf 0x20,w
+	0x200D, // call table
+	0x07A1, // addwf 0x21,f
+	0x0AA0, // incf 0x20,f
+	0x300F, // movlw 15
+	0x05A0, // andwf 0x20,f
+	0x2806, // goto loop
+	0x0782, // table: addwf 2,f
+	0x3400, // retlw 0
+	0x3401, // retlw 1
+	0x3402, // retlw 2
+	0x3403, // retlw 3
+	0x3404, // retlw 4
+	0x3405, // retlw 5
+	0x3406, // retlw 6
+	0x3407, // retlw 7
+	0x3408, // retlw 8
+	0x3409, // retlw 9
+	0x340A, // retlw 10
+	0x340B, // retlw 11
+	0x340C, // retlw 12
+	0x340D, // retlw 13
+	0x340E, // retlw 14
+	0x340F // retlw 15
+};
+
+/** Copy 16 bytes from bank 0 to bank 1 through INDF and FSR, in loop. */
+static const unsigned short Benchmark_Program_INDF_Copy[] =
+{
+	0x2805, // goto start
+	0x0000, // nop
+	0x0000, // nop
+	0x0000, // nop
+	0x0009, // retfie
+	0x3020, // start: movlw 0x20
+	0x0084, // movwf 4
+	0x3010, // movlw 16
+	0x00F0, // movwf 0x70
+	0x0800, // copy: movf 0,w
+	0x00F1, // movwf 0x71
+	0x1784, // bsf 4,7
+	0x0871, // movf 0x71,w
+	0x0080, // movwf 0
+	0x1384, // bcf 4,7
+	0x0A84, // incf 4,f
+	0x0BF0, // decfsz 0x70,f
+	0x2809, // goto copy
+	0x2805 // goto start
+};
+
+/** Read the whole I2C EEPROM in loop with sequential reads. */
+static const unsigned short Benchmark_Program_I2C_EEPROM_Read[] =
+{
+	0x2805, // goto start
+	0x0000, // nop
+	0x0000, // nop
+	0x0000, // nop
+	0x0009, // retfie
+	0x1683, // start: bsf 3,5
+	0x1411, // bsf 0x11,0
+	0x1283, // bcf 3,5
+	0x30A0, // movlw 0xA0
+	0x0093, // movwf 0x13
+	0x0100, // clrw
+	0x0093, // movwf 0x13
+	0x0093, // movwf 0x13
+	0x1683, // bsf 3,5
+	0x1491, // bsf 0x11,1
+	0x1283, // bcf 3,5
+	0x30A1, // movlw 0xA1
+	0x0093, // movwf 0x13
+	0x1683, // loop: bsf 3,5
+	0x1591, // bsf 0x11,3
+	0x1283, // bcf 3,5
+	0x0813, // movf 0x13,w
+	0x00A0, // movwf 0x20
+	0x1683, // bsf 3,5
+	0x1291, // bcf 0x11,5
+	0x1611, // bsf 0x11,4
+	0x1283, // bcf 3,5
+	0x2812 // goto loop
+};
+
+/** Transmit bytes on the UART as fast as TXIF allows. */
+static const unsigned short Benchmark_Program_UART_Flood[] =
+{
+	0x2805, // goto start
+	0x0000, // nop
+	0x0000, // nop
+	0x0000, // nop
+	0x0009, // retfie
+	0x1683, // start: bsf 3,5
+	0x3024, // movlw 0x24
+	0x0098, // movwf 0x18
+	0x1283, // bcf 3,5
+	0x1E0C, // loop: btfss 0x0C,4
+	0x2809, // goto loop
+	0x3055, // movlw 0x55
+	0x0099, // movwf 0x19
+	0x2809 // goto loop
+};
+
+/** Run a counter loop interrupted by timer 0 every 256 cycles and by timer 2 every 16 cycles. */
+static const unsigned short Benchmark_Program_Timer_Interrupts[] =
+{
+	0x2808, // goto start
+	0x0000, // nop
+	0x0000, // nop
+	0x0000, // nop
+	0x110B, // interrupt: bcf 0x0B,2
+	0x108C, // bcf 0x0C,1
+	0x0AF0, // incf 0x70,f
+	0x0009, // retfie
+	0x1683, // start: bsf 3,5
+	0x3008, // movlw 0x08
+	0x0081, // movwf 1
+	0x300F, // movlw 15
+	0x0092, // movwf 0x12
+	0x148C, // bsf 0x0C,1
+	0x1283, // bcf 3,5
+	0x3004, // movlw 0x04
+	0x0092, // movwf 0x12
+	0x30E0, // movlw 0xE0
+	0x008B, // movwf 0x0B
+	0x0AA0, // loop: incf 0x20,f
+	0x2813 // goto loop
+};
+
+/** All benchmarks, run in this order. */
+static TBenchmark Benchmarks[] =
+{
+	{ "ALU loop", Benchmark_Program_ALU, sizeof(Benchmark_Program_ALU) / sizeof(Benchmark_Program_ALU[0]) },
+	{ "RETLW table walk", Benchmark_Program_RETLW_Table, sizeof(Benchmark_Program_RETLW_Table) / sizeof(Benchmark_Program_RETLW_Table[0]) },
+	{ "INDF/FSR memory copy", Benchmark_Program_INDF_Copy, sizeof(Benchmark_Program_INDF_Copy) / sizeof(Benchmark_Program_INDF_Copy[0]) },
+	{ "I2C EEPROM bulk read", Benchmark_Program_I2C_EEPROM_Read, sizeof(Benchmark_Program_I2C_EEPROM_Read) / sizeof(Benchmark_Program_I2C_EEPROM_Read[0]) },
+	{ "UART output flood", Benchmark_Program_UART_Flood, sizeof(Benchmark_Program_UART_Flood) / sizeof(Benchmark_Program_UART_Flood[0]) },
+	{ "Timer interrupts", Benchmark_Program_Timer_Interrupts, sizeof(Benchmark_Program_Timer_Interrupts) / sizeof(Benchmark_Program_Timer_Interrupts[0]) }
+};
+
+/** The subsystems names displayed in the report. */
+static char *String_Benchmark_Subsystem_Names[BENCHMARK_SUBSYSTEMS_COUNT] =
+{
+	"core",
+	"timers",
+	"UART",
+	"ADC",
+	"memory access"
+};
+
+/** How long reading the clock takes (in nanoseconds), it is removed from each subsystem measure. */
+static unsigned long long Benchmark_Clock_Read_Time;
+
+/** The UART state before any program is run. */
+static TPeripheralUARTSnapshot Benchmark_UART_Initial_State;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Read the host monotonic clock.
+ * @return The current time in nanoseconds.
+ */
+static inline unsigned long long BenchmarkGetTime(void)
+{
+	struct timespec Time;
+	
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+	return (unsigned long long) Time.tv_sec * 1000000000ULL + Time.tv_nsec;
+}
+
+/** Find out how long a clock read takes. */
+static void BenchmarkCalibrateClock(void)
+{
+	unsigned long long Start_Time;
+	int i;
+	
+	Start_Time = BenchmarkGetTime();
+	for (i = 0; i < BENCHMARK_CLOCK_CALIBRATION_READS_COUNT; i++) BenchmarkGetTime();
+	Benchmark_Clock_Read_Time = (BenchmarkGetTime() - Start_Time) / BENCHMARK_CLOCK_CALIBRATION_READS_COUNT;
+}
+
+/** Load a canned program and reset the simulated microcontroller.
+ * @param Pointer_Benchmark The benchmark to load.
+ */
+static void BenchmarkLoadProgram(TBenchmark *Pointer_Benchmark)
+{
+	unsigned int Address;
+	
+	for (Address = 0; Address < PROGRAM_MEMORY_SIZE; Address++)
+	{
+		if (Address < Pointer_Benchmark->Instructions_Count) ProgramMemoryWrite(Address, Pointer_Benchmark->Pointer_Instructions[Address]);
+		else ProgramMemoryWrite(Address, BENCHMARK_ERASED_PROGRAM_MEMORY_VALUE);
+	}
+	
+	RegisterFileInitialize();
+	PeripheralUARTRestoreSnapshot(&Benchmark_UART_Initial_State); // The cycles count restarts from 0, the UART must not wait for a cycle of the previous benchmark
+	CoreReset();
+}
+
+/** Run a benchmark and display its results.
+ * @param Pointer_Benchmark The benchmark to run.
+ * @param Cycles_Count How many instruction cycles to execute.
+ * @return The benchmark duration in nanoseconds.
+ */
+static unsigned long long BenchmarkRun(TBenchmark *Pointer_Benchmark, unsigned long long Cycles_Count)
+{
+	unsigned long long Start_Time, Elapsed_Time, Subsystem_Times[BENCHMARK_SUBSYSTEMS_COUNT] = {0}, Sampled_Time = 0, Times[BENCHMARK_SUBSYSTEMS_COUNT + 1], Time;
+	unsigned int Iteration = 0, Cycles;
+	int i;
+	
+	BenchmarkLoadProgram(Pointer_Benchmark);
+	
+	Start_Time = BenchmarkGetTime();
+	while (CoreGetCyclesCount() < Cycles_Count)
+	{
+		// Run at full speed most of the time
+		Iteration++;
+		if (Iteration & (BENCHMARK_SAMPLING_PERIOD - 1))
+		{
+			Cycles = CoreExecuteNextInstruction();
+			PeripheralTimerIncrement(Cycles);
+			PeripheralUARTUpdate();
+			PeripheralADCUpdate();
+			PeripheralMemoryAccessUpdate();
+			continue;
+		}
+		
+		// Time each subsystem (this is the same sequence than the simulator main loop)
+		Times[BENCHMARK_SUBSYSTEM_CORE] = BenchmarkGetTime();
+		Cycles = CoreExecuteNextInstruction();
+		Times[BENCHMARK_SUBSYSTEM_TIMER] = BenchmarkGetTime();
+		PeripheralTimerIncrement(Cycles);
+		Times[BENCHMARK_SUBSYSTEM_UART] = BenchmarkGetTime();
+		PeripheralUARTUpdate();
+		Times[BENCHMARK_SUBSYSTEM_ADC] = BenchmarkGetTime();
+		PeripheralADCUpdate();
+		Times[BENCHMARK_SUBSYSTEM_MEMORY_ACCESS] = BenchmarkGetTime();
+		PeripheralMemoryAccessUpdate();
+		Times[BENCHMARK_SUBSYSTEMS_COUNT] = BenchmarkGetTime();
+		
+		for (i = 0; i < BENCHMARK_SUBSYSTEMS_COUNT; i++)
+		{
+			Time = Times[i + 1] - Times[i];
+			if (Time > Benchmark_Clock_Read_Time) Time -= Benchmark_Clock_Read_Time;
+			else Time = 0;
+			Subsystem_Times[i] += Time;
+			Sampled_Time += Time;
+		}
+	}
+	Elapsed_Time = BenchmarkGetTime() - Start_Time;
+	if (Elapsed_Time == 0) Elapsed_Time = 1;
+	if (Sampled_Time == 0) Sampled_Time = 1;
+	
+	// Display the results
+	printf("%-22s %10.2f %14.2f %12.1f %10.1f  ", Pointer_Benchmark->String_Name, (double) Cycles_Count * 1000.0 / Elapsed_Time, (double) Elapsed_Time / Cycles_Count, (double) Elapsed_Time / 1000000.0, (double) Cycles_Count * BENCHMARK_REAL_INSTRUCTION_CYCLE_TIME / Elapsed_Time);
+	for (i = 0; i < BENCHMARK_SUBSYSTEMS_COUNT; i++) printf(" %s %4.1f%%", String_Benchmark_Subsystem_Names[i], (double) Subsystem_Times[i] * 100.0 / Sampled_Time);
+	putchar('\n');
+	
+	return Elapsed_Time;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Entry point
+//-------------------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+	unsigned long long Cycles_Count = BENCHMARK_DEFAULT_CYCLES_COUNT, Total_Time = 0;
+	unsigned int i;
+	TCoreEngine Core_Engine = CORE_ENGINE_INTERPRETER;
+	
+	// Check parameters
+	if (argc > 3)
+	{
+		printf("Usage : %s [Cycles_Count [Core_Engine]]\n"
+			"  Cycles_Count : how many instruction cycles each benchmark runs for (default is %llu).\n"
+			"  Core_Engine : interpreter (the default), predecoded or lockstep, see the simulator -e option.\n", argv[0], BENCHMARK_DEFAULT_CYCLES_COUNT);
+		return EXIT_FAILURE;
+	}
+	if ((argc >= 2) && ((sscanf(argv[1], "%llu", &Cycles_Count) != 1) || (Cycles_Count == 0)))
+	{
+		printf("Error : the cycles count must be a positive integer.\n");
+		return EXIT_FAILURE;
+	}
+	if (argc == 3)
+	{
+		if (strcmp(argv[2], "interpreter") == 0) Core_Engine = CORE_ENGINE_INTERPRETER;
+		else if (strcmp(argv[2], "predecoded") == 0) Core_Engine = CORE_ENGINE_PREDECODED;
+		else if (strcmp(argv[2], "lockstep") == 0) Core_Engine = CORE_ENGINE_LOCKSTEP;
+		else
+		{
+			printf("Error : unknown core engine '%s'.\n", argv[2]);
+			return EXIT_FAILURE;
+		}
+	}
+	
+	// Initialize subsystems, only errors are logged to keep the logging cost the same than a normal simulator run
+	LogInitialize("/dev/null", LOG_LEVEL_ERROR);
+	RegisterFileInitialize();
+	if (PeripheralADCInitialize(PERIPHERAL_ADC_SAMPLE_SOURCE_CONSTANT, "512") != 0)
+	{
+		printf("Error : failed to initialize the ADC sample source.\n");
+		return EXIT_FAILURE;
+	}
+	// Use blank private EEPROMs
+	if ((PeripheralI2CEEPROMInitialize("/dev/null", 1) != 0) || (PeripheralDataEEPROMInitialize("/dev/null", 1) != 0))
+	{
+		printf("Error : failed to initialize the EEPROMs.\n");
+		return EXIT_FAILURE;
+	}
+	if (UARTBackendInitialize(UART_BACKEND_TYPE_NULL, NULL) != 0)
+	{
+		printf("Error : failed to start the UART backend.\n");
+		return EXIT_FAILURE;
+	}
+	PeripheralUARTSaveSnapshot(&Benchmark_UART_Initial_State);
+	CoreEnableThrottling(0);
+	CoreSetEngine(Core_Engine);
+	BenchmarkCalibrateClock();
+	
+	// Run all benchmarks
+	printf("Running each benchmark for %llu instruction cycles.\n", Cycles_Count);
+	printf("%-22s %10s %14s %12s %10s   %s\n", "Benchmark", "MIPS", "ns/instruction", "Time (ms)", "Real time", "Time per subsystem");
+	for (i = 0; i < sizeof(Benchmarks) / sizeof(Benchmarks[0]); i++) Total_Time += BenchmarkRun(&Benchmarks[i], Cycles_Count);
+	printf("%-22s %10.2f\n", "Average", (double) Cycles_Count * i * 1000.0 / Total_Time);
+	
+	UARTBackendUninitialize();
+	PeripheralDataEEPROMUninitialize();
+	PeripheralI2CEEPROMUninitialize();
+	
+	if (CoreIsDivergenceFound())
+	{
+		printf("Error : the core engines diverged.\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -3,9 +3,15 @@
  * @author Adrien RICCIARDI
  */
 #include <Core.h>
+#include <Coverage.h>
+#include <Disassembler.h>
+#include <Instrumentation.h>
+#include <Interrupt_Controller.h>
 #include <Log.h>
 #include <Program_Memory.h>
 #include <Register_File.h>
+#include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 //-------------------------------------------------------------------------------------------------
@@ -18,8 +24,112 @@
 /** The Zero flag was affected by the last operation. */
 #define CORE_AFFECTED_FLAG_ZERO (1 << 2)
 
-/** The needed time for the PIC core to execute an instruction (in nanoseconds). Two-cycle instructions are not taken into account. */
-#define CORE_INSTRUCTION_EXECUTION_TIME 1000 // Tcy = Fosc/4, on the Text Games System Fosc = 4MHz
+/** How many oscillator periods an instruction cycle lasts (Tcy = 4 Tosc). */
+#define CORE_OSCILLATOR_PERIODS_PER_INSTRUCTION_CYCLE 4
+
+/** How late the pacing can be before it gives up catching up with the real time (in nanoseconds). */
+#define CORE_MAXIMUM_PACING_DELAY 10000000LL
+
+/** How many register file accesses an instruction can do (RRF and RLF do 5 of them). */
+#define CORE_MAXIMUM_REGISTER_ACCESSES_COUNT 8
+
+/** How many of the last executed instructions are displayed when the lockstep engines diverge. This must be a power of two. */
+#define CORE_LOCKSTEP_TRACE_WINDOW_SIZE 16
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** All operations the predecoded engine can execute. */
+typedef enum
+{
+	CORE_OPERATION_NOP, // Must be zero, so a zeroed decoded instruction is a valid decoded NOP
+	CORE_OPERATION_RETURN,
+	CORE_OPERATION_RETFIE,
+	CORE_OPERATION_CLRW,
+	CORE_OPERATION_BCF,
+	CORE_OPERATION_BSF,
+	CORE_OPERATION_BTFSC,
+	CORE_OPERATION_BTFSS,
+	CORE_OPERATION_MOVWF,
+	CORE_OPERATION_CLRF,
+	CORE_OPERATION_SUBWF,
+	CORE_OPERATION_DECF,
+	CORE_OPERATION_IORWF,
+	CORE_OPERATION_ANDWF,
+	CORE_OPERATION_XORWF,
+	CORE_OPERATION_ADDWF,
+	CORE_OPERATION_MOVF,
+	CORE_OPERATION_COMF,
+	CORE_OPERATION_INCF,
+	CORE_OPERATION_DECFSZ,
+	CORE_OPERATION_RRF,
+	CORE_OPERATION_RLF,
+	CORE_OPERATION_SWAPF,
+	CORE_OPERATION_INCFSZ,
+	CORE_OPERATION_CALL,
+	CORE_OPERATION_GOTO,
+	CORE_OPERATION_MOVLW,
+	CORE_OPERATION_RETLW,
+	CORE_OPERATION_IORLW,
+	CORE_OPERATION_ANDLW,
+	CORE_OPERATION_XORLW,
+	CORE_OPERATION_SUBLW,
+	CORE_OPERATION_ADDLW,
+	CORE_OPERATION_UNKNOWN
+} TCoreOperation;
+
+/** An instruction decoded by the predecoded engine. */
+typedef struct
+{
+	unsigned short Instruction; //! The instruction code the entry has been decoded from.
+	unsigned char Operation; //! The operation to execute (a TCoreOperation value stored on a byte to keep the entries small).
+	unsigned char Modifier; //! The tested or modified bit mask for bit-oriented operations, the destination (0 for W, 1 for the file register) for byte-oriented operations.
+	unsigned short Operand; //! The file register address, the literal or the branch address.
+} TCoreDecodedInstruction;
+
+/** An instruction execution function.
+ * @param Instruction The fetched instruction code, the program counter still points to it.
+ */
+typedef void (*TCoreInstructionExecutor)(unsigned short Instruction);
+
+/** How the engines access the register file. */
+typedef enum
+{
+	CORE_REGISTER_ACCESS_MODE_DIRECT, //! Access the register file.
+	CORE_REGISTER_ACCESS_MODE_RECORD, //! Access the register file and record the accesses.
+	CORE_REGISTER_ACCESS_MODE_REPLAY //! Do not access the register file, reads get the data the recorded reads got and writes are only recorded.
+} TCoreRegisterAccessMode;
+
+/** A register file access done by an instruction. */
+typedef struct
+{
+	unsigned char Is_Write; //! Set to 1 for a write, set to 0 for a read.
+	unsigned char Address; //! The address in the current bank.
+	unsigned char Data; //! The read or written data.
+	unsigned char Is_Replayed; //! Tell whether a replaying engine already got this read data.
+} TCoreRegisterAccess;
+
+/** What an engine did when executing an instruction. */
+typedef struct
+{
+	TCoreState State; //! The core state after the instruction execution.
+	int Is_PCL_Written; //! Tell whether the instruction wrote to PCL.
+	unsigned short Written_Program_Counter; //! The program counter value loaded by the PCL write.
+	TCoreRegisterAccess Register_Accesses[CORE_MAXIMUM_REGISTER_ACCESSES_COUNT]; //! The register file accesses, in execution order.
+	int Register_Accesses_Count; //! How many register file accesses were done, only the first CORE_MAXIMUM_REGISTER_ACCESSES_COUNT ones are stored.
+	int Is_Replay_Failed; //! Set to 1 when the replaying engine read a register the recording engine did not read.
+	unsigned int Stalled_Cycles_Count; //! How many cycles the peripherals stalled the core for because of the recorded register writes (they are included in the lost cycles).
+} TCoreLockstepResult;
+
+/** An instruction executed in lockstep mode. */
+typedef struct
+{
+	unsigned long long Cycles_Count; //! The cycles count when the instruction was executed.
+	unsigned short Address; //! The instruction address.
+	unsigned short Instruction; //! The instruction code.
+	unsigned char Register_W; //! The working register value after the instruction execution.
+	unsigned char Register_STATUS; //! The STATUS register value after the instruction execution.
+} TCoreLockstepTraceEntry;
 
 //-------------------------------------------------------------------------------------------------
 // Private variables
@@ -33,12 +143,75 @@ static int Core_Stack_Pointer = 0;
 static unsigned char Core_Register_W;
 
 /** The program counter. */
-// TODO update program counter if PCL register is explicitly written
 static unsigned short Core_Program_Counter = 0;
 
+/** Tell whether the executed instruction wrote to PCL. */
+static int Core_Is_PCL_Written = 0;
+/** The program counter value loaded by a PCL write. */
+static unsigned short Core_Written_Program_Counter;
+
+/** How many extra instruction cycles the executed instruction costs (a 2-cycle instruction or a peripheral stall). */
+static unsigned int Core_Lost_Cycles_Count = 0;
+
+/** How many instruction cycles have been executed. */
+static unsigned long long Core_Cycles_Count = 0;
+
+/** Tell whether instructions execution is slowed down to the real PIC speed. */
+static int Core_Is_Throttling_Enabled = 1;
+
+/** The simulated oscillator frequency (in Hz). */
+static unsigned int Core_Oscillator_Frequency = CORE_DEFAULT_OSCILLATOR_FREQUENCY;
+/** How fast the simulated time goes compared to the real time, 0 means as fast as possible. */
+static double Core_Time_Scale = 1;
+/** How long an instruction cycle lasts on the host (in nanoseconds), with the time scale applied. */
+static long Core_Paced_Instruction_Cycle_Time = 1000;
+/** Tell whether the core waits after each instruction, which depends on both the throttling and the time scale. */
+static int Core_Is_Pacing_Enabled = 1;
+/** The host time the executed instructions must end at (in nanoseconds), 0 to start pacing again from the current time. */
+static long long Core_Pacing_Deadline = 0;
+
+/** The function called before each instruction is executed, or NULL if instructions are not traced. */
+static TCoreTraceCallback Core_Trace_Callback = NULL;
+
+/** The engine executing the instructions. */
+static TCoreEngine Core_Engine = CORE_ENGINE_INTERPRETER;
+
+/** The predecoded engine instructions, indexed by program memory address. An entry is decoded again as soon as the fetched instruction code does not match its code anymore, so program memory writes need no special handling. */
+static TCoreDecodedInstruction Core_Decoded_Instructions[PROGRAM_MEMORY_SIZE];
+
+/** How the engines access the register file. */
+static TCoreRegisterAccessMode Core_Register_Access_Mode = CORE_REGISTER_ACCESS_MODE_DIRECT;
+/** Where the register file accesses are recorded when the accesses mode is not direct. */
+static TCoreLockstepResult *Pointer_Core_Lockstep_Result;
+
+/** The interpreter results of the instruction executed in lockstep mode, the predecoded engine replays its reads. */
+static TCoreLockstepResult Core_Lockstep_Reference_Result;
+/** The predecoded engine results of the instruction executed in lockstep mode. */
+static TCoreLockstepResult Core_Lockstep_Candidate_Result;
+
+/** The last instructions executed in lockstep mode. */
+static TCoreLockstepTraceEntry Core_Lockstep_Trace_Window[CORE_LOCKSTEP_TRACE_WINDOW_SIZE];
+/** How many instructions have been executed in lockstep mode. */
+static unsigned int Core_Lockstep_Executed_Instructions_Count = 0;
+/** The location INDF pointed to when the instruction executed in lockstep mode started, the replaying engine can't look at FSR because the recording engine already executed the instruction. */
+static unsigned int Core_Lockstep_Indirect_Location;
+
+/** Tell whether the engines executed an instruction differently in lockstep mode. */
+static int Core_Is_Divergence_Found = 0;
+
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
+/** Compute how long the core waits after each instruction from the oscillator frequency, the time scale and the throttling state. */
+static void CoreUpdatePacing(void)
+{
+	// 0 means as fast as possible
+	if (Core_Time_Scale == 0) Core_Paced_Instruction_Cycle_Time = 0;
+	else Core_Paced_Instruction_Cycle_Time = (long) (1000000000.0 * CORE_OSCILLATOR_PERIODS_PER_INSTRUCTION_CYCLE / Core_Oscillator_Frequency / Core_Time_Scale + 0.5);
+	Core_Is_Pacing_Enabled = Core_Is_Throttling_Enabled && (Core_Paced_Instruction_Cycle_Time > 0);
+	Core_Pacing_Deadline = 0;
+}
+
 /** Add data on the stack top. Recurse on stack overflow.
  * @param Data The data to push.
  */
@@ -69,6 +242,169 @@ static unsigned short CoreStackPop(void)
 	return Core_Stack[Core_Stack_Pointer];
 }
 
+/** Record a register file access of the executed instruction.
+ * @param Is_Write Set to 1 for a write, set to 0 for a read.
+ * @param Address The address in the current bank.
+ * @param Data The read or written data.
+ */
+static void CoreRecordRegisterAccess(int Is_Write, unsigned char Address, unsigned char Data)
+{
+	TCoreRegisterAccess *Pointer_Access;
+	
+	// Keep counting the accesses that do not fit, so the results comparison still sees them
+	if (Pointer_Core_Lockstep_Result->Register_Accesses_Count < CORE_MAXIMUM_REGISTER_ACCESSES_COUNT)
+	{
+		Pointer_Access = &Pointer_Core_Lockstep_Result->Register_Accesses[Pointer_Core_Lockstep_Result->Register_Accesses_Count];
+		Pointer_Access->Is_Write = Is_Write;
+		Pointer_Access->Address = Address;
+		Pointer_Access->Data = Data;
+		Pointer_Access->Is_Replayed = 0;
+	}
+	Pointer_Core_Lockstep_Result->Register_Accesses_Count++;
+}
+
+/** Find the data the recording engine read from a register. The reads of a same register are replayed in the order they were recorded.
+ * @param Address The address in the current bank.
+ * @param Pointer_Data On output, contain the read data.
+ * @return 0 if the recording engine read the register,
+ * @return 1 if the recording engine did not read the register (or not so many times).
+ */
+static int CoreReplayRegisterRead(unsigned char Address, unsigned char *Pointer_Data)
+{
+	TCoreRegisterAccess *Pointer_Access;
+	int i, Accesses_Count;
+	
+	Accesses_Count = Core_Lockstep_Reference_Result.Register_Accesses_Count;
+	if (Accesses_Count > CORE_MAXIMUM_REGISTER_ACCESSES_COUNT) Accesses_Count = CORE_MAXIMUM_REGISTER_ACCESSES_COUNT;
+	
+	for (i = 0; i < Accesses_Count; i++)
+	{
+		Pointer_Access = &Core_Lockstep_Reference_Result.Register_Accesses[i];
+		if (Pointer_Access->Is_Write || Pointer_Access->Is_Replayed || (Pointer_Access->Address != Address)) continue;
+		
+		Pointer_Access->Is_Replayed = 1;
+		*Pointer_Data = Pointer_Access->Data;
+		return 0;
+	}
+	return 1;
+}
+
+/** Read a register from the current bank, the way the register access mode tells.
+ * @param Address The address bits 6..0, bits 8..7 are located in the STATUS register.
+ * @return The read data.
+ */
+static inline unsigned char CoreBankedRead(unsigned char Address)
+{
+	unsigned char Data = 0;
+	
+	if (Core_Register_Access_Mode == CORE_REGISTER_ACCESS_MODE_DIRECT) return RegisterFileBankedRead(Address);
+	
+	if (Core_Register_Access_Mode == CORE_REGISTER_ACCESS_MODE_RECORD) Data = RegisterFileBankedRead(Address);
+	else if (CoreReplayRegisterRead(Address, &Data) != 0) Pointer_Core_Lockstep_Result->Is_Replay_Failed = 1;
+	CoreRecordRegisterAccess(0, Address, Data);
+	return Data;
+}
+
+/** Write a register from the current bank, the way the register access mode tells.
+ * @param Address The address bits 6..0, bits 8..7 are located in the STATUS register.
+ * @param Data The data to write.
+ */
+static inline void CoreBankedWrite(unsigned char Address, unsigned char Data)
+{
+	if (Core_Register_Access_Mode == CORE_REGISTER_ACCESS_MODE_DIRECT)
+	{
+		RegisterFileBankedWrite(Address, Data);
+		return;
+	}
+	
+	if (Core_Register_Access_Mode == CORE_REGISTER_ACCESS_MODE_RECORD) RegisterFileBankedWrite(Address, Data);
+	CoreRecordRegisterAccess(1, Address, Data);
+}
+
+/** Tell whether INDF points to PCL in any bank, so the access must be handled by the core like a direct PCL access.
+ * @return 0 if INDF points to another register,
+ * @return 1 if INDF points to PCL.
+ */
+static inline int CoreIsIndirectAccessToPCL(void)
+{
+	unsigned int Location;
+	
+	if (Core_Register_Access_Mode == CORE_REGISTER_ACCESS_MODE_REPLAY) Location = Core_Lockstep_Indirect_Location;
+	else Location = RegisterFileGetIndirectLocation();
+	return (Location % REGISTER_FILE_REGISTERS_IN_BANK_COUNT) == REGISTER_FILE_REGISTER_ADDRESS_PCL;
+}
+
+/** Read the register INDF points to, the way the register access mode tells. The access is recorded as an INDF one, the way the program did it.
+ * @return The read data.
+ */
+static inline unsigned char CoreIndirectRead(void)
+{
+	unsigned char Data = 0;
+	
+	// PCL is provided by the core, like a direct read does
+	if (CoreIsIndirectAccessToPCL()) return (unsigned char) (Core_Program_Counter + 1);
+	
+	if (Core_Register_Access_Mode == CORE_REGISTER_ACCESS_MODE_DIRECT) return RegisterFileIndirectRead();
+	
+	if (Core_Register_Access_Mode == CORE_REGISTER_ACCESS_MODE_RECORD) Data = RegisterFileIndirectRead();
+	else if (CoreReplayRegisterRead(REGISTER_FILE_REGISTER_ADDRESS_INDF, &Data) != 0) Pointer_Core_Lockstep_Result->Is_Replay_Failed = 1;
+	CoreRecordRegisterAccess(0, REGISTER_FILE_REGISTER_ADDRESS_INDF, Data);
+	return Data;
+}
+
+/** Write the register INDF points to, the way the register access mode tells. The access is recorded as an INDF one, the way the program did it.
+ * @param Data The data to write.
+ */
+static inline void CoreIndirectWrite(unsigned char Data)
+{
+	// Writing PCL changes the program counter, like a direct write does
+	if (CoreIsIndirectAccessToPCL())
+	{
+		Core_Written_Program_Counter = ((CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_PCLATH) & 0x1F) << 8) | Data;
+		Core_Is_PCL_Written = 1;
+		return;
+	}
+	
+	if (Core_Register_Access_Mode == CORE_REGISTER_ACCESS_MODE_DIRECT)
+	{
+		RegisterFileIndirectWrite(Data);
+		return;
+	}
+	
+	if (Core_Register_Access_Mode == CORE_REGISTER_ACCESS_MODE_RECORD) RegisterFileIndirectWrite(Data);
+	CoreRecordRegisterAccess(1, REGISTER_FILE_REGISTER_ADDRESS_INDF, Data);
+}
+
+/** Read an instruction file register operand. PCL is directly provided by the core because it is the program counter low byte.
+ * @param Address The address bits 6..0, bits 8..7 are located in the STATUS register.
+ * @return The read data.
+ */
+static inline unsigned char CoreReadRegister(unsigned char Address)
+{
+	// PCL is located at the same address in all banks. The program counter has already been incremented when the instruction is executed
+	if (Address == REGISTER_FILE_REGISTER_ADDRESS_PCL) return (unsigned char) (Core_Program_Counter + 1);
+	// INDF is located at the same address in all banks too, the register it points to does not depend on the current bank
+	if (Address == REGISTER_FILE_REGISTER_ADDRESS_INDF) return CoreIndirectRead();
+	return CoreBankedRead(Address);
+}
+
+/** Write an instruction file register operand. Writing PCL loads the whole program counter with PCLATH<4:0> as the upper bits.
+ * @param Address The address bits 6..0, bits 8..7 are located in the STATUS register.
+ * @param Data The data to write.
+ */
+static inline void CoreWriteRegister(unsigned char Address, unsigned char Data)
+{
+	// The program counter can't be modified here because the instruction will make it point to the next instruction
+	if (Address == REGISTER_FILE_REGISTER_ADDRESS_PCL)
+	{
+		Core_Written_Program_Counter = ((CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_PCLATH) & 0x1F) << 8) | Data;
+		Core_Is_PCL_Written = 1;
+		return;
+	}
+	if (Address == REGISTER_FILE_REGISTER_ADDRESS_INDF) CoreIndirectWrite(Data);
+	else CoreBankedWrite(Address, Data);
+}
+
 /** Update the STATUS register flags according to the result of an operation.
  * @param Operation_Result The operation result, stored on more bits than the real operands size to allow carry report detection.
  * @param Affected_Flags_Bitmask Tell which flags should be affected by the operation (use the constants from the CORE_AFFECTED_FLAG_* pool).
@@ -78,8 +414,7 @@ static void CoreUpdateStatusRegister(unsigned short Operation_Result, int Affect
 	unsigned char Status_Register;
 	
 	// Get the current STATUS register value
-	Status_Register = RegisterFileBankedRead(REGISTER_FILE_REGISTER_ADDRESS_STATUS);
-	LOG(LOG_LEVEL_DEBUG, "Current STATUS value : 0x%02X.\n", Status_Register);
+	Status_Register = CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_STATUS);
 	
 	// Check for carry report
 	if (Affected_Flags_Bitmask & CORE_AFFECTED_FLAG_CARRY)
@@ -103,39 +438,16 @@ static void CoreUpdateStatusRegister(unsigned short Operation_Result, int Affect
 	}
 	
 	// Update the STATUS register value
-	RegisterFileBankedWrite(REGISTER_FILE_REGISTER_ADDRESS_STATUS, Status_Register);
-	LOG(LOG_LEVEL_DEBUG, "New STATUS value : 0x%02X.\n", Status_Register);
+	CoreBankedWrite(REGISTER_FILE_REGISTER_ADDRESS_STATUS, Status_Register);
 }
 
-//-------------------------------------------------------------------------------------------------
-// Public functions
-//-------------------------------------------------------------------------------------------------
-void CoreExecuteNextInstruction(void)
+/** Decode and execute an instruction with cascaded switches on the instruction formats. This is the reference engine.
+ * @param Instruction The instruction code.
+ */
+static void CoreExecuteInstructionInterpreter(unsigned short Instruction)
 {
 	unsigned char Byte_Operand_1, Byte_Operand_2, Temp_Byte, Current_Carry_Value, New_Carry_Value;
-	unsigned short Instruction, Temp_Word, Word_Operand;
-	struct timespec Time;
-	long Start_Time, Current_Time, Elapsed_Time;
-	static int Is_Cycle_Lost = 0;
-	
-	// Get the current clock value
-	clock_gettime(CLOCK_MONOTONIC, &Time);
-	Start_Time = Time.tv_nsec;
-	
-	// Fetch the next instruction
-	if (Is_Cycle_Lost) // An instruction cycle is wasted if a conditional test is true or if the program counter is changed by an instruction
-	{
-		Is_Cycle_Lost = 0;
-		LOG(LOG_LEVEL_DEBUG, "Executing a fake NOP instruction due to previous 2-cycle instruction.\n");
-		goto Exit; // Do not really execute the NOP instruction to avoid modifying the program counter register. Do not disable interrupts because they seem to be left enabled when a 2-cycle instruction is executed
-	}
-	else
-	{
-		Instruction = ProgramMemoryRead(Core_Program_Counter);
-		LOG(LOG_LEVEL_DEBUG, "Fetched next instruction at PC = 0x%04X, instruction : 0x%04X.\n", Core_Program_Counter, Instruction);
-	}
-	
-	// Decode and execute the instruction
+	unsigned short Temp_Word, Word_Operand;
 	
 	// No operand instruction format (must be executed before MOVWF as this instruction also starts by 0)
 	switch (Instruction & 0x3FFF)
@@ -144,44 +456,39 @@ void CoreExecuteNextInstruction(void)
 		case 0x0000:
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : NOP.\n");
-			goto Exit;
+			return;
 			
 		// RETURN
 		case 0x0008:
 			// Pop the return address
 			Core_Program_Counter = CoreStackPop();
-			Is_Cycle_Lost = 1; // This is a 2-cycle instruction
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : RETURN.\n");
-			goto Exit;
+			Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
+			return;
 			
 		// RETFIE
 		case 0x0009:
 			// Set the INTCON Global Interrupt Enable flag
-			Temp_Byte = RegisterFileBankedRead(REGISTER_FILE_REGISTER_ADDRESS_INTCON); // Get the current INTCON value
+			Temp_Byte = CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_INTCON); // Get the current INTCON value
 			Temp_Byte |= REGISTER_FILE_REGISTER_BIT_INTCON_GIE; // Set GIE bit
-			RegisterFileBankedWrite(REGISTER_FILE_REGISTER_ADDRESS_INTCON, Temp_Byte); // Set the new INTCON value
+			CoreBankedWrite(REGISTER_FILE_REGISTER_ADDRESS_INTCON, Temp_Byte); // Set the new INTCON value
 			// Pop the return address
 			Core_Program_Counter = CoreStackPop();
-			Is_Cycle_Lost = 1; // This is a 2-cycle instruction
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : RETFIE.\n");
-			goto Exit;
+			Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
+			return;
 			
 		// SLEEP
 		case 0x0063:
 			// TODO if useful
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : SLEEP (NOT IMPLEMENTED).\n");
-			goto Exit;
+			return;
 		
 		// CLRWDT
 		case 0x0064:
 			// TODO if useful
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : CLRWDT (NOT IMPLEMENTED).\n");
-			goto Exit;
+			return;
 			
 		// CLRW
 		case 0x0100:
@@ -191,8 +498,7 @@ void CoreExecuteNextInstruction(void)
 			CoreUpdateStatusRegister(0, CORE_AFFECTED_FLAG_ZERO);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : CLRW.\n");
-			goto Exit;
+			return;
 	}
 	
 	// One 3-bit operand followed by one 7-bit operand instruction format
@@ -203,56 +509,62 @@ void CoreExecuteNextInstruction(void)
 		// BCF
 		case 0x04:
 			// Get the current register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Clear the bit
 			Temp_Byte &= ~(1 << Byte_Operand_1);
 			// Set the new register value
-			RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : BCF 0x%02X, %d.\n", Byte_Operand_2, Byte_Operand_1);
-			goto Exit;
+			return;
 			
 		// BSF
 		case 0x05:
 			// Get the current register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Set the bit
 			Temp_Byte |= 1 << Byte_Operand_1;
 			// Set the new register value
-			RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : BSF 0x%02X, %d.\n", Byte_Operand_2, Byte_Operand_1);
-			goto Exit;
+			return;
 			
 		// BTFSC
 		case 0x06:
 			// Get the register to test value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Skip next instruction if the requested bit is clear
 			if (!(Temp_Byte & (1 << Byte_Operand_1)))
 			{
+				CoverageRecordSkip(Core_Program_Counter, 1);
 				Core_Program_Counter += 2;
-				Is_Cycle_Lost = 1; // This is a 2-cycle instruction
+				Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
+			}
+			else
+			{
+				CoverageRecordSkip(Core_Program_Counter, 0);
+				Core_Program_Counter++; // Point on next instruction
 			}
-			else Core_Program_Counter++; // Point on next instruction
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : BTFSC 0x%02X, %d.\n", Byte_Operand_2, Byte_Operand_1);
-			goto Exit;
+			return;
 			
 		// BTFSS
 		case 0x07:
 			// Get the register to test value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Skip next instruction if the requested bit is set
 			if (Temp_Byte & (1 << Byte_Operand_1))
 			{
+				CoverageRecordSkip(Core_Program_Counter, 1);
 				Core_Program_Counter += 2;
-				Is_Cycle_Lost = 1; // This is a 2-cycle instruction
+				Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
 			}
-			else Core_Program_Counter++; // Point on next instruction
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : BTFSS 0x%02X, %d.\n", Byte_Operand_2, Byte_Operand_1);
-			goto Exit;
+			else
+			{
+				CoverageRecordSkip(Core_Program_Counter, 0);
+				Core_Program_Counter++; // Point on next instruction
+			}
+			return;
 	}
 	
 	// One 1-bit operand followed by one 7-bit operand instruction format
@@ -263,27 +575,25 @@ void CoreExecuteNextInstruction(void)
 		// MOVWF
 		case 0x00:
 			// Do the operation
-			RegisterFileBankedWrite(Byte_Operand_2, Core_Register_W);
+			CoreWriteRegister(Byte_Operand_2, Core_Register_W);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : MOVWF 0x%02X.\n", Byte_Operand_2);
-			goto Exit;
+			return;
 			
 		// CLRF
 		case 0x01:
 			// Do the operation
-			RegisterFileBankedWrite(Byte_Operand_2, 0);
+			CoreWriteRegister(Byte_Operand_2, 0);
 			// Handle STATUS flags
 			CoreUpdateStatusRegister(0, CORE_AFFECTED_FLAG_ZERO);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : CLRF 0x%02X.\n", Byte_Operand_2);
-			goto Exit;
+			return;
 			
 		// SUBWF
 		case 0x02:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			Temp_Word = Temp_Byte - Core_Register_W;
 			// Invert carry value to get borrow
@@ -293,166 +603,161 @@ void CoreExecuteNextInstruction(void)
 			CoreUpdateStatusRegister(Temp_Word, CORE_AFFECTED_FLAG_CARRY | CORE_AFFECTED_FLAG_DIGIT_CARRY | CORE_AFFECTED_FLAG_ZERO);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = (unsigned char) Temp_Word;
-			else RegisterFileBankedWrite(Byte_Operand_2, (unsigned char) Temp_Word);
+			else CoreWriteRegister(Byte_Operand_2, (unsigned char) Temp_Word);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : SUBWF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// DECF
 		case 0x03:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			Temp_Byte--;
 			// Handle STATUS flags
 			CoreUpdateStatusRegister(Temp_Byte, CORE_AFFECTED_FLAG_ZERO);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : DECF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// IORWF
 		case 0x04:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			Temp_Byte |= Core_Register_W;
 			// Handle STATUS flags
 			CoreUpdateStatusRegister(Temp_Byte, CORE_AFFECTED_FLAG_ZERO);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : IORWF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// ANDWF
 		case 0x05:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			Temp_Byte &= Core_Register_W;
 			// Handle STATUS flags
 			CoreUpdateStatusRegister(Temp_Byte, CORE_AFFECTED_FLAG_ZERO);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : ANDWF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// XORWF
 		case 0x06:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			Temp_Byte ^= Core_Register_W;
 			// Handle STATUS flags
 			CoreUpdateStatusRegister(Temp_Byte, CORE_AFFECTED_FLAG_ZERO);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : XORWF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// ADDWF
 		case 0x07:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			Temp_Word = Temp_Byte + Core_Register_W;
 			// Handle STATUS flags
 			CoreUpdateStatusRegister(Temp_Word, CORE_AFFECTED_FLAG_CARRY | CORE_AFFECTED_FLAG_DIGIT_CARRY | CORE_AFFECTED_FLAG_ZERO);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = (unsigned char) Temp_Word;
-			else RegisterFileBankedWrite(Byte_Operand_2, (unsigned char) Temp_Word);
+			else CoreWriteRegister(Byte_Operand_2, (unsigned char) Temp_Word);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : ADDWF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// MOVF
 		case 0x08:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Handle STATUS flags
 			CoreUpdateStatusRegister(Temp_Byte, CORE_AFFECTED_FLAG_ZERO);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : MOVF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// COMF
 		case 0x09:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			Temp_Byte = ~Temp_Byte;
 			// Handle STATUS flags
 			CoreUpdateStatusRegister(Temp_Byte, CORE_AFFECTED_FLAG_ZERO);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : COMF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// INCF
 		case 0x0A:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			Temp_Byte++;
 			// Handle STATUS flags
 			CoreUpdateStatusRegister(Temp_Byte, CORE_AFFECTED_FLAG_ZERO);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : INCF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// DECFSZ
 		case 0x0B:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			Temp_Byte--;
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Skip next instruction if the result is zero
 			if (Temp_Byte == 0)
 			{
+				CoverageRecordSkip(Core_Program_Counter, 1);
 				Core_Program_Counter += 2;
-				Is_Cycle_Lost = 1; // This is a 2-cycle instruction
+				Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
+			}
+			else
+			{
+				CoverageRecordSkip(Core_Program_Counter, 0);
+				Core_Program_Counter++; // Point on next instruction
 			}
-			else Core_Program_Counter++; // Point on next instruction
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : DECFSZ 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// RRF
 		case 0x0C:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Keep operand least significant bit
 			New_Carry_Value = Temp_Byte & 1;
 			// Do the operation
 			Temp_Byte >>= 1;
 			// Put the current carry bit value at the operand most significant bit position
-			Current_Carry_Value = RegisterFileBankedRead(REGISTER_FILE_REGISTER_ADDRESS_STATUS) & REGISTER_FILE_REGISTER_BIT_STATUS_C;
+			Current_Carry_Value = CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_STATUS) & REGISTER_FILE_REGISTER_BIT_STATUS_C;
 			if (Current_Carry_Value != 0) Temp_Byte |= 0x80;
 			// Update STATUS carry flag using a little hack
 			if (New_Carry_Value != 0) Temp_Word = 0x0100;
@@ -460,22 +765,21 @@ void CoreExecuteNextInstruction(void)
 			CoreUpdateStatusRegister(Temp_Word, CORE_AFFECTED_FLAG_CARRY);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : RRF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// RLF
 		case 0x0D:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Keep operand most significant bit
 			New_Carry_Value = Temp_Byte & 0x80;
 			// Do the operation
 			Temp_Byte <<= 1;
 			// Put the current carry bit value at the operand least significant bit position
-			Current_Carry_Value = RegisterFileBankedRead(REGISTER_FILE_REGISTER_ADDRESS_STATUS) & REGISTER_FILE_REGISTER_BIT_STATUS_C; 
+			Current_Carry_Value = CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_STATUS) & REGISTER_FILE_REGISTER_BIT_STATUS_C; 
 			if (Current_Carry_Value != 0) Temp_Byte |= 0x01;
 			// Update STATUS carry flag using a little hack
 			if (New_Carry_Value != 0) Temp_Word = 0x0100;
@@ -483,69 +787,70 @@ void CoreExecuteNextInstruction(void)
 			CoreUpdateStatusRegister(Temp_Word, CORE_AFFECTED_FLAG_CARRY);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : RLF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// SWAPF
 		case 0x0E:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			New_Carry_Value = Temp_Byte & 0x0F; // Recycle New_Carry_Value variable to store the low operand nibble
 			Temp_Byte = ((New_Carry_Value << 4) & 0xF0) | ((Temp_Byte >> 4) & 0x0F);
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : SWAPF 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 			
 		// INCFSZ
 		case 0x0F:
 			// Get the operand register value
-			Temp_Byte = RegisterFileBankedRead(Byte_Operand_2);
+			Temp_Byte = CoreReadRegister(Byte_Operand_2);
 			// Do the operation
 			Temp_Byte++;
 			// Update the right destination register
 			if (Byte_Operand_1 == 0) Core_Register_W = Temp_Byte;
-			else RegisterFileBankedWrite(Byte_Operand_2, Temp_Byte);
+			else CoreWriteRegister(Byte_Operand_2, Temp_Byte);
 			// Skip next instruction if the result is zero
 			if (Temp_Byte == 0)
 			{
+				CoverageRecordSkip(Core_Program_Counter, 1);
 				Core_Program_Counter += 2;
-				Is_Cycle_Lost = 1; // This is a 2-cycle instruction
+				Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
+			}
+			else
+			{
+				CoverageRecordSkip(Core_Program_Counter, 0);
+				Core_Program_Counter++; // Point on next instruction
 			}
-			else Core_Program_Counter++; // Point on next instruction
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : INCFSZ 0x%02X, %c.\n", Byte_Operand_2, Byte_Operand_1 == 0 ? 'W' : 'F');
-			goto Exit;
+			return;
 	}
 	
 	// One 11-bit operand instruction format
 	Word_Operand = Instruction & 0x07FF; // Get the operand
-	Temp_Byte = RegisterFileBankedRead(REGISTER_FILE_REGISTER_ADDRESS_PCLATH) & 0x18; // Get upper 2 bits
 	switch ((Instruction >> 11) & 0x0007)
 	{
 		// CALL
 		case 0x04:
 			// Push the Program Counter return value (PC + 1)
 			CoreStackPush(Core_Program_Counter + 1);
-			// Do the operation
+			// Do the operation, the page is selected by PCLATH<4:3>
+			Temp_Byte = CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_PCLATH) & 0x18;
 			Core_Program_Counter = (Temp_Byte << 8) | Word_Operand;
-			Is_Cycle_Lost = 1; // This is a 2-cycle instruction
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : CALL 0x%04X.\n", Word_Operand);
-			goto Exit;
+			Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
+			return;
 		
 		// GOTO
 		case 0x05:
-			// Do the operation
+			// Do the operation, the page is selected by PCLATH<4:3>
+			Temp_Byte = CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_PCLATH) & 0x18;
 			Core_Program_Counter = (Temp_Byte << 8) | Word_Operand;
-			Is_Cycle_Lost = 1; // This is a 2-cycle instruction
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : GOTO 0x%04X.\n", Word_Operand);
-			goto Exit;
+			Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
+			return;
 	}
 	
 	// One 8-bit operand instruction format
@@ -558,8 +863,7 @@ void CoreExecuteNextInstruction(void)
 			Core_Register_W = Byte_Operand_1;
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : MOVLW 0x%02X.\n", Byte_Operand_1);
-			goto Exit;
+			return;
 			
 		// RETLW
 		case 0x34:
@@ -567,9 +871,8 @@ void CoreExecuteNextInstruction(void)
 			Core_Register_W = Byte_Operand_1;
 			// Pop the return address
 			Core_Program_Counter = CoreStackPop();
-			Is_Cycle_Lost = 1; // This is a 2-cycle instruction
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : RETLW 0x%02X.\n", Byte_Operand_1);
-			goto Exit;
+			Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
+			return;
 			
 		// IORLW
 		case 0x38:
@@ -579,8 +882,7 @@ void CoreExecuteNextInstruction(void)
 			CoreUpdateStatusRegister(Core_Register_W, CORE_AFFECTED_FLAG_ZERO);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : IORLW 0x%02X.\n", Byte_Operand_1);
-			goto Exit;
+			return;
 			
 		// ANDLW
 		case 0x39:
@@ -590,8 +892,7 @@ void CoreExecuteNextInstruction(void)
 			CoreUpdateStatusRegister(Core_Register_W, CORE_AFFECTED_FLAG_ZERO);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : ANDLW 0x%02X.\n", Byte_Operand_1);
-			goto Exit;
+			return;
 			
 		// XORLW
 		case 0x3A:
@@ -601,8 +902,7 @@ void CoreExecuteNextInstruction(void)
 			CoreUpdateStatusRegister(Core_Register_W, CORE_AFFECTED_FLAG_ZERO);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : XORLW 0x%02X.\n", Byte_Operand_1);
-			goto Exit;
+			return;
 			
 		// SUBLW
 		case 0x3C:
@@ -616,8 +916,7 @@ void CoreExecuteNextInstruction(void)
 			CoreUpdateStatusRegister(Temp_Word, CORE_AFFECTED_FLAG_CARRY | CORE_AFFECTED_FLAG_DIGIT_CARRY | CORE_AFFECTED_FLAG_ZERO);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : SUBLW 0x%02X.\n", Byte_Operand_1);
-			goto Exit;
+			return;
 			
 		// ADDLW
 		case 0x3E:
@@ -628,44 +927,784 @@ void CoreExecuteNextInstruction(void)
 			CoreUpdateStatusRegister(Temp_Word, CORE_AFFECTED_FLAG_CARRY | CORE_AFFECTED_FLAG_DIGIT_CARRY | CORE_AFFECTED_FLAG_ZERO);
 			// Point on next instruction
 			Core_Program_Counter++;
-			LOG(LOG_LEVEL_DEBUG, "Found instruction : ADDLW 0x%02X.\n", Byte_Operand_1);
-			goto Exit;
+			return;
 	}
 	
 	// Unknown instructions are executed as NOP
 	// Point on next instruction
 	Core_Program_Counter++;
 	LOG(LOG_LEVEL_WARNING, "WARNING : unknown instruction found, executing as NOP.\n");
+}
+
+/** Convert an instruction code to the predecoded engine format. The instruction formats are tried in the same order than the interpreter does, so both engines agree on the undocumented instruction codes.
+ * @param Instruction The instruction code.
+ * @param Pointer_Decoded_Instruction On output, contain the decoded instruction.
+ */
+static void CoreDecodeInstruction(unsigned short Instruction, TCoreDecodedInstruction *Pointer_Decoded_Instruction)
+{
+	static const unsigned char Byte_Oriented_Operations[] =
+	{
+		CORE_OPERATION_MOVWF,
+		CORE_OPERATION_CLRF,
+		CORE_OPERATION_SUBWF,
+		CORE_OPERATION_DECF,
+		CORE_OPERATION_IORWF,
+		CORE_OPERATION_ANDWF,
+		CORE_OPERATION_XORWF,
+		CORE_OPERATION_ADDWF,
+		CORE_OPERATION_MOVF,
+		CORE_OPERATION_COMF,
+		CORE_OPERATION_INCF,
+		CORE_OPERATION_DECFSZ,
+		CORE_OPERATION_RRF,
+		CORE_OPERATION_RLF,
+		CORE_OPERATION_SWAPF,
+		CORE_OPERATION_INCFSZ
+	};
+	unsigned char Operation_Code;
+	
+	Pointer_Decoded_Instruction->Instruction = Instruction;
+	Pointer_Decoded_Instruction->Modifier = 0;
+	Pointer_Decoded_Instruction->Operand = 0;
+	
+	// No operand instruction format
+	switch (Instruction & 0x3FFF)
+	{
+		case 0x0000: // NOP
+		case 0x0063: // SLEEP
+		case 0x0064: // CLRWDT
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_NOP;
+			return;
+			
+		case 0x0008:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_RETURN;
+			return;
+			
+		case 0x0009:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_RETFIE;
+			return;
+			
+		case 0x0100:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_CLRW;
+			return;
+	}
+	
+	// One 3-bit operand followed by one 7-bit operand instruction format
+	Operation_Code = (Instruction >> 10) & 0x000F;
+	if ((Operation_Code >= 0x04) && (Operation_Code <= 0x07))
+	{
+		Pointer_Decoded_Instruction->Operation = CORE_OPERATION_BCF + Operation_Code - 0x04;
+		Pointer_Decoded_Instruction->Modifier = 1 << ((Instruction >> 7) & 0x0007);
+		Pointer_Decoded_Instruction->Operand = Instruction & 0x007F;
+		return;
+	}
+	
+	// One 1-bit operand followed by one 7-bit operand instruction format
+	Operation_Code = (Instruction >> 8) & 0x003F;
+	if (Operation_Code <= 0x0F)
+	{
+		Pointer_Decoded_Instruction->Operation = Byte_Oriented_Operations[Operation_Code];
+		Pointer_Decoded_Instruction->Modifier = (Instruction >> 7) & 0x0001;
+		Pointer_Decoded_Instruction->Operand = Instruction & 0x007F;
+		return;
+	}
+	
+	// One 11-bit operand instruction format
+	Pointer_Decoded_Instruction->Operand = Instruction & 0x07FF;
+	switch ((Instruction >> 11) & 0x0007)
+	{
+		case 0x04:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_CALL;
+			return;
+			
+		case 0x05:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_GOTO;
+			return;
+	}
+	
+	// One 8-bit operand instruction format
+	Pointer_Decoded_Instruction->Operand = Instruction & 0x00FF;
+	switch ((Instruction >> 8) & 0x007F)
+	{
+		case 0x30:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_MOVLW;
+			return;
+			
+		case 0x34:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_RETLW;
+			return;
+			
+		case 0x38:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_IORLW;
+			return;
+			
+		case 0x39:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_ANDLW;
+			return;
+			
+		case 0x3A:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_XORLW;
+			return;
+			
+		case 0x3C:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_SUBLW;
+			return;
+			
+		case 0x3E:
+			Pointer_Decoded_Instruction->Operation = CORE_OPERATION_ADDLW;
+			return;
+	}
+	
+	Pointer_Decoded_Instruction->Operation = CORE_OPERATION_UNKNOWN;
+}
+
+/** Store a byte-oriented operation result to the instruction destination.
+ * @param Destination Set to 0 to store the result to W, set to 1 to store it to the file register.
+ * @param Address The file register address.
+ * @param Data The result.
+ */
+static inline void CoreStoreResult(unsigned char Destination, unsigned char Address, unsigned char Data)
+{
+	if (Destination == 0) Core_Register_W = Data;
+	else CoreWriteRegister(Address, Data);
+}
+
+/** Make the program counter point to the next instruction, or to the following one if the conditional skip is taken.
+ * @param Is_Skip_Taken Set to 1 to skip the next instruction.
+ */
+static inline void CoreSkipIf(int Is_Skip_Taken)
+{
+	CoverageRecordSkip(Core_Program_Counter, Is_Skip_Taken);
+	if (Is_Skip_Taken)
+	{
+		Core_Program_Counter += 2;
+		Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
+	}
+	else Core_Program_Counter++;
+}
+
+/** Execute an instruction decoded once per program memory location. It must behave exactly like the interpreter, use the lockstep engine to make sure of it.
+ * @param Instruction The instruction code.
+ */
+static void CoreExecuteInstructionPredecoded(unsigned short Instruction)
+{
+	TCoreDecodedInstruction *Pointer_Decoded_Instruction;
+	unsigned char Address, Data, Carry_Bit;
+	unsigned short Result;
+	
+	// The program counter can go past the program memory end, whose reads return an erased location
+	Pointer_Decoded_Instruction = &Core_Decoded_Instructions[Core_Program_Counter & (PROGRAM_MEMORY_SIZE - 1)];
+	if (Pointer_Decoded_Instruction->Instruction != Instruction) CoreDecodeInstruction(Instruction, Pointer_Decoded_Instruction);
+	Address = (unsigned char) Pointer_Decoded_Instruction->Operand;
+	
+	switch (Pointer_Decoded_Instruction->Operation)
+	{
+		case CORE_OPERATION_NOP:
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_RETURN:
+			Core_Program_Counter = CoreStackPop();
+			Core_Lost_Cycles_Count++;
+			return;
+			
+		case CORE_OPERATION_RETFIE:
+			CoreBankedWrite(REGISTER_FILE_REGISTER_ADDRESS_INTCON, CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_INTCON) | REGISTER_FILE_REGISTER_BIT_INTCON_GIE);
+			Core_Program_Counter = CoreStackPop();
+			Core_Lost_Cycles_Count++;
+			return;
+			
+		case CORE_OPERATION_CLRW:
+			Core_Register_W = 0;
+			CoreUpdateStatusRegister(0, CORE_AFFECTED_FLAG_ZERO);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_BCF:
+			CoreWriteRegister(Address, CoreReadRegister(Address) & ~Pointer_Decoded_Instruction->Modifier);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_BSF:
+			CoreWriteRegister(Address, CoreReadRegister(Address) | Pointer_Decoded_Instruction->Modifier);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_BTFSC:
+			CoreSkipIf(!(CoreReadRegister(Address) & Pointer_Decoded_Instruction->Modifier));
+			return;
+			
+		case CORE_OPERATION_BTFSS:
+			CoreSkipIf((CoreReadRegister(Address) & Pointer_Decoded_Instruction->Modifier) != 0);
+			return;
+			
+		case CORE_OPERATION_MOVWF:
+			CoreWriteRegister(Address, Core_Register_W);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_CLRF:
+			CoreWriteRegister(Address, 0);
+			CoreUpdateStatusRegister(0, CORE_AFFECTED_FLAG_ZERO);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_SUBWF:
+			// Invert the carry to get the borrow
+			Result = (CoreReadRegister(Address) - Core_Register_W) ^ 0x0100;
+			CoreUpdateStatusRegister(Result, CORE_AFFECTED_FLAG_CARRY | CORE_AFFECTED_FLAG_DIGIT_CARRY | CORE_AFFECTED_FLAG_ZERO);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, (unsigned char) Result);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_DECF:
+			Data = CoreReadRegister(Address) - 1;
+			CoreUpdateStatusRegister(Data, CORE_AFFECTED_FLAG_ZERO);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, Data);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_IORWF:
+			Data = CoreReadRegister(Address) | Core_Register_W;
+			CoreUpdateStatusRegister(Data, CORE_AFFECTED_FLAG_ZERO);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, Data);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_ANDWF:
+			Data = CoreReadRegister(Address) & Core_Register_W;
+			CoreUpdateStatusRegister(Data, CORE_AFFECTED_FLAG_ZERO);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, Data);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_XORWF:
+			Data = CoreReadRegister(Address) ^ Core_Register_W;
+			CoreUpdateStatusRegister(Data, CORE_AFFECTED_FLAG_ZERO);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, Data);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_ADDWF:
+			Result = CoreReadRegister(Address) + Core_Register_W;
+			CoreUpdateStatusRegister(Result, CORE_AFFECTED_FLAG_CARRY | CORE_AFFECTED_FLAG_DIGIT_CARRY | CORE_AFFECTED_FLAG_ZERO);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, (unsigned char) Result);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_MOVF:
+			// The file register is not written back when it is the destination
+			Data = CoreReadRegister(Address);
+			CoreUpdateStatusRegister(Data, CORE_AFFECTED_FLAG_ZERO);
+			if (Pointer_Decoded_Instruction->Modifier == 0) Core_Register_W = Data;
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_COMF:
+			Data = ~CoreReadRegister(Address);
+			CoreUpdateStatusRegister(Data, CORE_AFFECTED_FLAG_ZERO);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, Data);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_INCF:
+			Data = CoreReadRegister(Address) + 1;
+			CoreUpdateStatusRegister(Data, CORE_AFFECTED_FLAG_ZERO);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, Data);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_DECFSZ:
+			Data = CoreReadRegister(Address) - 1;
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, Data);
+			CoreSkipIf(Data == 0);
+			return;
+			
+		case CORE_OPERATION_RRF:
+			Data = CoreReadRegister(Address);
+			Carry_Bit = Data & 0x01;
+			Data >>= 1;
+			if (CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_STATUS) & REGISTER_FILE_REGISTER_BIT_STATUS_C) Data |= 0x80;
+			CoreUpdateStatusRegister(Carry_Bit << 8, CORE_AFFECTED_FLAG_CARRY);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, Data);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_RLF:
+			Data = CoreReadRegister(Address);
+			Carry_Bit = Data >> 7;
+			Data <<= 1;
+			if (CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_STATUS) & REGISTER_FILE_REGISTER_BIT_STATUS_C) Data |= 0x01;
+			CoreUpdateStatusRegister(Carry_Bit << 8, CORE_AFFECTED_FLAG_CARRY);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, Data);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_SWAPF:
+			Data = CoreReadRegister(Address);
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, (unsigned char) ((Data << 4) | (Data >> 4)));
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_INCFSZ:
+			Data = CoreReadRegister(Address) + 1;
+			CoreStoreResult(Pointer_Decoded_Instruction->Modifier, Address, Data);
+			CoreSkipIf(Data == 0);
+			return;
+			
+		case CORE_OPERATION_CALL:
+			CoreStackPush(Core_Program_Counter + 1);
+			Core_Program_Counter = ((CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_PCLATH) & 0x18) << 8) | Pointer_Decoded_Instruction->Operand;
+			Core_Lost_Cycles_Count++;
+			return;
+			
+		case CORE_OPERATION_GOTO:
+			Core_Program_Counter = ((CoreBankedRead(REGISTER_FILE_REGISTER_ADDRESS_PCLATH) & 0x18) << 8) | Pointer_Decoded_Instruction->Operand;
+			Core_Lost_Cycles_Count++;
+			return;
+			
+		case CORE_OPERATION_MOVLW:
+			Core_Register_W = (unsigned char) Pointer_Decoded_Instruction->Operand;
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_RETLW:
+			Core_Register_W = (unsigned char) Pointer_Decoded_Instruction->Operand;
+			Core_Program_Counter = CoreStackPop();
+			Core_Lost_Cycles_Count++;
+			return;
+			
+		case CORE_OPERATION_IORLW:
+			Core_Register_W |= Pointer_Decoded_Instruction->Operand;
+			CoreUpdateStatusRegister(Core_Register_W, CORE_AFFECTED_FLAG_ZERO);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_ANDLW:
+			Core_Register_W &= Pointer_Decoded_Instruction->Operand;
+			CoreUpdateStatusRegister(Core_Register_W, CORE_AFFECTED_FLAG_ZERO);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_XORLW:
+			Core_Register_W ^= Pointer_Decoded_Instruction->Operand;
+			CoreUpdateStatusRegister(Core_Register_W, CORE_AFFECTED_FLAG_ZERO);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_SUBLW:
+			// Invert the carry to get the borrow
+			Result = (Pointer_Decoded_Instruction->Operand - Core_Register_W) ^ 0x0100;
+			Core_Register_W = (unsigned char) Result;
+			CoreUpdateStatusRegister(Result, CORE_AFFECTED_FLAG_CARRY | CORE_AFFECTED_FLAG_DIGIT_CARRY | CORE_AFFECTED_FLAG_ZERO);
+			Core_Program_Counter++;
+			return;
+			
+		case CORE_OPERATION_ADDLW:
+			Result = Core_Register_W + Pointer_Decoded_Instruction->Operand;
+			Core_Register_W = (unsigned char) Result;
+			CoreUpdateStatusRegister(Result, CORE_AFFECTED_FLAG_CARRY | CORE_AFFECTED_FLAG_DIGIT_CARRY | CORE_AFFECTED_FLAG_ZERO);
+			Core_Program_Counter++;
+			return;
+			
+		default:
+			Core_Program_Counter++;
+			LOG(LOG_LEVEL_WARNING, "WARNING : unknown instruction found, executing as NOP.\n");
+			return;
+	}
+}
+
+/** Copy the core registers to a lockstep result.
+ * @param Pointer_Result On output, contain the core registers.
+ */
+static void CoreSaveLockstepResult(TCoreLockstepResult *Pointer_Result)
+{
+	// The program counter is not masked like CoreSetState() does, so it is compared as the engine left it
+	Pointer_Result->State.Register_W = Core_Register_W;
+	Pointer_Result->State.Program_Counter = Core_Program_Counter;
+	memcpy(Pointer_Result->State.Stack, Core_Stack, sizeof(Core_Stack));
+	Pointer_Result->State.Stack_Pointer = Core_Stack_Pointer;
+	Pointer_Result->State.Lost_Cycles_Count = Core_Lost_Cycles_Count;
+	Pointer_Result->State.Cycles_Count = Core_Cycles_Count;
+	Pointer_Result->Is_PCL_Written = Core_Is_PCL_Written;
+	Pointer_Result->Written_Program_Counter = Core_Written_Program_Counter;
+}
+
+/** Load the core registers from a lockstep result.
+ * @param Pointer_Result The core registers.
+ */
+static void CoreRestoreLockstepResult(const TCoreLockstepResult *Pointer_Result)
+{
+	Core_Register_W = Pointer_Result->State.Register_W;
+	Core_Program_Counter = Pointer_Result->State.Program_Counter;
+	memcpy(Core_Stack, Pointer_Result->State.Stack, sizeof(Core_Stack));
+	Core_Stack_Pointer = Pointer_Result->State.Stack_Pointer;
+	Core_Lost_Cycles_Count = Pointer_Result->State.Lost_Cycles_Count;
+	Core_Cycles_Count = Pointer_Result->State.Cycles_Count;
+	Core_Is_PCL_Written = Pointer_Result->Is_PCL_Written;
+	Core_Written_Program_Counter = Pointer_Result->Written_Program_Counter;
+}
+
+/** Execute an instruction with an engine while recording its register file accesses.
+ * @param Instruction_Executor The engine.
+ * @param Instruction The instruction code.
+ * @param Register_Access_Mode How the register file is accessed (record or replay).
+ * @param Pointer_Result On output, contain what the engine did.
+ */
+static void CoreExecuteInstructionRecorded(TCoreInstructionExecutor Instruction_Executor, unsigned short Instruction, TCoreRegisterAccessMode Register_Access_Mode, TCoreLockstepResult *Pointer_Result)
+{
+	Pointer_Result->Register_Accesses_Count = 0;
+	Pointer_Result->Is_Replay_Failed = 0;
+	Pointer_Result->Stalled_Cycles_Count = 0;
+	Pointer_Core_Lockstep_Result = Pointer_Result;
+	
+	Core_Register_Access_Mode = Register_Access_Mode;
+	Instruction_Executor(Instruction);
+	Core_Register_Access_Mode = CORE_REGISTER_ACCESS_MODE_DIRECT;
+	
+	CoreSaveLockstepResult(Pointer_Result);
+}
+
+/** Tell whether two engines did the same register file writes.
+ * @param Pointer_Reference_Result The first engine results.
+ * @param Pointer_Candidate_Result The second engine results.
+ * @return 0 if the writes are the same, in the same order,
+ * @return 1 if the writes differ.
+ */
+static int CoreCompareRegisterWrites(const TCoreLockstepResult *Pointer_Reference_Result, const TCoreLockstepResult *Pointer_Candidate_Result)
+{
+	const TCoreRegisterAccess *Pointer_Reference_Access, *Pointer_Candidate_Access;
+	int Reference_Index = 0, Candidate_Index = 0;
+	
+	// Both access lists must not have been truncated to be compared
+	if ((Pointer_Reference_Result->Register_Accesses_Count > CORE_MAXIMUM_REGISTER_ACCESSES_COUNT) || (Pointer_Candidate_Result->Register_Accesses_Count > CORE_MAXIMUM_REGISTER_ACCESSES_COUNT)) return 1;
+	
+	while (1)
+	{
+		// Skip the reads, the replayed ones got the same data anyway
+		while ((Reference_Index < Pointer_Reference_Result->Register_Accesses_Count) && !Pointer_Reference_Result->Register_Accesses[Reference_Index].Is_Write) Reference_Index++;
+		while ((Candidate_Index < Pointer_Candidate_Result->Register_Accesses_Count) && !Pointer_Candidate_Result->Register_Accesses[Candidate_Index].Is_Write) Candidate_Index++;
+		
+		// Both lists must end at the same time
+		if ((Reference_Index >= Pointer_Reference_Result->Register_Accesses_Count) || (Candidate_Index >= Pointer_Candidate_Result->Register_Accesses_Count)) return (Reference_Index < Pointer_Reference_Result->Register_Accesses_Count) || (Candidate_Index < Pointer_Candidate_Result->Register_Accesses_Count);
+		
+		Pointer_Reference_Access = &Pointer_Reference_Result->Register_Accesses[Reference_Index];
+		Pointer_Candidate_Access = &Pointer_Candidate_Result->Register_Accesses[Candidate_Index];
+		if ((Pointer_Reference_Access->Address != Pointer_Candidate_Access->Address) || (Pointer_Reference_Access->Data != Pointer_Candidate_Access->Data)) return 1;
+		Reference_Index++;
+		Candidate_Index++;
+	}
+}
+
+/** Tell whether two engines executed an instruction the same way.
+ * @param Pointer_Reference_Result The first engine results.
+ * @param Pointer_Candidate_Result The second engine results.
+ * @return 0 if the results are the same,
+ * @return 1 if the results differ.
+ */
+static int CoreCompareLockstepResults(const TCoreLockstepResult *Pointer_Reference_Result, const TCoreLockstepResult *Pointer_Candidate_Result)
+{
+	if (Pointer_Candidate_Result->Is_Replay_Failed) return 1;
+	if (Pointer_Reference_Result->State.Register_W != Pointer_Candidate_Result->State.Register_W) return 1;
+	if (Pointer_Reference_Result->State.Program_Counter != Pointer_Candidate_Result->State.Program_Counter) return 1;
+	if (Pointer_Reference_Result->State.Stack_Pointer != Pointer_Candidate_Result->State.Stack_Pointer) return 1;
+	if (memcmp(Pointer_Reference_Result->State.Stack, Pointer_Candidate_Result->State.Stack, sizeof(Pointer_Reference_Result->State.Stack)) != 0) return 1;
+	if (Pointer_Reference_Result->State.Lost_Cycles_Count - Pointer_Reference_Result->Stalled_Cycles_Count != Pointer_Candidate_Result->State.Lost_Cycles_Count) return 1; // Only the engine that really wrote to the register file could be stalled
+	if (Pointer_Reference_Result->Is_PCL_Written != Pointer_Candidate_Result->Is_PCL_Written) return 1;
+	if (Pointer_Reference_Result->Is_PCL_Written && (Pointer_Reference_Result->Written_Program_Counter != Pointer_Candidate_Result->Written_Program_Counter)) return 1;
+	return CoreCompareRegisterWrites(Pointer_Reference_Result, Pointer_Candidate_Result);
+}
+
+/** Write what an engine did to the log file.
+ * @param String_Engine_Name The engine name.
+ * @param Pointer_Result The engine results.
+ */
+static void CoreLogLockstepResult(char *String_Engine_Name, const TCoreLockstepResult *Pointer_Result)
+{
+	char String_Accesses[CORE_MAXIMUM_REGISTER_ACCESSES_COUNT * 16 + 1] = "", String_Stack[CORE_STACK_SIZE * 6 + 1] = "";
+	int i, Length = 0;
+	
+	for (i = 0; (i < Pointer_Result->Register_Accesses_Count) && (i < CORE_MAXIMUM_REGISTER_ACCESSES_COUNT); i++) Length += snprintf(&String_Accesses[Length], sizeof(String_Accesses) - Length, " %c 0x%02X=0x%02X", Pointer_Result->Register_Accesses[i].Is_Write ? 'W' : 'R', Pointer_Result->Register_Accesses[i].Address, Pointer_Result->Register_Accesses[i].Data);
+	Length = 0;
+	for (i = 0; i < CORE_STACK_SIZE; i++) Length += snprintf(&String_Stack[Length], sizeof(String_Stack) - Length, " %04X", Pointer_Result->State.Stack[i]);
+	
+	LOG(LOG_LEVEL_ERROR, "%s : W = 0x%02X, PC = 0x%04X, lost cycles = %u (%u stalled by peripherals), stack pointer = %d, stack =%s.\n", String_Engine_Name, Pointer_Result->State.Register_W, Pointer_Result->State.Program_Counter, Pointer_Result->State.Lost_Cycles_Count, Pointer_Result->Stalled_Cycles_Count, Pointer_Result->State.Stack_Pointer, String_Stack);
+	if (Pointer_Result->Is_PCL_Written) LOG(LOG_LEVEL_ERROR, "%s : PCL written, PC = 0x%04X.\n", String_Engine_Name, Pointer_Result->Written_Program_Counter);
+	LOG(LOG_LEVEL_ERROR, "%s : %d register accesses (R for read, W for write, banked addresses) :%s%s.\n", String_Engine_Name, Pointer_Result->Register_Accesses_Count, String_Accesses, Pointer_Result->Is_Replay_Failed ? ", a read was not done by the interpreter" : "");
+}
+
+/** Write the first divergence between the engines to the log file, with the last executed instructions. */
+static void CoreLogLockstepDivergence(void)
+{
+	char String_Address[DISASSEMBLER_ADDRESS_STRING_SIZE], String_Instruction[DISASSEMBLER_INSTRUCTION_STRING_SIZE];
+	TCoreLockstepTraceEntry *Pointer_Entry;
+	unsigned int i, Entries_Count;
+	
+	LOG(LOG_LEVEL_ERROR, "Error : the predecoded engine diverged from the interpreter at cycle %llu, only the interpreter is used from now.\n", Core_Cycles_Count);
+	
+	// Display the oldest instructions first, the last one is the diverging instruction
+	Entries_Count = Core_Lockstep_Executed_Instructions_Count;
+	if (Entries_Count > CORE_LOCKSTEP_TRACE_WINDOW_SIZE) Entries_Count = CORE_LOCKSTEP_TRACE_WINDOW_SIZE;
+	LOG(LOG_LEVEL_ERROR, "Last %u executed instructions (W and STATUS are the interpreter values after execution) :\n", Entries_Count);
+	for (i = Core_Lockstep_Executed_Instructions_Count - Entries_Count; i < Core_Lockstep_Executed_Instructions_Count; i++)
+	{
+		Pointer_Entry = &Core_Lockstep_Trace_Window[i & (CORE_LOCKSTEP_TRACE_WINDOW_SIZE - 1)];
+		DisassemblerFormatAddress(Pointer_Entry->Address, String_Address, sizeof(String_Address));
+		DisassemblerDecodeInstruction(Pointer_Entry->Address, Pointer_Entry->Instruction, String_Instruction, sizeof(String_Instruction));
+		LOG(LOG_LEVEL_ERROR, "  %llu : %s : %-24s W = 0x%02X, STATUS = 0x%02X\n", Pointer_Entry->Cycles_Count, String_Address, String_Instruction, Pointer_Entry->Register_W, Pointer_Entry->Register_STATUS);
+	}
+	
+	CoreLogLockstepResult("Interpreter", &Core_Lockstep_Reference_Result);
+	CoreLogLockstepResult("Predecoded", &Core_Lockstep_Candidate_Result);
+}
+
+/** Execute an instruction with both the interpreter and the predecoded engine, then compare what they did. Only the interpreter accesses the register file, so the peripherals see each access once : the predecoded engine gets the data the interpreter read and its writes are only recorded.
+ * @param Instruction The instruction code.
+ */
+static void CoreExecuteInstructionLockstep(unsigned short Instruction)
+{
+	TCoreLockstepResult Initial_State;
+	TCoreLockstepTraceEntry *Pointer_Entry;
+	
+	// Run the reference engine
+	CoreSaveLockstepResult(&Initial_State);
+	Core_Lockstep_Indirect_Location = RegisterFileGetIndirectLocation();
+	CoreExecuteInstructionRecorded(CoreExecuteInstructionInterpreter, Instruction, CORE_REGISTER_ACCESS_MODE_RECORD, &Core_Lockstep_Reference_Result);
+	
+	// Run the other engine from the same state
+	CoreRestoreLockstepResult(&Initial_State);
+	CoreExecuteInstructionRecorded(CoreExecuteInstructionPredecoded, Instruction, CORE_REGISTER_ACCESS_MODE_REPLAY, &Core_Lockstep_Candidate_Result);
+	
+	// Keep going with the reference results
+	CoreRestoreLockstepResult(&Core_Lockstep_Reference_Result);
+	
+	Pointer_Entry = &Core_Lockstep_Trace_Window[Core_Lockstep_Executed_Instructions_Count & (CORE_LOCKSTEP_TRACE_WINDOW_SIZE - 1)];
+	Pointer_Entry->Cycles_Count = Core_Cycles_Count;
+	Pointer_Entry->Address = Initial_State.State.Program_Counter;
+	Pointer_Entry->Instruction = Instruction;
+	Pointer_Entry->Register_W = Core_Register_W;
+	Pointer_Entry->Register_STATUS = RegisterFileDirectPeek(REGISTER_FILE_REGISTER_BANK_STATUS, REGISTER_FILE_REGISTER_ADDRESS_STATUS);
+	Core_Lockstep_Executed_Instructions_Count++;
+	
+	// Report only the first divergence, the next instructions would likely diverge too
+	if (CoreCompareLockstepResults(&Core_Lockstep_Reference_Result, &Core_Lockstep_Candidate_Result) != 0)
+	{
+		CoreLogLockstepDivergence();
+		Core_Is_Divergence_Found = 1;
+		Core_Engine = CORE_ENGINE_INTERPRETER;
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+unsigned int CoreExecuteNextInstruction(void)
+{
+	unsigned char Temp_Byte;
+	unsigned short Instruction;
+	unsigned int Cycles;
+	struct timespec Time;
+	long long Current_Time;
+	
+	// The peripherals accessed by the instruction see the cycle the instruction starts at
+	Core_Cycles_Count++;
+	
+	// Fetch the next instruction
+	Instruction = ProgramMemoryRead(Core_Program_Counter);
+	CoverageRecordInstruction(Core_Program_Counter);
+	if (Core_Trace_Callback != NULL) Core_Trace_Callback(Core_Program_Counter, Instruction);
+	
+	// Decode and execute the instruction with the selected engine
+	switch (Core_Engine)
+	{
+		case CORE_ENGINE_INTERPRETER:
+			CoreExecuteInstructionInterpreter(Instruction);
+			break;
+			
+		case CORE_ENGINE_PREDECODED:
+			CoreExecuteInstructionPredecoded(Instruction);
+			break;
+			
+		case CORE_ENGINE_LOCKSTEP:
+			CoreExecuteInstructionLockstep(Instruction);
+			break;
+	}
+	
+	// A PCL write replaces the next instruction address and flushes the prefetched instruction
+	if (Core_Is_PCL_Written)
+	{
+		Core_Program_Counter = Core_Written_Program_Counter;
+		Core_Is_PCL_Written = 0;
+		Core_Lost_Cycles_Count++; // This is a 2-cycle instruction
+		LOG(LOG_LEVEL_DEBUG, "PCL was written, new Program Counter value is : 0x%04X.\n", Core_Program_Counter);
+	}
+	// The program counter is 13-bit wide, so it rolls over to the reset vector after the last program memory location
+	Core_Program_Counter &= PROGRAM_MEMORY_SIZE - 1;
+	
+	// Account for the wasted cycles (a conditional test was true, the program counter was changed or a peripheral stalled the core) all at once, the caller clocks the peripherals with the same amount
+	Cycles = 1 + Core_Lost_Cycles_Count;
+	Core_Cycles_Count += Core_Lost_Cycles_Count;
+	Core_Lost_Cycles_Count = 0;
 	
-Exit:
 	// Check for interrupt
-	if (RegisterFileHasInterruptFired())
+	if (InterruptControllerGetPendingInterrupts())
 	{
+		LOG(LOG_LEVEL_DEBUG, "Interrupt fired (pending interrupts : 0x%04X). Branching to interrupt handler entry point.\n", InterruptControllerGetPendingInterrupts());
+		
 		// Disable the interrupts to avoid looping to the interrupt handler at each instruction
 		Temp_Byte = RegisterFileBankedRead(REGISTER_FILE_REGISTER_ADDRESS_INTCON);
 		Temp_Byte &= ~REGISTER_FILE_REGISTER_BIT_INTCON_GIE;
 		RegisterFileBankedWrite(REGISTER_FILE_REGISTER_ADDRESS_INTCON, Temp_Byte);
 		
-		// Push the Program Counter return value (PC + 1)
-		CoreStackPush(Core_Program_Counter + 1);
+		// Push the address of the next instruction to execute
+		CoreStackPush(Core_Program_Counter);
 		// Branch to the interrupt handler entry point
 		Core_Program_Counter = 0x0004;
-		LOG(LOG_LEVEL_DEBUG, "Interrupt fired. Branching to interrupt handler entry point.\n");
 	}
-
-	// Save the new Program Counter value to PCL
-	RegisterFileBankedWrite(REGISTER_FILE_REGISTER_ADDRESS_PCL, (unsigned char) Core_Program_Counter);
-	LOG(LOG_LEVEL_DEBUG, "Finished instruction execution, new Program Counter value is : 0x%04X.\n", Core_Program_Counter);
 	
-	// Wait a little if the host CPU is too fast to emulate the real PIC instruction cycle
-	do
+	// Wait a little if the host CPU is too fast to emulate the real PIC instruction cycles
+	if (!Core_Is_Pacing_Enabled) return Cycles;
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_THROTTLING);
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+	Current_Time = Time.tv_sec * 1000000000LL + Time.tv_nsec; // Keep the seconds, an instruction cycle can last more than one second with a slow oscillator
+	
+	// The deadline is absolute, so the time spent outside of this function is not added to each instruction duration. Do not catch up with a long delay (the board was halted by the debugger, the host was busy...), this would run the next instructions at full speed
+	Core_Pacing_Deadline += (long long) Cycles * Core_Paced_Instruction_Cycle_Time;
+	if (Current_Time - Core_Pacing_Deadline > CORE_MAXIMUM_PACING_DELAY) Core_Pacing_Deadline = Current_Time;
+	
+	while (Current_Time < Core_Pacing_Deadline) // This looks like a dirty hand-made spinlock but it was the only way to get an accurate time, clock_nanosleep() was too slow for this usage
 	{
-		// Get the current clock value
 		clock_gettime(CLOCK_MONOTONIC, &Time);
-		Current_Time = Time.tv_nsec;
-		
-		// Compute the gap between the two time values
-		if (Start_Time > Current_Time) Start_Time -= 1000000000L; // Handle the wrap-around by adjusting the start time to be negative, so it can be subtracted from the positive current time resulting in a positive value
-		Elapsed_Time = Current_Time - Start_Time;
-	} while (Elapsed_Time < CORE_INSTRUCTION_EXECUTION_TIME); // This looks like a dirty hand-made spinlock but it was the only way to get an accurate time, clock_nanosleep() was too slow for this usage
+		Current_Time = Time.tv_sec * 1000000000LL + Time.tv_nsec;
+	}
+	INSTRUMENTATION_LEAVE();
+	return Cycles;
+}
+
+void CoreReset(void)
+{
+	Core_Stack_Pointer = 0;
+	Core_Register_W = 0;
+	Core_Program_Counter = 0;
+	Core_Is_PCL_Written = 0;
+	Core_Lost_Cycles_Count = 0;
+	Core_Cycles_Count = 0;
+}
+
+void CoreEnableThrottling(int Is_Enabled)
+{
+	Core_Is_Throttling_Enabled = Is_Enabled;
+	CoreUpdatePacing();
+}
+
+int CoreSetOscillatorFrequency(unsigned int Frequency)
+{
+	if ((Frequency == 0) || (Frequency > CORE_MAXIMUM_OSCILLATOR_FREQUENCY))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : the oscillator frequency must be between 1 and %u Hz (%u Hz requested).\n", CORE_MAXIMUM_OSCILLATOR_FREQUENCY, Frequency);
+		return 1;
+	}
+	
+	Core_Oscillator_Frequency = Frequency;
+	CoreUpdatePacing();
+	LOG(LOG_LEVEL_DEBUG, "Oscillator frequency set to %u Hz.\n", Frequency);
+	return 0;
+}
+
+int CoreSetTimeScale(double Time_Scale)
+{
+	if ((Time_Scale < 0) || (Time_Scale > CORE_MAXIMUM_TIME_SCALE))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : the time scale must be between 0 and %d (%g requested).\n", CORE_MAXIMUM_TIME_SCALE, Time_Scale);
+		return 1;
+	}
+	
+	Core_Time_Scale = Time_Scale;
+	CoreUpdatePacing();
+	LOG(LOG_LEVEL_DEBUG, "Time scale set to %g.\n", Time_Scale);
+	return 0;
+}
+
+void CoreStall(unsigned int Cycles)
+{
+	Core_Lost_Cycles_Count += Cycles;
+	if (Core_Register_Access_Mode == CORE_REGISTER_ACCESS_MODE_RECORD) Pointer_Core_Lockstep_Result->Stalled_Cycles_Count += Cycles;
+}
+
+unsigned short CoreGetProgramCounter(void)
+{
+	return Core_Program_Counter;
+}
+
+void CoreGetState(TCoreState *Pointer_State)
+{
+	Pointer_State->Register_W = Core_Register_W;
+	Pointer_State->Program_Counter = Core_Program_Counter;
+	memcpy(Pointer_State->Stack, Core_Stack, sizeof(Core_Stack));
+	Pointer_State->Stack_Pointer = Core_Stack_Pointer;
+	Pointer_State->Lost_Cycles_Count = Core_Lost_Cycles_Count;
+	Pointer_State->Cycles_Count = Core_Cycles_Count;
+}
+
+void CoreSetState(const TCoreState *Pointer_State)
+{
+	Core_Register_W = Pointer_State->Register_W;
+	Core_Program_Counter = Pointer_State->Program_Counter & (PROGRAM_MEMORY_SIZE - 1);
+	memcpy(Core_Stack, Pointer_State->Stack, sizeof(Core_Stack));
+	Core_Stack_Pointer = Pointer_State->Stack_Pointer;
+	if ((Core_Stack_Pointer < 0) || (Core_Stack_Pointer > CORE_STACK_SIZE)) Core_Stack_Pointer = 0;
+	Core_Lost_Cycles_Count = Pointer_State->Lost_Cycles_Count;
+	Core_Cycles_Count = Pointer_State->Cycles_Count;
+}
+
+unsigned long long CoreGetCyclesCount(void)
+{
+	return Core_Cycles_Count;
+}
+
+unsigned int CoreConvertMicrosecondsToCycles(unsigned int Microseconds)
+{
+	unsigned long long Divider = 1000000ULL * CORE_OSCILLATOR_PERIODS_PER_INSTRUCTION_CYCLE;
+	
+	return ((unsigned long long) Microseconds * Core_Oscillator_Frequency + Divider - 1) / Divider;
+}
+
+void CoreSetTraceCallback(TCoreTraceCallback Trace_Callback)
+{
+	Core_Trace_Callback = Trace_Callback;
+}
+
+void CoreSetEngine(TCoreEngine Engine)
+{
+	Core_Engine = Engine;
+}
+
+int CoreIsDivergenceFound(void)
+{
+	return Core_Is_Divergence_Found;
+}
+
+void CoreDump(void)
+{
+	char String_Address[DISASSEMBLER_ADDRESS_STRING_SIZE], String_Instruction[DISASSEMBLER_INSTRUCTION_STRING_SIZE];
+	unsigned short Program_Counter;
+	int i, Stack_Pointer;
+	
+	// The core keeps running meanwhile, so work on a copy of the values that must be consistent
+	Program_Counter = Core_Program_Counter;
+	Stack_Pointer = Core_Stack_Pointer;
+	
+	DisassemblerFormatAddress(Program_Counter, String_Address, sizeof(String_Address));
+	DisassemblerDecodeInstruction(Program_Counter, ProgramMemoryRead(Program_Counter), String_Instruction, sizeof(String_Instruction));
+	LOG(LOG_LEVEL_ERROR, "PC = %s : %s\n", String_Address, String_Instruction);
+	LOG(LOG_LEVEL_ERROR, "W = 0x%02X\n", Core_Register_W);
+	LOG(LOG_LEVEL_ERROR, "Cycles count = %llu\n", Core_Cycles_Count);
+	
+	// Display the return addresses from the most recent one
+	LOG(LOG_LEVEL_ERROR, "Stack (%d entries) :\n", Stack_Pointer);
+	for (i = Stack_Pointer - 1; i >= 0; i--)
+	{
+		DisassemblerFormatAddress(Core_Stack[i], String_Address, sizeof(String_Address));
+		LOG(LOG_LEVEL_ERROR, "  %d : %s\n", i, String_Address);
+	}
 }
@@ -0,0 +1,108 @@
+/** @file Coverage.c
+ * @see Coverage.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Coverage.h>
+#include <errno.h>
+#include <Log.h>
+#include <stdio.h>
+#include <string.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Identify a coverage file and its format version. */
+#define COVERAGE_FILE_MAGIC "PICCOV02"
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** A coverage file content. Bitmaps are byte arrays and the program hash is stored byte by byte, so the file does not depend on the host endianness. */
+typedef struct
+{
+	char Magic[8]; //! Must be COVERAGE_FILE_MAGIC (without the terminating zero).
+	unsigned char Program_Hash[8]; //! The hash of the hex file the coverage has been recorded with, least significant byte first.
+	TCoverageMap Map; //! The coverage.
+} TCoverageFile;
+
+//-------------------------------------------------------------------------------------------------
+// Public variables
+//-------------------------------------------------------------------------------------------------
+TCoverageMap Coverage_Map;
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void CoverageMergeMaps(TCoverageMap *Pointer_Destination_Map, const TCoverageMap *Pointer_Source_Map)
+{
+	int i;
+	
+	for (i = 0; i < COVERAGE_BITMAP_SIZE; i++)
+	{
+		Pointer_Destination_Map->Executed_Instructions_Bitmap[i] |= Pointer_Source_Map->Executed_Instructions_Bitmap[i];
+		Pointer_Destination_Map->Taken_Skips_Bitmap[i] |= Pointer_Source_Map->Taken_Skips_Bitmap[i];
+		Pointer_Destination_Map->Not_Taken_Skips_Bitmap[i] |= Pointer_Source_Map->Not_Taken_Skips_Bitmap[i];
+	}
+}
+
+int CoverageLoadFile(char *String_File, TCoverageMap *Pointer_Map, unsigned long long *Pointer_Program_Hash)
+{
+	FILE *Pointer_File;
+	static TCoverageFile File_Content; // Avoid putting several KB on the stack
+	int Return_Value = 1, i;
+	
+	Pointer_File = fopen(String_File, "rb");
+	if (Pointer_File == NULL)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : failed to open the coverage file '%s' (%s).\n", String_File, strerror(errno));
+		return 1;
+	}
+	
+	if (fread(&File_Content, sizeof(File_Content), 1, Pointer_File) != 1)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : the coverage file '%s' is truncated.\n", String_File);
+		goto Exit;
+	}
+	if (memcmp(File_Content.Magic, COVERAGE_FILE_MAGIC, sizeof(File_Content.Magic)) != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : '%s' is not a coverage file.\n", String_File);
+		goto Exit;
+	}
+	memcpy(Pointer_Map, &File_Content.Map, sizeof(TCoverageMap));
+	*Pointer_Program_Hash = 0;
+	for (i = sizeof(File_Content.Program_Hash) - 1; i >= 0; i--) *Pointer_Program_Hash = (*Pointer_Program_Hash << 8) | File_Content.Program_Hash[i];
+	Return_Value = 0;
+	
+Exit:
+	fclose(Pointer_File);
+	return Return_Value;
+}
+
+int CoverageStoreFile(char *String_File, const TCoverageMap *Pointer_Map, unsigned long long Program_Hash)
+{
+	FILE *Pointer_File;
+	static TCoverageFile File_Content;
+	int Return_Value = 1, i;
+	
+	memcpy(File_Content.Magic, COVERAGE_FILE_MAGIC, sizeof(File_Content.Magic));
+	for (i = 0; i < (int) sizeof(File_Content.Program_Hash); i++) File_Content.Program_Hash[i] = (unsigned char) (Program_Hash >> (i * 8));
+	memcpy(&File_Content.Map, Pointer_Map, sizeof(TCoverageMap));
+	
+	Pointer_File = fopen(String_File, "wb");
+	if (Pointer_File == NULL)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : failed to create the coverage file '%s' (%s).\n", String_File, strerror(errno));
+		return 1;
+	}
+	
+	if (fwrite(&File_Content, sizeof(File_Content), 1, Pointer_File) != 1)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : failed to write the coverage file '%s' (%s).\n", String_File, strerror(errno));
+		goto Exit;
+	}
+	Return_Value = 0;
+	
+Exit:
+	if (fclose(Pointer_File) != 0) Return_Value = 1; // Buffered data may fail to be written here
+	return Return_Value;
+}
@@ -0,0 +1,233 @@
+/** @file Coverage_Report.c
+ * Merge the coverage files written by several simulator runs and show which instructions and conditional skip outcomes of the program were never exercised.
+ * @author Adrien RICCIARDI
+ */
+#include <Coverage.h>
+#include <Disassembler.h>
+#include <Log.h>
+#include <Program_Memory.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** How many runs exercised each program memory location. */
+typedef struct
+{
+	unsigned int Executed_Instructions[PROGRAM_MEMORY_SIZE]; //! How many runs executed the instruction.
+	unsigned int Taken_Skips[PROGRAM_MEMORY_SIZE]; //! How many runs saw the conditional skip instruction skip the next instruction.
+	unsigned int Not_Taken_Skips[PROGRAM_MEMORY_SIZE]; //! How many runs saw the conditional skip instruction execute the next instruction.
+} TCoverageReportRunsCount;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The coverage of all runs. */
+static TCoverageMap Coverage_Report_Merged_Map;
+
+/** The per-location runs count of all runs. */
+static TCoverageReportRunsCount Coverage_Report_Runs_Count;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Add a run coverage to the per-location runs count.
+ * @param Pointer_Map The run coverage.
+ */
+static void CoverageReportCountRun(TCoverageMap *Pointer_Map)
+{
+	unsigned short Address;
+	
+	for (Address = 0; Address < PROGRAM_MEMORY_SIZE; Address++)
+	{
+		Coverage_Report_Runs_Count.Executed_Instructions[Address] += CoverageIsAddressSet(Pointer_Map->Executed_Instructions_Bitmap, Address);
+		Coverage_Report_Runs_Count.Taken_Skips[Address] += CoverageIsAddressSet(Pointer_Map->Taken_Skips_Bitmap, Address);
+		Coverage_Report_Runs_Count.Not_Taken_Skips[Address] += CoverageIsAddressSet(Pointer_Map->Not_Taken_Skips_Bitmap, Address);
+	}
+}
+
+/** Tell whether a program memory location must be reported. Unprogrammed locations read as NOP, so a never executed NOP is considered unprogrammed.
+ * @param Address The location.
+ * @return 0 if the location must be ignored,
+ * @return 1 if the location must be reported.
+ */
+static int CoverageReportIsAddressReported(unsigned short Address)
+{
+	return (ProgramMemoryRead(Address) != 0) || (Coverage_Report_Runs_Count.Executed_Instructions[Address] > 0);
+}
+
+/** Display the program memory with the runs count of each instruction, then the coverage summary.
+ * @param String_Hex_File The program file name.
+ * @param Runs_Count How many coverage files have been merged.
+ */
+static void CoverageReportDisplayListing(char *String_Hex_File, int Runs_Count)
+{
+	unsigned short Address, Instruction;
+	unsigned int Instructions_Count = 0, Executed_Instructions_Count = 0, Skip_Outcomes_Count = 0, Seen_Skip_Outcomes_Count = 0;
+	char String_Runs_Count[16], String_Instruction[DISASSEMBLER_INSTRUCTION_STRING_SIZE];
+	const char *String_Symbol;
+	
+	printf("Coverage of '%s' from %d run(s).\n", String_Hex_File, Runs_Count);
+	printf("%7s | %7s | %-40s | %s\n", "Runs", "Address", "Instruction", "Skipped / Not skipped");
+	for (Address = 0; Address < PROGRAM_MEMORY_SIZE; Address++)
+	{
+		if (!CoverageReportIsAddressReported(Address)) continue;
+		Instruction = ProgramMemoryRead(Address);
+		
+		// Show never executed instructions like gcov does
+		Instructions_Count++;
+		if (Coverage_Report_Runs_Count.Executed_Instructions[Address] > 0)
+		{
+			snprintf(String_Runs_Count, sizeof(String_Runs_Count), "%u", Coverage_Report_Runs_Count.Executed_Instructions[Address]);
+			Executed_Instructions_Count++;
+		}
+		else strcpy(String_Runs_Count, "#####");
+		
+		// Show labels on their own line like in the assembler source
+		String_Symbol = DisassemblerGetSymbol(Address);
+		if (String_Symbol != NULL) printf("%7s | %7s | %s:\n", "", "", String_Symbol);
+		DisassemblerDecodeInstruction(Address, Instruction, String_Instruction, sizeof(String_Instruction));
+		printf("%7s |  0x%04X | %-40s |", String_Runs_Count, Address, String_Instruction);
+		
+		// Tell which ways the conditional skips went
+		if (DisassemblerIsConditionalSkip(Instruction))
+		{
+			printf(" %u / %u", Coverage_Report_Runs_Count.Taken_Skips[Address], Coverage_Report_Runs_Count.Not_Taken_Skips[Address]);
+			Skip_Outcomes_Count += 2;
+			if (Coverage_Report_Runs_Count.Taken_Skips[Address] > 0) Seen_Skip_Outcomes_Count++;
+			if (Coverage_Report_Runs_Count.Not_Taken_Skips[Address] > 0) Seen_Skip_Outcomes_Count++;
+		}
+		putchar('\n');
+	}
+	
+	printf("Executed instructions : %u/%u (%.1f%%).\n", Executed_Instructions_Count, Instructions_Count, Instructions_Count == 0 ? 0.0 : 100.0 * Executed_Instructions_Count / Instructions_Count);
+	printf("Seen conditional skip outcomes : %u/%u (%.1f%%).\n", Seen_Skip_Outcomes_Count, Skip_Outcomes_Count, Skip_Outcomes_Count == 0 ? 0.0 : 100.0 * Seen_Skip_Outcomes_Count / Skip_Outcomes_Count);
+}
+
+/** Display the coverage as a lcov tracefile, so lcov tools like genhtml can use it. Line numbers are the instruction addresses plus one, matching a one-instruction-per-line listing of the program memory.
+ * @param String_Hex_File The program file name.
+ */
+static void CoverageReportDisplayTracefile(char *String_Hex_File)
+{
+	unsigned short Address, Instruction;
+	unsigned int Lines_Count = 0, Hit_Lines_Count = 0, Branches_Count = 0, Hit_Branches_Count = 0;
+	
+	printf("TN:\nSF:%s\n", String_Hex_File);
+	for (Address = 0; Address < PROGRAM_MEMORY_SIZE; Address++)
+	{
+		if (!CoverageReportIsAddressReported(Address)) continue;
+		Instruction = ProgramMemoryRead(Address);
+		
+		// Conditional skips are two-way branches, "-" tells that the branch was never evaluated
+		if (DisassemblerIsConditionalSkip(Instruction))
+		{
+			Branches_Count += 2;
+			if (Coverage_Report_Runs_Count.Executed_Instructions[Address] == 0) printf("BRDA:%u,0,0,-\nBRDA:%u,0,1,-\n", Address + 1, Address + 1);
+			else
+			{
+				printf("BRDA:%u,0,0,%u\nBRDA:%u,0,1,%u\n", Address + 1, Coverage_Report_Runs_Count.Taken_Skips[Address], Address + 1, Coverage_Report_Runs_Count.Not_Taken_Skips[Address]);
+				if (Coverage_Report_Runs_Count.Taken_Skips[Address] > 0) Hit_Branches_Count++;
+				if (Coverage_Report_Runs_Count.Not_Taken_Skips[Address] > 0) Hit_Branches_Count++;
+			}
+		}
+		
+		printf("DA:%u,%u\n", Address + 1, Coverage_Report_Runs_Count.Executed_Instructions[Address]);
+		Lines_Count++;
+		if (Coverage_Report_Runs_Count.Executed_Instructions[Address] > 0) Hit_Lines_Count++;
+	}
+	printf("BRF:%u\nBRH:%u\nLF:%u\nLH:%u\nend_of_record\n", Branches_Count, Hit_Branches_Count, Lines_Count, Hit_Lines_Count);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Entry point
+//-------------------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+	char *String_Hex_File, *String_Merged_Coverage_File = NULL, *String_Listing_File = NULL;
+	int Option, Is_Tracefile_Displayed = 0, i;
+	unsigned long long Program_Hash;
+	static TCoverageMap Map; // Avoid putting several KB on the stack
+	
+	// Retrieve options
+	while ((Option = getopt(argc, argv, "lo:s:")) != -1)
+	{
+		switch (Option)
+		{
+			// lcov tracefile output
+			case 'l':
+				Is_Tracefile_Displayed = 1;
+				break;
+			
+			// Merged coverage file
+			case 'o':
+				String_Merged_Coverage_File = optarg;
+				break;
+				
+			// Program symbols
+			case 's':
+				String_Listing_File = optarg;
+				break;
+			
+			default:
+				optind = argc; // Force the usage to be displayed
+				break;
+		}
+	}
+	
+	// Check parameters
+	if (argc - optind < 2)
+	{
+		printf("Usage : %s [-l] [-o Merged_Coverage_File] [-s Listing_File] Program_Hex_File Coverage_File...\n"
+			"  Program_Hex_File : the Intel Hex file the simulator executed.\n"
+			"  Coverage_File : one or more coverage files written by the simulator '-c' option, they are merged.\n"
+			"  -l : display a lcov tracefile instead of the program listing (line numbers are the instruction addresses plus one).\n"
+			"  -o Merged_Coverage_File : also write the merged coverage to a file that can be given to the simulator tools again.\n"
+			"  -s Listing_File : the assembler listing file of the program, its labels are displayed in the program listing.\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	String_Hex_File = argv[optind];
+	
+	LogInitialize("/dev/null", LOG_LEVEL_ERROR);
+	// This tool only reads files, do not create the program image next to the hex file
+	if (ProgramMemoryLoadHexFile(String_Hex_File, 0) != 0)
+	{
+		printf("Error : failed to load the hex file '%s'.\n", String_Hex_File);
+		return EXIT_FAILURE;
+	}
+	if ((String_Listing_File != NULL) && (DisassemblerLoadSymbols(String_Listing_File) != 0))
+	{
+		printf("Error : failed to load the listing file '%s'.\n", String_Listing_File);
+		return EXIT_FAILURE;
+	}
+	
+	// Merge all runs
+	for (i = optind + 1; i < argc; i++)
+	{
+		if (CoverageLoadFile(argv[i], &Map, &Program_Hash) != 0)
+		{
+			printf("Error : failed to load the coverage file '%s'.\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+		// The coverage of another program build does not match these instruction addresses
+		if (Program_Hash != ProgramMemoryGetHexFileHash())
+		{
+			printf("Error : the coverage file '%s' has been recorded with another program than '%s'.\n", argv[i], String_Hex_File);
+			return EXIT_FAILURE;
+		}
+		CoverageMergeMaps(&Coverage_Report_Merged_Map, &Map);
+		CoverageReportCountRun(&Map);
+	}
+	
+	if ((String_Merged_Coverage_File != NULL) && (CoverageStoreFile(String_Merged_Coverage_File, &Coverage_Report_Merged_Map, ProgramMemoryGetHexFileHash()) != 0))
+	{
+		printf("Error : failed to write the merged coverage file '%s'.\n", String_Merged_Coverage_File);
+		return EXIT_FAILURE;
+	}
+	
+	if (Is_Tracefile_Displayed) CoverageReportDisplayTracefile(String_Hex_File);
+	else CoverageReportDisplayListing(String_Hex_File, argc - optind - 1);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,393 @@
+/** @file Debugger.c
+ * @see Debugger.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Core.h>
+#include <Debugger.h>
+#include <errno.h>
+#include <Log.h>
+#include <Program_Memory.h>
+#include <pthread.h>
+#include <Snapshot.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** Tell which program memory locations hold a breakpoint. The CPU thread reads it without locking, so it is modified only while the board is halted. */
+static unsigned char Debugger_Breakpoints[PROGRAM_MEMORY_SIZE];
+/** How many breakpoints are set. */
+static unsigned int Debugger_Breakpoints_Count = 0;
+
+/** Tell the CPU thread to halt at the next instruction boundary. */
+static atomic_int Debugger_Is_Halt_Requested = 0;
+/** Tell the CPU thread to halt after having executed one instruction. Modified only while the board is halted. */
+static int Debugger_Is_Single_Step = 0;
+/** Tell whether the pending halt request comes from a watchpoint. */
+static int Debugger_Is_Watchpoint_Hit = 0;
+/** Tell whether the CPU thread is waiting to be resumed. */
+static int Debugger_Is_Halted = 0;
+/** Why the board halted the last time. */
+static TDebuggerStopReason Debugger_Stop_Reason = DEBUGGER_STOP_REASON_HALT_REQUEST;
+
+/** The cycles count when the board was resumed the last time, so the instruction the board was halted on does not halt it again. */
+static unsigned long long Debugger_Resume_Cycles_Count = ~0ULL;
+
+/** Protect the halt state. */
+static pthread_mutex_t Debugger_Mutex = PTHREAD_MUTEX_INITIALIZER;
+/** Wake the halted CPU thread up. */
+static pthread_cond_t Debugger_Condition_Resume = PTHREAD_COND_INITIALIZER;
+
+/** Signaled each time the board halts. */
+static int Debugger_Halt_Event_File_Descriptor = -1;
+
+/** When it is not ~0, the board is executing again instructions it has already executed and halts at the first instruction boundary reaching this cycle, whatever happens before. Modified only while the board is halted. */
+static unsigned long long Debugger_Stop_Cycles_Count = ~0ULL;
+/** Record the breakpoints and the watchpoints reached before Debugger_Stop_Cycles_Count instead of ignoring them. */
+static int Debugger_Is_Scanning = 0;
+/** Tell whether a watchpoint triggered by the instruction preceding Debugger_Stop_Cycles_Count must be recorded too. */
+static int Debugger_Is_Stop_Boundary_Scanned;
+/** The last instruction boundary found while scanning. */
+static unsigned long long Debugger_Last_Boundary_Cycles_Count;
+/** The last instruction boundary a breakpoint or a watchpoint was found at while scanning, ~0 if none was found. */
+static unsigned long long Debugger_Last_Hit_Cycles_Count;
+/** Wake the thread waiting for the board to reach Debugger_Stop_Cycles_Count. */
+static pthread_cond_t Debugger_Condition_Stop_Cycle_Reached = PTHREAD_COND_INITIALIZER;
+
+//-------------------------------------------------------------------------------------------------
+// Public variables
+//-------------------------------------------------------------------------------------------------
+atomic_int Debugger_Is_Armed = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Tell the CPU thread whether it must check the next instructions. The debugger mutex must be held. */
+static void DebuggerUpdateArmedState(void)
+{
+	atomic_store(&Debugger_Is_Armed, atomic_load(&Debugger_Is_Halt_Requested) || Debugger_Is_Single_Step || (Debugger_Breakpoints_Count > 0) || (Debugger_Stop_Cycles_Count != ~0ULL));
+}
+
+/** Record the breakpoints and the watchpoints reached while executing again instructions. The debugger mutex must be held.
+ * @return 0 if the board must halt because Debugger_Stop_Cycles_Count is reached,
+ * @return 1 if the board must continue.
+ */
+static int DebuggerScanInstructionBoundary(void)
+{
+	unsigned long long Cycles_Count;
+	int Is_Stop_Cycle_Reached;
+	
+	Cycles_Count = CoreGetCyclesCount();
+	Is_Stop_Cycle_Reached = (Cycles_Count >= Debugger_Stop_Cycles_Count);
+	
+	if (Debugger_Is_Scanning)
+	{
+		if (!Is_Stop_Cycle_Reached)
+		{
+			Debugger_Last_Boundary_Cycles_Count = Cycles_Count;
+			if (Debugger_Is_Watchpoint_Hit || Debugger_Breakpoints[CoreGetProgramCounter()]) Debugger_Last_Hit_Cycles_Count = Cycles_Count;
+		}
+		else if (Debugger_Is_Watchpoint_Hit && Debugger_Is_Stop_Boundary_Scanned) Debugger_Last_Hit_Cycles_Count = Cycles_Count;
+	}
+	if (Is_Stop_Cycle_Reached) return 0;
+	
+	// Only the watchpoints triggered right before the stop cycle matter
+	Debugger_Is_Watchpoint_Hit = 0;
+	return 1;
+}
+
+/** Execute again instructions from the current cycle, and wait for the board to halt. The board must be halted and the debugger mutex must not be held.
+ * @param Stop_Cycles_Count Halt at the first instruction boundary reaching this cycle.
+ * @param Is_Scanning Set to 1 to record the breakpoints and watchpoints found on the way, set to 0 to ignore them.
+ * @param Is_Stop_Boundary_Scanned Set to 1 to record a watchpoint triggered by the instruction preceding the stop cycle.
+ * @return 0 if the board halted at the requested cycle,
+ * @return 1 if the board has been released meanwhile.
+ */
+static int DebuggerExecuteAgain(unsigned long long Stop_Cycles_Count, int Is_Scanning, int Is_Stop_Boundary_Scanned)
+{
+	int Return_Value;
+	
+	pthread_mutex_lock(&Debugger_Mutex);
+	
+	Debugger_Stop_Cycles_Count = Stop_Cycles_Count;
+	Debugger_Is_Scanning = Is_Scanning;
+	Debugger_Is_Stop_Boundary_Scanned = Is_Stop_Boundary_Scanned;
+	Debugger_Is_Watchpoint_Hit = 0;
+	Debugger_Is_Single_Step = 0;
+	Debugger_Is_Halted = 0;
+	DebuggerUpdateArmedState();
+	pthread_cond_signal(&Debugger_Condition_Resume);
+	
+	// The real time does not matter for instructions that have already been executed
+	CoreEnableThrottling(0);
+	while (!Debugger_Is_Halted && (Debugger_Stop_Cycles_Count != ~0ULL)) pthread_cond_wait(&Debugger_Condition_Stop_Cycle_Reached, &Debugger_Mutex);
+	CoreEnableThrottling(1);
+	
+	Return_Value = !Debugger_Is_Halted;
+	Debugger_Stop_Cycles_Count = ~0ULL;
+	Debugger_Is_Scanning = 0;
+	DebuggerUpdateArmedState();
+	
+	pthread_mutex_unlock(&Debugger_Mutex);
+	return Return_Value;
+}
+
+/** Set the stop reason of a board halted by an execution backward.
+ * @param Stop_Reason The stop reason.
+ */
+static void DebuggerSetStopReason(TDebuggerStopReason Stop_Reason)
+{
+	pthread_mutex_lock(&Debugger_Mutex);
+	Debugger_Stop_Reason = Stop_Reason;
+	pthread_mutex_unlock(&Debugger_Mutex);
+}
+
+/** Set the board back to a snapshot and execute instructions again until a cycle. The board must be halted and the debugger mutex must not be held.
+ * @param Snapshot_Index The snapshot to start from.
+ * @param Stop_Cycles_Count The instruction boundary to halt at, it must be equal to or greater than the snapshot cycle.
+ * @return 0 if the board halted at the requested cycle,
+ * @return 1 if the board has been released meanwhile.
+ */
+static int DebuggerGoBackTo(int Snapshot_Index, unsigned long long Stop_Cycles_Count)
+{
+	SnapshotRestore(Snapshot_Index);
+	if (CoreGetCyclesCount() < Stop_Cycles_Count) return DebuggerExecuteAgain(Stop_Cycles_Count, 0, 0); // The stop reason is set when the board halts
+	
+	// The snapshot is the requested instruction boundary
+	if (Debugger_Breakpoints[CoreGetProgramCounter()]) DebuggerSetStopReason(DEBUGGER_STOP_REASON_BREAKPOINT);
+	else DebuggerSetStopReason(DEBUGGER_STOP_REASON_SINGLE_STEP);
+	return 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int DebuggerInitialize(void)
+{
+	Debugger_Halt_Event_File_Descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (Debugger_Halt_Event_File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the debugger halt event (%s).\n", strerror(errno));
+		return 1;
+	}
+	return 0;
+}
+
+void DebuggerCheck(void)
+{
+	uint64_t Event_Value = 1;
+	
+	// Instructions executed again only halt at the requested cycle
+	if (Debugger_Stop_Cycles_Count != ~0ULL)
+	{
+		pthread_mutex_lock(&Debugger_Mutex);
+		if (DebuggerScanInstructionBoundary())
+		{
+			pthread_mutex_unlock(&Debugger_Mutex);
+			return;
+		}
+		
+		if (Debugger_Is_Watchpoint_Hit) Debugger_Stop_Reason = DEBUGGER_STOP_REASON_WATCHPOINT;
+		else if (Debugger_Breakpoints[CoreGetProgramCounter()]) Debugger_Stop_Reason = DEBUGGER_STOP_REASON_BREAKPOINT;
+		else Debugger_Stop_Reason = DEBUGGER_STOP_REASON_SINGLE_STEP;
+	}
+	else
+	{
+		// Do not take the lock unless the board really needs to halt
+		if (!atomic_load(&Debugger_Is_Halt_Requested))
+		{
+			if (CoreGetCyclesCount() == Debugger_Resume_Cycles_Count) return; // No instruction has been executed since the board was resumed
+			if (!Debugger_Is_Single_Step && !Debugger_Breakpoints[CoreGetProgramCounter()]) return;
+		}
+		
+		pthread_mutex_lock(&Debugger_Mutex);
+		
+		if (Debugger_Is_Watchpoint_Hit) Debugger_Stop_Reason = DEBUGGER_STOP_REASON_WATCHPOINT;
+		else if (atomic_load(&Debugger_Is_Halt_Requested)) Debugger_Stop_Reason = DEBUGGER_STOP_REASON_HALT_REQUEST;
+		else if (Debugger_Is_Single_Step) Debugger_Stop_Reason = DEBUGGER_STOP_REASON_SINGLE_STEP;
+		else Debugger_Stop_Reason = DEBUGGER_STOP_REASON_BREAKPOINT;
+	}
+	atomic_store(&Debugger_Is_Halt_Requested, 0);
+	Debugger_Is_Watchpoint_Hit = 0;
+	Debugger_Is_Single_Step = 0;
+	Debugger_Is_Halted = 1;
+	LOG(LOG_LEVEL_DEBUG, "Board halted at address 0x%04X (reason : %d).\n", CoreGetProgramCounter(), Debugger_Stop_Reason);
+	
+	// Tell the front end (or the execution backward in progress) and wait for it to resume the board
+	if (Debugger_Stop_Cycles_Count != ~0ULL) pthread_cond_signal(&Debugger_Condition_Stop_Cycle_Reached);
+	else if (write(Debugger_Halt_Event_File_Descriptor, &Event_Value, sizeof(Event_Value)) != sizeof(Event_Value)) LOG(LOG_LEVEL_WARNING, "WARNING : failed to signal the debugger halt event (%s).\n", strerror(errno));
+	while (Debugger_Is_Halted) pthread_cond_wait(&Debugger_Condition_Resume, &Debugger_Mutex);
+	
+	Debugger_Resume_Cycles_Count = CoreGetCyclesCount();
+	DebuggerUpdateArmedState();
+	
+	pthread_mutex_unlock(&Debugger_Mutex);
+}
+
+void DebuggerHalt(void)
+{
+	pthread_mutex_lock(&Debugger_Mutex);
+	
+	// The board may have reached a breakpoint meanwhile, a pending request would halt it again right after it is resumed
+	if (!Debugger_Is_Halted)
+	{
+		atomic_store(&Debugger_Is_Halt_Requested, 1);
+		atomic_store(&Debugger_Is_Armed, 1);
+	}
+	
+	pthread_mutex_unlock(&Debugger_Mutex);
+}
+
+void DebuggerHaltOnWatchpoint(void)
+{
+	pthread_mutex_lock(&Debugger_Mutex);
+	
+	// Instructions executed again only record the watchpoint
+	if (Debugger_Stop_Cycles_Count != ~0ULL) Debugger_Is_Watchpoint_Hit = 1;
+	else if (!Debugger_Is_Halted)
+	{
+		Debugger_Is_Watchpoint_Hit = 1;
+		atomic_store(&Debugger_Is_Halt_Requested, 1);
+		atomic_store(&Debugger_Is_Armed, 1);
+	}
+	
+	pthread_mutex_unlock(&Debugger_Mutex);
+}
+
+void DebuggerResume(int Is_Single_Step)
+{
+	pthread_mutex_lock(&Debugger_Mutex);
+	
+	Debugger_Is_Single_Step = Is_Single_Step;
+	Debugger_Is_Halted = 0;
+	DebuggerUpdateArmedState();
+	pthread_cond_signal(&Debugger_Condition_Resume);
+	
+	pthread_mutex_unlock(&Debugger_Mutex);
+}
+
+int DebuggerIsExecutingBackward(void)
+{
+	// The stop cycle is modified only while the board is halted, so the CPU thread can read it without the lock
+	return Debugger_Stop_Cycles_Count != ~0ULL;
+}
+
+void DebuggerRelease(void)
+{
+	pthread_mutex_lock(&Debugger_Mutex);
+	
+	memset(Debugger_Breakpoints, 0, sizeof(Debugger_Breakpoints));
+	Debugger_Breakpoints_Count = 0;
+	atomic_store(&Debugger_Is_Halt_Requested, 0);
+	Debugger_Is_Watchpoint_Hit = 0;
+	Debugger_Is_Single_Step = 0;
+	Debugger_Is_Halted = 0;
+	Debugger_Stop_Cycles_Count = ~0ULL; // Abort an execution backward in progress
+	Debugger_Is_Scanning = 0;
+	DebuggerUpdateArmedState();
+	pthread_cond_signal(&Debugger_Condition_Resume);
+	pthread_cond_signal(&Debugger_Condition_Stop_Cycle_Reached);
+	
+	pthread_mutex_unlock(&Debugger_Mutex);
+}
+
+int DebuggerGetHaltEventFileDescriptor(void)
+{
+	return Debugger_Halt_Event_File_Descriptor;
+}
+
+TDebuggerStopReason DebuggerGetStopReason(void)
+{
+	TDebuggerStopReason Stop_Reason;
+	
+	pthread_mutex_lock(&Debugger_Mutex);
+	Stop_Reason = Debugger_Stop_Reason;
+	pthread_mutex_unlock(&Debugger_Mutex);
+	
+	return Stop_Reason;
+}
+
+int DebuggerSetBreakpoint(unsigned short Address, int Is_Enabled)
+{
+	if (Address >= PROGRAM_MEMORY_SIZE) return 1;
+	
+	pthread_mutex_lock(&Debugger_Mutex);
+	
+	if (Is_Enabled && !Debugger_Breakpoints[Address])
+	{
+		Debugger_Breakpoints[Address] = 1;
+		Debugger_Breakpoints_Count++;
+	}
+	else if (!Is_Enabled && Debugger_Breakpoints[Address])
+	{
+		Debugger_Breakpoints[Address] = 0;
+		Debugger_Breakpoints_Count--;
+	}
+	DebuggerUpdateArmedState();
+	
+	pthread_mutex_unlock(&Debugger_Mutex);
+	
+	return 0;
+}
+
+int DebuggerReverseStep(void)
+{
+	unsigned long long Cycles_Count;
+	int Snapshot_Index;
+	
+	// Each snapshot is taken at an instruction boundary, so the previous instruction boundary is in the newest interval starting before the current instruction
+	Cycles_Count = CoreGetCyclesCount();
+	Snapshot_Index = SnapshotFind(Cycles_Count);
+	if (Snapshot_Index < 0)
+	{
+		DebuggerSetStopReason(DEBUGGER_STOP_REASON_HISTORY_START);
+		return 1;
+	}
+	
+	// The snapshot itself can be the previous instruction boundary
+	SnapshotRestore(Snapshot_Index);
+	Debugger_Last_Boundary_Cycles_Count = CoreGetCyclesCount();
+	if (DebuggerExecuteAgain(Cycles_Count, 1, 0) != 0) return 1;
+	
+	if (DebuggerGoBackTo(Snapshot_Index, Debugger_Last_Boundary_Cycles_Count) != 0) return 1;
+	DebuggerSetStopReason(DEBUGGER_STOP_REASON_SINGLE_STEP);
+	return 0;
+}
+
+int DebuggerReverseContinue(void)
+{
+	unsigned long long End_Cycles_Count;
+	int Snapshot_Index, Is_Stop_Boundary_Scanned = 0;
+	
+	// Scan the snapshot intervals from the newest one, the last breakpoint or watchpoint found in an interval is the one to halt at
+	End_Cycles_Count = CoreGetCyclesCount();
+	Snapshot_Index = SnapshotFind(End_Cycles_Count);
+	if (Snapshot_Index < 0)
+	{
+		DebuggerSetStopReason(DEBUGGER_STOP_REASON_HISTORY_START);
+		return 1;
+	}
+	while (Snapshot_Index >= 0)
+	{
+		SnapshotRestore(Snapshot_Index);
+		
+		if (Debugger_Breakpoints[CoreGetProgramCounter()]) Debugger_Last_Hit_Cycles_Count = CoreGetCyclesCount();
+		else Debugger_Last_Hit_Cycles_Count = ~0ULL;
+		if (DebuggerExecuteAgain(End_Cycles_Count, 1, Is_Stop_Boundary_Scanned) != 0) return 1;
+		
+		if (Debugger_Last_Hit_Cycles_Count != ~0ULL) return DebuggerGoBackTo(Snapshot_Index, Debugger_Last_Hit_Cycles_Count);
+		
+		// A watchpoint triggered by the instruction preceding the next interval can only be seen from this one
+		End_Cycles_Count = SnapshotGetCyclesCount(Snapshot_Index);
+		Is_Stop_Boundary_Scanned = 1;
+		Snapshot_Index--;
+	}
+	
+	// Halt at the oldest recorded cycle
+	SnapshotRestore(0);
+	DebuggerSetStopReason(DEBUGGER_STOP_REASON_HISTORY_START);
+	return 1;
+}
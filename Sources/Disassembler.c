@@ -0,0 +1,377 @@
+/** @file Disassembler.c
+ * @see Disassembler.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <ctype.h>
+#include <Disassembler.h>
+#include <errno.h>
+#include <Log.h>
+#include <Program_Memory.h>
+#include <Register_File.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** How many labels can be loaded. */
+#define DISASSEMBLER_MAXIMUM_SYMBOLS_COUNT 4096
+/** How many characters of a label name are kept. */
+#define DISASSEMBLER_MAXIMUM_SYMBOL_NAME_LENGTH 47
+
+/** The longest listing file line that can be parsed, longer lines are truncated. */
+#define DISASSEMBLER_MAXIMUM_LISTING_LINE_LENGTH 512
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** How the instruction operands are encoded. */
+typedef enum
+{
+	DISASSEMBLER_OPERANDS_FORMAT_NONE, //! No operand.
+	DISASSEMBLER_OPERANDS_FORMAT_FILE, //! A 7-bit file register address.
+	DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, //! A 7-bit file register address and the destination bit.
+	DISASSEMBLER_OPERANDS_FORMAT_FILE_BIT, //! A 7-bit file register address and a 3-bit bit number.
+	DISASSEMBLER_OPERANDS_FORMAT_LITERAL, //! An 8-bit literal.
+	DISASSEMBLER_OPERANDS_FORMAT_ADDRESS //! An 11-bit program memory address.
+} TDisassemblerOperandsFormat;
+
+/** Describe how to recognize an instruction. */
+typedef struct
+{
+	unsigned short Mask; //! The instruction bits that are not operands.
+	unsigned short Value; //! The instruction bits value once masked.
+	const char *String_Mnemonic; //! The instruction name.
+	TDisassemblerOperandsFormat Operands_Format; //! How to decode the operands.
+	int Is_Conditional_Skip; //! Set to 1 if the instruction may skip the next one.
+} TDisassemblerInstructionDescription;
+
+/** A label found in the listing file. */
+typedef struct
+{
+	unsigned short Address; //! The labeled program memory address.
+	char String_Name[DISASSEMBLER_MAXIMUM_SYMBOL_NAME_LENGTH + 1]; //! The label name.
+} TDisassemblerSymbol;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** All instructions the core knows, in the order the core decodes them (the first matching entry wins). */
+static const TDisassemblerInstructionDescription Disassembler_Instructions[] =
+{
+	// No operand instructions
+	{ 0x3FFF, 0x0000, "NOP", DISASSEMBLER_OPERANDS_FORMAT_NONE, 0 },
+	{ 0x3FFF, 0x0008, "RETURN", DISASSEMBLER_OPERANDS_FORMAT_NONE, 0 },
+	{ 0x3FFF, 0x0009, "RETFIE", DISASSEMBLER_OPERANDS_FORMAT_NONE, 0 },
+	{ 0x3FFF, 0x0063, "SLEEP", DISASSEMBLER_OPERANDS_FORMAT_NONE, 0 },
+	{ 0x3FFF, 0x0064, "CLRWDT", DISASSEMBLER_OPERANDS_FORMAT_NONE, 0 },
+	{ 0x3FFF, 0x0100, "CLRW", DISASSEMBLER_OPERANDS_FORMAT_NONE, 0 },
+	// Bit-oriented instructions
+	{ 0x3C00, 0x1000, "BCF", DISASSEMBLER_OPERANDS_FORMAT_FILE_BIT, 0 },
+	{ 0x3C00, 0x1400, "BSF", DISASSEMBLER_OPERANDS_FORMAT_FILE_BIT, 0 },
+	{ 0x3C00, 0x1800, "BTFSC", DISASSEMBLER_OPERANDS_FORMAT_FILE_BIT, 1 },
+	{ 0x3C00, 0x1C00, "BTFSS", DISASSEMBLER_OPERANDS_FORMAT_FILE_BIT, 1 },
+	// Byte-oriented instructions
+	{ 0x3F00, 0x0000, "MOVWF", DISASSEMBLER_OPERANDS_FORMAT_FILE, 0 },
+	{ 0x3F00, 0x0100, "CLRF", DISASSEMBLER_OPERANDS_FORMAT_FILE, 0 },
+	{ 0x3F00, 0x0200, "SUBWF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0300, "DECF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0400, "IORWF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0500, "ANDWF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0600, "XORWF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0700, "ADDWF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0800, "MOVF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0900, "COMF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0A00, "INCF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0B00, "DECFSZ", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 1 },
+	{ 0x3F00, 0x0C00, "RRF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0D00, "RLF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0E00, "SWAPF", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 0 },
+	{ 0x3F00, 0x0F00, "INCFSZ", DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION, 1 },
+	// Control instructions
+	{ 0x3800, 0x2000, "CALL", DISASSEMBLER_OPERANDS_FORMAT_ADDRESS, 0 },
+	{ 0x3800, 0x2800, "GOTO", DISASSEMBLER_OPERANDS_FORMAT_ADDRESS, 0 },
+	// Literal instructions
+	{ 0x3F00, 0x3000, "MOVLW", DISASSEMBLER_OPERANDS_FORMAT_LITERAL, 0 },
+	{ 0x3F00, 0x3400, "RETLW", DISASSEMBLER_OPERANDS_FORMAT_LITERAL, 0 },
+	{ 0x3F00, 0x3800, "IORLW", DISASSEMBLER_OPERANDS_FORMAT_LITERAL, 0 },
+	{ 0x3F00, 0x3900, "ANDLW", DISASSEMBLER_OPERANDS_FORMAT_LITERAL, 0 },
+	{ 0x3F00, 0x3A00, "XORLW", DISASSEMBLER_OPERANDS_FORMAT_LITERAL, 0 },
+	{ 0x3F00, 0x3C00, "SUBLW", DISASSEMBLER_OPERANDS_FORMAT_LITERAL, 0 },
+	{ 0x3F00, 0x3E00, "ADDLW", DISASSEMBLER_OPERANDS_FORMAT_LITERAL, 0 }
+};
+
+/** The registers that are located at the same address in all banks, so they can be named without knowing the selected bank. */
+static const char *Disassembler_Register_Names[] =
+{
+	[REGISTER_FILE_REGISTER_ADDRESS_INDF] = "INDF",
+	[REGISTER_FILE_REGISTER_ADDRESS_PCL] = "PCL",
+	[REGISTER_FILE_REGISTER_ADDRESS_STATUS] = "STATUS",
+	[REGISTER_FILE_REGISTER_ADDRESS_FSR] = "FSR",
+	[REGISTER_FILE_REGISTER_ADDRESS_PCLATH] = "PCLATH",
+	[REGISTER_FILE_REGISTER_ADDRESS_INTCON] = "INTCON"
+};
+
+/** The assembler directives that can start a listing source line, they must not be taken for labels. */
+static const char *Disassembler_Directives[] =
+{
+	"__badram", "__config", "__idlocs", "__maxram", "banksel", "cblock", "code", "constant", "data", "db", "de", "dt", "dw", "else", "end", "endc", "endif", "endm", "endw", "errorlevel", "extern", "global", "if", "ifdef", "ifndef", "include", "list", "local", "messg", "nolist", "org", "page", "pagesel", "processor", "radix", "res", "space", "subtitle", "title", "udata", "variable", "while"
+};
+
+/** The loaded labels, sorted by increasing address. */
+static TDisassemblerSymbol Disassembler_Symbols[DISASSEMBLER_MAXIMUM_SYMBOLS_COUNT];
+/** How many labels are loaded. */
+static int Disassembler_Symbols_Count = 0;
+
+/** For each program memory address, the index of the closest label located at or before this address (-1 if there is none). */
+static short Disassembler_Closest_Symbol_Indexes[PROGRAM_MEMORY_SIZE];
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Find how an instruction is encoded.
+ * @param Instruction The instruction code.
+ * @return The instruction description,
+ * @return NULL if the core does not know this instruction.
+ */
+static const TDisassemblerInstructionDescription *DisassemblerFindInstruction(unsigned short Instruction)
+{
+	unsigned int i;
+	
+	Instruction &= 0x3FFF;
+	for (i = 0; i < sizeof(Disassembler_Instructions) / sizeof(Disassembler_Instructions[0]); i++)
+	{
+		if ((Instruction & Disassembler_Instructions[i].Mask) == Disassembler_Instructions[i].Value) return &Disassembler_Instructions[i];
+	}
+	return NULL;
+}
+
+/** Convert a file register operand to text.
+ * @param Address The 7-bit register address.
+ * @param String_Register On output, contain the register name or address.
+ * @param Size The output buffer size.
+ */
+static void DisassemblerFormatRegister(unsigned char Address, char *String_Register, size_t Size)
+{
+	if ((Address < sizeof(Disassembler_Register_Names) / sizeof(Disassembler_Register_Names[0])) && (Disassembler_Register_Names[Address] != NULL)) snprintf(String_Register, Size, "%s", Disassembler_Register_Names[Address]);
+	else snprintf(String_Register, Size, "0x%02X", Address);
+}
+
+/** Tell whether a word is an assembler directive.
+ * @param String_Word The word to check (it does not need to be terminated after Length characters).
+ * @param Length The word length.
+ * @return 0 if the word is not a directive,
+ * @return 1 if the word is a directive.
+ */
+static int DisassemblerIsDirective(const char *String_Word, size_t Length)
+{
+	unsigned int i;
+	
+	for (i = 0; i < sizeof(Disassembler_Directives) / sizeof(Disassembler_Directives[0]); i++)
+	{
+		if ((strlen(Disassembler_Directives[i]) == Length) && (strncasecmp(String_Word, Disassembler_Directives[i], Length) == 0)) return 1;
+	}
+	return 0;
+}
+
+/** Parse a listing file line.
+ * @param String_Line The line.
+ * @param Pointer_Address On output, contain the address of the code generated by the line, or -1 if the line does not generate code.
+ * @param String_Label On output, contain the label defined by the line, or an empty string if the line does not define a label.
+ */
+static void DisassemblerParseListingLine(char *String_Line, int *Pointer_Address, char *String_Label)
+{
+	char *Pointer_Character = String_Line, *Pointer_Source;
+	unsigned int Address;
+	int Is_Address_Present, Has_Code = 0;
+	size_t Length;
+	
+	*Pointer_Address = -1;
+	String_Label[0] = 0;
+	
+	// Code lines start with the 4-digit hexadecimal address, followed by the generated words
+	Is_Address_Present = isxdigit((unsigned char) String_Line[0]) && isxdigit((unsigned char) String_Line[3]) && (String_Line[4] == ' ') && (sscanf(String_Line, "%4x", &Address) == 1);
+	
+	// Find the 5-digit source line number, the source text follows it
+	while (1)
+	{
+		while (*Pointer_Character == ' ') Pointer_Character++;
+		if (*Pointer_Character == 0) return;
+		
+		Length = strspn(Pointer_Character, "0123456789ABCDEFabcdef");
+		if ((Length == 5) && (strspn(Pointer_Character, "0123456789") == 5) && ((Pointer_Character[5] == ' ') || (Pointer_Character[5] == 0))) break;
+		if ((Length == 4) && (Pointer_Character != String_Line)) Has_Code = 1; // A generated word
+		else if ((Length == 0) || (Pointer_Character[Length] != ' ')) return; // This is not a code line (header, symbol table, messages...)
+		Pointer_Character += Length;
+	}
+	if (Is_Address_Present && Has_Code && (Address < PROGRAM_MEMORY_SIZE)) *Pointer_Address = Address;
+	Pointer_Source = Pointer_Character + 5;
+	if (*Pointer_Source == ' ') Pointer_Source++;
+	
+	// Labels start at the first source column
+	if (!isalpha((unsigned char) *Pointer_Source) && (*Pointer_Source != '_')) return;
+	Length = strspn(Pointer_Source, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_.?");
+	if (DisassemblerIsDirective(Pointer_Source, Length)) return;
+	
+	// Discard constant and macro definitions
+	Pointer_Character = Pointer_Source + Length;
+	if (*Pointer_Character == ':') Pointer_Character++;
+	while ((*Pointer_Character == ' ') || (*Pointer_Character == '\t')) Pointer_Character++;
+	if ((strncasecmp(Pointer_Character, "equ", 3) == 0) || (strncasecmp(Pointer_Character, "set", 3) == 0) || (strncasecmp(Pointer_Character, "macro", 5) == 0) || (*Pointer_Character == '=')) return;
+	
+	if (Length > DISASSEMBLER_MAXIMUM_SYMBOL_NAME_LENGTH) Length = DISASSEMBLER_MAXIMUM_SYMBOL_NAME_LENGTH;
+	memcpy(String_Label, Pointer_Source, Length);
+	String_Label[Length] = 0;
+}
+
+/** Add a label to the symbols table, keeping it sorted.
+ * @param Address The labeled address.
+ * @param String_Name The label name.
+ * @return 0 if the label was added,
+ * @return 1 if the table is full.
+ */
+static int DisassemblerAddSymbol(unsigned short Address, char *String_Name)
+{
+	int i;
+	
+	if (Disassembler_Symbols_Count >= DISASSEMBLER_MAXIMUM_SYMBOLS_COUNT) return 1;
+	
+	// Listing files are mostly sorted, so start searching from the end
+	for (i = Disassembler_Symbols_Count; (i > 0) && (Disassembler_Symbols[i - 1].Address > Address); i--) Disassembler_Symbols[i] = Disassembler_Symbols[i - 1];
+	Disassembler_Symbols[i].Address = Address;
+	strcpy(Disassembler_Symbols[i].String_Name, String_Name);
+	Disassembler_Symbols_Count++;
+	return 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int DisassemblerLoadSymbols(char *String_Listing_File)
+{
+	FILE *Pointer_File;
+	char String_Line[DISASSEMBLER_MAXIMUM_LISTING_LINE_LENGTH], String_Label[DISASSEMBLER_MAXIMUM_SYMBOL_NAME_LENGTH + 1], String_Pending_Label[DISASSEMBLER_MAXIMUM_SYMBOL_NAME_LENGTH + 1] = "";
+	int Address, Symbol_Index = -1, i;
+	
+	Pointer_File = fopen(String_Listing_File, "r");
+	if (Pointer_File == NULL)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : failed to open the listing file '%s' (%s).\n", String_Listing_File, strerror(errno));
+		return 1;
+	}
+	Disassembler_Symbols_Count = 0;
+	
+	while (fgets(String_Line, sizeof(String_Line), Pointer_File) != NULL)
+	{
+		// The symbol table at the listing end mixes labels and constants, labels are taken from the source lines only
+		if (strncmp(String_Line, "SYMBOL TABLE", 12) == 0) break;
+		String_Line[strcspn(String_Line, "\r\n")] = 0;
+		
+		DisassemblerParseListingLine(String_Line, &Address, String_Label);
+		
+		// A label alone on its line names the next generated instruction
+		if (String_Label[0] != 0) strcpy(String_Pending_Label, String_Label);
+		if ((Address >= 0) && (String_Pending_Label[0] != 0))
+		{
+			if (DisassemblerAddSymbol(Address, String_Pending_Label) != 0)
+			{
+				LOG(LOG_LEVEL_WARNING, "WARNING : too many labels in the listing file, only the first %d ones are used.\n", DISASSEMBLER_MAXIMUM_SYMBOLS_COUNT);
+				break;
+			}
+			String_Pending_Label[0] = 0;
+		}
+	}
+	fclose(Pointer_File);
+	
+	// Cache the closest label of each address, so formatting an address does not search the table
+	for (i = 0; i < PROGRAM_MEMORY_SIZE; i++)
+	{
+		while ((Symbol_Index + 1 < Disassembler_Symbols_Count) && (Disassembler_Symbols[Symbol_Index + 1].Address <= i)) Symbol_Index++;
+		Disassembler_Closest_Symbol_Indexes[i] = Symbol_Index;
+	}
+	LOG(LOG_LEVEL_DEBUG, "Loaded %d labels from '%s'.\n", Disassembler_Symbols_Count, String_Listing_File);
+	return 0;
+}
+
+const char *DisassemblerGetSymbol(unsigned short Address)
+{
+	int Index;
+	
+	if ((Disassembler_Symbols_Count == 0) || (Address >= PROGRAM_MEMORY_SIZE)) return NULL;
+	
+	Index = Disassembler_Closest_Symbol_Indexes[Address];
+	if ((Index < 0) || (Disassembler_Symbols[Index].Address != Address)) return NULL;
+	return Disassembler_Symbols[Index].String_Name;
+}
+
+void DisassemblerFormatAddress(unsigned short Address, char *String_Address, size_t Size)
+{
+	int Index;
+	
+	if ((Disassembler_Symbols_Count == 0) || (Address >= PROGRAM_MEMORY_SIZE) || (Disassembler_Closest_Symbol_Indexes[Address] < 0))
+	{
+		snprintf(String_Address, Size, "0x%04X", Address);
+		return;
+	}
+	
+	Index = Disassembler_Closest_Symbol_Indexes[Address];
+	if (Disassembler_Symbols[Index].Address == Address) snprintf(String_Address, Size, "%s (0x%04X)", Disassembler_Symbols[Index].String_Name, Address);
+	else snprintf(String_Address, Size, "%s+0x%X (0x%04X)", Disassembler_Symbols[Index].String_Name, Address - Disassembler_Symbols[Index].Address, Address);
+}
+
+void DisassemblerDecodeInstruction(unsigned short Address, unsigned short Instruction, char *String_Instruction, size_t Size)
+{
+	const TDisassemblerInstructionDescription *Pointer_Description;
+	char String_Operand[DISASSEMBLER_ADDRESS_STRING_SIZE];
+	unsigned short Target_Address;
+	
+	Pointer_Description = DisassemblerFindInstruction(Instruction);
+	if (Pointer_Description == NULL)
+	{
+		snprintf(String_Instruction, Size, "DW 0x%04X", Instruction);
+		return;
+	}
+	
+	switch (Pointer_Description->Operands_Format)
+	{
+		case DISASSEMBLER_OPERANDS_FORMAT_NONE:
+			snprintf(String_Instruction, Size, "%s", Pointer_Description->String_Mnemonic);
+			break;
+		
+		case DISASSEMBLER_OPERANDS_FORMAT_FILE:
+			DisassemblerFormatRegister(Instruction & 0x7F, String_Operand, sizeof(String_Operand));
+			snprintf(String_Instruction, Size, "%s %s", Pointer_Description->String_Mnemonic, String_Operand);
+			break;
+		
+		case DISASSEMBLER_OPERANDS_FORMAT_FILE_DESTINATION:
+			DisassemblerFormatRegister(Instruction & 0x7F, String_Operand, sizeof(String_Operand));
+			snprintf(String_Instruction, Size, "%s %s, %c", Pointer_Description->String_Mnemonic, String_Operand, (Instruction & 0x80) ? 'F' : 'W');
+			break;
+		
+		case DISASSEMBLER_OPERANDS_FORMAT_FILE_BIT:
+			DisassemblerFormatRegister(Instruction & 0x7F, String_Operand, sizeof(String_Operand));
+			snprintf(String_Instruction, Size, "%s %s, %d", Pointer_Description->String_Mnemonic, String_Operand, (Instruction >> 7) & 0x07);
+			break;
+		
+		case DISASSEMBLER_OPERANDS_FORMAT_LITERAL:
+			snprintf(String_Instruction, Size, "%s 0x%02X", Pointer_Description->String_Mnemonic, Instruction & 0xFF);
+			break;
+		
+		case DISASSEMBLER_OPERANDS_FORMAT_ADDRESS:
+			// PCLATH<4:3> is not known here, assume that the target is in the same page than the instruction
+			Target_Address = (Address & 0x1800) | (Instruction & 0x07FF);
+			DisassemblerFormatAddress(Target_Address, String_Operand, sizeof(String_Operand));
+			snprintf(String_Instruction, Size, "%s %s", Pointer_Description->String_Mnemonic, String_Operand);
+			break;
+	}
+}
+
+int DisassemblerIsConditionalSkip(unsigned short Instruction)
+{
+	const TDisassemblerInstructionDescription *Pointer_Description;
+	
+	Pointer_Description = DisassemblerFindInstruction(Instruction);
+	if (Pointer_Description == NULL) return 0;
+	return Pointer_Description->Is_Conditional_Skip;
+}
@@ -0,0 +1,485 @@
+/** @file Fuzzer.c
+ * Execute random PIC programs from random initial register file states and check that the core keeps its invariants. The fuzzer input is converted to a program made of valid instructions only, which is executed for a bounded cycles count with the lockstep engine, so the predecoded engine is compared with the interpreter too.
+ * Build with "make fuzz" to get a standalone driver generating the inputs with a pseudo-random generator. Build with "make fuzz LIBFUZZER=1" to get a libFuzzer target instead (FUZZER_LIBFUZZER is then defined).
+ * @author Adrien RICCIARDI
+ */
+#include <Core.h>
+#include <Log.h>
+#include <Peripheral_ADC.h>
+#include <Peripheral_Data_EEPROM.h>
+#include <Peripheral_I2C_EEPROM.h>
+#include <Peripheral_Memory_Access.h>
+#include <Peripheral_Timer.h>
+#include <Peripheral_UART.h>
+#include <Program_Memory.h>
+#include <Register_File.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <UART_Backend.h>
+#include <unistd.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** How many instruction cycles each program runs for when no budget is provided. */
+#define FUZZER_DEFAULT_CYCLES_COUNT 2000
+
+/** How many programs the standalone driver executes when no count is provided. */
+#define FUZZER_DEFAULT_PROGRAMS_COUNT 100000
+
+/** How many instructions a program generated by the standalone driver can have. */
+#define FUZZER_MAXIMUM_GENERATED_INSTRUCTIONS_COUNT 64
+
+/** The value of an erased program memory location. */
+#define FUZZER_ERASED_PROGRAM_MEMORY_VALUE 0x3FFF
+
+/** The "movf INDF, w" instruction code, its result is checked when INDF points to PCL. */
+#define FUZZER_INSTRUCTION_MOVF_INDF_W 0x0800
+/** The "movwf INDF" instruction code, its result is checked when INDF points to PCL. */
+#define FUZZER_INSTRUCTION_MOVWF_INDF 0x0080
+/** Where the core branches to when an interrupt fires. */
+#define FUZZER_INTERRUPT_VECTOR 0x0004
+
+/** The input bytes giving the initial state : W, STATUS, FSR, PCLATH, INTCON and the 4-byte seed of the general purpose registers content. */
+#define FUZZER_INPUT_HEADER_SIZE 9
+/** How many input bytes an instruction is made of : the instruction kind and a 16-bit operand. */
+#define FUZZER_INPUT_INSTRUCTION_SIZE 3
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** How an instruction operand is built. */
+typedef enum
+{
+	FUZZER_OPERAND_TYPE_NONE, //! The instruction has no operand.
+	FUZZER_OPERAND_TYPE_FILE_REGISTER, //! A file register address and a destination bit.
+	FUZZER_OPERAND_TYPE_BIT, //! A file register address and a bit number.
+	FUZZER_OPERAND_TYPE_LITERAL, //! An 8-bit literal.
+	FUZZER_OPERAND_TYPE_BRANCH //! A program address, always located in the program so most branches stay in it.
+} TFuzzerOperandType;
+
+/** An instruction the fuzzer can generate. */
+typedef struct
+{
+	unsigned short Code; //! The instruction code without its operand.
+	unsigned short Operand_Mask; //! The operand bits.
+	TFuzzerOperandType Operand_Type; //! How the operand is built.
+} TFuzzerInstruction;
+
+/** The board state all programs start from. */
+typedef struct
+{
+	unsigned char Register_File[REGISTER_FILE_LOCATIONS_COUNT]; //! All register file locations after the register file initialization.
+	TPeripheralTimerSnapshot Timer; //! The timers prescalers.
+	TPeripheralADCSnapshot ADC; //! The ADC conversion state.
+	TPeripheralMemoryAccessSnapshot Memory_Access; //! The EECON registers interface state.
+	TPeripheralDataEEPROMSnapshot Data_EEPROM; //! The data EEPROM content.
+	TPeripheralI2CEEPROMSnapshot I2C_EEPROM; //! The external EEPROM content and protocol state.
+	TPeripheralUARTSnapshot UART; //! The transmitter and receiver timing state.
+} TFuzzerBoardState;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** All PIC16F876 instructions, with their documented encoding. */
+static const TFuzzerInstruction Fuzzer_Instructions[] =
+{
+	{ 0x0700, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // ADDWF
+	{ 0x0500, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // ANDWF
+	{ 0x0180, 0x007F, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // CLRF
+	{ 0x0100, 0x0000, FUZZER_OPERAND_TYPE_NONE }, // CLRW
+	{ 0x0900, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // COMF
+	{ 0x0300, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // DECF
+	{ 0x0B00, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // DECFSZ
+	{ 0x0A00, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // INCF
+	{ 0x0F00, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // INCFSZ
+	{ 0x0400, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // IORWF
+	{ 0x0800, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // MOVF
+	{ 0x0080, 0x007F, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // MOVWF
+	{ 0x0000, 0x0000, FUZZER_OPERAND_TYPE_NONE }, // NOP
+	{ 0x0D00, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // RLF
+	{ 0x0C00, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // RRF
+	{ 0x0200, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // SUBWF
+	{ 0x0E00, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // SWAPF
+	{ 0x0600, 0x00FF, FUZZER_OPERAND_TYPE_FILE_REGISTER }, // XORWF
+	{ 0x1000, 0x03FF, FUZZER_OPERAND_TYPE_BIT }, // BCF
+	{ 0x1400, 0x03FF, FUZZER_OPERAND_TYPE_BIT }, // BSF
+	{ 0x1800, 0x03FF, FUZZER_OPERAND_TYPE_BIT }, // BTFSC
+	{ 0x1C00, 0x03FF, FUZZER_OPERAND_TYPE_BIT }, // BTFSS
+	{ 0x3E00, 0x00FF, FUZZER_OPERAND_TYPE_LITERAL }, // ADDLW
+	{ 0x3900, 0x00FF, FUZZER_OPERAND_TYPE_LITERAL }, // ANDLW
+	{ 0x2000, 0x07FF, FUZZER_OPERAND_TYPE_BRANCH }, // CALL
+	{ 0x0064, 0x0000, FUZZER_OPERAND_TYPE_NONE }, // CLRWDT
+	{ 0x2800, 0x07FF, FUZZER_OPERAND_TYPE_BRANCH }, // GOTO
+	{ 0x3800, 0x00FF, FUZZER_OPERAND_TYPE_LITERAL }, // IORLW
+	{ 0x3000, 0x00FF, FUZZER_OPERAND_TYPE_LITERAL }, // MOVLW
+	{ 0x0009, 0x0000, FUZZER_OPERAND_TYPE_NONE }, // RETFIE
+	{ 0x3400, 0x00FF, FUZZER_OPERAND_TYPE_LITERAL }, // RETLW
+	{ 0x0008, 0x0000, FUZZER_OPERAND_TYPE_NONE }, // RETURN
+	{ 0x0063, 0x0000, FUZZER_OPERAND_TYPE_NONE }, // SLEEP
+	{ 0x3C00, 0x00FF, FUZZER_OPERAND_TYPE_LITERAL }, // SUBLW
+	{ 0x3A00, 0x00FF, FUZZER_OPERAND_TYPE_LITERAL } // XORLW
+};
+
+/** The board state restored before each program is executed. */
+static TFuzzerBoardState Fuzzer_Initial_Board_State;
+
+/** The program memory content given to the program memory before each program is executed, only the program words differ from an erased memory. */
+static unsigned short Fuzzer_Program_Memory[PROGRAM_MEMORY_SIZE];
+
+/** The register file content given to the register file before each program is executed. */
+static unsigned char Fuzzer_Register_File[REGISTER_FILE_LOCATIONS_COUNT];
+
+/** How many instruction cycles each program runs for. */
+static unsigned long long Fuzzer_Cycles_Count = FUZZER_DEFAULT_CYCLES_COUNT;
+
+/** The input being executed, so it can be stored when it makes the core fail. */
+static const unsigned char *Pointer_Fuzzer_Input;
+/** The input size in bytes. */
+static size_t Fuzzer_Input_Size;
+/** Tell whether a program is being executed, so an exit() call from the simulator code can be reported as a failure. */
+static int Fuzzer_Is_Input_Running = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Get the next value of a xorshift pseudo-random generator.
+ * @param Pointer_State The generator state, it must not be zero.
+ * @return A 32-bit pseudo-random value.
+ */
+static inline unsigned int FuzzerGetRandomValue(unsigned int *Pointer_State)
+{
+	unsigned int State = *Pointer_State;
+	
+	State ^= State << 13;
+	State ^= State >> 17;
+	State ^= State << 5;
+	*Pointer_State = State;
+	return State;
+}
+
+/** Display why the core failed, store the input that made it fail and abort, so libFuzzer or the standalone driver report the failure.
+ * @param String_Reason The failed invariant.
+ */
+static void FuzzerReportFailure(char *String_Reason)
+{
+	TCoreState Core_State;
+#ifndef FUZZER_LIBFUZZER
+	char String_File[64];
+	FILE *Pointer_File;
+#endif
+	
+	Fuzzer_Is_Input_Running = 0;
+	fflush(stdout); // abort() does not flush the standard output
+	CoreGetState(&Core_State);
+	fprintf(stderr, "Error : %s (cycle %llu, PC = 0x%04X, stack pointer = %d).\n", String_Reason, Core_State.Cycles_Count, Core_State.Program_Counter, Core_State.Stack_Pointer);
+
+#ifndef FUZZER_LIBFUZZER
+	// libFuzzer stores the crashing input by itself
+	snprintf(String_File, sizeof(String_File), "Fuzzer_Failure_%d.bin", (int) getpid());
+	Pointer_File = fopen(String_File, "wb");
+	if ((Pointer_File != NULL) && (fwrite(Pointer_Fuzzer_Input, 1, Fuzzer_Input_Size, Pointer_File) == Fuzzer_Input_Size)) fprintf(stderr, "The failing input has been stored to '%s', give it to the fuzzer to execute it again.\n", String_File);
+	if (Pointer_File != NULL) fclose(Pointer_File);
+#endif
+	abort();
+}
+
+/** Report the exit() calls done by the simulator code (on a bad register file address for instance) while a program is executed. */
+static void FuzzerHandleExit(void)
+{
+	if (Fuzzer_Is_Input_Running) FuzzerReportFailure("the simulator exited while executing the program");
+}
+
+/** Initialize the simulated board once, then keep its initial state so it can be quickly restored before each program.
+ * @param String_Log_File The file receiving the simulator logs.
+ * @return 0 if the board was successfully initialized,
+ * @return 1 if an error occurred.
+ */
+static int FuzzerInitializeBoard(char *String_Log_File)
+{
+	int i;
+	
+	// Only errors are logged, the random programs generate many warnings (stack overflows, unknown instructions...)
+	LogInitialize(String_Log_File, LOG_LEVEL_ERROR);
+	RegisterFileInitialize();
+	if (PeripheralADCInitialize(PERIPHERAL_ADC_SAMPLE_SOURCE_CONSTANT, "512") != 0)
+	{
+		printf("Error : failed to initialize the ADC sample source.\n");
+		return 1;
+	}
+	// Use blank private EEPROMs
+	if ((PeripheralI2CEEPROMInitialize("/dev/null", 1) != 0) || (PeripheralDataEEPROMInitialize("/dev/null", 1) != 0))
+	{
+		printf("Error : failed to initialize the EEPROMs.\n");
+		return 1;
+	}
+	if (UARTBackendInitialize(UART_BACKEND_TYPE_NULL, NULL) != 0)
+	{
+		printf("Error : failed to start the UART backend.\n");
+		return 1;
+	}
+	CoreEnableThrottling(0);
+	CoreSetEngine(CORE_ENGINE_LOCKSTEP);
+	
+	// Keep the state all programs start from
+	RegisterFileSaveSnapshot(Fuzzer_Initial_Board_State.Register_File);
+	PeripheralTimerSaveSnapshot(&Fuzzer_Initial_Board_State.Timer);
+	PeripheralADCSaveSnapshot(&Fuzzer_Initial_Board_State.ADC);
+	PeripheralMemoryAccessSaveSnapshot(&Fuzzer_Initial_Board_State.Memory_Access);
+	PeripheralDataEEPROMSaveSnapshot(&Fuzzer_Initial_Board_State.Data_EEPROM);
+	PeripheralI2CEEPROMSaveSnapshot(&Fuzzer_Initial_Board_State.I2C_EEPROM);
+	PeripheralUARTSaveSnapshot(&Fuzzer_Initial_Board_State.UART);
+	
+	memset(Fuzzer_Program_Memory, 0xFF, sizeof(Fuzzer_Program_Memory)); // Set all locations to 0xFFFF, which ProgramMemoryWrite() turns to FUZZER_ERASED_PROGRAM_MEMORY_VALUE
+	ProgramMemoryRestoreSnapshot(Fuzzer_Program_Memory);
+	for (i = 0; i < PROGRAM_MEMORY_SIZE; i++) Fuzzer_Program_Memory[i] = FUZZER_ERASED_PROGRAM_MEMORY_VALUE;
+	
+	atexit(FuzzerHandleExit);
+	return 0;
+}
+
+/** Convert an input instruction to a valid instruction code.
+ * @param Pointer_Input_Instruction The FUZZER_INPUT_INSTRUCTION_SIZE input bytes.
+ * @param Instructions_Count How many instructions the program has.
+ * @return The instruction code.
+ */
+static unsigned short FuzzerConvertInstruction(const unsigned char *Pointer_Input_Instruction, unsigned int Instructions_Count)
+{
+	const TFuzzerInstruction *Pointer_Instruction;
+	unsigned short Operand;
+	
+	Pointer_Instruction = &Fuzzer_Instructions[Pointer_Input_Instruction[0] % (sizeof(Fuzzer_Instructions) / sizeof(Fuzzer_Instructions[0]))];
+	Operand = Pointer_Input_Instruction[1] | (Pointer_Input_Instruction[2] << 8);
+	
+	// Branch to a program instruction most of the time, PCLATH can still select another page
+	if (Pointer_Instruction->Operand_Type == FUZZER_OPERAND_TYPE_BRANCH) Operand %= Instructions_Count;
+	return Pointer_Instruction->Code | (Operand & Pointer_Instruction->Operand_Mask);
+}
+
+/** Set the whole board to the state the input describes : the initial board state, the input registers values and the input program.
+ * @param Pointer_Input The input bytes.
+ * @param Instructions_Count How many instructions the input program has.
+ */
+static void FuzzerLoadInput(const unsigned char *Pointer_Input, unsigned int Instructions_Count)
+{
+	unsigned int Address, Location, Random_State;
+	TCoreState Core_State;
+	
+	// Fill the general purpose registers with pseudo-random values, the input would be too large to give them all
+	memcpy(Fuzzer_Register_File, Fuzzer_Initial_Board_State.Register_File, sizeof(Fuzzer_Register_File));
+	Random_State = Pointer_Input[5] | (Pointer_Input[6] << 8) | (Pointer_Input[7] << 16) | ((unsigned int) Pointer_Input[8] << 24);
+	if (Random_State == 0) Random_State = 1;
+	for (Location = 0; Location < REGISTER_FILE_LOCATIONS_COUNT; Location++)
+	{
+		if ((Location % REGISTER_FILE_REGISTERS_IN_BANK_COUNT) >= 0x20) Fuzzer_Register_File[Location] = (unsigned char) FuzzerGetRandomValue(&Random_State); // Mirrors are not restored, so they keep their mirrored location
+	}
+	Fuzzer_Register_File[REGISTER_FILE_REGISTER_BANK_STATUS * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + REGISTER_FILE_REGISTER_ADDRESS_STATUS] = Pointer_Input[1];
+	Fuzzer_Register_File[REGISTER_FILE_REGISTER_BANK_FSR * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + REGISTER_FILE_REGISTER_ADDRESS_FSR] = Pointer_Input[2];
+	Fuzzer_Register_File[REGISTER_FILE_REGISTER_ADDRESS_PCLATH] = Pointer_Input[3];
+	Fuzzer_Register_File[REGISTER_FILE_REGISTER_BANK_INTCON * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + REGISTER_FILE_REGISTER_ADDRESS_INTCON] = Pointer_Input[4];
+	RegisterFileRestoreSnapshot(Fuzzer_Register_File);
+	
+	PeripheralTimerRestoreSnapshot(&Fuzzer_Initial_Board_State.Timer);
+	PeripheralADCRestoreSnapshot(&Fuzzer_Initial_Board_State.ADC);
+	PeripheralMemoryAccessRestoreSnapshot(&Fuzzer_Initial_Board_State.Memory_Access);
+	PeripheralDataEEPROMRestoreSnapshot(&Fuzzer_Initial_Board_State.Data_EEPROM);
+	PeripheralI2CEEPROMRestoreSnapshot(&Fuzzer_Initial_Board_State.I2C_EEPROM);
+	PeripheralUARTRestoreSnapshot(&Fuzzer_Initial_Board_State.UART);
+	
+	// Only the words differing from the previous program (or modified by its self-programming) are written
+	for (Address = 0; Address < Instructions_Count; Address++) Fuzzer_Program_Memory[Address] = FuzzerConvertInstruction(&Pointer_Input[FUZZER_INPUT_HEADER_SIZE + Address * FUZZER_INPUT_INSTRUCTION_SIZE], Instructions_Count);
+	ProgramMemoryRestoreSnapshot(Fuzzer_Program_Memory);
+	for (Address = 0; Address < Instructions_Count; Address++) Fuzzer_Program_Memory[Address] = FUZZER_ERASED_PROGRAM_MEMORY_VALUE;
+	
+	CoreReset();
+	memset(&Core_State, 0, sizeof(Core_State));
+	Core_State.Register_W = Pointer_Input[0];
+	CoreSetState(&Core_State);
+}
+
+/** Execute a program and check the core invariants after each instruction cycle. The function aborts when an invariant is broken.
+ * @param Pointer_Input The input bytes.
+ * @param Input_Size The input size in bytes.
+ */
+static void FuzzerExecuteInput(const unsigned char *Pointer_Input, size_t Input_Size)
+{
+	unsigned int Instructions_Count, Cycles;
+	unsigned long long Cycles_Count = 0;
+	unsigned short Instruction, Program_Counter, Written_Program_Counter;
+	TCoreState Core_State;
+	
+	// Inputs too small to hold a program are ignored, the trailing bytes not making a whole instruction too
+	if (Input_Size < FUZZER_INPUT_HEADER_SIZE + FUZZER_INPUT_INSTRUCTION_SIZE) return;
+	Instructions_Count = (Input_Size - FUZZER_INPUT_HEADER_SIZE) / FUZZER_INPUT_INSTRUCTION_SIZE;
+	if (Instructions_Count > PROGRAM_MEMORY_SIZE) Instructions_Count = PROGRAM_MEMORY_SIZE;
+	
+	Pointer_Fuzzer_Input = Pointer_Input;
+	Fuzzer_Input_Size = Input_Size;
+	FuzzerLoadInput(Pointer_Input, Instructions_Count);
+	
+	Fuzzer_Is_Input_Running = 1;
+	while (Cycles_Count < Fuzzer_Cycles_Count)
+	{
+		// Accessing PCL through INDF must behave like a direct access, find out what the instruction must do when it reads or writes PCL this way
+		CoreGetState(&Core_State);
+		Program_Counter = Core_State.Program_Counter;
+		Instruction = ProgramMemoryRead(Program_Counter);
+		if ((RegisterFileGetIndirectLocation() % REGISTER_FILE_REGISTERS_IN_BANK_COUNT) != REGISTER_FILE_REGISTER_ADDRESS_PCL) Instruction = FUZZER_ERASED_PROGRAM_MEMORY_VALUE; // Do not check the instruction
+		Written_Program_Counter = ((RegisterFileDirectPeek(0, REGISTER_FILE_REGISTER_ADDRESS_PCLATH) & 0x1F) << 8) | Core_State.Register_W;
+		
+		Cycles = CoreExecuteNextInstruction();
+		Cycles_Count += Cycles;
+		
+		CoreGetState(&Core_State);
+		if ((Cycles == 0) || (Core_State.Cycles_Count != Cycles_Count)) FuzzerReportFailure("an instruction did not advance the cycles count by its duration");
+		if (Core_State.Lost_Cycles_Count != 0) FuzzerReportFailure("an instruction left cycles to be wasted by the next one");
+		if (Core_State.Program_Counter >= PROGRAM_MEMORY_SIZE) FuzzerReportFailure("the program counter went out of the program memory");
+		if ((Core_State.Stack_Pointer < 0) || (Core_State.Stack_Pointer > CORE_STACK_SIZE)) FuzzerReportFailure("the stack pointer went out of the stack");
+		if (CoreIsDivergenceFound()) FuzzerReportFailure("the predecoded engine diverged from the interpreter, see the log file");
+		if ((Instruction == FUZZER_INSTRUCTION_MOVF_INDF_W) && (Core_State.Register_W != (unsigned char) (Program_Counter + 1))) FuzzerReportFailure("reading PCL through INDF did not give the next instruction address low byte");
+		if ((Instruction == FUZZER_INSTRUCTION_MOVWF_INDF) && (Core_State.Program_Counter != Written_Program_Counter) && (Core_State.Program_Counter != FUZZER_INTERRUPT_VECTOR)) FuzzerReportFailure("writing PCL through INDF did not branch to PCLATH:W"); // A firing interrupt branches to its vector right after the instruction
+	}
+	Fuzzer_Is_Input_Running = 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Entry points
+//-------------------------------------------------------------------------------------------------
+#ifdef FUZZER_LIBFUZZER
+/** Called once by libFuzzer before the inputs are executed.
+ * @param Pointer_Arguments_Count Not used here.
+ * @param Pointer_Arguments Not used here.
+ * @return Always 0.
+ */
+int LLVMFuzzerInitialize(int __attribute__((unused)) *Pointer_Arguments_Count, char __attribute__((unused)) ***Pointer_Arguments)
+{
+	if (FuzzerInitializeBoard("/dev/stderr") != 0) exit(EXIT_FAILURE);
+	return 0;
+}
+
+/** Called by libFuzzer for each input.
+ * @param Pointer_Data The input bytes.
+ * @param Size The input size in bytes.
+ * @return Always 0.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *Pointer_Data, size_t Size)
+{
+	FuzzerExecuteInput(Pointer_Data, Size);
+	return 0;
+}
+#else
+int main(int argc, char *argv[])
+{
+	char *String_Log_File = "/dev/stderr";
+	unsigned long long Programs_Count = FUZZER_DEFAULT_PROGRAMS_COUNT, Program_Index, Elapsed_Time;
+	unsigned int Seed = (unsigned int) time(NULL), Random_State, Instructions_Count, i;
+	unsigned char Input[FUZZER_INPUT_HEADER_SIZE + FUZZER_MAXIMUM_GENERATED_INSTRUCTIONS_COUNT * FUZZER_INPUT_INSTRUCTION_SIZE], *Pointer_File_Input;
+	size_t Input_Size;
+	struct timespec Start_Time, End_Time;
+	FILE *Pointer_File;
+	int Option;
+	
+	// Retrieve options
+	while ((Option = getopt(argc, argv, "c:l:n:s:")) != -1)
+	{
+		switch (Option)
+		{
+			// Cycles count
+			case 'c':
+				if ((sscanf(optarg, "%llu", &Fuzzer_Cycles_Count) != 1) || (Fuzzer_Cycles_Count == 0))
+				{
+					printf("Error : the cycles count must be a positive integer.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			
+			// Log file
+			case 'l':
+				String_Log_File = optarg;
+				break;
+			
+			// Programs count
+			case 'n':
+				if ((sscanf(optarg, "%llu", &Programs_Count) != 1) || (Programs_Count == 0))
+				{
+					printf("Error : the programs count must be a positive integer.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			
+			// Seed
+			case 's':
+				if (sscanf(optarg, "%u", &Seed) != 1)
+				{
+					printf("Error : the seed must be a positive integer.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			
+			default:
+				printf("Usage : %s [-c Cycles_Count] [-l Log_File] [-n Programs_Count] [-s Seed] [Input_File]...\n"
+					"  -c Cycles_Count : how many instruction cycles each program runs for (default is %d).\n"
+					"  -l Log_File : where the simulator errors are written to, like the engines divergences (default is the standard error).\n"
+					"  -n Programs_Count : how many random programs to execute (default is %d).\n"
+					"  -s Seed : the pseudo-random generator seed (default is the current time).\n"
+					"  Input_File : execute the input stored in this file instead of random programs, to reproduce a failure.\n", argv[0], FUZZER_DEFAULT_CYCLES_COUNT, FUZZER_DEFAULT_PROGRAMS_COUNT);
+				return EXIT_FAILURE;
+		}
+	}
+	
+	if (FuzzerInitializeBoard(String_Log_File) != 0) return EXIT_FAILURE;
+	
+	// Execute the provided inputs
+	if (optind < argc)
+	{
+		for (i = optind; i < (unsigned int) argc; i++)
+		{
+			Pointer_File = fopen(argv[i], "rb");
+			if (Pointer_File == NULL)
+			{
+				printf("Error : failed to open the input file '%s'.\n", argv[i]);
+				return EXIT_FAILURE;
+			}
+			Pointer_File_Input = malloc(FUZZER_INPUT_HEADER_SIZE + PROGRAM_MEMORY_SIZE * FUZZER_INPUT_INSTRUCTION_SIZE);
+			if (Pointer_File_Input == NULL)
+			{
+				printf("Error : failed to allocate the input buffer.\n");
+				return EXIT_FAILURE;
+			}
+			Input_Size = fread(Pointer_File_Input, 1, FUZZER_INPUT_HEADER_SIZE + PROGRAM_MEMORY_SIZE * FUZZER_INPUT_INSTRUCTION_SIZE, Pointer_File);
+			fclose(Pointer_File);
+			
+			FuzzerExecuteInput(Pointer_File_Input, Input_Size);
+			printf("Input '%s' executed without failure.\n", argv[i]);
+			free(Pointer_File_Input);
+		}
+		return EXIT_SUCCESS;
+	}
+	
+	// Generate and execute random programs
+	printf("Executing %llu random programs for %llu instruction cycles each, seed is %u.\n", Programs_Count, Fuzzer_Cycles_Count, Seed);
+	Random_State = Seed;
+	if (Random_State == 0) Random_State = 1;
+	clock_gettime(CLOCK_MONOTONIC, &Start_Time);
+	for (Program_Index = 0; Program_Index < Programs_Count; Program_Index++)
+	{
+		Instructions_Count = FuzzerGetRandomValue(&Random_State) % FUZZER_MAXIMUM_GENERATED_INSTRUCTIONS_COUNT + 1;
+		Input_Size = FUZZER_INPUT_HEADER_SIZE + Instructions_Count * FUZZER_INPUT_INSTRUCTION_SIZE;
+		for (i = 0; i < Input_Size; i++) Input[i] = (unsigned char) FuzzerGetRandomValue(&Random_State);
+		FuzzerExecuteInput(Input, Input_Size);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &End_Time);
+	
+	Elapsed_Time = (End_Time.tv_sec - Start_Time.tv_sec) * 1000000000ULL + End_Time.tv_nsec - Start_Time.tv_nsec;
+	if (Elapsed_Time == 0) Elapsed_Time = 1;
+	printf("All programs executed without failure in %.2f s (%.0f programs per second, %.2f million instruction cycles per second).\n", (double) Elapsed_Time / 1000000000.0, (double) Programs_Count * 1000000000.0 / Elapsed_Time, (double) Programs_Count * Fuzzer_Cycles_Count * 1000.0 / Elapsed_Time);
+	
+	UARTBackendUninitialize();
+	PeripheralDataEEPROMUninitialize();
+	PeripheralI2CEEPROMUninitialize();
+	return EXIT_SUCCESS;
+}
+#endif
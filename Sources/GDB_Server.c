@@ -0,0 +1,887 @@
+/** @file GDB_Server.c
+ * @see GDB_Server.h for description.
+ * @author Adrien RICCIARDI
+ */
+#define _GNU_SOURCE // Needed by accept4()
+#include <arpa/inet.h>
+#include <Core.h>
+#include <Debugger.h>
+#include <errno.h>
+#include <GDB_Server.h>
+#include <Log.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <Program_Memory.h>
+#include <pthread.h>
+#include <Register_File.h>
+#include <Snapshot.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <Watchpoint.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** The biggest packet exchanged with GDB, framing characters included. */
+#define GDB_SERVER_PACKET_BUFFER_SIZE 4096
+
+/** Where the register file is located in the GDB address space. */
+#define GDB_SERVER_DATA_MEMORY_BASE_ADDRESS 0x800000
+/** How many bytes the program memory is made of in the GDB address space. */
+#define GDB_SERVER_PROGRAM_MEMORY_BYTES_COUNT (PROGRAM_MEMORY_SIZE * 2)
+/** How many bytes the register file is made of in the GDB address space. */
+#define GDB_SERVER_DATA_MEMORY_BYTES_COUNT (REGISTER_FILE_BANKS_COUNT * REGISTER_FILE_REGISTERS_IN_BANK_COUNT)
+
+/** The signal reported when GDB interrupted the program. */
+#define GDB_SERVER_SIGNAL_INTERRUPT 2
+/** The signal reported when a breakpoint or a single-step halted the program. */
+#define GDB_SERVER_SIGNAL_TRAP 5
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** All registers known by GDB, in the target description order. */
+typedef enum
+{
+	GDB_SERVER_REGISTER_W,
+	GDB_SERVER_REGISTER_STATUS,
+	GDB_SERVER_REGISTER_PC,
+	GDB_SERVER_REGISTER_FSR,
+	GDB_SERVER_REGISTER_STACK_POINTER,
+	GDB_SERVER_REGISTER_STACK_LEVEL_0,
+	GDB_SERVER_REGISTERS_COUNT = GDB_SERVER_REGISTER_STACK_LEVEL_0 + CORE_STACK_SIZE
+} TGDBServerRegister;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** Tell GDB how the registers are laid out. */
+static const char GDB_Server_String_Target_Description[] =
+	"<?xml version=\"1.0\"?>\n"
+	"<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+	"<target version=\"1.0\">\n"
+	"<feature name=\"org.pic16f876.core\">\n"
+	"<reg name=\"w\" bitsize=\"8\" type=\"uint8\" regnum=\"0\"/>\n"
+	"<reg name=\"status\" bitsize=\"8\" type=\"uint8\"/>\n"
+	"<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+	"<reg name=\"fsr\" bitsize=\"8\" type=\"uint8\"/>\n"
+	"<reg name=\"sp\" bitsize=\"8\" type=\"uint8\"/>\n"
+	"<reg name=\"stack0\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+	"<reg name=\"stack1\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+	"<reg name=\"stack2\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+	"<reg name=\"stack3\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+	"<reg name=\"stack4\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+	"<reg name=\"stack5\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+	"<reg name=\"stack6\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+	"<reg name=\"stack7\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+	"</feature>\n"
+	"</target>\n";
+
+/** The listening socket. */
+static int GDB_Server_Server_File_Descriptor = -1;
+/** The connected GDB socket (-1 if GDB is not connected). */
+static int GDB_Server_Client_File_Descriptor = -1;
+/** Wake the server thread up when the simulator exits. */
+static int GDB_Server_Exit_Event_File_Descriptor = -1;
+
+/** The Unix socket path, needed to remove the socket file on exit (empty when listening on TCP). */
+static char GDB_Server_String_Socket_Path[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+
+/** Received bytes not processed yet. */
+static char GDB_Server_Reception_Buffer[GDB_SERVER_PACKET_BUFFER_SIZE];
+/** How many bytes the reception buffer holds. */
+static unsigned int GDB_Server_Received_Bytes_Count = 0;
+
+/** Tell whether packets must be acknowledged (GDB can disable this on reliable links). */
+static int GDB_Server_Is_Acknowledge_Enabled;
+/** Tell whether the board is running, so GDB is waiting for it to halt. */
+static int GDB_Server_Is_Target_Running;
+/** Tell whether GDB expects a stop reply when the board halts. */
+static int GDB_Server_Is_Stop_Reply_Expected;
+/** Tell whether GDB asked to interrupt the running board. */
+static int GDB_Server_Is_Interrupt_Requested;
+
+/** Tell the server thread to terminate. */
+static volatile int GDB_Server_Is_Exiting = 0;
+
+/** The server thread ID. */
+static pthread_t GDB_Server_Thread_ID;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Close the GDB connection and let the board run freely. */
+static void GDBServerDisconnectClient(void)
+{
+	uint64_t Event_Value;
+	
+	if (GDB_Server_Client_File_Descriptor == -1) return;
+	
+	close(GDB_Server_Client_File_Descriptor);
+	GDB_Server_Client_File_Descriptor = -1;
+	GDB_Server_Received_Bytes_Count = 0;
+	
+	// Forget a halt that happened meanwhile, so the next client does not see it
+	WatchpointRemoveAll(WATCHPOINT_ACTION_HALT);
+	DebuggerRelease();
+	if (read(DebuggerGetHaltEventFileDescriptor(), &Event_Value, sizeof(Event_Value)) != sizeof(Event_Value)) LOG(LOG_LEVEL_DEBUG, "No pending halt event.\n");
+	LOG(LOG_LEVEL_ERROR, "GDB disconnected.\n");
+}
+
+/** Send raw bytes to GDB.
+ * @param Pointer_Buffer The bytes to send.
+ * @param Size How many bytes to send.
+ */
+static void GDBServerSendBytes(const void *Pointer_Buffer, size_t Size)
+{
+	ssize_t Sent_Bytes_Count;
+	
+	while (Size > 0)
+	{
+		Sent_Bytes_Count = send(GDB_Server_Client_File_Descriptor, Pointer_Buffer, Size, MSG_NOSIGNAL);
+		if (Sent_Bytes_Count < 0)
+		{
+			if (errno == EINTR) continue;
+			LOG(LOG_LEVEL_WARNING, "WARNING : failed to send data to GDB (%s).\n", strerror(errno));
+			GDBServerDisconnectClient();
+			return;
+		}
+		Pointer_Buffer = (const unsigned char *) Pointer_Buffer + Sent_Bytes_Count;
+		Size -= Sent_Bytes_Count;
+	}
+}
+
+/** Frame a reply and send it to GDB.
+ * @param String_Data The packet content.
+ */
+static void GDBServerSendPacket(const char *String_Data)
+{
+	static char String_Packet[GDB_SERVER_PACKET_BUFFER_SIZE + 4]; // Room for the '$', '#' and checksum characters
+	unsigned char Checksum = 0;
+	int Length, i;
+	
+	Length = snprintf(String_Packet, sizeof(String_Packet) - 3, "$%s", String_Data);
+	if (Length >= (int) sizeof(String_Packet) - 3) Length = sizeof(String_Packet) - 4;
+	for (i = 1; i < Length; i++) Checksum += (unsigned char) String_Packet[i];
+	sprintf(&String_Packet[Length], "#%02x", Checksum);
+	GDBServerSendBytes(String_Packet, Length + 3);
+}
+
+/** Tell GDB why the board is halted. */
+static void GDBServerSendStopReply(void)
+{
+	char String_Reply[32];
+	const char *String_Watchpoint_Kind;
+	TDebuggerStopReason Stop_Reason;
+	unsigned int Location;
+	TWatchpointType Type;
+	int Signal;
+	
+	Stop_Reason = DebuggerGetStopReason();
+	if ((Stop_Reason == DEBUGGER_STOP_REASON_HALT_REQUEST) && GDB_Server_Is_Interrupt_Requested) Signal = GDB_SERVER_SIGNAL_INTERRUPT;
+	else Signal = GDB_SERVER_SIGNAL_TRAP;
+	
+	// Tell which data address triggered the watchpoint
+	if (Stop_Reason == DEBUGGER_STOP_REASON_HISTORY_START) sprintf(String_Reply, "T%02xreplaylog:begin;", Signal);
+	else if (Stop_Reason == DEBUGGER_STOP_REASON_WATCHPOINT)
+	{
+		WatchpointGetLastHit(&Location, &Type);
+		if (Type == WATCHPOINT_TYPE_WRITE) String_Watchpoint_Kind = "watch";
+		else if (Type == WATCHPOINT_TYPE_READ) String_Watchpoint_Kind = "rwatch";
+		else String_Watchpoint_Kind = "awatch";
+		sprintf(String_Reply, "T%02x%s:%x;", Signal, String_Watchpoint_Kind, GDB_SERVER_DATA_MEMORY_BASE_ADDRESS + Location);
+	}
+	else sprintf(String_Reply, "S%02x", Signal);
+	GDBServerSendPacket(String_Reply);
+}
+
+/** Convert hexadecimal text to bytes.
+ * @param String_Hexadecimal The text, it must contain at least 2 * Bytes_Count hexadecimal digits.
+ * @param Pointer_Bytes On output, contain the converted bytes.
+ * @param Bytes_Count How many bytes to convert.
+ * @return 0 if the text was successfully converted,
+ * @return 1 if the text is too short or is not hexadecimal.
+ */
+static int GDBServerDecodeHexadecimalBytes(const char *String_Hexadecimal, unsigned char *Pointer_Bytes, unsigned int Bytes_Count)
+{
+	unsigned int i, Byte;
+	
+	for (i = 0; i < Bytes_Count; i++)
+	{
+		if ((String_Hexadecimal[0] == 0) || (String_Hexadecimal[1] == 0) || (sscanf(String_Hexadecimal, "%2x", &Byte) != 1)) return 1;
+		Pointer_Bytes[i] = (unsigned char) Byte;
+		String_Hexadecimal += 2;
+	}
+	return 0;
+}
+
+/** Get the size of a register.
+ * @param Register The register.
+ * @return The register size in bytes.
+ */
+static int GDBServerGetRegisterSize(TGDBServerRegister Register)
+{
+	if ((Register == GDB_SERVER_REGISTER_PC) || (Register >= GDB_SERVER_REGISTER_STACK_LEVEL_0)) return 2;
+	return 1;
+}
+
+/** Get a register value.
+ * @param Pointer_Core_State The current core state.
+ * @param Register The register.
+ * @return The register value.
+ */
+static unsigned int GDBServerReadRegister(TCoreState *Pointer_Core_State, TGDBServerRegister Register)
+{
+	switch (Register)
+	{
+		case GDB_SERVER_REGISTER_W:
+			return Pointer_Core_State->Register_W;
+		
+		case GDB_SERVER_REGISTER_STATUS:
+			return RegisterFileDirectPeek(REGISTER_FILE_REGISTER_BANK_STATUS, REGISTER_FILE_REGISTER_ADDRESS_STATUS);
+		
+		case GDB_SERVER_REGISTER_PC:
+			return Pointer_Core_State->Program_Counter * 2;
+		
+		case GDB_SERVER_REGISTER_FSR:
+			return RegisterFileDirectPeek(REGISTER_FILE_REGISTER_BANK_FSR, REGISTER_FILE_REGISTER_ADDRESS_FSR);
+		
+		case GDB_SERVER_REGISTER_STACK_POINTER:
+			return Pointer_Core_State->Stack_Pointer;
+		
+		default:
+			return Pointer_Core_State->Stack[Register - GDB_SERVER_REGISTER_STACK_LEVEL_0] * 2;
+	}
+}
+
+/** Modify a register. The core registers are stored to the provided state, the register file registers are immediately written.
+ * @param Pointer_Core_State The core state to update.
+ * @param Register The register.
+ * @param Value The new value.
+ */
+static void GDBServerWriteRegister(TCoreState *Pointer_Core_State, TGDBServerRegister Register, unsigned int Value)
+{
+	switch (Register)
+	{
+		case GDB_SERVER_REGISTER_W:
+			Pointer_Core_State->Register_W = (unsigned char) Value;
+			break;
+		
+		case GDB_SERVER_REGISTER_STATUS:
+			RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_STATUS, REGISTER_FILE_REGISTER_ADDRESS_STATUS, (unsigned char) Value);
+			break;
+		
+		case GDB_SERVER_REGISTER_PC:
+			Pointer_Core_State->Program_Counter = (Value / 2) & (PROGRAM_MEMORY_SIZE - 1);
+			break;
+		
+		case GDB_SERVER_REGISTER_FSR:
+			RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_FSR, REGISTER_FILE_REGISTER_ADDRESS_FSR, (unsigned char) Value);
+			break;
+		
+		case GDB_SERVER_REGISTER_STACK_POINTER:
+			if (Value <= CORE_STACK_SIZE) Pointer_Core_State->Stack_Pointer = Value;
+			break;
+		
+		default:
+			Pointer_Core_State->Stack[Register - GDB_SERVER_REGISTER_STACK_LEVEL_0] = (Value / 2) & (PROGRAM_MEMORY_SIZE - 1);
+			break;
+	}
+}
+
+/** Append a register value to a reply, as GDB expects it (little-endian hexadecimal bytes).
+ * @param Pointer_Core_State The current core state.
+ * @param Register The register.
+ * @param String_Reply The reply to append the value to.
+ */
+static void GDBServerAppendRegister(TCoreState *Pointer_Core_State, TGDBServerRegister Register, char *String_Reply)
+{
+	unsigned int Value;
+	int i;
+	
+	Value = GDBServerReadRegister(Pointer_Core_State, Register);
+	String_Reply += strlen(String_Reply);
+	for (i = 0; i < GDBServerGetRegisterSize(Register); i++) String_Reply += sprintf(String_Reply, "%02x", (Value >> (8 * i)) & 0xFF);
+}
+
+/** Decode a register value sent by GDB and write it.
+ * @param Pointer_Core_State The core state to update.
+ * @param Register The register.
+ * @param String_Value The little-endian hexadecimal value.
+ * @return 0 if the register was written,
+ * @return 1 if the value is malformed.
+ */
+static int GDBServerParseRegister(TCoreState *Pointer_Core_State, TGDBServerRegister Register, const char *String_Value)
+{
+	unsigned char Bytes[2];
+	int Size;
+	
+	Size = GDBServerGetRegisterSize(Register);
+	if (GDBServerDecodeHexadecimalBytes(String_Value, Bytes, Size) != 0) return 1;
+	GDBServerWriteRegister(Pointer_Core_State, Register, Size == 2 ? (unsigned int) (Bytes[1] << 8) | Bytes[0] : Bytes[0]);
+	return 0;
+}
+
+/** Read a byte from the GDB address space.
+ * @param Address The byte address.
+ * @param Pointer_Byte On output, contain the read byte.
+ * @return 0 if the byte was read,
+ * @return 1 if the address is not mapped.
+ */
+static int GDBServerReadMemoryByte(unsigned long Address, unsigned char *Pointer_Byte)
+{
+	unsigned short Word;
+	
+	if (Address < GDB_SERVER_PROGRAM_MEMORY_BYTES_COUNT)
+	{
+		Word = ProgramMemoryRead(Address / 2);
+		if (Address & 1) *Pointer_Byte = Word >> 8;
+		else *Pointer_Byte = (unsigned char) Word;
+		return 0;
+	}
+	
+	if ((Address >= GDB_SERVER_DATA_MEMORY_BASE_ADDRESS) && (Address < GDB_SERVER_DATA_MEMORY_BASE_ADDRESS + GDB_SERVER_DATA_MEMORY_BYTES_COUNT))
+	{
+		Address -= GDB_SERVER_DATA_MEMORY_BASE_ADDRESS;
+		*Pointer_Byte = RegisterFileDirectPeek(Address / REGISTER_FILE_REGISTERS_IN_BANK_COUNT, Address % REGISTER_FILE_REGISTERS_IN_BANK_COUNT);
+		return 0;
+	}
+	
+	return 1;
+}
+
+/** Write a byte to the GDB address space. Register file writes have the same side effects than the program writing the register.
+ * @param Address The byte address.
+ * @param Byte The byte to write.
+ * @return 0 if the byte was written,
+ * @return 1 if the address is not mapped.
+ */
+static int GDBServerWriteMemoryByte(unsigned long Address, unsigned char Byte)
+{
+	unsigned short Word;
+	
+	if (Address < GDB_SERVER_PROGRAM_MEMORY_BYTES_COUNT)
+	{
+		Word = ProgramMemoryRead(Address / 2);
+		if (Address & 1) Word = (Word & 0x00FF) | (Byte << 8);
+		else Word = (Word & 0xFF00) | Byte;
+		ProgramMemoryWrite(Address / 2, Word & 0x3FFF);
+		return 0;
+	}
+	
+	if ((Address >= GDB_SERVER_DATA_MEMORY_BASE_ADDRESS) && (Address < GDB_SERVER_DATA_MEMORY_BASE_ADDRESS + GDB_SERVER_DATA_MEMORY_BYTES_COUNT))
+	{
+		Address -= GDB_SERVER_DATA_MEMORY_BASE_ADDRESS;
+		RegisterFileDirectWrite(Address / REGISTER_FILE_REGISTERS_IN_BANK_COUNT, Address % REGISTER_FILE_REGISTERS_IN_BANK_COUNT, Byte);
+		return 0;
+	}
+	
+	return 1;
+}
+
+/** Handle a "q" or "Q" packet.
+ * @param String_Packet The packet content.
+ * @param String_Reply On output, contain the reply to send.
+ */
+static void GDBServerProcessQueryPacket(char *String_Packet, char *String_Reply)
+{
+	unsigned long Offset, Length, Description_Length;
+	
+	if (strncmp(String_Packet, "qSupported", 10) == 0)
+	{
+		sprintf(String_Reply, "PacketSize=%x;qXfer:features:read+;QStartNoAckMode+", GDB_SERVER_PACKET_BUFFER_SIZE);
+		if (SnapshotIsEnabled()) strcat(String_Reply, ";ReverseStep+;ReverseContinue+");
+	}
+	else if (strcmp(String_Packet, "qAttached") == 0) strcpy(String_Reply, "1"); // Detaching must not kill the simulator
+	else if (sscanf(String_Packet, "qXfer:features:read:target.xml:%lx,%lx", &Offset, &Length) == 2)
+	{
+		// Send the description by chunks, "m" tells that there is more data to read, "l" tells that this is the last chunk
+		Description_Length = sizeof(GDB_Server_String_Target_Description) - 1;
+		if (Offset > Description_Length) Offset = Description_Length;
+		if (Length > GDB_SERVER_PACKET_BUFFER_SIZE - 8) Length = GDB_SERVER_PACKET_BUFFER_SIZE - 8;
+		if (Offset + Length < Description_Length) String_Reply[0] = 'm';
+		else
+		{
+			String_Reply[0] = 'l';
+			Length = Description_Length - Offset;
+		}
+		memcpy(&String_Reply[1], &GDB_Server_String_Target_Description[Offset], Length);
+		String_Reply[Length + 1] = 0;
+	}
+	else if (strcmp(String_Packet, "QStartNoAckMode") == 0)
+	{
+		strcpy(String_Reply, "OK");
+		GDB_Server_Is_Acknowledge_Enabled = 0;
+	}
+}
+
+/** Handle a packet received while the board is halted.
+ * @param String_Packet The packet content, without framing characters.
+ */
+static void GDBServerProcessPacket(char *String_Packet)
+{
+	static char String_Reply[GDB_SERVER_PACKET_BUFFER_SIZE];
+	TCoreState Core_State;
+	unsigned long Address, Length, i;
+	unsigned int Register, Type, Location;
+	TWatchpointType Watchpoint_Type;
+	unsigned char Byte;
+	char *Pointer_Data;
+	
+	String_Reply[0] = 0; // An empty reply tells GDB that the packet is not supported
+	CoreGetState(&Core_State);
+	
+	switch (String_Packet[0])
+	{
+		// Halt reason
+		case '?':
+			GDBServerSendStopReply();
+			return;
+		
+		// Read all registers
+		case 'g':
+			for (Register = 0; Register < GDB_SERVER_REGISTERS_COUNT; Register++) GDBServerAppendRegister(&Core_State, Register, String_Reply);
+			break;
+		
+		// Write all registers
+		case 'G':
+			Pointer_Data = &String_Packet[1];
+			for (Register = 0; Register < GDB_SERVER_REGISTERS_COUNT; Register++)
+			{
+				if (GDBServerParseRegister(&Core_State, Register, Pointer_Data) != 0) break;
+				Pointer_Data += GDBServerGetRegisterSize(Register) * 2;
+			}
+			CoreSetState(&Core_State);
+			SnapshotDiscardFuture(); // The next instructions will not behave like the first time they were executed
+			if (Register < GDB_SERVER_REGISTERS_COUNT) strcpy(String_Reply, "E01");
+			else strcpy(String_Reply, "OK");
+			break;
+		
+		// Read one register
+		case 'p':
+			if ((sscanf(&String_Packet[1], "%x", &Register) != 1) || (Register >= GDB_SERVER_REGISTERS_COUNT)) strcpy(String_Reply, "E01");
+			else GDBServerAppendRegister(&Core_State, Register, String_Reply);
+			break;
+		
+		// Write one register
+		case 'P':
+			Pointer_Data = strchr(String_Packet, '=');
+			if ((Pointer_Data == NULL) || (sscanf(&String_Packet[1], "%x", &Register) != 1) || (Register >= GDB_SERVER_REGISTERS_COUNT) || (GDBServerParseRegister(&Core_State, Register, Pointer_Data + 1) != 0)) strcpy(String_Reply, "E01");
+			else
+			{
+				CoreSetState(&Core_State);
+				SnapshotDiscardFuture();
+				strcpy(String_Reply, "OK");
+			}
+			break;
+		
+		// Read memory
+		case 'm':
+			if (sscanf(&String_Packet[1], "%lx,%lx", &Address, &Length) != 2)
+			{
+				strcpy(String_Reply, "E01");
+				break;
+			}
+			if (Length > (GDB_SERVER_PACKET_BUFFER_SIZE - 8) / 2) Length = (GDB_SERVER_PACKET_BUFFER_SIZE - 8) / 2;
+			for (i = 0; i < Length; i++)
+			{
+				if (GDBServerReadMemoryByte(Address + i, &Byte) != 0) break;
+				sprintf(&String_Reply[i * 2], "%02x", Byte);
+			}
+			if ((i == 0) && (Length > 0)) strcpy(String_Reply, "E14"); // Only a partial read can be returned, the first byte must be readable
+			break;
+		
+		// Write memory
+		case 'M':
+			Pointer_Data = strchr(String_Packet, ':');
+			if ((Pointer_Data == NULL) || (sscanf(&String_Packet[1], "%lx,%lx", &Address, &Length) != 2))
+			{
+				strcpy(String_Reply, "E01");
+				break;
+			}
+			Pointer_Data++;
+			for (i = 0; i < Length; i++)
+			{
+				if ((GDBServerDecodeHexadecimalBytes(Pointer_Data + i * 2, &Byte, 1) != 0) || (GDBServerWriteMemoryByte(Address + i, Byte) != 0)) break;
+			}
+			if (i > 0) SnapshotDiscardFuture();
+			if (i < Length) strcpy(String_Reply, "E14");
+			else strcpy(String_Reply, "OK");
+			break;
+		
+		// Continue or single-step, optionally from another address
+		case 'c':
+		case 's':
+			if (sscanf(&String_Packet[1], "%lx", &Address) == 1)
+			{
+				Core_State.Program_Counter = (Address / 2) & (PROGRAM_MEMORY_SIZE - 1);
+				CoreSetState(&Core_State);
+				SnapshotDiscardFuture();
+			}
+			GDB_Server_Is_Target_Running = 1;
+			GDB_Server_Is_Stop_Reply_Expected = 1;
+			GDB_Server_Is_Interrupt_Requested = 0;
+			DebuggerResume(String_Packet[0] == 's');
+			return; // The stop reply is sent when the board halts
+		
+		// Reverse single-step or continue, the board is halted again when the function returns
+		case 'b':
+			if (!SnapshotIsEnabled() || ((String_Packet[1] != 's') && (String_Packet[1] != 'c')) || (String_Packet[2] != 0)) break;
+			GDB_Server_Is_Interrupt_Requested = 0;
+			if (String_Packet[1] == 's') DebuggerReverseStep();
+			else DebuggerReverseContinue();
+			GDBServerSendStopReply();
+			return;
+		
+		// Set or remove a breakpoint or a watchpoint, hardware and software breakpoints are the same
+		case 'Z':
+		case 'z':
+			if (sscanf(&String_Packet[1], "%u,%lx,%lx", &Type, &Address, &Length) != 3) break;
+			if (Type <= 1)
+			{
+				if (DebuggerSetBreakpoint(Address / 2, String_Packet[0] == 'Z') != 0) strcpy(String_Reply, "E01");
+				else strcpy(String_Reply, "OK");
+				break;
+			}
+			if (Type > 4) break;
+			
+			// Watch each byte of the register file area
+			if (Type == 2) Watchpoint_Type = WATCHPOINT_TYPE_WRITE;
+			else if (Type == 3) Watchpoint_Type = WATCHPOINT_TYPE_READ;
+			else Watchpoint_Type = WATCHPOINT_TYPE_ACCESS;
+			if ((Address < GDB_SERVER_DATA_MEMORY_BASE_ADDRESS) || (Length == 0) || (Address + Length > GDB_SERVER_DATA_MEMORY_BASE_ADDRESS + GDB_SERVER_DATA_MEMORY_BYTES_COUNT))
+			{
+				strcpy(String_Reply, "E01");
+				break;
+			}
+			Address -= GDB_SERVER_DATA_MEMORY_BASE_ADDRESS;
+			for (i = Address; i < Address + Length; i++)
+			{
+				Location = RegisterFileGetPhysicalLocation(i / REGISTER_FILE_REGISTERS_IN_BANK_COUNT, i % REGISTER_FILE_REGISTERS_IN_BANK_COUNT);
+				if (String_Packet[0] == 'z') WatchpointRemove(Location, Watchpoint_Type);
+				else if (WatchpointSet(Location, Watchpoint_Type, WATCHPOINT_VALUE_ANY, WATCHPOINT_ACTION_HALT) != 0) break;
+			}
+			if (i < Address + Length) strcpy(String_Reply, "E01");
+			else strcpy(String_Reply, "OK");
+			break;
+		
+		// General queries
+		case 'q':
+		case 'Q':
+			GDBServerProcessQueryPacket(String_Packet, String_Reply);
+			break;
+		
+		// Select a thread, there is only one
+		case 'H':
+			strcpy(String_Reply, "OK");
+			break;
+		
+		// Detach
+		case 'D':
+			GDBServerSendPacket("OK");
+			GDBServerDisconnectClient();
+			return;
+		
+		// Kill, the simulator keeps running without the debugger
+		case 'k':
+			GDBServerDisconnectClient();
+			return;
+		
+		default:
+			break;
+	}
+	
+	GDBServerSendPacket(String_Reply);
+}
+
+/** Handle all complete packets of the reception buffer. Packets other than an interruption request are kept in the buffer until the board halts. */
+static void GDBServerProcessReceivedBytes(void)
+{
+	unsigned int Offset = 0, Checksum_Offset, i;
+	unsigned char Computed_Checksum;
+	unsigned int Received_Checksum;
+	
+	while ((Offset < GDB_Server_Received_Bytes_Count) && (GDB_Server_Client_File_Descriptor != -1))
+	{
+		// Ctrl+C
+		if (GDB_Server_Reception_Buffer[Offset] == 0x03)
+		{
+			if (GDB_Server_Is_Target_Running)
+			{
+				GDB_Server_Is_Interrupt_Requested = 1;
+				DebuggerHalt();
+			}
+			Offset++;
+			continue;
+		}
+		
+		// Skip the acknowledges, the link is reliable so packets are never sent again
+		if (GDB_Server_Reception_Buffer[Offset] != '$')
+		{
+			Offset++;
+			continue;
+		}
+		if (GDB_Server_Is_Target_Running) break;
+		
+		// Wait for the whole packet
+		for (Checksum_Offset = Offset + 1; Checksum_Offset < GDB_Server_Received_Bytes_Count; Checksum_Offset++)
+		{
+			if (GDB_Server_Reception_Buffer[Checksum_Offset] == '#') break;
+		}
+		if (Checksum_Offset + 2 >= GDB_Server_Received_Bytes_Count) break;
+		
+		// Check the packet integrity
+		Computed_Checksum = 0;
+		for (i = Offset + 1; i < Checksum_Offset; i++) Computed_Checksum += (unsigned char) GDB_Server_Reception_Buffer[i];
+		GDB_Server_Reception_Buffer[Checksum_Offset] = 0;
+		if ((sscanf(&GDB_Server_Reception_Buffer[Checksum_Offset + 1], "%2x", &Received_Checksum) != 1) || (Received_Checksum != Computed_Checksum))
+		{
+			LOG(LOG_LEVEL_WARNING, "WARNING : received a corrupted GDB packet.\n");
+			if (GDB_Server_Is_Acknowledge_Enabled) GDBServerSendBytes("-", 1);
+		}
+		else
+		{
+			if (GDB_Server_Is_Acknowledge_Enabled) GDBServerSendBytes("+", 1);
+			LOG(LOG_LEVEL_DEBUG, "Received GDB packet '%s'.\n", &GDB_Server_Reception_Buffer[Offset + 1]);
+			GDBServerProcessPacket(&GDB_Server_Reception_Buffer[Offset + 1]);
+		}
+		Offset = Checksum_Offset + 3;
+	}
+	
+	// The client may have been disconnected while processing a packet
+	if (GDB_Server_Client_File_Descriptor == -1) return;
+	
+	// Discard a packet too big to ever be received
+	if ((Offset == 0) && (GDB_Server_Received_Bytes_Count == sizeof(GDB_Server_Reception_Buffer)) && !GDB_Server_Is_Target_Running)
+	{
+		LOG(LOG_LEVEL_WARNING, "WARNING : the GDB packet is too big, discarding it.\n");
+		Offset = GDB_Server_Received_Bytes_Count;
+	}
+	
+	// Keep the incomplete packets for later
+	GDB_Server_Received_Bytes_Count -= Offset;
+	memmove(GDB_Server_Reception_Buffer, &GDB_Server_Reception_Buffer[Offset], GDB_Server_Received_Bytes_Count);
+}
+
+/** Accept a GDB connection and halt the board. Only one GDB can be connected at a time. */
+static void GDBServerAcceptClient(void)
+{
+	int File_Descriptor, Is_Enabled = 1;
+	
+	File_Descriptor = accept4(GDB_Server_Server_File_Descriptor, NULL, NULL, SOCK_CLOEXEC);
+	if (File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_WARNING, "WARNING : failed to accept the GDB connection (%s).\n", strerror(errno));
+		return;
+	}
+	// GDB sends many small packets and waits for each reply
+	if (GDB_Server_String_Socket_Path[0] == 0) setsockopt(File_Descriptor, IPPROTO_TCP, TCP_NODELAY, &Is_Enabled, sizeof(Is_Enabled));
+	
+	GDB_Server_Client_File_Descriptor = File_Descriptor;
+	GDB_Server_Received_Bytes_Count = 0;
+	GDB_Server_Is_Acknowledge_Enabled = 1;
+	GDB_Server_Is_Target_Running = 1;
+	GDB_Server_Is_Stop_Reply_Expected = 0;
+	GDB_Server_Is_Interrupt_Requested = 0;
+	DebuggerHalt();
+	LOG(LOG_LEVEL_ERROR, "GDB connected.\n");
+}
+
+/** Serve GDB requests.
+ * @return always NULL.
+ */
+static void *GDBServerThread(void __attribute__((unused)) *Pointer_Parameters)
+{
+	struct pollfd Poll_File_Descriptors[3];
+	ssize_t Read_Bytes_Count;
+	uint64_t Event_Value;
+	
+	LOG(LOG_LEVEL_DEBUG, "Thread started.\n");
+	
+	while (1)
+	{
+		// Wait for a connection, for GDB requests and for the board to halt
+		Poll_File_Descriptors[0].fd = GDB_Server_Exit_Event_File_Descriptor;
+		Poll_File_Descriptors[0].events = POLLIN;
+		if (GDB_Server_Client_File_Descriptor == -1) Poll_File_Descriptors[1].fd = GDB_Server_Server_File_Descriptor;
+		else if (GDB_Server_Received_Bytes_Count < sizeof(GDB_Server_Reception_Buffer)) Poll_File_Descriptors[1].fd = GDB_Server_Client_File_Descriptor;
+		else Poll_File_Descriptors[1].fd = -1; // Wait for the board to halt before receiving more packets
+		Poll_File_Descriptors[1].events = POLLIN;
+		if ((GDB_Server_Client_File_Descriptor != -1) && GDB_Server_Is_Target_Running) Poll_File_Descriptors[2].fd = DebuggerGetHaltEventFileDescriptor();
+		else Poll_File_Descriptors[2].fd = -1;
+		Poll_File_Descriptors[2].events = POLLIN;
+		
+		if (poll(Poll_File_Descriptors, 3, -1) < 0)
+		{
+			if (errno == EINTR) continue;
+			LOG(LOG_LEVEL_ERROR, "Error : failed to wait for GDB events (%s).\n", strerror(errno));
+			break;
+		}
+		if (GDB_Server_Is_Exiting) break;
+		
+		// The board halted
+		if (Poll_File_Descriptors[2].revents & POLLIN)
+		{
+			if (read(Poll_File_Descriptors[2].fd, &Event_Value, sizeof(Event_Value)) != sizeof(Event_Value)) LOG(LOG_LEVEL_DEBUG, "Spurious halt event notification.\n");
+			GDB_Server_Is_Target_Running = 0;
+			if (GDB_Server_Is_Stop_Reply_Expected) GDBServerSendStopReply();
+			GDB_Server_Is_Stop_Reply_Expected = 0;
+			
+			// Handle the packets received while the board was running
+			GDBServerProcessReceivedBytes();
+		}
+		
+		if (Poll_File_Descriptors[1].revents == 0) continue;
+		if (Poll_File_Descriptors[1].fd == GDB_Server_Server_File_Descriptor) GDBServerAcceptClient();
+		else if (Poll_File_Descriptors[1].fd == GDB_Server_Client_File_Descriptor)
+		{
+			Read_Bytes_Count = recv(GDB_Server_Client_File_Descriptor, &GDB_Server_Reception_Buffer[GDB_Server_Received_Bytes_Count], sizeof(GDB_Server_Reception_Buffer) - GDB_Server_Received_Bytes_Count, 0);
+			if (Read_Bytes_Count <= 0)
+			{
+				if ((Read_Bytes_Count < 0) && (errno == EINTR)) continue;
+				GDBServerDisconnectClient();
+				continue;
+			}
+			GDB_Server_Received_Bytes_Count += Read_Bytes_Count;
+			GDBServerProcessReceivedBytes();
+		}
+	}
+	
+	LOG(LOG_LEVEL_DEBUG, "Thread exited.\n");
+	return NULL;
+}
+
+/** Create the Unix socket server.
+ * @param String_Path Where to create the socket.
+ * @return 0 on success,
+ * @return 1 if an error occurred.
+ */
+static int GDBServerOpenUnixSocket(char *String_Path)
+{
+	struct sockaddr_un Address;
+	
+	if (strlen(String_Path) >= sizeof(Address.sun_path))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : the GDB server Unix socket path is too long.\n");
+		return 1;
+	}
+	
+	GDB_Server_Server_File_Descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (GDB_Server_Server_File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the GDB server Unix socket (%s).\n", strerror(errno));
+		return 1;
+	}
+	
+	// Remove a stale socket left by a previous run
+	unlink(String_Path);
+	memset(&Address, 0, sizeof(Address));
+	Address.sun_family = AF_UNIX;
+	strcpy(Address.sun_path, String_Path);
+	if ((bind(GDB_Server_Server_File_Descriptor, (struct sockaddr *) &Address, sizeof(Address)) != 0) || (listen(GDB_Server_Server_File_Descriptor, 1) != 0))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to listen on the GDB server Unix socket '%s' (%s).\n", String_Path, strerror(errno));
+		return 1;
+	}
+	strcpy(GDB_Server_String_Socket_Path, String_Path);
+	
+	LOG(LOG_LEVEL_ERROR, "GDB server is listening on Unix socket '%s'.\n", String_Path);
+	return 0;
+}
+
+/** Create the TCP server, it is reachable from the local host only.
+ * @param String_Port The TCP port.
+ * @return 0 on success,
+ * @return 1 if an error occurred.
+ */
+static int GDBServerOpenTCPSocket(char *String_Port)
+{
+	struct sockaddr_in Address;
+	char *Pointer_End;
+	long Port;
+	int Is_Enabled = 1;
+	
+	Port = strtol(String_Port, &Pointer_End, 10);
+	if ((*String_Port == 0) || (*Pointer_End != 0) || (Port <= 0) || (Port > 65535))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : invalid GDB server TCP port '%s'.\n", String_Port);
+		return 1;
+	}
+	
+	GDB_Server_Server_File_Descriptor = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (GDB_Server_Server_File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the GDB server TCP socket (%s).\n", strerror(errno));
+		return 1;
+	}
+	setsockopt(GDB_Server_Server_File_Descriptor, SOL_SOCKET, SO_REUSEADDR, &Is_Enabled, sizeof(Is_Enabled));
+	
+	memset(&Address, 0, sizeof(Address));
+	Address.sin_family = AF_INET;
+	Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	Address.sin_port = htons((unsigned short) Port);
+	if ((bind(GDB_Server_Server_File_Descriptor, (struct sockaddr *) &Address, sizeof(Address)) != 0) || (listen(GDB_Server_Server_File_Descriptor, 1) != 0))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to listen on the GDB server TCP port %ld (%s).\n", Port, strerror(errno));
+		return 1;
+	}
+	
+	LOG(LOG_LEVEL_ERROR, "GDB server is listening on TCP port %ld.\n", Port);
+	return 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int GDBServerInitialize(char *String_Address)
+{
+	int Result;
+	
+	if (DebuggerInitialize() != 0) return 1;
+	GDB_Server_Exit_Event_File_Descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (GDB_Server_Exit_Event_File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the GDB server exit event (%s).\n", strerror(errno));
+		return 1;
+	}
+	
+	// Create the server
+	if (strncmp(String_Address, "unix:", 5) == 0) Result = GDBServerOpenUnixSocket(String_Address + 5);
+	else if (strncmp(String_Address, "tcp:", 4) == 0) Result = GDBServerOpenTCPSocket(String_Address + 4);
+	else
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : unknown GDB server address '%s'.\n", String_Address);
+		Result = 1;
+	}
+	if (Result != 0) return 1;
+	
+	if (pthread_create(&GDB_Server_Thread_ID, NULL, GDBServerThread, NULL) != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the GDB server thread (%s).\n", strerror(errno));
+		return 1;
+	}
+	return 0;
+}
+
+void GDBServerUninitialize(void)
+{
+	uint64_t Event_Value = 1;
+	
+	// Stop serving GDB before releasing the board, so it can't be halted again
+	GDB_Server_Is_Exiting = 1;
+	if (write(GDB_Server_Exit_Event_File_Descriptor, &Event_Value, sizeof(Event_Value)) != sizeof(Event_Value)) LOG(LOG_LEVEL_WARNING, "WARNING : failed to notify the GDB server thread (%s).\n", strerror(errno));
+	DebuggerRelease(); // The server thread may be waiting for an execution backward that the exiting CPU thread will never terminate
+	pthread_join(GDB_Server_Thread_ID, NULL);
+	
+	GDBServerDisconnectClient();
+	DebuggerRelease();
+	close(GDB_Server_Server_File_Descriptor);
+	if (GDB_Server_String_Socket_Path[0] != 0) unlink(GDB_Server_String_Socket_Path);
+}
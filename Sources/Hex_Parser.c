@@ -3,8 +3,7 @@
  * @author Adrien RICCIARDI
  */
 #include <Hex_Parser.h>
-#include <stdio.h>
-#include <string.h>
+#include <Log.h>
 
 //-------------------------------------------------------------------------------------------------
 // Private constants
@@ -18,81 +17,165 @@
 /** Offset of the beginning of the data into the record. */
 #define HEX_PARSER_OFFSET_DATA 4
 
+/** How many bytes are surrounding the record data (size, address, type and checksum). */
+#define HEX_PARSER_RECORD_OVERHEAD_SIZE 5
+
 /** The record holds data. */
 #define HEX_PARSER_RECORD_TYPE_DATA 0
 /** End of file record. */
 #define HEX_PARSER_RECORD_TYPE_END_OF_FILE 1
+/** The record holds the base address bits 19 to 4. */
+#define HEX_PARSER_RECORD_TYPE_EXTENDED_SEGMENT_ADDRESS 2
+/** The record holds a 80x86 start address, it has no meaning here. */
+#define HEX_PARSER_RECORD_TYPE_START_SEGMENT_ADDRESS 3
+/** The record holds the base address bits 31 to 16. */
+#define HEX_PARSER_RECORD_TYPE_EXTENDED_LINEAR_ADDRESS 4
+/** The record holds a 32-bit start address, it has no meaning here. */
+#define HEX_PARSER_RECORD_TYPE_START_LINEAR_ADDRESS 5
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** Convert an hexadecimal digit character to its value plus one, so all invalid characters are implicitly converted to zero. */
+static const unsigned char Hex_Parser_Digits_Values[256] =
+{
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16
+};
 
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
 /** Convert an hexadecimal string number into its binary representation.
- * @param High_Nibble The high nibble of the hexadecimal number (corresponding to bits 7 to 4).
- * @param Low_Nibble The low nibble of the hexadecimal number (corresponding to bits 3 to 0).
- * @return The binary value of the number.
- * @warning No checks are done on nibble validity, be careful about parameters value.
+ * @param Pointer_Digits The two hexadecimal digits, high nibble first.
+ * @return The binary value of the number (from 0 to 255),
+ * @return -1 if a character is not an hexadecimal digit.
  */
-static inline unsigned char HexParserConvertHexadecimalToByte(unsigned char High_Nibble, unsigned char Low_Nibble)
+static inline int HexParserConvertHexadecimalToByte(const char *Pointer_Digits)
 {
-	// Convert symbol to capitals if needed
-	if ((High_Nibble >= 'a') && (High_Nibble <= 'f')) High_Nibble -= 32;
-	if ((Low_Nibble >= 'a') && (Low_Nibble <= 'f')) Low_Nibble -= 32;
+	int High_Nibble, Low_Nibble;
 	
-	// High nibble
-	if ((High_Nibble >= 'A') && (High_Nibble <= 'F')) High_Nibble -= 55; // A = 10 in decimal
-	else High_Nibble -= 48; // Handle digits
-	// Low nibble
-	if ((Low_Nibble >= 'A') && (Low_Nibble <= 'F')) Low_Nibble -= 55; // A = 10 in decimal
-	else Low_Nibble -= 48; // Handle digits
-		
-	return (unsigned char) (High_Nibble << 4) + Low_Nibble;
+	High_Nibble = Hex_Parser_Digits_Values[(unsigned char) Pointer_Digits[0]];
+	Low_Nibble = Hex_Parser_Digits_Values[(unsigned char) Pointer_Digits[1]];
+	if ((High_Nibble == 0) || (Low_Nibble == 0)) return -1;
+	
+	return ((High_Nibble - 1) << 4) | (Low_Nibble - 1);
 }
 
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
-int HexParserDecodeLine(char *String_Hex_Line, THexParserInstruction Instructions[])
+int HexParserDecodeRecord(const char *Pointer_Record, unsigned int Available_Characters, unsigned int *Pointer_Base_Address, THexParserInstruction Instructions[], int *Pointer_Instructions_Count)
 {
-	unsigned char Buffer[(HEX_PARSER_MAXIMUM_INSTRUCTIONS_PER_LINE * 2) + 20]; // Should be large enough
-	unsigned short Address;
-	int i, j = 1, Instructions_Count, Buffer_Size;
+	unsigned char Buffer[255 + HEX_PARSER_RECORD_OVERHEAD_SIZE];
+	unsigned int Address, Record_Characters_Count;
+	int i, Byte, Buffer_Size, Checksum = 0, Instructions_Count;
 	
-	// Convert line to binary value
-	Buffer_Size = (strlen(String_Hex_Line) - 1) / 2;
-	for (i = 0; i < Buffer_Size; i++)
+	*Pointer_Instructions_Count = 0;
+	
+	// Check the start code and get the record size to know how many characters to convert
+	if ((Available_Characters < 3) || (Pointer_Record[0] != ':'))
 	{
-		Buffer[i] = HexParserConvertHexadecimalToByte(String_Hex_Line[j], String_Hex_Line[j + 1]);
-		j += 2;
+		LOG(LOG_LEVEL_ERROR, "ERROR : the hex record does not begin with a start code.\n");
+		return -1;
 	}
-
-	// Is end of file reached ?
-	if (Buffer[HEX_PARSER_OFFSET_RECORD_TYPE] == HEX_PARSER_RECORD_TYPE_END_OF_FILE)
+	Byte = HexParserConvertHexadecimalToByte(&Pointer_Record[1]);
+	if (Byte < 0)
 	{
-		Instructions[0].Is_Instruction_Valid = 0;
-		Instructions[0].Is_End_Of_File = 1;
-		return 1;
+		LOG(LOG_LEVEL_ERROR, "ERROR : the hex record size is not an hexadecimal number.\n");
+		return -1;
+	}
+	Buffer_Size = Byte + HEX_PARSER_RECORD_OVERHEAD_SIZE;
+	Record_Characters_Count = 1 + (Buffer_Size * 2);
+	if (Record_Characters_Count > Available_Characters)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : the hex record is truncated.\n");
+		return -1;
 	}
 	
-	// Assert this is a data record
-	if (Buffer[HEX_PARSER_OFFSET_RECORD_TYPE] != HEX_PARSER_RECORD_TYPE_DATA) return 0;
+	// Convert the record to binary values and compute the checksum on the fly
+	Pointer_Record++;
+	for (i = 0; i < Buffer_Size; i++)
+	{
+		Byte = HexParserConvertHexadecimalToByte(Pointer_Record);
+		if (Byte < 0)
+		{
+			LOG(LOG_LEVEL_ERROR, "ERROR : the hex record contains a bad hexadecimal digit.\n");
+			return -1;
+		}
+		Buffer[i] = (unsigned char) Byte;
+		Checksum += Byte;
+		Pointer_Record += 2;
+	}
 	
-	// Compute instructions count
-	Instructions_Count = Buffer[HEX_PARSER_OFFSET_RECORD_SIZE] / 2; // 2 bytes per instruction
-	// Find record start address
-	Address = ((Buffer[HEX_PARSER_OFFSET_DATA_ADDRESS] << 8) | Buffer[HEX_PARSER_OFFSET_DATA_ADDRESS + 1]) / 2; // The address is in bytes, we need it in words
+	// The checksum is the two's complement of the record bytes sum, so the sum of all bytes including the checksum is zero
+	if ((Checksum & 0xFF) != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : bad hex record checksum.\n");
+		return -1;
+	}
 	
-	// Parse data
-	for (i = 0; i < Instructions_Count; i++)
+	switch (Buffer[HEX_PARSER_OFFSET_RECORD_TYPE])
 	{
-		// Set instruction address
-		Instructions[i].Address = Address;
-		// Next instruction
-		Address++;
-		
-		// Find instruction code
-		Instructions[i].Code = (Buffer[HEX_PARSER_OFFSET_DATA + (i * 2) + 1] << 8) | Buffer[HEX_PARSER_OFFSET_DATA + (i * 2)]; // Convert little endian storage in the hex file to big endian
-		Instructions[i].Is_Instruction_Valid = 1;
-		Instructions[i].Is_End_Of_File = 0;
+		case HEX_PARSER_RECORD_TYPE_DATA:
+			// PIC instructions are stored as 2 bytes, so an odd amount of data is not a valid program
+			if (Buffer[HEX_PARSER_OFFSET_RECORD_SIZE] & 1)
+			{
+				LOG(LOG_LEVEL_ERROR, "ERROR : the hex data record has an odd size (%u bytes).\n", Buffer[HEX_PARSER_OFFSET_RECORD_SIZE]);
+				return -1;
+			}
+			
+			// Compute instructions count
+			Instructions_Count = Buffer[HEX_PARSER_OFFSET_RECORD_SIZE] / 2; // 2 bytes per instruction
+			// Find record start address
+			Address = (*Pointer_Base_Address + ((Buffer[HEX_PARSER_OFFSET_DATA_ADDRESS] << 8) | Buffer[HEX_PARSER_OFFSET_DATA_ADDRESS + 1])) / 2; // The address is in bytes, we need it in words
+			
+			// Parse data
+			for (i = 0; i < Instructions_Count; i++)
+			{
+				// Set instruction address
+				Instructions[i].Address = Address;
+				// Next instruction
+				Address++;
+				
+				// Find instruction code
+				Instructions[i].Code = (Buffer[HEX_PARSER_OFFSET_DATA + (i * 2) + 1] << 8) | Buffer[HEX_PARSER_OFFSET_DATA + (i * 2)]; // Convert little endian storage in the hex file to big endian
+				Instructions[i].Is_Instruction_Valid = 1;
+				Instructions[i].Is_End_Of_File = 0;
+			}
+			*Pointer_Instructions_Count = Instructions_Count;
+			break;
+			
+		case HEX_PARSER_RECORD_TYPE_END_OF_FILE:
+			Instructions[0].Is_Instruction_Valid = 0;
+			Instructions[0].Is_End_Of_File = 1;
+			*Pointer_Instructions_Count = 1;
+			break;
+			
+		case HEX_PARSER_RECORD_TYPE_EXTENDED_SEGMENT_ADDRESS:
+		case HEX_PARSER_RECORD_TYPE_EXTENDED_LINEAR_ADDRESS:
+			if (Buffer[HEX_PARSER_OFFSET_RECORD_SIZE] != 2)
+			{
+				LOG(LOG_LEVEL_ERROR, "ERROR : the hex extended address record has a bad size (%u bytes).\n", Buffer[HEX_PARSER_OFFSET_RECORD_SIZE]);
+				return -1;
+			}
+			Address = (Buffer[HEX_PARSER_OFFSET_DATA] << 8) | Buffer[HEX_PARSER_OFFSET_DATA + 1];
+			
+			// A segment address is multiplied by 16, a linear address provides the upper 16 bits
+			if (Buffer[HEX_PARSER_OFFSET_RECORD_TYPE] == HEX_PARSER_RECORD_TYPE_EXTENDED_SEGMENT_ADDRESS) *Pointer_Base_Address = Address << 4;
+			else *Pointer_Base_Address = Address << 16;
+			LOG(LOG_LEVEL_DEBUG, "New hex base address : 0x%08X.\n", *Pointer_Base_Address);
+			break;
+			
+		case HEX_PARSER_RECORD_TYPE_START_SEGMENT_ADDRESS:
+		case HEX_PARSER_RECORD_TYPE_START_LINEAR_ADDRESS:
+			break;
+			
+		default:
+			LOG(LOG_LEVEL_ERROR, "ERROR : unknown hex record type (0x%02X).\n", Buffer[HEX_PARSER_OFFSET_RECORD_TYPE]);
+			return -1;
 	}
-	return Instructions_Count;
+	
+	return (int) Record_Characters_Count;
 }
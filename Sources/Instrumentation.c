@@ -0,0 +1,187 @@
+/** @file Instrumentation.c
+ * @see Instrumentation.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Instrumentation.h>
+
+#ifdef INSTRUMENTATION_ENABLED
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <Log.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** All hardware performance counters. */
+typedef enum
+{
+	INSTRUMENTATION_COUNTER_CYCLES,
+	INSTRUMENTATION_COUNTER_INSTRUCTIONS,
+	INSTRUMENTATION_COUNTER_BRANCH_MISSES,
+	INSTRUMENTATION_COUNTER_CACHE_MISSES,
+	INSTRUMENTATION_COUNTERS_COUNT
+} TInstrumentationCounter;
+
+/** The counters group content returned by read() when the PERF_FORMAT_GROUP format is used. */
+typedef struct
+{
+	uint64_t Counters_Count;
+	uint64_t Values[INSTRUMENTATION_COUNTERS_COUNT];
+} TInstrumentationCountersGroupValues;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The hardware event measured by each counter. */
+static const unsigned long long Instrumentation_Counter_Events[INSTRUMENTATION_COUNTERS_COUNT] =
+{
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_BRANCH_MISSES,
+	PERF_COUNT_HW_CACHE_MISSES
+};
+
+/** The counters names displayed in the report. */
+static char *String_Instrumentation_Counter_Names[INSTRUMENTATION_COUNTERS_COUNT] =
+{
+	"Host cycles",
+	"Host instructions",
+	"Branch misses",
+	"Cache misses"
+};
+
+/** The subsystems names displayed in the report. */
+static char *String_Instrumentation_Subsystem_Names[INSTRUMENTATION_SUBSYSTEMS_COUNT] =
+{
+	"Main loop",
+	"Core",
+	"Throttling",
+	"Register file",
+	"Interrupt controller",
+	"Timers",
+	"UART",
+	"I2C EEPROM",
+	"ADC",
+	"Memory access",
+	"Logging"
+};
+
+/** The counters group file descriptor (the first counter one), or -1 if the performance counters are not available. */
+static int Instrumentation_Counters_Group_File_Descriptor = -1;
+
+/** The time stamp counter value when the instrumentation started. */
+static unsigned long long Instrumentation_Start_Timestamp;
+/** The monotonic clock value when the instrumentation started (in nanoseconds). */
+static unsigned long long Instrumentation_Start_Time;
+
+//-------------------------------------------------------------------------------------------------
+// Public variables
+//-------------------------------------------------------------------------------------------------
+__thread int Instrumentation_Is_Thread_Instrumented = 0;
+TInstrumentationSubsystem Instrumentation_Subsystems_Stack[INSTRUMENTATION_MAXIMUM_NESTING_LEVEL] = { INSTRUMENTATION_SUBSYSTEM_MAIN_LOOP };
+int Instrumentation_Subsystems_Stack_Top = 0;
+unsigned long long Instrumentation_Subsystem_Ticks[INSTRUMENTATION_SUBSYSTEMS_COUNT];
+unsigned long long Instrumentation_Last_Timestamp;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Read the monotonic clock.
+ * @return The current time in nanoseconds.
+ */
+static unsigned long long InstrumentationGetTime(void)
+{
+	struct timespec Time;
+	
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+	return (unsigned long long) Time.tv_sec * 1000000000ULL + Time.tv_nsec;
+}
+
+/** Open all hardware performance counters as a single group counting the calling thread user space execution.
+ * @return 0 if the counters were started,
+ * @return 1 if the host does not provide them.
+ */
+static int InstrumentationOpenCounters(void)
+{
+	struct perf_event_attr Attributes;
+	int i, File_Descriptor;
+	
+	for (i = 0; i < INSTRUMENTATION_COUNTERS_COUNT; i++)
+	{
+		memset(&Attributes, 0, sizeof(Attributes));
+		Attributes.size = sizeof(Attributes);
+		Attributes.type = PERF_TYPE_HARDWARE;
+		Attributes.config = Instrumentation_Counter_Events[i];
+		Attributes.read_format = PERF_FORMAT_GROUP;
+		Attributes.disabled = (i == 0); // Start all counters at once when the group leader is enabled
+		Attributes.exclude_kernel = 1; // Needed by the default perf_event_paranoid setting
+		Attributes.exclude_hv = 1;
+		
+		File_Descriptor = syscall(SYS_perf_event_open, &Attributes, 0, -1, Instrumentation_Counters_Group_File_Descriptor, 0);
+		if (File_Descriptor == -1)
+		{
+			LOG(LOG_LEVEL_WARNING, "WARNING : could not open the '%s' hardware performance counter (%s), hardware counters are disabled.\n", String_Instrumentation_Counter_Names[i], strerror(errno));
+			if (Instrumentation_Counters_Group_File_Descriptor != -1) close(Instrumentation_Counters_Group_File_Descriptor); // Closing the leader releases the whole group
+			Instrumentation_Counters_Group_File_Descriptor = -1;
+			return 1;
+		}
+		if (i == 0) Instrumentation_Counters_Group_File_Descriptor = File_Descriptor;
+	}
+	
+	ioctl(Instrumentation_Counters_Group_File_Descriptor, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(Instrumentation_Counters_Group_File_Descriptor, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void InstrumentationStart(void)
+{
+	InstrumentationOpenCounters();
+	
+	Instrumentation_Start_Time = InstrumentationGetTime();
+	Instrumentation_Start_Timestamp = InstrumentationReadTimestamp();
+	Instrumentation_Last_Timestamp = Instrumentation_Start_Timestamp;
+	Instrumentation_Is_Thread_Instrumented = 1;
+}
+
+void InstrumentationDump(void)
+{
+	TInstrumentationCountersGroupValues Counters;
+	unsigned long long Total_Ticks = 0, Elapsed_Time;
+	double Nanoseconds_Per_Tick;
+	int i;
+	
+	// Convert the time stamp counter ticks to time
+	Elapsed_Time = InstrumentationGetTime() - Instrumentation_Start_Time;
+	for (i = 0; i < INSTRUMENTATION_SUBSYSTEMS_COUNT; i++) Total_Ticks += Instrumentation_Subsystem_Ticks[i];
+	if (Total_Ticks == 0) Total_Ticks = 1;
+	Nanoseconds_Per_Tick = (double) Elapsed_Time / (InstrumentationReadTimestamp() - Instrumentation_Start_Timestamp + 1);
+	
+	LOG(LOG_LEVEL_ERROR, "Subsystem            |          Ticks | Time (ms) | Share\n");
+	LOG(LOG_LEVEL_ERROR, "---------------------+----------------+-----------+-------\n");
+	for (i = 0; i < INSTRUMENTATION_SUBSYSTEMS_COUNT; i++) LOG(LOG_LEVEL_ERROR, "%-20s | %14llu | %9.1f | %5.1f%%\n", String_Instrumentation_Subsystem_Names[i], Instrumentation_Subsystem_Ticks[i], Instrumentation_Subsystem_Ticks[i] * Nanoseconds_Per_Tick / 1000000.0, Instrumentation_Subsystem_Ticks[i] * 100.0 / Total_Ticks);
+	
+	if (Instrumentation_Counters_Group_File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_ERROR, "Hardware performance counters are not available.\n");
+		return;
+	}
+	if ((read(Instrumentation_Counters_Group_File_Descriptor, &Counters, sizeof(Counters)) != sizeof(Counters)) || (Counters.Counters_Count != INSTRUMENTATION_COUNTERS_COUNT))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to read the hardware performance counters (%s).\n", strerror(errno));
+		return;
+	}
+	for (i = 0; i < INSTRUMENTATION_COUNTERS_COUNT; i++) LOG(LOG_LEVEL_ERROR, "%-20s : %llu\n", String_Instrumentation_Counter_Names[i], (unsigned long long) Counters.Values[i]);
+	if (Counters.Values[INSTRUMENTATION_COUNTER_CYCLES] != 0) LOG(LOG_LEVEL_ERROR, "%-20s : %.2f\n", "Instructions/cycle", (double) Counters.Values[INSTRUMENTATION_COUNTER_INSTRUCTIONS] / Counters.Values[INSTRUMENTATION_COUNTER_CYCLES]);
+}
+
+#endif
@@ -0,0 +1,68 @@
+/** @file Interrupt_Controller.c
+ * @see Interrupt_Controller.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Instrumentation.h>
+#include <Interrupt_Controller.h>
+#include <Log.h>
+#include <Register_File.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** All INTCON interrupt flags, their enable bit is located 3 bits above. */
+#define INTERRUPT_CONTROLLER_INTCON_FLAGS_MASK (REGISTER_FILE_REGISTER_BIT_INTCON_T0IF | REGISTER_FILE_REGISTER_BIT_INTCON_INTF | REGISTER_FILE_REGISTER_BIT_INTCON_RBIF)
+/** All PIR1 interrupt flags existing on the PIC16F876 (there is no parallel slave port on the 28-pin devices). */
+#define INTERRUPT_CONTROLLER_PIR1_FLAGS_MASK (REGISTER_FILE_REGISTER_BIT_PIR1_ADIF | REGISTER_FILE_REGISTER_BIT_PIR1_RCIF | REGISTER_FILE_REGISTER_BIT_PIR1_TXIF | REGISTER_FILE_REGISTER_BIT_PIR1_SSPIF | REGISTER_FILE_REGISTER_BIT_PIR1_CCP1IF | REGISTER_FILE_REGISTER_BIT_PIR1_TMR2IF | REGISTER_FILE_REGISTER_BIT_PIR1_TMR1IF)
+/** All PIR2 interrupt flags. */
+#define INTERRUPT_CONTROLLER_PIR2_FLAGS_MASK (REGISTER_FILE_REGISTER_BIT_PIR2_EEIF | REGISTER_FILE_REGISTER_BIT_PIR2_BCLIF | REGISTER_FILE_REGISTER_BIT_PIR2_CCP2IF)
+
+//-------------------------------------------------------------------------------------------------
+// Public variables
+//-------------------------------------------------------------------------------------------------
+unsigned int Interrupt_Controller_Pending_Interrupts = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void InterruptControllerWriteRegister(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data)
+{
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_INTERRUPT_CONTROLLER);
+	Pointer_Content->Data = Data;
+	InterruptControllerUpdate();
+	INSTRUMENTATION_LEAVE();
+}
+
+void InterruptControllerWriteRemappedRegister(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data)
+{
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_INTERRUPT_CONTROLLER);
+	*(Pointer_Content->Pointer_Data) = Data;
+	InterruptControllerUpdate();
+	INSTRUMENTATION_LEAVE();
+}
+
+void InterruptControllerUpdate(void)
+{
+	unsigned int INTCON_Register, Pending_Interrupts;
+	
+	// No interrupt can be serviced when interrupts are disabled
+	INTCON_Register = RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_INTCON, REGISTER_FILE_REGISTER_ADDRESS_INTCON);
+	if (!(INTCON_Register & REGISTER_FILE_REGISTER_BIT_INTCON_GIE))
+	{
+		Interrupt_Controller_Pending_Interrupts = 0;
+		return;
+	}
+	
+	// T0I, INT and RBI do not depend on PEIE
+	Pending_Interrupts = ((INTCON_Register >> 3) & INTCON_Register & INTERRUPT_CONTROLLER_INTCON_FLAGS_MASK) << INTERRUPT_CONTROLLER_PENDING_INTERRUPTS_SHIFT_INTCON;
+	
+	// Add peripheral flags if peripheral interrupts are enabled
+	if (INTCON_Register & REGISTER_FILE_REGISTER_BIT_INTCON_PEIE)
+	{
+		Pending_Interrupts |= (RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_PIE1, REGISTER_FILE_REGISTER_ADDRESS_PIE1) & RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1) & INTERRUPT_CONTROLLER_PIR1_FLAGS_MASK) << INTERRUPT_CONTROLLER_PENDING_INTERRUPTS_SHIFT_PIR1;
+		Pending_Interrupts |= (RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_PIE2, REGISTER_FILE_REGISTER_ADDRESS_PIE2) & RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_PIR2, REGISTER_FILE_REGISTER_ADDRESS_PIR2) & INTERRUPT_CONTROLLER_PIR2_FLAGS_MASK) << INTERRUPT_CONTROLLER_PENDING_INTERRUPTS_SHIFT_PIR2;
+	}
+	
+	if (Pending_Interrupts != Interrupt_Controller_Pending_Interrupts) LOG(LOG_LEVEL_DEBUG, "Pending interrupts changed to 0x%06X.\n", Pending_Interrupts);
+	Interrupt_Controller_Pending_Interrupts = Pending_Interrupts;
+}
@@ -2,6 +2,7 @@
  * @see Log.h for description.
  * @author Adrien RICCIARDI
  */
+#include <Instrumentation.h>
 #include <Log.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -50,10 +51,12 @@ void LogWrite(TLogLevel Log_Level, char *String_Format, ...)
 {
 	va_list Arguments_List;
 	
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_LOGGING);
 	if (Log_Level <= Log_Maximum_Level)
 	{
 		va_start(Arguments_List, String_Format);
 		vfprintf(Pointer_Log_File, String_Format, Arguments_List);
 		va_end(Arguments_List);
 	}
+	INSTRUMENTATION_LEAVE();
 }
\ No newline at end of file
@@ -3,18 +3,32 @@
  * @author Adrien RICCIARDI
  */
 #include <Core.h>
+#include <Coverage.h>
+#include <Debugger.h>
+#include <Disassembler.h>
 #include <errno.h>
+#include <GDB_Server.h>
+#include <Instrumentation.h>
+#include <limits.h>
 #include <Log.h>
 #include <Peripheral_ADC.h>
+#include <Peripheral_Data_EEPROM.h>
 #include <Peripheral_I2C_EEPROM.h>
+#include <Peripheral_Memory_Access.h>
 #include <Peripheral_Timer.h>
 #include <Peripheral_UART.h>
 #include <Program_Memory.h>
 #include <pthread.h>
 #include <Register_File.h>
+#include <signal.h>
+#include <Snapshot.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <UART_Backend.h>
+#include <unistd.h>
+#include <Virtual_Terminal.h>
+#include <Watchpoint.h>
 
 //-------------------------------------------------------------------------------------------------
 // Private constants
@@ -25,43 +39,189 @@
  */
 #define MAIN_CONTROL_KEY_COMBINATION(Key) (Key & 0x1F)
 
+/** How many watchpoints can be given on the command line. */
+#define MAIN_MAXIMUM_WATCHPOINTS_COUNT 32
+/** How many screen checks can be given on the command line. */
+#define MAIN_MAXIMUM_SCREEN_CHECKS_COUNT 16
+
+/** The value of a configuration word the hex file does not program. */
+#define MAIN_CONFIGURATION_WORD_UNPROGRAMMED_VALUE 0x3FFF
+/** The configuration word watchdog timer enable bit. */
+#define MAIN_CONFIGURATION_WORD_BIT_WDTE 0x0004
+/** The configuration word oscillator selection bits. */
+#define MAIN_CONFIGURATION_WORD_MASK_FOSC 0x0003
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** The board state a reloaded program is started from. The EEPROMs content is not part of it, so it survives the reloads. */
+typedef struct
+{
+	TCoreState Core_State; //! The core registers (the cycles count is not restored).
+	unsigned char Register_File[REGISTER_FILE_LOCATIONS_COUNT]; //! All register file locations.
+	TPeripheralTimerSnapshot Timer; //! The timers prescalers.
+	TPeripheralADCSnapshot ADC; //! The ADC conversion state.
+	TPeripheralMemoryAccessSnapshot Memory_Access; //! The EECON registers interface state.
+	TPeripheralUARTSnapshot UART; //! The transmitter and receiver timing state.
+} TMainResetState;
+
 //-------------------------------------------------------------------------------------------------
 // Private variables
 //-------------------------------------------------------------------------------------------------
 /** Tell whether the simulator is quitting or not. */
 static volatile int Main_Is_Simulator_Exiting = 0;
 
+/** Tell whether the CPU thread must reload the program before executing the next instruction. */
+static volatile int Main_Is_Program_Reload_Requested = 0;
+/** Set to 1 to continue the reloaded program with the current core, registers and peripherals state instead of restarting it. */
+static int Main_Is_Core_State_Kept = 0;
+/** The program hex file, loaded again on each reload. */
+static char *String_Main_Program_Hex_File;
+/** The program listing file, loaded again on each reload (NULL if no listing file is used). */
+static char *String_Main_Listing_File = NULL;
+/** The board state right after the simulator initialization. */
+static TMainResetState Main_Reset_State;
+/** The simulated oscillator frequency in Hz, checked against each loaded program configuration word. */
+static unsigned int Main_Oscillator_Frequency = CORE_DEFAULT_OSCILLATOR_FREQUENCY;
+
+/** Tell whether the standard input is a terminal the user can type on. */
+static int Main_Is_Console_Interactive;
+
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
 /** Do not display typed in text and disable all default console features. */
 static inline void MainInitializeConsole(void)
 {
+	if (!Main_Is_Console_Interactive) return;
 	if (system("stty raw -echo") != 0) printf("WARNING : tty initialization failed.\n");
 }
 
 /** Restore the console default behavior. */
 static inline void MainUninitializeConsole(void)
 {
+	if (!Main_Is_Console_Interactive) return;
 	if (system("stty cooked echo") != 0) printf("WARNING : tty uninitialization failed.\n");
 	
 	// Show cursor
 	printf("\x1B[?25h");
 }
 
+/** Write the instruction that is about to be executed to the log file.
+ * @param Address The instruction address.
+ * @param Instruction The instruction code.
+ */
+static void MainTraceInstruction(unsigned short Address, unsigned short Instruction)
+{
+	char String_Address[DISASSEMBLER_ADDRESS_STRING_SIZE], String_Instruction[DISASSEMBLER_INSTRUCTION_STRING_SIZE];
+	
+	DisassemblerFormatAddress(Address, String_Address, sizeof(String_Address));
+	DisassemblerDecodeInstruction(Address, Instruction, String_Instruction, sizeof(String_Instruction));
+	LOG(LOG_LEVEL_DEBUG, "%s : %s\n", String_Address, String_Instruction);
+}
+
+/** Warn about the loaded program configuration word settings the simulation does not match, because the program would behave differently on the real chip. */
+static void MainCheckConfigurationWord(void)
+{
+	static char *String_Oscillator_Modes[] = { "LP", "XT", "HS", "RC" };
+	static unsigned int Maximum_Oscillator_Frequencies[] = { 200000, 4000000, 20000000, 4000000 }; // In Hz, for each oscillator mode
+	unsigned short Configuration_Word;
+	unsigned int Oscillator_Mode;
+	
+	Configuration_Word = ProgramMemoryGetConfigurationWord();
+	if (Configuration_Word == MAIN_CONFIGURATION_WORD_UNPROGRAMMED_VALUE)
+	{
+		LOG(LOG_LEVEL_DEBUG, "The hex file does not program the configuration word.\n");
+		return;
+	}
+	LOG(LOG_LEVEL_DEBUG, "Configuration word : 0x%04X.\n", Configuration_Word);
+	
+	// The watchdog timer is not simulated, so it never resets a program that does not clear it in time
+	if (Configuration_Word & MAIN_CONFIGURATION_WORD_BIT_WDTE) LOG(LOG_LEVEL_WARNING, "WARNING : the configuration word enables the watchdog timer, which is not simulated.\n");
+	
+	// Each oscillator mode drives a limited frequency range
+	Oscillator_Mode = Configuration_Word & MAIN_CONFIGURATION_WORD_MASK_FOSC;
+	if (Main_Oscillator_Frequency > Maximum_Oscillator_Frequencies[Oscillator_Mode]) LOG(LOG_LEVEL_WARNING, "WARNING : the configuration word selects the %s oscillator mode, which does not run at %u Hz (%u Hz at most).\n", String_Oscillator_Modes[Oscillator_Mode], Main_Oscillator_Frequency, Maximum_Oscillator_Frequencies[Oscillator_Mode]);
+}
+
+/** Replace the program by the current hex file content, then restart it from the reset vector unless the core state must be kept. The EEPROMs content and the UART backend are left untouched. Must be called by the CPU thread, between two instructions. */
+static void MainReloadProgram(void)
+{
+	TCoreState Core_State;
+	
+	Main_Is_Program_Reload_Requested = 0;
+	if (ProgramMemoryReloadHexFile(String_Main_Program_Hex_File) != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to reload the hex file, the previous program is still executed.\n");
+		return;
+	}
+	if ((String_Main_Listing_File != NULL) && (DisassemblerLoadSymbols(String_Main_Listing_File) != 0)) LOG(LOG_LEVEL_WARNING, "WARNING : failed to reload the listing file, the previous labels are still used.\n");
+	MainCheckConfigurationWord();
+	
+	// The peripherals pending operations and the snapshots are based on the cycles count, so it keeps going on
+	if (!Main_Is_Core_State_Kept)
+	{
+		Core_State = Main_Reset_State.Core_State;
+		Core_State.Cycles_Count = CoreGetCyclesCount();
+		CoreSetState(&Core_State);
+		RegisterFileRestoreSnapshot(Main_Reset_State.Register_File);
+		PeripheralTimerRestoreSnapshot(&Main_Reset_State.Timer);
+		PeripheralADCRestoreSnapshot(&Main_Reset_State.ADC);
+		PeripheralMemoryAccessRestoreSnapshot(&Main_Reset_State.Memory_Access);
+		PeripheralUARTRestoreSnapshot(&Main_Reset_State.UART);
+	}
+	
+	// The previous program history can't be executed again
+	if (SnapshotIsEnabled()) SnapshotDiscardAll();
+	// The previous program coverage does not match the new program addresses
+	memset(&Coverage_Map, 0, sizeof(Coverage_Map));
+	LOG(LOG_LEVEL_ERROR, "Program reloaded from '%s' at cycle %llu%s.\n", String_Main_Program_Hex_File, CoreGetCyclesCount(), Main_Is_Core_State_Kept ? ", the core state is kept" : "");
+}
+
 /** Execute the PIC program.
  * @return always 0.
  */
 static void *MainThreadExecuteProgram(void __attribute__((unused)) *Pointer_Parameters)
 {
+	unsigned int Cycles;
+	
 	LOG(LOG_LEVEL_DEBUG, "Thread started.\n");
+	InstrumentationStart();
 
 	while (!Main_Is_Simulator_Exiting)
 	{
-		CoreExecuteNextInstruction();
+		// Swap the program between two instructions, so no instruction sees a mix of both programs. Wait for an execution backward to finish, it uses the snapshots the reload discards
+		if (Main_Is_Program_Reload_Requested && !DebuggerIsExecutingBackward()) MainReloadProgram();
+		
+		// Save the board state from time to time, so the debugger can execute the program backward
+		if (SnapshotIsEnabled()) SnapshotUpdate();
 		
-		// Clock the timers
-		PeripheralTimerIncrement();
+		// Let the debugger halt the whole board before the instruction is executed
+		if (DebuggerIsArmed()) DebuggerCheck();
+		
+		INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_CORE);
+		Cycles = CoreExecuteNextInstruction();
+		INSTRUMENTATION_LEAVE();
+		
+		// Clock the timers for the whole instruction duration
+		INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_TIMER);
+		PeripheralTimerIncrement(Cycles);
+		INSTRUMENTATION_LEAVE();
+		
+		// Give the UART the next received byte if possible
+		INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_UART);
+		PeripheralUARTUpdate();
+		INSTRUMENTATION_LEAVE();
+		
+		// Terminate the pending analog conversion if its time has come
+		INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_ADC);
+		PeripheralADCUpdate();
+		INSTRUMENTATION_LEAVE();
+		
+		// Terminate the pending data EEPROM or program memory write if its time has come
+		INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_MEMORY_ACCESS);
+		PeripheralMemoryAccessUpdate();
+		INSTRUMENTATION_LEAVE();
 	}
 
 	LOG(LOG_LEVEL_DEBUG, "Thread exited.\n");
@@ -73,53 +233,343 @@ static void *MainThreadExecuteProgram(void __attribute__((unused)) *Pointer_Para
 //-------------------------------------------------------------------------------------------------
 int main(int argc, char *argv[])
 {
-	char *String_Log_File, *String_Program_Hex_File, *String_EEPROM_File;
+	char *String_Log_File, *String_Program_Hex_File, *String_EEPROM_File, *String_Data_EEPROM_File = NULL, *String_UART_Backend_Path = NULL, *String_ADC_Sample_Source_Parameter = NULL, *String_Coverage_File = NULL, *String_Listing_File = NULL, *String_GDB_Server_Address = NULL, *String_Snapshot_Parameters = NULL, String_Default_Data_EEPROM_File[PATH_MAX];
 	TLogLevel Log_Level;
+	TUARTBackendType UART_Backend_Type = UART_BACKEND_TYPE_CONSOLE;
+	TPeripheralADCSampleSource ADC_Sample_Source = PERIPHERAL_ADC_SAMPLE_SOURCE_PSEUDO_RANDOM;
+	TCoreEngine Core_Engine = CORE_ENGINE_INTERPRETER;
+	double Time_Scale = 1;
 	pthread_t Thread_ID;
-	int Character_Code;
+	char *String_Watchpoints[MAIN_MAXIMUM_WATCHPOINTS_COUNT], *String_Screen_Check_Texts[MAIN_MAXIMUM_SCREEN_CHECKS_COUNT];
+	int Character_Code, Option, Is_EEPROM_Base_Image_Shared = 0, Watchpoints_Count = 0, i, Virtual_Terminal_Frames_Per_Second = -1, Screen_Check_Rows[MAIN_MAXIMUM_SCREEN_CHECKS_COUNT], Screen_Checks_Count = 0, Text_Offset, Is_Screen_Check_Failed = 0;
+	sigset_t Signals_Set;
+	
+	// Retrieve options
+	while ((Option = getopt(argc, argv, "a:b:c:d:e:f:g:krs:t:u:v:w:x:")) != -1)
+	{
+		switch (Option)
+		{
+			// ADC sample source
+			case 'a':
+				if (strncmp(optarg, "prng:", 5) == 0)
+				{
+					ADC_Sample_Source = PERIPHERAL_ADC_SAMPLE_SOURCE_PSEUDO_RANDOM;
+					String_ADC_Sample_Source_Parameter = optarg + 5;
+				}
+				else if (strncmp(optarg, "file:", 5) == 0)
+				{
+					ADC_Sample_Source = PERIPHERAL_ADC_SAMPLE_SOURCE_FILE;
+					String_ADC_Sample_Source_Parameter = optarg + 5;
+				}
+				else if (strncmp(optarg, "const:", 6) == 0)
+				{
+					ADC_Sample_Source = PERIPHERAL_ADC_SAMPLE_SOURCE_CONSTANT;
+					String_ADC_Sample_Source_Parameter = optarg + 6;
+				}
+				else
+				{
+					printf("Error : unknown ADC sample source '%s'.\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+				
+			// Snapshots
+			case 'b':
+				String_Snapshot_Parameters = optarg;
+				break;
+				
+			// Coverage file
+			case 'c':
+				String_Coverage_File = optarg;
+				break;
+				
+			// Data EEPROM file
+			case 'd':
+				String_Data_EEPROM_File = optarg;
+				break;
+				
+			// Core engine
+			case 'e':
+				if (strcmp(optarg, "interpreter") == 0) Core_Engine = CORE_ENGINE_INTERPRETER;
+				else if (strcmp(optarg, "predecoded") == 0) Core_Engine = CORE_ENGINE_PREDECODED;
+				else if (strcmp(optarg, "lockstep") == 0) Core_Engine = CORE_ENGINE_LOCKSTEP;
+				else
+				{
+					printf("Error : unknown core engine '%s'.\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+				
+			// Oscillator frequency
+			case 'f':
+				if (sscanf(optarg, "%u", &Main_Oscillator_Frequency) != 1)
+				{
+					printf("Error : the oscillator frequency must be an integer value.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+				
+			// GDB server
+			case 'g':
+				String_GDB_Server_Address = optarg;
+				break;
+				
+			// Keep the core state on reload
+			case 'k':
+				Main_Is_Core_State_Kept = 1;
+				break;
+				
+			// Shared EEPROM base image
+			case 'r':
+				Is_EEPROM_Base_Image_Shared = 1;
+				break;
+				
+			// Program symbols
+			case 's':
+				String_Listing_File = optarg;
+				break;
+				
+			// Time scale
+			case 't':
+				if (strcmp(optarg, "unlimited") == 0) Time_Scale = 0;
+				else if ((sscanf(optarg, "%lf", &Time_Scale) != 1) || (Time_Scale <= 0))
+				{
+					printf("Error : the time scale must be a positive number or 'unlimited'.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+				
+			// UART backend
+			case 'u':
+				if (strcmp(optarg, "console") == 0) UART_Backend_Type = UART_BACKEND_TYPE_CONSOLE;
+				else if (strcmp(optarg, "pty") == 0) UART_Backend_Type = UART_BACKEND_TYPE_PSEUDO_TERMINAL;
+				else if (strcmp(optarg, "null") == 0) UART_Backend_Type = UART_BACKEND_TYPE_NULL;
+				else if (strncmp(optarg, "socket:", 7) == 0)
+				{
+					UART_Backend_Type = UART_BACKEND_TYPE_UNIX_SOCKET;
+					String_UART_Backend_Path = optarg + 7;
+				}
+				else if (strncmp(optarg, "pipe:", 5) == 0)
+				{
+					UART_Backend_Type = UART_BACKEND_TYPE_PIPE;
+					String_UART_Backend_Path = optarg + 5;
+				}
+				else
+				{
+					printf("Error : unknown UART backend '%s'.\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+				
+			// Virtual terminal
+			case 'v':
+				if (sscanf(optarg, "%d", &Virtual_Terminal_Frames_Per_Second) != 1)
+				{
+					printf("Error : the virtual terminal frame rate must be an integer value.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+				
+			// Watchpoint
+			case 'w':
+				if (Watchpoints_Count >= MAIN_MAXIMUM_WATCHPOINTS_COUNT)
+				{
+					printf("Error : no more than %d watchpoints can be set.\n", MAIN_MAXIMUM_WATCHPOINTS_COUNT);
+					return EXIT_FAILURE;
+				}
+				String_Watchpoints[Watchpoints_Count] = optarg;
+				Watchpoints_Count++;
+				break;
+				
+			// Screen check
+			case 'x':
+				if (Screen_Checks_Count >= MAIN_MAXIMUM_SCREEN_CHECKS_COUNT)
+				{
+					printf("Error : no more than %d screen checks can be set.\n", MAIN_MAXIMUM_SCREEN_CHECKS_COUNT);
+					return EXIT_FAILURE;
+				}
+				Text_Offset = 0;
+				if ((sscanf(optarg, "%d:%n", &Screen_Check_Rows[Screen_Checks_Count], &Text_Offset) != 1) || (Text_Offset == 0) || (Screen_Check_Rows[Screen_Checks_Count] < 0) || (Screen_Check_Rows[Screen_Checks_Count] >= VIRTUAL_TERMINAL_ROWS_COUNT))
+				{
+					printf("Error : invalid screen check '%s', it must be Row:Text with Row from 0 to %d.\n", optarg, VIRTUAL_TERMINAL_ROWS_COUNT - 1);
+					return EXIT_FAILURE;
+				}
+				String_Screen_Check_Texts[Screen_Checks_Count] = optarg + Text_Offset;
+				Screen_Checks_Count++;
+				break;
+				
+			default:
+				optind = argc; // Force the usage to be displayed
+				break;
+		}
+	}
 	
 	// Check parameters
-	if (argc != 5)
+	if (argc - optind != 4)
 	{
-		printf("Usage : %s Log_File Log_Level Program_Hex_File EEPROM_File\n"
+		printf("Usage : %s [-a ADC_Sample_Source] [-b Snapshot_Interval[:Snapshots_Count]] [-c Coverage_File] [-d Data_EEPROM_File] [-e Core_Engine] [-f Oscillator_Frequency] [-g GDB_Server_Address] [-k] [-r] [-s Listing_File] [-t Time_Scale] [-u UART_Backend] [-v Frames_Per_Second] [-w Watchpoint]... [-x Row:Text]... Log_File Log_Level Program_Hex_File EEPROM_File\n"
 			"  Log_File : the file that will contain all logs.\n"
-			"  Log_Level : how much log to write to the log file (error = 0, warning = 1, debug = 2).\n"
+			"  Log_Level : how much log to write to the log file (error = 0, warning = 1, debug = 2, which also traces each executed instruction).\n"
 			"  Program_Hex_File : an Intel Hex file containing the program code.\n"
-			"  EEPROM_File : a 4096-byte file containing the EEPROM data.\n"
+			"  EEPROM_File : a 4096-byte file containing the EEPROM data, EEPROM writes are immediately stored to it.\n"
+			"  -a ADC_Sample_Source : where the converted analog values come from (default is a pseudo-random generator seeded with %d) :\n"
+			"     prng:Seed : a pseudo-random generator per channel, all seeded from Seed,\n"
+			"     file:Path : a text file containing one 10-bit value per line, played in loop,\n"
+			"     const:Value : always convert Value.\n"
+			"  -b Snapshot_Interval[:Snapshots_Count] : save the board state every Snapshot_Interval cycles and keep the Snapshots_Count last ones (default is %d), so GDB can execute the program backward (reverse-stepi and reverse-continue commands).\n"
+			"  -c Coverage_File : write the executed instructions and the conditional skips outcome to Coverage_File on exit, use Coverage_Report to view it.\n"
+			"  -d Data_EEPROM_File : a 256-byte file containing the microcontroller internal data EEPROM, created if needed (default is Program_Hex_File.eeprom).\n"
+			"  -e Core_Engine : how the instructions are executed (default is interpreter) :\n"
+			"     interpreter : decode each instruction when it is executed,\n"
+			"     predecoded : decode each program memory location once,\n"
+			"     lockstep : execute each instruction with both engines and compare their results, the first divergence is written to the log file and makes the simulator exit with a failure status.\n"
+			"  -f Oscillator_Frequency : the oscillator frequency in Hz (default is %d, up to %d). An instruction cycle lasts 4 oscillator periods, the timers, UART, ADC and memory write durations are all counted in instruction cycles.\n"
+			"  -g GDB_Server_Address : let GDB debug the program (use 'target remote' from GDB, the board is halted when GDB connects) :\n"
+			"     unix:Path : a Unix domain socket server created at Path,\n"
+			"     tcp:Port : a TCP server listening on the local host only.\n"
+			"  -k : when the program is reloaded, continue it from the current core, register file and peripherals state instead of restarting it from the reset vector.\n"
+			"  -r : use EEPROM_File and Data_EEPROM_File as read-only base images that several simulators can share, EEPROM writes are not stored.\n"
+			"  -s Listing_File : the assembler listing file of the program, its labels are used to display program addresses in traces and dumps.\n"
+			"  -t Time_Scale : how fast the simulated time goes compared to the real time (default is 1), for instance 0.25 runs four times slower and 10 runs ten times faster (up to %d) if the host is fast enough. Use 'unlimited' to run as fast as the host can. The program behaves the same whatever the time scale is.\n"
+			"  -u UART_Backend : where the UART is connected to (default is console) :\n"
+			"     console : the simulator terminal,\n"
+			"     pty : a newly created pseudo-terminal, use screen or minicom to attach to it,\n"
+			"     socket:Path : a Unix domain socket server created at Path,\n"
+			"     pipe:Reception_Path,Transmission_Path : two named pipes (created if needed),\n"
+			"     null : transmitted bytes are discarded, nothing is received.\n"
+			"  -v Frames_Per_Second : interpret the transmitted ANSI escape sequences with a %dx%d VT100 screen model and send only the screen changes to the UART backend, at most Frames_Per_Second times per second (up to %d). Use 0 to send nothing, the screen is then only written to the log file by Ctrl+D and on exit.\n"
+			"  -w Address[:r|w|rw][=Value] : write the program counter and the cycles count to the log file each time the program reads (r), writes (w, the default) or accesses (rw) the register at the 9-bit register file address Address (Bank * 0x80 + register address, INDF accesses are detected too), optionally only when Value is read or written. Can be used several times.\n"
+			"  -x Row:Text : when the simulator exits, check that the virtual terminal screen row Row (0 is the topmost one) displays Text, otherwise exit with a failure status. Requires -v. Can be used several times.\n"
 			"Use Ctrl+C to exit program.\n"
-			"Use Ctrl+D to write a dump of the register file to the log file.\n", argv[0]);
+			"Use Ctrl+D to write a dump of the core, of the register file and of the virtual terminal screen to the log file.\n"
+			"Use Ctrl+T to write the instrumentation statistics to the log file (the simulator must be built with 'make INSTRUMENTATION=1').\n"
+			"Use Ctrl+R (or send SIGHUP when the standard input is not a terminal) to reload Program_Hex_File and Listing_File without restarting the simulator, the EEPROMs content and the UART connection are kept.\n", argv[0], PERIPHERAL_ADC_DEFAULT_PSEUDO_RANDOM_SEED, SNAPSHOT_DEFAULT_COUNT, CORE_DEFAULT_OSCILLATOR_FREQUENCY, CORE_MAXIMUM_OSCILLATOR_FREQUENCY, CORE_MAXIMUM_TIME_SCALE, VIRTUAL_TERMINAL_COLUMNS_COUNT, VIRTUAL_TERMINAL_ROWS_COUNT, VIRTUAL_TERMINAL_MAXIMUM_FRAMES_PER_SECOND);
 		return EXIT_FAILURE;
 	}
 	
 	// Retrieve parameters
-	String_Log_File = argv[1];
+	String_Log_File = argv[optind];
 	// Retrieve log level
-	if (sscanf(argv[2], "%d", (int *) &Log_Level) != 1)
+	if (sscanf(argv[optind + 1], "%d", (int *) &Log_Level) != 1)
 	{
 		printf("Error : the log level must be an integer value between 0 and 2.\n");
 		return EXIT_FAILURE;
 	}
-	String_Program_Hex_File = argv[3];
-	String_EEPROM_File = argv[4];
+	String_Program_Hex_File = argv[optind + 2];
+	String_Main_Program_Hex_File = String_Program_Hex_File;
+	String_Main_Listing_File = String_Listing_File;
+	String_EEPROM_File = argv[optind + 3];
+	// The internal data EEPROM content belongs to the program by default
+	if (String_Data_EEPROM_File == NULL)
+	{
+		if (snprintf(String_Default_Data_EEPROM_File, sizeof(String_Default_Data_EEPROM_File), "%s.eeprom", String_Program_Hex_File) >= (int) sizeof(String_Default_Data_EEPROM_File))
+		{
+			printf("Error : the program hex file path is too long.\n");
+			return EXIT_FAILURE;
+		}
+		String_Data_EEPROM_File = String_Default_Data_EEPROM_File;
+	}
+	if ((Screen_Checks_Count > 0) && (Virtual_Terminal_Frames_Per_Second < 0))
+	{
+		printf("Error : the screen checks need the virtual terminal, use -v.\n");
+		return EXIT_FAILURE;
+	}
+	Main_Is_Console_Interactive = isatty(STDIN_FILENO);
 	
 	// Initialize subsystems
 	LogInitialize(String_Log_File, Log_Level);
 	RegisterFileInitialize();
-	PeripheralADCInitialize();
+	// The register file mirrors must be known to watch a register
+	for (i = 0; i < Watchpoints_Count; i++)
+	{
+		if (WatchpointSetFromString(String_Watchpoints[i]) != 0)
+		{
+			printf("Error : invalid watchpoint '%s'. See logs for more information.\n", String_Watchpoints[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (PeripheralADCInitialize(ADC_Sample_Source, String_ADC_Sample_Source_Parameter) != 0)
+	{
+		printf("Error : failed to initialize the ADC sample source. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
 	
 	// Load the program to execute
-	if (ProgramMemoryLoadHexFile(String_Program_Hex_File) != 0)
+	if (ProgramMemoryLoadHexFile(String_Program_Hex_File, 1) != 0)
 	{
 		printf("Error : failed to load the hex file. See logs for more information.\n");
 		return EXIT_FAILURE;
 	}
 	
+	// Give the program addresses a name
+	if ((String_Listing_File != NULL) && (DisassemblerLoadSymbols(String_Listing_File) != 0))
+	{
+		printf("Error : failed to load the listing file. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
+	if (Log_Level >= LOG_LEVEL_DEBUG) CoreSetTraceCallback(MainTraceInstruction);
+	CoreSetEngine(Core_Engine);
+	if ((CoreSetOscillatorFrequency(Main_Oscillator_Frequency) != 0) || (CoreSetTimeScale(Time_Scale) != 0))
+	{
+		printf("Error : invalid oscillator frequency or time scale. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
+	MainCheckConfigurationWord();
+	
 	// Load the EEPROM content
-	if (PeripheralI2CEEPROMInitialize(String_EEPROM_File) != 0)
+	if (PeripheralI2CEEPROMInitialize(String_EEPROM_File, Is_EEPROM_Base_Image_Shared) != 0)
 	{
 		printf("Error : failed to load the EEPROM file. See logs for more information.\n");
 		return EXIT_FAILURE;
 	}
+	if (PeripheralDataEEPROMInitialize(String_Data_EEPROM_File, Is_EEPROM_Base_Image_Shared) != 0)
+	{
+		printf("Error : failed to load the data EEPROM file. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
+	
+	// Record the board history
+	if ((String_Snapshot_Parameters != NULL) && (SnapshotInitialize(String_Snapshot_Parameters) != 0))
+	{
+		printf("Error : invalid snapshot parameters '%s'. See logs for more information.\n", String_Snapshot_Parameters);
+		return EXIT_FAILURE;
+	}
+	
+	// Keep the power-on board state to restart the reloaded programs from
+	CoreGetState(&Main_Reset_State.Core_State);
+	RegisterFileSaveSnapshot(Main_Reset_State.Register_File);
+	PeripheralTimerSaveSnapshot(&Main_Reset_State.Timer);
+	PeripheralADCSaveSnapshot(&Main_Reset_State.ADC);
+	PeripheralMemoryAccessSaveSnapshot(&Main_Reset_State.Memory_Access);
+	PeripheralUARTSaveSnapshot(&Main_Reset_State.UART);
+	
+	// When the simulator is run from a script, let only the user interface thread receive the termination and reload signals (all threads inherit this mask), so they can be waited for
+	sigemptyset(&Signals_Set);
+	sigaddset(&Signals_Set, SIGINT);
+	sigaddset(&Signals_Set, SIGTERM);
+	if (!Main_Is_Console_Interactive) sigaddset(&Signals_Set, SIGHUP); // A terminal hangup must still terminate an interactive simulator
+	if (!Main_Is_Console_Interactive) pthread_sigmask(SIG_BLOCK, &Signals_Set, NULL);
+	
+	// Connect the UART to the host
+	if (UARTBackendInitialize(UART_Backend_Type, String_UART_Backend_Path) != 0)
+	{
+		printf("Error : failed to start the UART backend. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
+	
+	// Send only the screen changes to the UART backend
+	if ((Virtual_Terminal_Frames_Per_Second >= 0) && (VirtualTerminalInitialize(Virtual_Terminal_Frames_Per_Second) != 0))
+	{
+		printf("Error : failed to start the virtual terminal. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
+
+	// Wait for GDB in the background
+	if ((String_GDB_Server_Address != NULL) && (GDBServerInitialize(String_GDB_Server_Address) != 0))
+	{
+		printf("Error : failed to start the GDB server. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
 
 	// Create a thread that will execute the PIC program
 	if (pthread_create(&Thread_ID, NULL, MainThreadExecuteProgram, NULL) != 0)
@@ -133,29 +583,90 @@ int main(int argc, char *argv[])
 	while (1)
 	{
 		Character_Code = getchar();
+		if (Character_Code == EOF)
+		{
+			// Nothing can be typed anymore (the simulator is run from a script), wait for a termination signal and reload the program on SIGHUP
+			while ((sigwait(&Signals_Set, &Character_Code) == 0) && (Character_Code == SIGHUP)) Main_Is_Program_Reload_Requested = 1;
+			break;
+		}
 		if (Character_Code == MAIN_CONTROL_KEY_COMBINATION('c')) break; // Ctrl+c
-		else if (Character_Code == MAIN_CONTROL_KEY_COMBINATION('d')) RegisterFileDump(); // Ctrl+d, stands for "dump"
+		else if (Character_Code == MAIN_CONTROL_KEY_COMBINATION('d')) // Ctrl+d, stands for "dump"
+		{
+			CoreDump();
+			RegisterFileDump();
+			if (VirtualTerminalIsEnabled()) VirtualTerminalDump();
+		}
+		else if (Character_Code == MAIN_CONTROL_KEY_COMBINATION('t')) InstrumentationDump(); // Ctrl+t, stands for "time"
+		else if (Character_Code == MAIN_CONTROL_KEY_COMBINATION('r')) Main_Is_Program_Reload_Requested = 1; // Ctrl+r, stands for "reload"
 
-		// Send the character to the UART
-		PeripheralUARTReceiveByte((unsigned char) Character_Code);
+		// Send the character to the UART (only the console backend takes it into account)
+		UARTBackendInjectByte((unsigned char) Character_Code);
 	}
 	MainUninitializeConsole(); // TODO this function and below code are not reached when the simulator must do an emergency exit
 	
 	// Wait for the thread to terminate
 	Main_Is_Simulator_Exiting = 1;
+	if (String_GDB_Server_Address != NULL) GDBServerUninitialize(); // The CPU thread can't exit while the debugger halts it
 	if (pthread_join(Thread_ID, NULL) != 0)
 	{
 		printf("Error : failed to join the CPU thread (%s).\n", strerror(errno));
 		return EXIT_FAILURE;
 	}
 	
-	// Store the EEPROM content to the EEPROM file
-	if (PeripheralI2CEEPROMStoreMemoryToFile(String_EEPROM_File))
+	// Send the last screen changes and keep the final screen content for scripts
+	if (VirtualTerminalIsEnabled())
+	{
+		VirtualTerminalUninitialize();
+		VirtualTerminalDump();
+	}
+	
+	// Send the last transmitted bytes
+	UARTBackendUninitialize();
+	
+	// Tell where the time went during the whole simulation
+	InstrumentationDump();
+	
+	// Make sure the EEPROM content is stored to the EEPROM file
+	if (PeripheralI2CEEPROMUninitialize() != 0)
 	{
 		printf("Error : failed to save the EEPROM memory content to the EEPROM file. See logs for more information.\n");
 		return EXIT_FAILURE;
 	}
+	if (PeripheralDataEEPROMUninitialize() != 0)
+	{
+		printf("Error : failed to save the data EEPROM memory content to the data EEPROM file. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
 
+	// Tell which parts of the program have been exercised
+	if ((String_Coverage_File != NULL) && (CoverageStoreFile(String_Coverage_File, &Coverage_Map, ProgramMemoryGetHexFileHash()) != 0))
+	{
+		printf("Error : failed to write the coverage file. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
+	
+	// Make scripts notice that the program did not display what was expected
+	for (i = 0; i < Screen_Checks_Count; i++)
+	{
+		if (VirtualTerminalFindText(Screen_Check_Rows[i], String_Screen_Check_Texts[i]) < 0)
+		{
+			LOG(LOG_LEVEL_ERROR, "Error : the virtual terminal screen row %d does not display '%s'.\n", Screen_Check_Rows[i], String_Screen_Check_Texts[i]);
+			Is_Screen_Check_Failed = 1;
+		}
+	}
+	if (Is_Screen_Check_Failed)
+	{
+		printf("Error : the virtual terminal screen does not display the expected text. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
+	
+	// Make scripts notice that the engines did not agree
+	if (CoreIsDivergenceFound())
+	{
+		printf("Error : the core engines diverged. See logs for more information.\n");
+		return EXIT_FAILURE;
+	}
+	
 	LOG(LOG_LEVEL_ERROR, "Program successfully exited.\n");
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,165 @@
+/** @file Memory_File.c
+ * @see Memory_File.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <Log.h>
+#include <Memory_File.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Fill the memory bytes that are not present in the file with the erased value.
+ * @param Pointer_Memory_File The memory.
+ * @param File_Size How many bytes were loaded from the file.
+ * @param Erased_Value The erased byte value.
+ */
+static void MemoryFileErase(TMemoryFile *Pointer_Memory_File, unsigned int File_Size, unsigned char Erased_Value)
+{
+	unsigned int Address;
+	
+	// Extended file bytes are zero, so there is nothing to store if they are already erased
+	if ((File_Size >= Pointer_Memory_File->Size) || (Erased_Value == 0)) return;
+	
+	for (Address = File_Size; Address < Pointer_Memory_File->Size; Address++) MemoryFileWriteByte(Pointer_Memory_File, Address, Erased_Value);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int MemoryFileMap(TMemoryFile *Pointer_Memory_File, char *String_File, unsigned int Size, unsigned char Erased_Value, int Is_Missing_File_Created, int Is_Base_Image_Shared)
+{
+	int File_Descriptor, Return_Value = 1;
+	struct stat File_Status;
+	ssize_t Result;
+	
+	Pointer_Memory_File->Pointer_Memory = NULL;
+	Pointer_Memory_File->Size = Size;
+	Pointer_Memory_File->Is_Persistent = !Is_Base_Image_Shared;
+	Pointer_Memory_File->Dirty_Pages_Mask = 0;
+	Pointer_Memory_File->Host_Page_Size = sysconf(_SC_PAGESIZE);
+	if (Pointer_Memory_File->Host_Page_Size < MEMORY_FILE_MINIMUM_HOST_PAGE_SIZE) Pointer_Memory_File->Host_Page_Size = MEMORY_FILE_MINIMUM_HOST_PAGE_SIZE; // mmap() only needs the offsets to be aligned on a real page boundary, so a bigger value is safe
+	if (Size > MEMORY_FILE_MAXIMUM_SIZE)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : the memory backed by '%s' is too big (%u bytes).\n", String_File, Size);
+		return 1;
+	}
+	
+	// Try to open the file
+	if (Is_Base_Image_Shared) File_Descriptor = open(String_File, O_RDONLY);
+	else File_Descriptor = open(String_File, Is_Missing_File_Created ? O_RDWR | O_CREAT : O_RDWR, 0644);
+	if (File_Descriptor == -1)
+	{
+		// A missing base image is a blank memory if allowed
+		if (!Is_Base_Image_Shared || !Is_Missing_File_Created || (errno != ENOENT))
+		{
+			LOG(LOG_LEVEL_ERROR, "Error : could not open the memory file '%s' (%s).\n", String_File, strerror(errno));
+			goto Exit;
+		}
+		File_Status.st_size = 0;
+	}
+	else if (fstat(File_Descriptor, &File_Status) != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to retrieve the memory file '%s' size (%s).\n", String_File, strerror(errno));
+		goto Exit;
+	}
+	
+	if (Is_Base_Image_Shared)
+	{
+		if (File_Status.st_size >= Size)
+		{
+			// All simulators share the base image pages until they write to them, written pages become private
+			Pointer_Memory_File->Pointer_Memory = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE, File_Descriptor, 0);
+		}
+		else
+		{
+			// Accessing a file mapping beyond the file end is not allowed, so copy the too short image to private memory
+			Pointer_Memory_File->Pointer_Memory = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if ((Pointer_Memory_File->Pointer_Memory != MAP_FAILED) && (File_Status.st_size > 0))
+			{
+				Result = pread(File_Descriptor, Pointer_Memory_File->Pointer_Memory, File_Status.st_size, 0);
+				if (Result != File_Status.st_size)
+				{
+					LOG(LOG_LEVEL_ERROR, "Error : failed to read from the memory file '%s' (%s).\n", String_File, strerror(errno));
+					goto Exit;
+				}
+			}
+		}
+	}
+	else
+	{
+		// Make sure the whole memory is backed by the file
+		if ((File_Status.st_size < Size) && (ftruncate(File_Descriptor, Size) != 0))
+		{
+			LOG(LOG_LEVEL_ERROR, "Error : failed to extend the memory file '%s' to %u bytes (%s).\n", String_File, Size, strerror(errno));
+			goto Exit;
+		}
+		
+		// Every write to the memory directly goes to the file
+		Pointer_Memory_File->Pointer_Memory = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_SHARED, File_Descriptor, 0);
+	}
+	if (Pointer_Memory_File->Pointer_Memory == MAP_FAILED)
+	{
+		Pointer_Memory_File->Pointer_Memory = NULL;
+		LOG(LOG_LEVEL_ERROR, "Error : failed to map the memory file '%s' to memory (%s).\n", String_File, strerror(errno));
+		goto Exit;
+	}
+	MemoryFileErase(Pointer_Memory_File, File_Status.st_size, Erased_Value);
+	
+	LOG(LOG_LEVEL_DEBUG, "Memory file '%s' successfully mapped (%s mode).\n", String_File, Is_Base_Image_Shared ? "shared base image" : "persistent");
+	Return_Value = 0;
+	
+Exit:
+	if (File_Descriptor != -1) close(File_Descriptor); // The mapping stays valid after the file is closed
+	return Return_Value;
+}
+
+int MemoryFileSynchronize(TMemoryFile *Pointer_Memory_File, int Flags)
+{
+	unsigned int Page, Pages_Count;
+	int Return_Value = 0;
+	long Offset, Length;
+	
+	if (!Pointer_Memory_File->Is_Persistent || (Pointer_Memory_File->Dirty_Pages_Mask == 0)) return 0;
+	
+	// Synchronize only the touched pages
+	Pages_Count = (Pointer_Memory_File->Size + Pointer_Memory_File->Host_Page_Size - 1) / Pointer_Memory_File->Host_Page_Size;
+	for (Page = 0; Page < Pages_Count; Page++)
+	{
+		if (!(Pointer_Memory_File->Dirty_Pages_Mask & (1u << Page))) continue;
+		
+		// Do not go beyond the mapping end if the host page is bigger than the memory
+		Offset = Page * Pointer_Memory_File->Host_Page_Size;
+		Length = Pointer_Memory_File->Size - Offset;
+		if (Length > Pointer_Memory_File->Host_Page_Size) Length = Pointer_Memory_File->Host_Page_Size;
+		
+		if (msync(Pointer_Memory_File->Pointer_Memory + Offset, Length, Flags) != 0)
+		{
+			LOG(LOG_LEVEL_ERROR, "Error : failed to synchronize the memory page %u with the memory file (%s).\n", Page, strerror(errno));
+			Return_Value = 1;
+			continue;
+		}
+		Pointer_Memory_File->Dirty_Pages_Mask &= ~(1u << Page);
+	}
+	
+	return Return_Value;
+}
+
+int MemoryFileUnmap(TMemoryFile *Pointer_Memory_File)
+{
+	int Return_Value;
+	
+	if (Pointer_Memory_File->Pointer_Memory == NULL) return 0;
+	
+	// Wait for all modifications to be stored
+	Return_Value = MemoryFileSynchronize(Pointer_Memory_File, MS_SYNC);
+	
+	munmap(Pointer_Memory_File->Pointer_Memory, Pointer_Memory_File->Size);
+	Pointer_Memory_File->Pointer_Memory = NULL;
+	return Return_Value;
+}
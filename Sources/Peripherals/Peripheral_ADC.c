@@ -2,40 +2,287 @@
  * @see Peripheral_ADC.h for description.
  * @author Adrien RICCIARDI.
  */
+#include <Core.h>
+#include <errno.h>
+#include <Instrumentation.h>
 #include <Log.h>
 #include <Peripheral_ADC.h>
 #include <Register_File.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** The greatest converted value. */
+#define PERIPHERAL_ADC_MAXIMUM_VALUE 0x03FF
+
+/** How many TAD a 10-bit conversion lasts. */
+#define PERIPHERAL_ADC_CONVERSION_TAD_COUNT 12
+/** The internal RC oscillator typical TAD period (in microseconds). */
+#define PERIPHERAL_ADC_RC_OSCILLATOR_TAD_PERIOD 4
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The selected sample source. */
+static TPeripheralADCSampleSource Peripheral_ADC_Sample_Source = PERIPHERAL_ADC_SAMPLE_SOURCE_PSEUDO_RANDOM;
+
+/** Each channel pseudo-random generator state. */
+static unsigned long long Peripheral_ADC_Pseudo_Random_States[PERIPHERAL_ADC_CHANNELS_COUNT];
+/** The samples file. */
+static FILE *Pointer_Peripheral_ADC_Samples_File = NULL;
+/** The constant sample value. */
+static int Peripheral_ADC_Constant_Sample = 0;
+
+/** Tell whether a conversion is in progress. */
+static int Peripheral_ADC_Is_Conversion_In_Progress = 0;
+/** The instruction cycle at which the current conversion will be terminated. */
+static unsigned long long Peripheral_ADC_Conversion_End_Cycle;
+/** The value sampled when the conversion started. */
+static int Peripheral_ADC_Sampled_Value;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Get the next value of a SplitMix64 sequence, which is used to derive the channels generators state from a single seed.
+ * @param Pointer_State The sequence state.
+ * @return The next sequence value.
+ */
+static unsigned long long PeripheralADCSplitMix64(unsigned long long *Pointer_State)
+{
+	unsigned long long Value;
+	
+	*Pointer_State += 0x9E3779B97F4A7C15ULL;
+	Value = *Pointer_State;
+	Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBULL;
+	return Value ^ (Value >> 31);
+}
+
+/** Get a channel next pseudo-random value using a xorshift64* generator.
+ * @param Channel The channel number.
+ * @return A 10-bit value.
+ */
+static inline int PeripheralADCGetPseudoRandomSample(int Channel)
+{
+	unsigned long long State;
+	
+	State = Peripheral_ADC_Pseudo_Random_States[Channel];
+	State ^= State >> 12;
+	State ^= State << 25;
+	State ^= State >> 27;
+	Peripheral_ADC_Pseudo_Random_States[Channel] = State;
+	
+	return (int) ((State * 0x2545F4914F6CDD1DULL) >> 54); // Keep the 10 most significant bits, which are the best ones
+}
+
+/** Read the next value from the samples file.
+ * @return A 10-bit value.
+ */
+static int PeripheralADCGetFileSample(void)
+{
+	int Sample, Is_File_Rewound = 0;
+	
+	while (fscanf(Pointer_Peripheral_ADC_Samples_File, "%i", &Sample) != 1)
+	{
+		// Play the samples again from the beginning, but do not loop forever if the file contains no valid sample
+		if (feof(Pointer_Peripheral_ADC_Samples_File) && !Is_File_Rewound)
+		{
+			rewind(Pointer_Peripheral_ADC_Samples_File);
+			Is_File_Rewound = 1;
+			continue;
+		}
+		LOG(LOG_LEVEL_WARNING, "WARNING : no valid sample could be read from the samples file, converting 0.\n");
+		return 0;
+	}
+	
+	if ((Sample < 0) || (Sample > PERIPHERAL_ADC_MAXIMUM_VALUE)) LOG(LOG_LEVEL_WARNING, "WARNING : the sample %d read from the samples file is out of the 10-bit range, it will be truncated.\n", Sample);
+	return Sample & PERIPHERAL_ADC_MAXIMUM_VALUE;
+}
+
+/** Compute how long a conversion lasts.
+ * @param ADCON0_Register The ADCON0 value selecting the conversion clock.
+ * @return The conversion duration in instruction cycles.
+ */
+static unsigned int PeripheralADCGetConversionCycles(unsigned char ADCON0_Register)
+{
+	switch ((ADCON0_Register & REGISTER_FILE_REGISTER_BIT_ADCON0_ADCS_MASK) >> REGISTER_FILE_REGISTER_BIT_ADCON0_ADCS_SHIFT)
+	{
+		// TAD = 2 TOSC, an instruction cycle lasts 4 TOSC
+		case 0:
+			return (PERIPHERAL_ADC_CONVERSION_TAD_COUNT * 2) / 4;
+			
+		// TAD = 8 TOSC
+		case 1:
+			return (PERIPHERAL_ADC_CONVERSION_TAD_COUNT * 8) / 4;
+			
+		// TAD = 32 TOSC
+		case 2:
+			return (PERIPHERAL_ADC_CONVERSION_TAD_COUNT * 32) / 4;
+			
+		// Internal RC oscillator
+		default:
+			return CoreConvertMicrosecondsToCycles(PERIPHERAL_ADC_CONVERSION_TAD_COUNT * PERIPHERAL_ADC_RC_OSCILLATOR_TAD_PERIOD);
+	}
+}
 
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
-void PeripheralADCInitialize(void)
+int PeripheralADCInitialize(TPeripheralADCSampleSource Sample_Source, char *String_Parameter)
 {
-	srand(time(NULL));
+	unsigned long long Seed;
+	char *Pointer_String_End;
+	int i;
+	
+	Peripheral_ADC_Sample_Source = Sample_Source;
+	
+	switch (Sample_Source)
+	{
+		case PERIPHERAL_ADC_SAMPLE_SOURCE_PSEUDO_RANDOM:
+			if (String_Parameter == NULL) Seed = PERIPHERAL_ADC_DEFAULT_PSEUDO_RANDOM_SEED;
+			else
+			{
+				Seed = strtoull(String_Parameter, &Pointer_String_End, 0);
+				if ((*String_Parameter == 0) || (*Pointer_String_End != 0))
+				{
+					LOG(LOG_LEVEL_ERROR, "ERROR : bad ADC pseudo-random generator seed '%s'.\n", String_Parameter);
+					return 1;
+				}
+			}
+			// Log the seed so a run can be reproduced
+			LOG(LOG_LEVEL_ERROR, "ADC pseudo-random generator seed : %llu.\n", Seed);
+			
+			// Give each channel an independent sequence (a xorshift state must not be zero, which SplitMix64 output nearly never is)
+			for (i = 0; i < PERIPHERAL_ADC_CHANNELS_COUNT; i++)
+			{
+				Peripheral_ADC_Pseudo_Random_States[i] = PeripheralADCSplitMix64(&Seed);
+				if (Peripheral_ADC_Pseudo_Random_States[i] == 0) Peripheral_ADC_Pseudo_Random_States[i] = 1;
+			}
+			break;
+			
+		case PERIPHERAL_ADC_SAMPLE_SOURCE_FILE:
+			Pointer_Peripheral_ADC_Samples_File = fopen(String_Parameter, "r");
+			if (Pointer_Peripheral_ADC_Samples_File == NULL)
+			{
+				LOG(LOG_LEVEL_ERROR, "ERROR : failed to open the ADC samples file '%s' (%s).\n", String_Parameter, strerror(errno));
+				return 1;
+			}
+			break;
+			
+		case PERIPHERAL_ADC_SAMPLE_SOURCE_CONSTANT:
+			Peripheral_ADC_Constant_Sample = (int) strtol(String_Parameter, &Pointer_String_End, 0);
+			if ((*String_Parameter == 0) || (*Pointer_String_End != 0) || (Peripheral_ADC_Constant_Sample < 0) || (Peripheral_ADC_Constant_Sample > PERIPHERAL_ADC_MAXIMUM_VALUE))
+			{
+				LOG(LOG_LEVEL_ERROR, "ERROR : bad ADC constant sample '%s', it must be in range [0; %d].\n", String_Parameter, PERIPHERAL_ADC_MAXIMUM_VALUE);
+				return 1;
+			}
+			break;
+			
+		default:
+			LOG(LOG_LEVEL_ERROR, "ERROR : unknown ADC sample source (%d).\n", Sample_Source);
+			return 1;
+	}
+	
+	return 0;
 }
 
 void PeripheralADCWriteADCON0(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data)
 {
-	int Sampled_Value;
+	int Channel;
+	
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_ADC);
 	
 	// Start a conversion if ADC module is enabled and if the GO bit is set
 	if ((Data & REGISTER_FILE_REGISTER_BIT_ADCON0_ADON) && (Data & REGISTER_FILE_REGISTER_BIT_ADCON0_GO))
 	{
-		// Sample data
-		Sampled_Value = rand() % 1024; // The ADC sample is stored on 10 bits
-		LOG(LOG_LEVEL_DEBUG, "ADC sampled value : %d.\n", Sampled_Value & 0x03FF);
-			
-		// Fill result registers
-		// TODO take justification into account if needed
-		RegisterFileDirectWriteFromCallback(REGISTER_FILE_REGISTER_BANK_ADRESH, REGISTER_FILE_REGISTER_ADDRESS_ADRESH, (Sampled_Value >> 8) & 0x03);
-		RegisterFileDirectWriteFromCallback(REGISTER_FILE_REGISTER_BANK_ADRESL, REGISTER_FILE_REGISTER_ADDRESS_ADRESL, (unsigned char) Sampled_Value);
-		
-		// Clear GO bit to tell that the conversion is terminated
+		// Writing GO again during a conversion has no effect
+		if (!Peripheral_ADC_Is_Conversion_In_Progress)
+		{
+			// Sample data
+			Channel = (Data & REGISTER_FILE_REGISTER_BIT_ADCON0_CHS_MASK) >> REGISTER_FILE_REGISTER_BIT_ADCON0_CHS_SHIFT;
+			switch (Peripheral_ADC_Sample_Source)
+			{
+				case PERIPHERAL_ADC_SAMPLE_SOURCE_FILE:
+					Peripheral_ADC_Sampled_Value = PeripheralADCGetFileSample();
+					break;
+				case PERIPHERAL_ADC_SAMPLE_SOURCE_CONSTANT:
+					Peripheral_ADC_Sampled_Value = Peripheral_ADC_Constant_Sample;
+					break;
+				default:
+					Peripheral_ADC_Sampled_Value = PeripheralADCGetPseudoRandomSample(Channel);
+					break;
+			}
+			
+			// The GO bit stays set until the conversion is terminated
+			Peripheral_ADC_Conversion_End_Cycle = CoreGetCyclesCount() + PeripheralADCGetConversionCycles(Data);
+			Peripheral_ADC_Is_Conversion_In_Progress = 1;
+			LOG(LOG_LEVEL_DEBUG, "ADC started conversion on channel %d, sampled value : %d.\n", Channel, Peripheral_ADC_Sampled_Value);
+		}
+	}
+	else if (Peripheral_ADC_Is_Conversion_In_Progress)
+	{
+		// Clearing GO or ADON aborts the conversion without updating the result registers
+		Peripheral_ADC_Is_Conversion_In_Progress = 0;
 		Data &= ~REGISTER_FILE_REGISTER_BIT_ADCON0_GO;
+		LOG(LOG_LEVEL_DEBUG, "ADC conversion aborted.\n");
 	}
 	
 	Pointer_Content->Data = Data;
-}
\ No newline at end of file
+	INSTRUMENTATION_LEAVE();
+}
+
+void PeripheralADCUpdate(void)
+{
+	unsigned char ADCON0_Register, PIR1_Register;
+	
+	// Nothing to do most of the time
+	if (!Peripheral_ADC_Is_Conversion_In_Progress || (CoreGetCyclesCount() < Peripheral_ADC_Conversion_End_Cycle)) return;
+	Peripheral_ADC_Is_Conversion_In_Progress = 0;
+	
+	// Fill result registers according to the selected justification
+	if (RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_ADCON1, REGISTER_FILE_REGISTER_ADDRESS_ADCON1) & REGISTER_FILE_REGISTER_BIT_ADCON1_ADFM)
+	{
+		// Right justified, the 6 most significant bits of ADRESH are read as '0'
+		RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_ADRESH, REGISTER_FILE_REGISTER_ADDRESS_ADRESH, (Peripheral_ADC_Sampled_Value >> 8) & 0x03);
+		RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_ADRESL, REGISTER_FILE_REGISTER_ADDRESS_ADRESL, (unsigned char) Peripheral_ADC_Sampled_Value);
+	}
+	else
+	{
+		// Left justified, the 6 least significant bits of ADRESL are read as '0'
+		RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_ADRESH, REGISTER_FILE_REGISTER_ADDRESS_ADRESH, (unsigned char) (Peripheral_ADC_Sampled_Value >> 2));
+		RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_ADRESL, REGISTER_FILE_REGISTER_ADDRESS_ADRESL, (unsigned char) (Peripheral_ADC_Sampled_Value << 6));
+	}
+	
+	// Clear GO bit to tell that the conversion is terminated (the conversion is not in progress anymore, so the ADCON0 callback will not abort anything)
+	ADCON0_Register = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_ADCON0, REGISTER_FILE_REGISTER_ADDRESS_ADCON0);
+	ADCON0_Register &= ~REGISTER_FILE_REGISTER_BIT_ADCON0_GO;
+	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_ADCON0, REGISTER_FILE_REGISTER_ADDRESS_ADCON0, ADCON0_Register);
+	
+	// Set ADIF flag
+	PIR1_Register = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1);
+	PIR1_Register |= REGISTER_FILE_REGISTER_BIT_PIR1_ADIF;
+	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1, PIR1_Register);
+	LOG(LOG_LEVEL_DEBUG, "ADC conversion terminated.\n");
+}
+
+void PeripheralADCSaveSnapshot(TPeripheralADCSnapshot *Pointer_Snapshot)
+{
+	memcpy(Pointer_Snapshot->Pseudo_Random_States, Peripheral_ADC_Pseudo_Random_States, sizeof(Peripheral_ADC_Pseudo_Random_States));
+	if (Pointer_Peripheral_ADC_Samples_File != NULL) Pointer_Snapshot->Samples_File_Offset = ftell(Pointer_Peripheral_ADC_Samples_File);
+	else Pointer_Snapshot->Samples_File_Offset = 0;
+	Pointer_Snapshot->Is_Conversion_In_Progress = Peripheral_ADC_Is_Conversion_In_Progress;
+	Pointer_Snapshot->Conversion_End_Cycle = Peripheral_ADC_Conversion_End_Cycle;
+	Pointer_Snapshot->Sampled_Value = Peripheral_ADC_Sampled_Value;
+}
+
+void PeripheralADCRestoreSnapshot(const TPeripheralADCSnapshot *Pointer_Snapshot)
+{
+	memcpy(Peripheral_ADC_Pseudo_Random_States, Pointer_Snapshot->Pseudo_Random_States, sizeof(Peripheral_ADC_Pseudo_Random_States));
+	if ((Pointer_Peripheral_ADC_Samples_File != NULL) && (fseek(Pointer_Peripheral_ADC_Samples_File, Pointer_Snapshot->Samples_File_Offset, SEEK_SET) != 0)) LOG(LOG_LEVEL_WARNING, "WARNING : failed to move back in the ADC samples file (%s).\n", strerror(errno));
+	Peripheral_ADC_Is_Conversion_In_Progress = Pointer_Snapshot->Is_Conversion_In_Progress;
+	Peripheral_ADC_Conversion_End_Cycle = Pointer_Snapshot->Conversion_End_Cycle;
+	Peripheral_ADC_Sampled_Value = Pointer_Snapshot->Sampled_Value;
+}
@@ -0,0 +1,66 @@
+/** @file Peripheral_Data_EEPROM.c
+ * @see Peripheral_Data_EEPROM.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Log.h>
+#include <Memory_File.h>
+#include <Peripheral_Data_EEPROM.h>
+#include <string.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** The value of a never programmed byte. */
+#define PERIPHERAL_DATA_EEPROM_ERASED_VALUE 0xFF
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The data EEPROM content, mapped from the data EEPROM file. */
+static TMemoryFile Peripheral_Data_EEPROM_Memory;
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int PeripheralDataEEPROMInitialize(char *String_Data_EEPROM_File, int Is_Base_Image_Shared)
+{
+	return MemoryFileMap(&Peripheral_Data_EEPROM_Memory, String_Data_EEPROM_File, PERIPHERAL_DATA_EEPROM_SIZE, PERIPHERAL_DATA_EEPROM_ERASED_VALUE, 1, Is_Base_Image_Shared);
+}
+
+int PeripheralDataEEPROMUninitialize(void)
+{
+	return MemoryFileUnmap(&Peripheral_Data_EEPROM_Memory);
+}
+
+unsigned char PeripheralDataEEPROMRead(unsigned char Address)
+{
+	return Peripheral_Data_EEPROM_Memory.Pointer_Memory[Address];
+}
+
+void PeripheralDataEEPROMWrite(unsigned char Address, unsigned char Data)
+{
+	MemoryFileWriteByte(&Peripheral_Data_EEPROM_Memory, Address, Data);
+	LOG(LOG_LEVEL_DEBUG, "Data EEPROM programmed byte 0x%02X at address 0x%02X.\n", Data, Address);
+	
+	// Start writing the modified page back to the data EEPROM file
+	MemoryFileSynchronize(&Peripheral_Data_EEPROM_Memory, MS_ASYNC);
+}
+
+void PeripheralDataEEPROMSaveSnapshot(TPeripheralDataEEPROMSnapshot *Pointer_Snapshot)
+{
+	memcpy(Pointer_Snapshot->Memory, Peripheral_Data_EEPROM_Memory.Pointer_Memory, PERIPHERAL_DATA_EEPROM_SIZE);
+}
+
+void PeripheralDataEEPROMRestoreSnapshot(const TPeripheralDataEEPROMSnapshot *Pointer_Snapshot)
+{
+	int Address, Is_Memory_Modified = 0;
+	
+	// Write only the modified bytes, so the data EEPROM file pages that did not change are not written again
+	for (Address = 0; Address < PERIPHERAL_DATA_EEPROM_SIZE; Address++)
+	{
+		if (Peripheral_Data_EEPROM_Memory.Pointer_Memory[Address] == Pointer_Snapshot->Memory[Address]) continue;
+		MemoryFileWriteByte(&Peripheral_Data_EEPROM_Memory, Address, Pointer_Snapshot->Memory[Address]);
+		Is_Memory_Modified = 1;
+	}
+	if (Is_Memory_Modified) MemoryFileSynchronize(&Peripheral_Data_EEPROM_Memory, MS_ASYNC);
+}
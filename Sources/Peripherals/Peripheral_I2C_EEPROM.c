@@ -2,8 +2,10 @@
  * @see Peripheral_I2C_EEPROM.h for description.
  * @author Adrien RICCIARDI
  */
-#include <errno.h>
+#include <Core.h>
+#include <Instrumentation.h>
 #include <Log.h>
+#include <Memory_File.h>
 #include <Peripheral_I2C_EEPROM.h>
 #include <Register_File.h>
 #include <stdio.h>
@@ -18,11 +20,15 @@
 /** The EEPROM bus address for a read operation. */
 #define PERIPHERAL_I2C_EEPROM_READ_ADDRESS 0xA1
 
-/** The EEPROM memory size in bytes. */
-#define PERIPHERAL_I2C_EEPROM_MEMORY_SIZE 4096
 /** The EEPROM internal address register used bits. */
 #define PERIPHERAL_I2C_EEPROM_ADDRESS_REGISTER_MASK 0x0FFF
 
+/** The address bits selecting a byte into a page. */
+#define PERIPHERAL_I2C_EEPROM_PAGE_OFFSET_MASK (PERIPHERAL_I2C_EEPROM_PAGE_SIZE - 1)
+
+/** The maximum time needed to program a page after the Stop condition (in microseconds). The EEPROM does not acknowledge its address during this time. */
+#define PERIPHERAL_I2C_EEPROM_WRITE_CYCLE_TIME 5000
+
 //-------------------------------------------------------------------------------------------------
 // Private types
 //-------------------------------------------------------------------------------------------------
@@ -32,139 +38,203 @@ typedef enum
 	PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DEVICE_ADDRESS,
 	PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DATA_HIGH_BYTE_ADDRESS,
 	PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DATA_LOW_BYTE_ADDRESS,
-	PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DATA_BYTE
+	PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DATA_BYTE,
+	PERIPHERAL_I2C_EEPROM_STATE_TRANSMIT_DATA_BYTE,
+	PERIPHERAL_I2C_EEPROM_STATE_NOT_SELECTED //! The EEPROM ignores the bus until the next Start condition.
 } TPeripheralI2CEEPROMState;
 
 //-------------------------------------------------------------------------------------------------
 // Private variables
 //-------------------------------------------------------------------------------------------------
-/** The EEPROM content. */
-static unsigned char Peripheral_I2C_EEPROM_Memory[PERIPHERAL_I2C_EEPROM_MEMORY_SIZE];
+/** The EEPROM content, mapped from the EEPROM file. */
+static TMemoryFile Peripheral_I2C_EEPROM_Memory;
 /** The EEPROM address register. */
 static unsigned short Peripheral_I2C_EEPROM_Address_Register = 0;
 
 /** The EEPROM internal state machine current state. */
 static TPeripheralI2CEEPROMState Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DEVICE_ADDRESS;
 
+/** The bytes received during a write operation, programmed to the memory on the Stop condition. */
+static unsigned char Peripheral_I2C_EEPROM_Page_Buffer[PERIPHERAL_I2C_EEPROM_PAGE_SIZE];
+/** Tell which page buffer bytes have been received (bit n is set when byte n has been received). */
+static unsigned int Peripheral_I2C_EEPROM_Page_Buffer_Loaded_Bytes_Mask = 0;
+
+/** The instruction cycle at which the current write cycle will be terminated. */
+static unsigned long long Peripheral_I2C_EEPROM_Write_Cycle_End_Cycle = 0;
+
+/** The SSPBUF value, which is either the last byte sent by the master or the last byte received from the EEPROM. */
+static unsigned char Peripheral_I2C_EEPROM_SSPBUF_Value = 0;
+/** Tell whether the last byte sent by the master was not acknowledged (this is the SSPCON2 ACKSTAT bit value). */
+static int Peripheral_I2C_EEPROM_Is_Acknowledge_Missing = 0;
+
 //-------------------------------------------------------------------------------------------------
-// Public functions
+// Private functions
 //-------------------------------------------------------------------------------------------------
-int PeripheralI2CEEPROMInitialize(char *String_EEPROM_File)
+/** Set the SSPIF flag to tell the firmware that the I2C module operation is terminated. */
+static inline void PeripheralI2CEEPROMSetInterruptFlag(void)
 {
-	FILE *Pointer_File;
-	int Return_Value = 1, Result;
-	
-	// Try to open the file
-	Pointer_File = fopen(String_EEPROM_File, "rb"); // Must specify 'binary' mode on Windows
-	if (Pointer_File == NULL)
-	{
-		LOG(LOG_LEVEL_ERROR, "Error : could not open the EEPROM file '%s' (%s).\n", String_EEPROM_File, strerror(errno));
-		goto Exit;
-	}
+	unsigned char PIR1_Register;
 	
-	// Read the file content
-	Result = fread(Peripheral_I2C_EEPROM_Memory, 1, PERIPHERAL_I2C_EEPROM_MEMORY_SIZE, Pointer_File);
-	if (ferror(Pointer_File))
-	{
-		LOG(LOG_LEVEL_ERROR, "Error : failed to read from the EEPROM file (%s).\n", strerror(errno));
-		goto Exit;
-	}
+	PIR1_Register = RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1);
+	PIR1_Register |= REGISTER_FILE_REGISTER_BIT_PIR1_SSPIF;
+	RegisterFileDirectWriteFromCallback(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1, PIR1_Register);
+}
+
+/** Store a received byte into the page buffer. The address register low bits are incremented, rolling over to the page beginning if the page end is reached.
+ * @param Data The received byte.
+ */
+static inline void PeripheralI2CEEPROMLoadPageBuffer(unsigned char Data)
+{
+	unsigned int Offset;
 	
-	LOG(LOG_LEVEL_DEBUG, "EEPROM file successfully read (%d bytes).\n", Result);
-	Return_Value = 0;
+	Offset = Peripheral_I2C_EEPROM_Address_Register & PERIPHERAL_I2C_EEPROM_PAGE_OFFSET_MASK;
+	Peripheral_I2C_EEPROM_Page_Buffer[Offset] = Data; // Previously received data are overwritten when more than a page is received
+	Peripheral_I2C_EEPROM_Page_Buffer_Loaded_Bytes_Mask |= 1u << Offset;
 	
-Exit:
-	if (Pointer_File != NULL) fclose(Pointer_File); // Close the file if needed
-	return Return_Value;
+	Peripheral_I2C_EEPROM_Address_Register = (Peripheral_I2C_EEPROM_Address_Register & ~PERIPHERAL_I2C_EEPROM_PAGE_OFFSET_MASK) | ((Offset + 1) & PERIPHERAL_I2C_EEPROM_PAGE_OFFSET_MASK);
 }
 
-int PeripheralI2CEEPROMStoreMemoryToFile(char *String_EEPROM_File)
+/** Program the received bytes into the memory and start the write cycle. */
+static void PeripheralI2CEEPROMProgramPage(void)
 {
-	FILE *Pointer_File;
-	int Return_Value = 1, Result;
+	unsigned short Page_Address;
+	unsigned int Offset;
 	
-	// Try to open the file
-	Pointer_File = fopen(String_EEPROM_File, "wb"); // Must specify 'binary' mode on Windows
-	if (Pointer_File == NULL)
-	{
-		LOG(LOG_LEVEL_ERROR, "Error : could not open the EEPROM file '%s' (%s).\n", String_EEPROM_File, strerror(errno));
-		goto Exit;
-	}
+	// A Stop condition sent right after the address does not program anything
+	if (Peripheral_I2C_EEPROM_Page_Buffer_Loaded_Bytes_Mask == 0) return;
 	
-	// Write the memory content to the file
-	Result = fwrite(Peripheral_I2C_EEPROM_Memory, 1, PERIPHERAL_I2C_EEPROM_MEMORY_SIZE, Pointer_File);
-	if (ferror(Pointer_File))
+	Page_Address = Peripheral_I2C_EEPROM_Address_Register & ~PERIPHERAL_I2C_EEPROM_PAGE_OFFSET_MASK;
+	for (Offset = 0; Offset < PERIPHERAL_I2C_EEPROM_PAGE_SIZE; Offset++)
 	{
-		LOG(LOG_LEVEL_ERROR, "Error : failed to write to the EEPROM file (%s).\n", strerror(errno));
-		goto Exit;
+		if (Peripheral_I2C_EEPROM_Page_Buffer_Loaded_Bytes_Mask & (1u << Offset)) MemoryFileWriteByte(&Peripheral_I2C_EEPROM_Memory, Page_Address + Offset, Peripheral_I2C_EEPROM_Page_Buffer[Offset]);
 	}
+	Peripheral_I2C_EEPROM_Page_Buffer_Loaded_Bytes_Mask = 0;
 	
-	LOG(LOG_LEVEL_DEBUG, "EEPROM file successfully written (%d bytes).\n", Result);
-	Return_Value = 0;
+	// The EEPROM is busy until the data are programmed
+	Peripheral_I2C_EEPROM_Write_Cycle_End_Cycle = CoreGetCyclesCount() + CoreConvertMicrosecondsToCycles(PERIPHERAL_I2C_EEPROM_WRITE_CYCLE_TIME);
+	LOG(LOG_LEVEL_DEBUG, "EEPROM started a write cycle for page 0x%04X.\n", Page_Address);
 	
-Exit:
-	if (Pointer_File != NULL) fclose(Pointer_File); // Close the file if needed
-	return Return_Value;
+	// Start writing the modified pages back to the EEPROM file
+	MemoryFileSynchronize(&Peripheral_I2C_EEPROM_Memory, MS_ASYNC);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int PeripheralI2CEEPROMInitialize(char *String_EEPROM_File, int Is_Base_Image_Shared)
+{
+	return MemoryFileMap(&Peripheral_I2C_EEPROM_Memory, String_EEPROM_File, PERIPHERAL_I2C_EEPROM_MEMORY_SIZE, 0, 0, Is_Base_Image_Shared); // The EEPROM file is mandatory, so a mistyped path is not taken for a blank EEPROM
+}
+
+int PeripheralI2CEEPROMUninitialize(void)
+{
+	return MemoryFileUnmap(&Peripheral_I2C_EEPROM_Memory);
+}
+
+unsigned char PeripheralI2CEEPROMReadSSPBUF(TRegisterFileRegisterContent __attribute__((unused)) *Pointer_Content)
+{
+	return Peripheral_I2C_EEPROM_SSPBUF_Value;
 }
 
 void PeripheralI2CEEPROMWriteSSPCON2(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data)
 {
-	unsigned char PIR1_Register;
+	int Is_Interrupt_Flag_Set = 0;
 	
-	// Start, Repeated Start and Stop conditions must set the I2C interrupt flag and be cleared by hardware
-	if ((Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKEN) || (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_RCEN) || (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_PEN) || (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_RSEN) || (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_SEN))
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_I2C_EEPROM);
+	
+	// Start, Repeated Start and Stop conditions, acknowledge and reception sequences must set the I2C interrupt flag and be cleared by hardware
+	if (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKEN)
 	{
-		if (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKEN) LOG(LOG_LEVEL_DEBUG, "EEPROM sent (N)ACK.\n");
-		if (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_RCEN) LOG(LOG_LEVEL_DEBUG, "EEPROM is in reception mode.\n");
-		if (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_PEN)
+		// The EEPROM stops transmitting when the master does not acknowledge the received byte
+		if ((Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKDT) && (Peripheral_I2C_EEPROM_State == PERIPHERAL_I2C_EEPROM_STATE_TRANSMIT_DATA_BYTE)) Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_NOT_SELECTED;
+		LOG(LOG_LEVEL_DEBUG, "Master sent %s.\n", Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKDT ? "NACK" : "ACK");
+		Is_Interrupt_Flag_Set = 1;
+	}
+	if (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_RCEN)
+	{
+		if (Peripheral_I2C_EEPROM_State == PERIPHERAL_I2C_EEPROM_STATE_TRANSMIT_DATA_BYTE)
 		{
-			Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DEVICE_ADDRESS;
-			LOG(LOG_LEVEL_DEBUG, "EEPROM sent I2C Stop.\n");
+			// Transmit the byte at the current address
+			Peripheral_I2C_EEPROM_SSPBUF_Value = Peripheral_I2C_EEPROM_Memory.Pointer_Memory[Peripheral_I2C_EEPROM_Address_Register];
+			LOG(LOG_LEVEL_DEBUG, "EEPROM read value 0x%02X at current address 0x%04X.\n", Peripheral_I2C_EEPROM_SSPBUF_Value, Peripheral_I2C_EEPROM_Address_Register);
+			
+			// EEPROM address register is auto-incrementing, sequential reads roll over from the last address to the first one
+			Peripheral_I2C_EEPROM_Address_Register = (Peripheral_I2C_EEPROM_Address_Register + 1) & PERIPHERAL_I2C_EEPROM_ADDRESS_REGISTER_MASK;
 		}
-		if (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_RSEN)
+		else
 		{
-			Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DEVICE_ADDRESS;
-			LOG(LOG_LEVEL_DEBUG, "EEPROM sent I2C Repeated Start.\n");
+			// Nobody drives the bus, so the master reads released lines
+			Peripheral_I2C_EEPROM_SSPBUF_Value = 0xFF;
+			LOG(LOG_LEVEL_WARNING, "WARNING : the master received a byte while the EEPROM is not transmitting.\n");
 		}
-		if (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_SEN) LOG(LOG_LEVEL_DEBUG, "EEPROM sent I2C Start.\n");
-		
-		// Set SSPIF flag to tell that the condition has been transmitted to the bus
-		PIR1_Register = RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1);
-		PIR1_Register |= REGISTER_FILE_REGISTER_BIT_PIR1_SSPIF;
-		RegisterFileDirectWriteFromCallback(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1, PIR1_Register);
-		
-		// Clear the conditions (but RCEN that is handled only by the user firmware)
-		Data &= ~(REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_PEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_RSEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_SEN);
+		Is_Interrupt_Flag_Set = 1;
 	}
+	if (Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_PEN)
+	{
+		// Program the received bytes, so the write operation is really started only when the transaction is correctly terminated
+		if (Peripheral_I2C_EEPROM_State == PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DATA_BYTE) PeripheralI2CEEPROMProgramPage();
+		Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_NOT_SELECTED;
+		LOG(LOG_LEVEL_DEBUG, "Master sent I2C Stop.\n");
+		Is_Interrupt_Flag_Set = 1;
+	}
+	if (Data & (REGISTER_FILE_REGISTER_BIT_SSPCON2_RSEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_SEN))
+	{
+		// A Repeated Start aborts a pending write operation, this is how a random read sets the address register
+		Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DEVICE_ADDRESS;
+		LOG(LOG_LEVEL_DEBUG, "Master sent I2C %s.\n", Data & REGISTER_FILE_REGISTER_BIT_SSPCON2_RSEN ? "Repeated Start" : "Start");
+		Is_Interrupt_Flag_Set = 1;
+	}
+	
+	// Set SSPIF flag to tell that the sequence has been transmitted to the bus
+	if (Is_Interrupt_Flag_Set) PeripheralI2CEEPROMSetInterruptFlag();
+	
+	// Clear the sequences enable bits and reflect the acknowledge status, which is read-only
+	Data &= ~(REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKSTAT | REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_RCEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_PEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_RSEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_SEN);
+	if (Peripheral_I2C_EEPROM_Is_Acknowledge_Missing) Data |= REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKSTAT;
 	
 	// Store the register value
 	Pointer_Content->Data = Data;
+	INSTRUMENTATION_LEAVE();
 }
 
 void PeripheralI2CEEPROMWriteSSPBUF(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data)
 {
-	unsigned char PIR1_Register;
+	unsigned char SSPCON2_Register;
+	int Is_Acknowledge_Missing = 0;
+	
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_I2C_EEPROM);
+	
+	Peripheral_I2C_EEPROM_SSPBUF_Value = Data;
+	Pointer_Content->Data = Data;
 	
 	switch (Peripheral_I2C_EEPROM_State)
 	{
 		// The master sent the EEPROM device address and the operation type
 		case PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DEVICE_ADDRESS:
-			if (Data == PERIPHERAL_I2C_EEPROM_READ_ADDRESS)
+			// The EEPROM does not respond while it is programming a page, the master can poll it to know when the write cycle is terminated
+			if (CoreGetCyclesCount() < Peripheral_I2C_EEPROM_Write_Cycle_End_Cycle)
 			{
-				// Write the corresponding memory cell value to SSPBUF so it will return this value when read
-				Pointer_Content->Data = Peripheral_I2C_EEPROM_Memory[Peripheral_I2C_EEPROM_Address_Register];
-				LOG(LOG_LEVEL_DEBUG, "EEPROM read value 0x%02X at current address 0x%04X.\n", Pointer_Content->Data, Peripheral_I2C_EEPROM_Address_Register);
-
-				// EEPROM address register is auto-incrementing
-				Peripheral_I2C_EEPROM_Address_Register++;
-				if (Peripheral_I2C_EEPROM_Address_Register >= PERIPHERAL_I2C_EEPROM_MEMORY_SIZE) Peripheral_I2C_EEPROM_Address_Register = 0; // Handle wrap-around
+				Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_NOT_SELECTED;
+				Is_Acknowledge_Missing = 1;
+				LOG(LOG_LEVEL_DEBUG, "EEPROM is busy with a write cycle, not acknowledging its address.\n");
+			}
+			else if (Data == PERIPHERAL_I2C_EEPROM_READ_ADDRESS)
+			{
+				// Bytes will be transmitted from the current address each time the master enables the reception
+				Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_TRANSMIT_DATA_BYTE;
+				LOG(LOG_LEVEL_DEBUG, "EEPROM read operation at current address 0x%04X.\n", Peripheral_I2C_EEPROM_Address_Register);
 			}
 			else if (Data == PERIPHERAL_I2C_EEPROM_WRITE_ADDRESS)
 			{
 				Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DATA_HIGH_BYTE_ADDRESS;
 				LOG(LOG_LEVEL_DEBUG, "EEPROM write operation.\n");
 			}
-			else LOG(LOG_LEVEL_WARNING, "Received and discarded a bad I2C address (0x%02X).\n", Data);
+			else
+			{
+				Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_NOT_SELECTED;
+				Is_Acknowledge_Missing = 1;
+				LOG(LOG_LEVEL_WARNING, "Received and discarded a bad I2C address (0x%02X).\n", Data);
+			}
 			break;
 			
 		// The master sent the high byte of the address to write to
@@ -179,26 +249,76 @@ void PeripheralI2CEEPROMWriteSSPBUF(TRegisterFileRegisterContent *Pointer_Conten
 		case PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DATA_LOW_BYTE_ADDRESS:
 			Peripheral_I2C_EEPROM_Address_Register |= Data;
 			// Wait for the data to write
+			Peripheral_I2C_EEPROM_Page_Buffer_Loaded_Bytes_Mask = 0;
 			Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DATA_BYTE;
 			LOG(LOG_LEVEL_DEBUG, "EEPROM received address low byte (0x%02X), EEPROM address register : 0x%04X.\n", Data, Peripheral_I2C_EEPROM_Address_Register);
 			break;
 			
-		// The master sent the payload byte to write
+		// The master sent a payload byte to write
 		case PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DATA_BYTE:
-			Peripheral_I2C_EEPROM_Memory[Peripheral_I2C_EEPROM_Address_Register] = Data;
-			// The operation is finished
-			Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_RECEIVE_DEVICE_ADDRESS;
+			PeripheralI2CEEPROMLoadPageBuffer(Data);
 			LOG(LOG_LEVEL_DEBUG, "EEPROM received data to write : 0x%02X.\n", Data);
 			break;
 			
+		// The master must not transmit while the EEPROM is transmitting
+		case PERIPHERAL_I2C_EEPROM_STATE_TRANSMIT_DATA_BYTE:
+			Peripheral_I2C_EEPROM_State = PERIPHERAL_I2C_EEPROM_STATE_NOT_SELECTED;
+			Is_Acknowledge_Missing = 1;
+			LOG(LOG_LEVEL_WARNING, "WARNING : the master sent a byte (0x%02X) during an EEPROM read operation.\n", Data);
+			break;
+			
+		// Nobody acknowledges the byte
+		case PERIPHERAL_I2C_EEPROM_STATE_NOT_SELECTED:
+			Is_Acknowledge_Missing = 1;
+			LOG(LOG_LEVEL_DEBUG, "Nobody acknowledged the byte 0x%02X.\n", Data);
+			break;
+			
 		// Should never be reached
 		default:
 			LOG(LOG_LEVEL_ERROR, "ERROR : Inconsistent EEPROM state machine state (%d).\n", Peripheral_I2C_EEPROM_State);
 			exit(EXIT_FAILURE);
 	}
 	
-	// Set SSPIF flag to tell that the EEPROM access is terminated
-	PIR1_Register = RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1);
-	PIR1_Register |= REGISTER_FILE_REGISTER_BIT_PIR1_SSPIF;
-	RegisterFileDirectWriteFromCallback(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1, PIR1_Register);
+	// Report the acknowledge status to SSPCON2 (the SSPCON2 callback keeps the ACKSTAT value from Peripheral_I2C_EEPROM_Is_Acknowledge_Missing)
+	Peripheral_I2C_EEPROM_Is_Acknowledge_Missing = Is_Acknowledge_Missing;
+	SSPCON2_Register = RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_SSPCON2, REGISTER_FILE_REGISTER_ADDRESS_SSPCON2);
+	RegisterFileDirectWriteFromCallback(REGISTER_FILE_REGISTER_BANK_SSPCON2, REGISTER_FILE_REGISTER_ADDRESS_SSPCON2, SSPCON2_Register & ~(REGISTER_FILE_REGISTER_BIT_SSPCON2_ACKEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_RCEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_PEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_RSEN | REGISTER_FILE_REGISTER_BIT_SSPCON2_SEN));
+	
+	// Set SSPIF flag to tell that the byte transmission is terminated
+	PeripheralI2CEEPROMSetInterruptFlag();
+	INSTRUMENTATION_LEAVE();
+}
+
+void PeripheralI2CEEPROMSaveSnapshot(TPeripheralI2CEEPROMSnapshot *Pointer_Snapshot)
+{
+	memcpy(Pointer_Snapshot->Memory, Peripheral_I2C_EEPROM_Memory.Pointer_Memory, PERIPHERAL_I2C_EEPROM_MEMORY_SIZE);
+	memcpy(Pointer_Snapshot->Page_Buffer, Peripheral_I2C_EEPROM_Page_Buffer, PERIPHERAL_I2C_EEPROM_PAGE_SIZE);
+	Pointer_Snapshot->Page_Buffer_Loaded_Bytes_Mask = Peripheral_I2C_EEPROM_Page_Buffer_Loaded_Bytes_Mask;
+	Pointer_Snapshot->Address_Register = Peripheral_I2C_EEPROM_Address_Register;
+	Pointer_Snapshot->SSPBUF_Value = Peripheral_I2C_EEPROM_SSPBUF_Value;
+	Pointer_Snapshot->State = Peripheral_I2C_EEPROM_State;
+	Pointer_Snapshot->Is_Acknowledge_Missing = Peripheral_I2C_EEPROM_Is_Acknowledge_Missing;
+	Pointer_Snapshot->Write_Cycle_End_Cycle = Peripheral_I2C_EEPROM_Write_Cycle_End_Cycle;
+}
+
+void PeripheralI2CEEPROMRestoreSnapshot(const TPeripheralI2CEEPROMSnapshot *Pointer_Snapshot)
+{
+	int Address, Is_Memory_Modified = 0;
+	
+	// Write only the modified bytes, so the EEPROM file pages that did not change are not written again
+	for (Address = 0; Address < PERIPHERAL_I2C_EEPROM_MEMORY_SIZE; Address++)
+	{
+		if (Peripheral_I2C_EEPROM_Memory.Pointer_Memory[Address] == Pointer_Snapshot->Memory[Address]) continue;
+		MemoryFileWriteByte(&Peripheral_I2C_EEPROM_Memory, Address, Pointer_Snapshot->Memory[Address]);
+		Is_Memory_Modified = 1;
+	}
+	if (Is_Memory_Modified) MemoryFileSynchronize(&Peripheral_I2C_EEPROM_Memory, MS_ASYNC);
+	
+	memcpy(Peripheral_I2C_EEPROM_Page_Buffer, Pointer_Snapshot->Page_Buffer, PERIPHERAL_I2C_EEPROM_PAGE_SIZE);
+	Peripheral_I2C_EEPROM_Page_Buffer_Loaded_Bytes_Mask = Pointer_Snapshot->Page_Buffer_Loaded_Bytes_Mask;
+	Peripheral_I2C_EEPROM_Address_Register = Pointer_Snapshot->Address_Register;
+	Peripheral_I2C_EEPROM_SSPBUF_Value = Pointer_Snapshot->SSPBUF_Value;
+	Peripheral_I2C_EEPROM_State = (TPeripheralI2CEEPROMState) Pointer_Snapshot->State;
+	Peripheral_I2C_EEPROM_Is_Acknowledge_Missing = Pointer_Snapshot->Is_Acknowledge_Missing;
+	Peripheral_I2C_EEPROM_Write_Cycle_End_Cycle = Pointer_Snapshot->Write_Cycle_End_Cycle;
 }
@@ -0,0 +1,220 @@
+/** @file Peripheral_Memory_Access.c
+ * @see Peripheral_Memory_Access.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Core.h>
+#include <Instrumentation.h>
+#include <Log.h>
+#include <Peripheral_Data_EEPROM.h>
+#include <Peripheral_Memory_Access.h>
+#include <Program_Memory.h>
+#include <Register_File.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** The first byte of the write unlock sequence. */
+#define PERIPHERAL_MEMORY_ACCESS_UNLOCK_SEQUENCE_FIRST_BYTE 0x55
+/** The second byte of the write unlock sequence. */
+#define PERIPHERAL_MEMORY_ACCESS_UNLOCK_SEQUENCE_SECOND_BYTE 0xAA
+
+/** The typical data EEPROM write time (in microseconds). */
+#define PERIPHERAL_MEMORY_ACCESS_DATA_EEPROM_WRITE_TIME 4000
+/** The typical program Flash write time (in microseconds). */
+#define PERIPHERAL_MEMORY_ACCESS_PROGRAM_MEMORY_WRITE_TIME 4000
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** The unlock sequence states. */
+typedef enum
+{
+	PERIPHERAL_MEMORY_ACCESS_UNLOCK_STATE_LOCKED,
+	PERIPHERAL_MEMORY_ACCESS_UNLOCK_STATE_FIRST_BYTE_RECEIVED,
+	PERIPHERAL_MEMORY_ACCESS_UNLOCK_STATE_UNLOCKED
+} TPeripheralMemoryAccessUnlockState;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** Where the unlock sequence is. */
+static TPeripheralMemoryAccessUnlockState Peripheral_Memory_Access_Unlock_State = PERIPHERAL_MEMORY_ACCESS_UNLOCK_STATE_LOCKED;
+/** The instruction cycle of the last unlock sequence step, the sequence bytes and the WR bit setting must be written in consecutive instructions. */
+static unsigned long long Peripheral_Memory_Access_Unlock_Step_Cycle;
+
+/** Tell whether a write operation is in progress. */
+static int Peripheral_Memory_Access_Is_Write_In_Progress = 0;
+/** Tell whether the write operation targets the program memory or the data EEPROM. */
+static int Peripheral_Memory_Access_Is_Program_Memory_Write;
+/** The written location address. */
+static unsigned short Peripheral_Memory_Access_Write_Address;
+/** The data to write (14-bit word for the program memory or byte for the data EEPROM). */
+static unsigned short Peripheral_Memory_Access_Write_Data;
+/** The instruction cycle at which the current write operation will be terminated. */
+static unsigned long long Peripheral_Memory_Access_Write_End_Cycle;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Read the data EEPROM or the program memory location selected by the address registers to the data registers.
+ * @param Is_Program_Memory_Read Set to 1 to read the program memory, set to 0 to read the data EEPROM.
+ */
+static void PeripheralMemoryAccessRead(int Is_Program_Memory_Read)
+{
+	unsigned short Address, Data;
+	
+	if (Is_Program_Memory_Read)
+	{
+		Address = ((RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_EEADRH, REGISTER_FILE_REGISTER_ADDRESS_EEADRH) & 0x1F) << 8) | RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_EEADR, REGISTER_FILE_REGISTER_ADDRESS_EEADR);
+		Data = ProgramMemoryRead(Address);
+		RegisterFileDirectWriteFromCallback(REGISTER_FILE_REGISTER_BANK_EEDATH, REGISTER_FILE_REGISTER_ADDRESS_EEDATH, (Data >> 8) & 0x3F);
+		RegisterFileDirectWriteFromCallback(REGISTER_FILE_REGISTER_BANK_EEDATA, REGISTER_FILE_REGISTER_ADDRESS_EEDATA, (unsigned char) Data);
+		
+		// The Flash is accessed during the next two instruction cycles, they are spent by the two NOP the firmware must place after setting RD, so no cycle is added here
+		LOG(LOG_LEVEL_DEBUG, "Read program memory word 0x%04X at address 0x%04X.\n", Data, Address);
+	}
+	else
+	{
+		// The data is available in EEDATA on the very next cycle
+		Address = RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_EEADR, REGISTER_FILE_REGISTER_ADDRESS_EEADR);
+		Data = PeripheralDataEEPROMRead(Address);
+		RegisterFileDirectWriteFromCallback(REGISTER_FILE_REGISTER_BANK_EEDATA, REGISTER_FILE_REGISTER_ADDRESS_EEDATA, (unsigned char) Data);
+		LOG(LOG_LEVEL_DEBUG, "Read data EEPROM byte 0x%02X at address 0x%02X.\n", Data, Address);
+	}
+}
+
+/** Start programming the data registers content to the location selected by the address registers.
+ * @param Is_Program_Memory_Write Set to 1 to write the program memory, set to 0 to write the data EEPROM.
+ */
+static void PeripheralMemoryAccessStartWrite(int Is_Program_Memory_Write)
+{
+	Peripheral_Memory_Access_Is_Program_Memory_Write = Is_Program_Memory_Write;
+	if (Is_Program_Memory_Write)
+	{
+		Peripheral_Memory_Access_Write_Address = ((RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_EEADRH, REGISTER_FILE_REGISTER_ADDRESS_EEADRH) & 0x1F) << 8) | RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_EEADR, REGISTER_FILE_REGISTER_ADDRESS_EEADR);
+		Peripheral_Memory_Access_Write_Data = ((RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_EEDATH, REGISTER_FILE_REGISTER_ADDRESS_EEDATH) & 0x3F) << 8) | RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_EEDATA, REGISTER_FILE_REGISTER_ADDRESS_EEDATA);
+		Peripheral_Memory_Access_Write_End_Cycle = CoreGetCyclesCount() + CoreConvertMicrosecondsToCycles(PERIPHERAL_MEMORY_ACCESS_PROGRAM_MEMORY_WRITE_TIME);
+		
+		// The processor does not execute instructions while the Flash is being programmed
+		CoreStall(CoreConvertMicrosecondsToCycles(PERIPHERAL_MEMORY_ACCESS_PROGRAM_MEMORY_WRITE_TIME));
+		LOG(LOG_LEVEL_DEBUG, "Started writing program memory word 0x%04X at address 0x%04X.\n", Peripheral_Memory_Access_Write_Data, Peripheral_Memory_Access_Write_Address);
+	}
+	else
+	{
+		Peripheral_Memory_Access_Write_Address = RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_EEADR, REGISTER_FILE_REGISTER_ADDRESS_EEADR);
+		Peripheral_Memory_Access_Write_Data = RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_EEDATA, REGISTER_FILE_REGISTER_ADDRESS_EEDATA);
+		Peripheral_Memory_Access_Write_End_Cycle = CoreGetCyclesCount() + CoreConvertMicrosecondsToCycles(PERIPHERAL_MEMORY_ACCESS_DATA_EEPROM_WRITE_TIME);
+		LOG(LOG_LEVEL_DEBUG, "Started writing data EEPROM byte 0x%02X at address 0x%02X.\n", Peripheral_Memory_Access_Write_Data, Peripheral_Memory_Access_Write_Address);
+	}
+	Peripheral_Memory_Access_Is_Write_In_Progress = 1;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void PeripheralMemoryAccessWriteEECON1(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data)
+{
+	int Is_Unlocked;
+	
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_MEMORY_ACCESS);
+	
+	// RD and WR bits can only be set by software, they are cleared by hardware
+	if (Peripheral_Memory_Access_Is_Write_In_Progress) Data |= REGISTER_FILE_REGISTER_BIT_EECON1_WR;
+	else if (Data & REGISTER_FILE_REGISTER_BIT_EECON1_WR)
+	{
+		// The WR bit must be set right after the unlock sequence
+		Is_Unlocked = (Peripheral_Memory_Access_Unlock_State == PERIPHERAL_MEMORY_ACCESS_UNLOCK_STATE_UNLOCKED) && (CoreGetCyclesCount() == Peripheral_Memory_Access_Unlock_Step_Cycle + 1);
+		if (!(Data & REGISTER_FILE_REGISTER_BIT_EECON1_WREN))
+		{
+			LOG(LOG_LEVEL_WARNING, "WARNING : EECON1.WR was set while EECON1.WREN is cleared, ignoring the write operation.\n");
+			Data &= ~REGISTER_FILE_REGISTER_BIT_EECON1_WR;
+		}
+		else if (!Is_Unlocked)
+		{
+			LOG(LOG_LEVEL_WARNING, "WARNING : EECON1.WR was not set right after the 0x55, 0xAA sequence written to EECON2, ignoring the write operation.\n");
+			Data &= ~REGISTER_FILE_REGISTER_BIT_EECON1_WR;
+		}
+		else PeripheralMemoryAccessStartWrite(Data & REGISTER_FILE_REGISTER_BIT_EECON1_EEPGD);
+	}
+	Peripheral_Memory_Access_Unlock_State = PERIPHERAL_MEMORY_ACCESS_UNLOCK_STATE_LOCKED;
+	
+	// A read operation terminates immediately
+	if (Data & REGISTER_FILE_REGISTER_BIT_EECON1_RD)
+	{
+		PeripheralMemoryAccessRead(Data & REGISTER_FILE_REGISTER_BIT_EECON1_EEPGD);
+		Data &= ~REGISTER_FILE_REGISTER_BIT_EECON1_RD;
+	}
+	
+	Pointer_Content->Data = Data;
+	INSTRUMENTATION_LEAVE();
+}
+
+unsigned char PeripheralMemoryAccessReadEECON2(TRegisterFileRegisterContent __attribute__((unused)) *Pointer_Content)
+{
+	return 0;
+}
+
+void PeripheralMemoryAccessWriteEECON2(TRegisterFileRegisterContent __attribute__((unused)) *Pointer_Content, unsigned char Data)
+{
+	unsigned long long Cycles_Count;
+	
+	// The firmware must load W between the two sequence bytes, so the bytes are written two cycles apart
+	Cycles_Count = CoreGetCyclesCount();
+	if (Data == PERIPHERAL_MEMORY_ACCESS_UNLOCK_SEQUENCE_FIRST_BYTE) Peripheral_Memory_Access_Unlock_State = PERIPHERAL_MEMORY_ACCESS_UNLOCK_STATE_FIRST_BYTE_RECEIVED;
+	else if ((Data == PERIPHERAL_MEMORY_ACCESS_UNLOCK_SEQUENCE_SECOND_BYTE) && (Peripheral_Memory_Access_Unlock_State == PERIPHERAL_MEMORY_ACCESS_UNLOCK_STATE_FIRST_BYTE_RECEIVED) && (Cycles_Count == Peripheral_Memory_Access_Unlock_Step_Cycle + 2)) Peripheral_Memory_Access_Unlock_State = PERIPHERAL_MEMORY_ACCESS_UNLOCK_STATE_UNLOCKED;
+	else Peripheral_Memory_Access_Unlock_State = PERIPHERAL_MEMORY_ACCESS_UNLOCK_STATE_LOCKED;
+	Peripheral_Memory_Access_Unlock_Step_Cycle = Cycles_Count;
+}
+
+void PeripheralMemoryAccessUpdate(void)
+{
+	unsigned char Register_Value;
+	
+	// Nothing to do most of the time
+	if (!Peripheral_Memory_Access_Is_Write_In_Progress || (CoreGetCyclesCount() < Peripheral_Memory_Access_Write_End_Cycle)) return;
+	Peripheral_Memory_Access_Is_Write_In_Progress = 0;
+	
+	// Program the data
+	if (Peripheral_Memory_Access_Is_Program_Memory_Write)
+	{
+		ProgramMemoryWrite(Peripheral_Memory_Access_Write_Address, Peripheral_Memory_Access_Write_Data);
+		LOG(LOG_LEVEL_DEBUG, "Program memory write terminated.\n");
+	}
+	else
+	{
+		PeripheralDataEEPROMWrite(Peripheral_Memory_Access_Write_Address, Peripheral_Memory_Access_Write_Data);
+		LOG(LOG_LEVEL_DEBUG, "Data EEPROM write terminated.\n");
+	}
+	
+	// Clear WR bit to tell that the write operation is terminated (the write operation is not in progress anymore, so the EECON1 callback will not keep it set)
+	Register_Value = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_EECON1, REGISTER_FILE_REGISTER_ADDRESS_EECON1);
+	Register_Value &= ~REGISTER_FILE_REGISTER_BIT_EECON1_WR;
+	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_EECON1, REGISTER_FILE_REGISTER_ADDRESS_EECON1, Register_Value);
+	
+	// Set EEIF flag
+	Register_Value = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_PIR2, REGISTER_FILE_REGISTER_ADDRESS_PIR2);
+	Register_Value |= REGISTER_FILE_REGISTER_BIT_PIR2_EEIF;
+	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_PIR2, REGISTER_FILE_REGISTER_ADDRESS_PIR2, Register_Value);
+}
+
+void PeripheralMemoryAccessSaveSnapshot(TPeripheralMemoryAccessSnapshot *Pointer_Snapshot)
+{
+	Pointer_Snapshot->Unlock_State = Peripheral_Memory_Access_Unlock_State;
+	Pointer_Snapshot->Is_Write_In_Progress = Peripheral_Memory_Access_Is_Write_In_Progress;
+	Pointer_Snapshot->Unlock_Step_Cycle = Peripheral_Memory_Access_Unlock_Step_Cycle;
+	Pointer_Snapshot->Is_Program_Memory_Write = Peripheral_Memory_Access_Is_Program_Memory_Write;
+	Pointer_Snapshot->Write_Address = Peripheral_Memory_Access_Write_Address;
+	Pointer_Snapshot->Write_Data = Peripheral_Memory_Access_Write_Data;
+	Pointer_Snapshot->Write_End_Cycle = Peripheral_Memory_Access_Write_End_Cycle;
+}
+
+void PeripheralMemoryAccessRestoreSnapshot(const TPeripheralMemoryAccessSnapshot *Pointer_Snapshot)
+{
+	Peripheral_Memory_Access_Unlock_State = (TPeripheralMemoryAccessUnlockState) Pointer_Snapshot->Unlock_State;
+	Peripheral_Memory_Access_Is_Write_In_Progress = Pointer_Snapshot->Is_Write_In_Progress;
+	Peripheral_Memory_Access_Unlock_Step_Cycle = Pointer_Snapshot->Unlock_Step_Cycle;
+	Peripheral_Memory_Access_Is_Program_Memory_Write = Pointer_Snapshot->Is_Program_Memory_Write;
+	Peripheral_Memory_Access_Write_Address = Pointer_Snapshot->Write_Address;
+	Peripheral_Memory_Access_Write_Data = Pointer_Snapshot->Write_Data;
+	Peripheral_Memory_Access_Write_End_Cycle = Pointer_Snapshot->Write_End_Cycle;
+}
@@ -5,20 +5,32 @@
 #include <Peripheral_Timer.h>
 #include <Register_File.h>
 
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** Timer 0 prescaler counter. */
+static int Peripheral_Timer_0_Prescaler = 0;
+/** Timer 2 prescaler counter. */
+static int Peripheral_Timer_2_Prescaler = 0;
+/** Timer 2 postscaler counter. */
+static int Peripheral_Timer_2_Postscaler = 0;
+
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
-/** Increment TMR0 and set the T0IF flag if needed. */
-static inline void PeripheralTimer0Increment(void)
+/** Add increments to TMR0 and set the T0IF flag if needed.
+ * @param Increments_Count How many times TMR0 is incremented.
+ */
+static inline void PeripheralTimer0Increment(unsigned int Increments_Count)
 {
-	unsigned char Timer_Value, INTCON_Register;
+	unsigned int Timer_Value;
+	unsigned char INTCON_Register;
 	
-	Timer_Value = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_TMR0, REGISTER_FILE_REGISTER_ADDRESS_TMR0);
-	Timer_Value++;
-	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_TMR0, REGISTER_FILE_REGISTER_ADDRESS_TMR0, Timer_Value);
+	Timer_Value = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_TMR0, REGISTER_FILE_REGISTER_ADDRESS_TMR0) + Increments_Count;
+	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_TMR0, REGISTER_FILE_REGISTER_ADDRESS_TMR0, (unsigned char) Timer_Value);
 	
 	// Did the timer overflow ?
-	if (Timer_Value == 0)
+	if (Timer_Value > 0xFF)
 	{
 		// Set INTCON.T0IF
 		INTCON_Register = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_INTCON, REGISTER_FILE_REGISTER_ADDRESS_INTCON);
@@ -27,26 +39,75 @@ static inline void PeripheralTimer0Increment(void)
 	}
 }
 
+/** Add increments to TMR2 and set the TMR2IF flag if needed.
+ * @param Increments_Count How many times TMR2 is incremented.
+ * @param Postscaler_Value How many TMR2 to PR2 matches are needed to set the interrupt flag (from 1 to 16).
+ */
+static inline void PeripheralTimer2Increment(unsigned int Increments_Count, int Postscaler_Value)
+{
+	unsigned char Timer_Value, Period_Value, PIR1_Register;
+	int Prescaler, Postscaler, Is_Interrupt_Flag_Set = 0;
+	
+	// Each increment must be compared to PR2, so they are done one by one
+	Timer_Value = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_TMR2, REGISTER_FILE_REGISTER_ADDRESS_TMR2);
+	Period_Value = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_PR2, REGISTER_FILE_REGISTER_ADDRESS_PR2);
+	Postscaler = Peripheral_Timer_2_Postscaler;
+	while (Increments_Count > 0)
+	{
+		// TMR2 is reset on the next increment when it matches PR2
+		if (Timer_Value == Period_Value)
+		{
+			Timer_Value = 0;
+			
+			// The match output feeds the postscaler
+			Postscaler++;
+			if (Postscaler >= Postscaler_Value)
+			{
+				Is_Interrupt_Flag_Set = 1;
+				Postscaler = 0;
+			}
+		}
+		else Timer_Value++;
+		Increments_Count--;
+	}
+	
+	// Writing TMR2 clears the prescaler and postscaler counters like a program write, so they are set afterwards
+	Prescaler = Peripheral_Timer_2_Prescaler;
+	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_TMR2, REGISTER_FILE_REGISTER_ADDRESS_TMR2, Timer_Value);
+	Peripheral_Timer_2_Prescaler = Prescaler;
+	Peripheral_Timer_2_Postscaler = Postscaler;
+	
+	if (Is_Interrupt_Flag_Set)
+	{
+		// Set PIR1.TMR2IF
+		PIR1_Register = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1);
+		PIR1_Register |= REGISTER_FILE_REGISTER_BIT_PIR1_TMR2IF;
+		RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1, PIR1_Register);
+	}
+}
+
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
-void PeripheralTimerIncrement(void)
+void PeripheralTimerIncrement(unsigned int Cycles)
 {
-	static int Timer_0_Prescaler = 0, Prescaler_Value;
+	int Prescaler_Value;
+	unsigned int Increments_Count;
 	unsigned char Temp_Byte;
 	
 	// Timer 0 (always enabled, can't be disabled)
 	Temp_Byte = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_OPTION_REG, REGISTER_FILE_REGISTER_ADDRESS_OPTION_REG);
-	if (Temp_Byte & REGISTER_FILE_REGISTER_BIT_OPTION_REG_PSA) PeripheralTimer0Increment(); // The prescaler is assigned to the watchdog timer, so increment TMR0
+	if (Temp_Byte & REGISTER_FILE_REGISTER_BIT_OPTION_REG_PSA) PeripheralTimer0Increment(Cycles); // The prescaler is assigned to the watchdog timer, so increment TMR0
 	else // The prescaler is assigned to the timer
 	{
 		Prescaler_Value = 2 << (Temp_Byte & 0x07);
 		
-		Timer_0_Prescaler++;
-		if (Timer_0_Prescaler == Prescaler_Value)
+		// The prescaler can overflow several times when an instruction lasts many cycles
+		Peripheral_Timer_0_Prescaler += Cycles;
+		if (Peripheral_Timer_0_Prescaler >= Prescaler_Value)
 		{
-			PeripheralTimer0Increment();
-			Timer_0_Prescaler = 0;
+			PeripheralTimer0Increment(Peripheral_Timer_0_Prescaler / Prescaler_Value);
+			Peripheral_Timer_0_Prescaler %= Prescaler_Value;
 		}
 	}
 		
@@ -54,14 +115,45 @@ void PeripheralTimerIncrement(void)
 	Temp_Byte = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_T2CON, REGISTER_FILE_REGISTER_ADDRESS_T2CON);
 	if (Temp_Byte & REGISTER_FILE_REGISTER_BIT_T2CON_TMR2ON)
 	{
-		// TODO handle prescaler
+		// Prescaler values are 1, 4 or 16
+		Prescaler_Value = 1 << (2 * (Temp_Byte & REGISTER_FILE_REGISTER_BIT_T2CON_T2CKPS_MASK));
+		if (Prescaler_Value > 16) Prescaler_Value = 16;
 		
-		Temp_Byte = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_TMR2, REGISTER_FILE_REGISTER_ADDRESS_TMR2);
-		Temp_Byte++;
-		RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_TMR2, REGISTER_FILE_REGISTER_ADDRESS_TMR2, Temp_Byte);
-		
-		// TODO handle postscaler
-		
-		// TODO handle interrupt flag
+		// The prescaler can overflow several times when an instruction lasts many cycles
+		Peripheral_Timer_2_Prescaler += Cycles;
+		if (Peripheral_Timer_2_Prescaler >= Prescaler_Value)
+		{
+			Increments_Count = Peripheral_Timer_2_Prescaler / Prescaler_Value;
+			Peripheral_Timer_2_Prescaler %= Prescaler_Value;
+			PeripheralTimer2Increment(Increments_Count, ((Temp_Byte & REGISTER_FILE_REGISTER_BIT_T2CON_TOUTPS_MASK) >> REGISTER_FILE_REGISTER_BIT_T2CON_TOUTPS_SHIFT) + 1);
+		}
 	}
-}
\ No newline at end of file
+}
+
+void PeripheralTimerWriteTMR2(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data)
+{
+	Pointer_Content->Data = Data;
+	Peripheral_Timer_2_Prescaler = 0;
+	Peripheral_Timer_2_Postscaler = 0;
+}
+
+void PeripheralTimerWriteT2CON(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data)
+{
+	Pointer_Content->Data = Data;
+	Peripheral_Timer_2_Prescaler = 0;
+	Peripheral_Timer_2_Postscaler = 0;
+}
+
+void PeripheralTimerSaveSnapshot(TPeripheralTimerSnapshot *Pointer_Snapshot)
+{
+	Pointer_Snapshot->Timer_0_Prescaler = Peripheral_Timer_0_Prescaler;
+	Pointer_Snapshot->Timer_2_Prescaler = Peripheral_Timer_2_Prescaler;
+	Pointer_Snapshot->Timer_2_Postscaler = Peripheral_Timer_2_Postscaler;
+}
+
+void PeripheralTimerRestoreSnapshot(const TPeripheralTimerSnapshot *Pointer_Snapshot)
+{
+	Peripheral_Timer_0_Prescaler = Pointer_Snapshot->Timer_0_Prescaler;
+	Peripheral_Timer_2_Prescaler = Pointer_Snapshot->Timer_2_Prescaler;
+	Peripheral_Timer_2_Postscaler = Pointer_Snapshot->Timer_2_Postscaler;
+}
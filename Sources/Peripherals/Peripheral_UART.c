@@ -2,10 +2,174 @@
  * @see Peripheral_UART.h for description.
  * @author Adrien RICCIARDI
  */
+#include <Core.h>
+#include <Instrumentation.h>
 #include <Log.h>
 #include <Peripheral_UART.h>
 #include <Register_File.h>
-#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <UART_Backend.h>
+#include <Virtual_Terminal.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** How many entries the reception journal can hold when it is allocated for the first time. */
+#define PERIPHERAL_UART_JOURNAL_INITIAL_ENTRIES_COUNT 256
+
+/** How many bits an asynchronous frame has (a start bit, 8 data bits and a stop bit, the 9-bit mode is not simulated). */
+#define PERIPHERAL_UART_FRAME_BITS_COUNT 10
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** A byte given to the firmware. */
+typedef struct
+{
+	unsigned long long Cycles_Count; //! The cycles count when the byte was moved to RCREG.
+	unsigned char Data; //! The received byte.
+} TPeripheralUARTJournalEntry;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** Tell whether the received bytes must be recorded. */
+static int Peripheral_UART_Is_Journal_Enabled = 0;
+/** All received bytes, sorted by cycles count. */
+static TPeripheralUARTJournalEntry *Pointer_Peripheral_UART_Journal = NULL;
+/** How many entries are stored in the journal. */
+static unsigned int Peripheral_UART_Journal_Entries_Count = 0;
+/** How many entries the journal can hold before being enlarged. */
+static unsigned int Peripheral_UART_Journal_Allocated_Entries_Count = 0;
+
+/** Tell whether the instructions being executed have already been executed once. */
+static int Peripheral_UART_Is_Replaying = 0;
+/** The last cycle that has already been executed once. */
+static unsigned long long Peripheral_UART_Replay_End_Cycle;
+/** The next journal entry to replay. */
+static unsigned int Peripheral_UART_Replay_Entry_Index;
+
+/** The instruction cycle at which the transmit shift register has sent its byte, 0 when it is empty. */
+static unsigned long long Peripheral_UART_Transmission_End_Cycle = 0;
+/** Tell whether a byte waits in TXREG for the transmit shift register. */
+static int Peripheral_UART_Is_TXREG_Full = 0;
+/** The byte waiting in TXREG. */
+static unsigned char Peripheral_UART_TXREG_Data;
+/** The first instruction cycle at which the next received byte can be moved to RCREG. */
+static unsigned long long Peripheral_UART_Reception_End_Cycle = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Compute how long a frame lasts at the programmed baud rate. The baud rate generator is clocked by the oscillator, so the frame duration in instruction cycles does not depend on the oscillator frequency.
+ * @param TXSTA_Register The TXSTA value selecting the high or low speed.
+ * @param SPBRG_Register The baud rate generator period.
+ * @return The frame duration in instruction cycles.
+ */
+static inline unsigned int PeripheralUARTGetFrameCycles(unsigned char TXSTA_Register, unsigned char SPBRG_Register)
+{
+	// An asynchronous bit lasts 16 (SPBRG + 1) oscillator periods in high speed and 64 (SPBRG + 1) in low speed, an instruction cycle lasts 4 oscillator periods
+	if (TXSTA_Register & REGISTER_FILE_REGISTER_BIT_TXSTA_BRGH) return PERIPHERAL_UART_FRAME_BITS_COUNT * 4 * (SPBRG_Register + 1);
+	return PERIPHERAL_UART_FRAME_BITS_COUNT * 16 * (SPBRG_Register + 1);
+}
+
+/** Load a byte to the transmit shift register and give it to the host.
+ * @param Data The byte to send.
+ * @param Frame_Cycles How many instruction cycles the transmission lasts.
+ */
+static void PeripheralUARTStartTransmission(unsigned char Data, unsigned int Frame_Cycles)
+{
+	Peripheral_UART_Transmission_End_Cycle = CoreGetCyclesCount() + Frame_Cycles;
+	
+	// The host has already received the bytes sent by replayed instructions
+	if (Peripheral_UART_Is_Replaying && (CoreGetCyclesCount() <= Peripheral_UART_Replay_End_Cycle)) return;
+	
+	// Send the transmitted data to the host channel
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_UART);
+	if (VirtualTerminalIsEnabled()) VirtualTerminalWriteByte(Data); // The virtual terminal sends the resulting screen changes itself
+	else UARTBackendWriteByte(Data);
+	INSTRUMENTATION_LEAVE();
+}
+
+/** Append a received byte to the journal.
+ * @param Data The received byte.
+ */
+static void PeripheralUARTRecordByte(unsigned char Data)
+{
+	TPeripheralUARTJournalEntry *Pointer_Journal;
+	unsigned int Entries_Count;
+	
+	// Make room for the new entry
+	if (Peripheral_UART_Journal_Entries_Count == Peripheral_UART_Journal_Allocated_Entries_Count)
+	{
+		if (Peripheral_UART_Journal_Allocated_Entries_Count == 0) Entries_Count = PERIPHERAL_UART_JOURNAL_INITIAL_ENTRIES_COUNT;
+		else Entries_Count = Peripheral_UART_Journal_Allocated_Entries_Count * 2;
+		
+		Pointer_Journal = realloc(Pointer_Peripheral_UART_Journal, Entries_Count * sizeof(TPeripheralUARTJournalEntry));
+		if (Pointer_Journal == NULL)
+		{
+			LOG(LOG_LEVEL_WARNING, "WARNING : failed to enlarge the UART reception journal, the received bytes will not be replayed when the program is executed backward.\n");
+			Peripheral_UART_Is_Journal_Enabled = 0;
+			return;
+		}
+		Pointer_Peripheral_UART_Journal = Pointer_Journal;
+		Peripheral_UART_Journal_Allocated_Entries_Count = Entries_Count;
+	}
+	
+	Pointer_Peripheral_UART_Journal[Peripheral_UART_Journal_Entries_Count].Cycles_Count = CoreGetCyclesCount();
+	Pointer_Peripheral_UART_Journal[Peripheral_UART_Journal_Entries_Count].Data = Data;
+	Peripheral_UART_Journal_Entries_Count++;
+}
+
+/** Find the first journal entry recorded after a cycle.
+ * @param Cycles_Count The cycle.
+ * @return The entry index (Peripheral_UART_Journal_Entries_Count if there is no such entry).
+ */
+static unsigned int PeripheralUARTFindJournalEntry(unsigned long long Cycles_Count)
+{
+	unsigned int Lower_Index = 0, Upper_Index = Peripheral_UART_Journal_Entries_Count, Middle_Index;
+	
+	while (Lower_Index < Upper_Index)
+	{
+		Middle_Index = (Lower_Index + Upper_Index) / 2;
+		if (Pointer_Peripheral_UART_Journal[Middle_Index].Cycles_Count <= Cycles_Count) Lower_Index = Middle_Index + 1;
+		else Upper_Index = Middle_Index;
+	}
+	return Lower_Index;
+}
+
+/** Give the firmware the bytes it received the first time the current instructions were executed.
+ * @return 0 if all recorded instructions have been executed again, so bytes can be received from the UART backend,
+ * @return 1 if the replay is still in progress.
+ */
+static int PeripheralUARTReplayJournal(void)
+{
+	unsigned long long Cycles_Count;
+	TPeripheralUARTJournalEntry *Pointer_Entry;
+	unsigned char PIR1_Register;
+	
+	Cycles_Count = CoreGetCyclesCount();
+	if (Cycles_Count > Peripheral_UART_Replay_End_Cycle)
+	{
+		Peripheral_UART_Is_Replaying = 0;
+		LOG(LOG_LEVEL_DEBUG, "UART journal replay terminated.\n");
+		return 0;
+	}
+	
+	if (Peripheral_UART_Replay_Entry_Index >= Peripheral_UART_Journal_Entries_Count) return 1;
+	Pointer_Entry = &Pointer_Peripheral_UART_Journal[Peripheral_UART_Replay_Entry_Index];
+	if (Pointer_Entry->Cycles_Count != Cycles_Count) return 1;
+	Peripheral_UART_Replay_Entry_Index++;
+	
+	// Time the reception like the live path does, so the first byte received after the replay ends is not too close to the last replayed one
+	Peripheral_UART_Reception_End_Cycle = Cycles_Count + PeripheralUARTGetFrameCycles(RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_TXSTA, REGISTER_FILE_REGISTER_ADDRESS_TXSTA), RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_SPBRG, REGISTER_FILE_REGISTER_ADDRESS_SPBRG));
+	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_RCREG, REGISTER_FILE_REGISTER_ADDRESS_RCREG, Pointer_Entry->Data);
+	PIR1_Register = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1);
+	PIR1_Register |= REGISTER_FILE_REGISTER_BIT_PIR1_RCIF;
+	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1, PIR1_Register);
+	return 1;
+}
 
 //-------------------------------------------------------------------------------------------------
 // Public functions
@@ -24,9 +188,23 @@ unsigned char PeripheralUARTReadRCREG(TRegisterFileRegisterContent *Pointer_Cont
 
 void PeripheralUARTWriteTXREG(TRegisterFileRegisterContent __attribute__((unused)) *Pointer_Content, unsigned char Data)
 {
-	// Display the transmitted data (no need to clear and set the TXIF flag because the write operation will block the instruction execution flow, just let TXIF set)
-	putchar(Data);
-	fflush(stdout);
+	unsigned char PIR1_Register;
+	
+	// The byte immediately goes to the empty transmit shift register, so TXREG stays empty and TXIF stays set
+	if (Peripheral_UART_Transmission_End_Cycle == 0)
+	{
+		PeripheralUARTStartTransmission(Data, PeripheralUARTGetFrameCycles(RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_TXSTA, REGISTER_FILE_REGISTER_ADDRESS_TXSTA), RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_SPBRG, REGISTER_FILE_REGISTER_ADDRESS_SPBRG)));
+		return;
+	}
+	
+	// Otherwise the byte waits in TXREG until the current byte is sent, like the real UART a byte already waiting is overwritten
+	if (Peripheral_UART_Is_TXREG_Full) LOG(LOG_LEVEL_WARNING, "WARNING : TXREG was written while full, the byte 0x%02X it contained is lost.\n", Peripheral_UART_TXREG_Data);
+	Peripheral_UART_TXREG_Data = Data;
+	Peripheral_UART_Is_TXREG_Full = 1;
+	
+	PIR1_Register = RegisterFileDirectReadFromCallback(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1);
+	PIR1_Register &= ~REGISTER_FILE_REGISTER_BIT_PIR1_TXIF;
+	RegisterFileDirectWriteFromCallback(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1, PIR1_Register);
 }
 
 void PeripheralUARTWriteTXSTA(TRegisterFileRegisterContent *Pointer_Content, unsigned char Data)
@@ -44,18 +222,103 @@ void PeripheralUARTWriteTXSTA(TRegisterFileRegisterContent *Pointer_Content, uns
 	Pointer_Content->Data = Data;
 }
 
-void PeripheralUARTReceiveByte(unsigned char Data)
+void PeripheralUARTUpdate(void)
 {
-	unsigned char PIR1_Register;
+	unsigned char PIR1_Register, Data;
+	unsigned long long Cycles_Count;
+	
+	// The transmit shift register has sent its byte, load the byte waiting in TXREG if any (this must be done during replays too, so TXIF is set at the same cycles)
+	Cycles_Count = CoreGetCyclesCount();
+	if ((Peripheral_UART_Transmission_End_Cycle != 0) && (Cycles_Count >= Peripheral_UART_Transmission_End_Cycle))
+	{
+		if (Peripheral_UART_Is_TXREG_Full)
+		{
+			Peripheral_UART_Is_TXREG_Full = 0;
+			PeripheralUARTStartTransmission(Peripheral_UART_TXREG_Data, PeripheralUARTGetFrameCycles(RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_TXSTA, REGISTER_FILE_REGISTER_ADDRESS_TXSTA), RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_SPBRG, REGISTER_FILE_REGISTER_ADDRESS_SPBRG)));
+			
+			PIR1_Register = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1);
+			PIR1_Register |= REGISTER_FILE_REGISTER_BIT_PIR1_TXIF;
+			RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1, PIR1_Register);
+		}
+		else Peripheral_UART_Transmission_End_Cycle = 0;
+	}
 	
+	// Receive the same bytes at the same cycles than the first time the instructions were executed, the backend bytes wait meanwhile
+	if (Peripheral_UART_Is_Replaying && PeripheralUARTReplayJournal()) return;
+	
+	// Nothing to do most of the time
+	if (!UARTBackendIsReceivedDataAvailable()) return;
+	
+	// A byte can't be received faster than the baud rate allows
+	if (Cycles_Count < Peripheral_UART_Reception_End_Cycle) return;
+	
+	// Keep the byte in the reception queue until the firmware has read the previous one, so no data is lost
+	PIR1_Register = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1);
+	if (PIR1_Register & REGISTER_FILE_REGISTER_BIT_PIR1_RCIF) return;
+	
+	if (UARTBackendReadByte(&Data) != 0) return;
 	LOG(LOG_LEVEL_DEBUG, "Received byte '0x%02X' from UART.\n", Data);
+	Peripheral_UART_Reception_End_Cycle = Cycles_Count + PeripheralUARTGetFrameCycles(RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_TXSTA, REGISTER_FILE_REGISTER_ADDRESS_TXSTA), RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_SPBRG, REGISTER_FILE_REGISTER_ADDRESS_SPBRG));
+	if (Peripheral_UART_Is_Journal_Enabled) PeripheralUARTRecordByte(Data);
 	
 	// Fill RCREG register
 	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_RCREG, REGISTER_FILE_REGISTER_ADDRESS_RCREG, Data);
 	
-	// Set RCIF flag
-	// TODO atomic access for the PIR register during read-modify-write operation
-	PIR1_Register = RegisterFileDirectRead(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1);
+	// Set RCIF flag (only the CPU thread modifies PIR1, so the read-modify-write operation is safe)
 	PIR1_Register |= REGISTER_FILE_REGISTER_BIT_PIR1_RCIF;
 	RegisterFileDirectWrite(REGISTER_FILE_REGISTER_BANK_PIR1, REGISTER_FILE_REGISTER_ADDRESS_PIR1, PIR1_Register);
 }
+
+void PeripheralUARTEnableJournal(void)
+{
+	Peripheral_UART_Is_Journal_Enabled = 1;
+}
+
+void PeripheralUARTStartReplay(unsigned long long Cycles_Count, unsigned long long Replay_End_Cycle)
+{
+	if (Replay_End_Cycle <= Cycles_Count)
+	{
+		Peripheral_UART_Is_Replaying = 0;
+		return;
+	}
+	
+	Peripheral_UART_Replay_Entry_Index = PeripheralUARTFindJournalEntry(Cycles_Count);
+	Peripheral_UART_Replay_End_Cycle = Replay_End_Cycle;
+	Peripheral_UART_Is_Replaying = 1;
+}
+
+void PeripheralUARTForgetJournal(unsigned long long Cycles_Count)
+{
+	unsigned int Removed_Entries_Count;
+	
+	// Remove the entries recorded up to the provided cycle
+	Removed_Entries_Count = PeripheralUARTFindJournalEntry(Cycles_Count);
+	if (Removed_Entries_Count == 0) return;
+	
+	Peripheral_UART_Journal_Entries_Count -= Removed_Entries_Count;
+	memmove(Pointer_Peripheral_UART_Journal, &Pointer_Peripheral_UART_Journal[Removed_Entries_Count], Peripheral_UART_Journal_Entries_Count * sizeof(TPeripheralUARTJournalEntry));
+	if (Peripheral_UART_Replay_Entry_Index >= Removed_Entries_Count) Peripheral_UART_Replay_Entry_Index -= Removed_Entries_Count;
+	else Peripheral_UART_Replay_Entry_Index = 0;
+}
+
+void PeripheralUARTTruncateJournal(unsigned long long Cycles_Count)
+{
+	Peripheral_UART_Journal_Entries_Count = PeripheralUARTFindJournalEntry(Cycles_Count);
+	Peripheral_UART_Is_Replaying = 0;
+}
+
+void PeripheralUARTSaveSnapshot(TPeripheralUARTSnapshot *Pointer_Snapshot)
+{
+	Pointer_Snapshot->Transmission_End_Cycle = Peripheral_UART_Transmission_End_Cycle;
+	Pointer_Snapshot->Is_TXREG_Full = Peripheral_UART_Is_TXREG_Full;
+	Pointer_Snapshot->TXREG_Data = Peripheral_UART_TXREG_Data;
+	Pointer_Snapshot->Reception_End_Cycle = Peripheral_UART_Reception_End_Cycle;
+}
+
+void PeripheralUARTRestoreSnapshot(const TPeripheralUARTSnapshot *Pointer_Snapshot)
+{
+	Peripheral_UART_Transmission_End_Cycle = Pointer_Snapshot->Transmission_End_Cycle;
+	Peripheral_UART_Is_TXREG_Full = Pointer_Snapshot->Is_TXREG_Full;
+	Peripheral_UART_TXREG_Data = Pointer_Snapshot->TXREG_Data;
+	Peripheral_UART_Reception_End_Cycle = Pointer_Snapshot->Reception_End_Cycle;
+}
@@ -2,92 +2,367 @@
  * @see Program_Memory.h for description.
  * @author Adrien RICCIARDI
  */
+#include <errno.h>
+#include <fcntl.h>
 #include <Hex_Parser.h>
+#include <limits.h>
 #include <Log.h>
 #include <Program_Memory.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** The string appended to the hex file name to build the program image file name. */
+#define PROGRAM_MEMORY_IMAGE_FILE_EXTENSION ".image"
+
+/** Identify a program image file and its format version. */
+#define PROGRAM_MEMORY_IMAGE_MAGIC "PICIMG01"
+
+/** The configuration word address. */
+#define PROGRAM_MEMORY_CONFIGURATION_WORD_ADDRESS 0x2007
+
+/** FNV-1a 64-bit hash initial value. */
+#define PROGRAM_MEMORY_HASH_OFFSET_BASIS 0xCBF29CE484222325ULL
+/** FNV-1a 64-bit hash prime. */
+#define PROGRAM_MEMORY_HASH_PRIME 0x100000001B3ULL
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** A program image file content. It is stored with the host endianness because it is only a cache of the hex file. */
+typedef struct
+{
+	char Magic[8]; //! Must be PROGRAM_MEMORY_IMAGE_MAGIC (without the terminating zero).
+	unsigned long long Hex_File_Hash; //! The hash of the hex file content this image has been generated from.
+	unsigned short Configuration_Word; //! The configuration word found in the hex file.
+	unsigned short Reserved[3]; //! Keep the program words aligned on 8 bytes.
+	unsigned short Program_Memory[PROGRAM_MEMORY_SIZE]; //! The program memory content.
+} TProgramMemoryImage;
 
 //-------------------------------------------------------------------------------------------------
 // Private variables
 //-------------------------------------------------------------------------------------------------
-/** The program memory. */
-static unsigned short Program_Memory[PROGRAM_MEMORY_SIZE];
+/** The program memory storage used when the program image can't be mapped. */
+static TProgramMemoryImage Program_Memory_Image;
+
+/** Where a reloaded hex file is parsed, so the program in use is kept when the new hex file is corrupted. */
+static TProgramMemoryImage Program_Memory_Reloaded_Image;
+
+/** The program image in use, it is either mapped from the program image file or Program_Memory_Image. */
+static TProgramMemoryImage *Pointer_Program_Memory_Image = &Program_Memory_Image;
 
 //-------------------------------------------------------------------------------------------------
-// Public functions
+// Private functions
 //-------------------------------------------------------------------------------------------------
-unsigned short ProgramMemoryRead(unsigned short Address)
+/** Compute the FNV-1a hash of a buffer.
+ * @param Pointer_Buffer The data to hash.
+ * @param Size The data size in bytes.
+ * @return The 64-bit hash.
+ */
+static unsigned long long ProgramMemoryComputeHash(const unsigned char *Pointer_Buffer, size_t Size)
 {
-	if (Address >= PROGRAM_MEMORY_SIZE)
+	unsigned long long Hash = PROGRAM_MEMORY_HASH_OFFSET_BASIS;
+	size_t i;
+	
+	for (i = 0; i < Size; i++)
 	{
-		LOG(LOG_LEVEL_WARNING, "WARNING : the requested address (0x%04X) is out of program memory bounds.\n", Address);
-		return 0x3FFF; // Empty flash location
+		Hash ^= Pointer_Buffer[i];
+		Hash *= PROGRAM_MEMORY_HASH_PRIME;
 	}
-	
-	return Program_Memory[Address];
+	return Hash;
 }
 
-int ProgramMemoryLoadHexFile(char *String_Hex_File)
+/** Map the program image file if it has been generated from the provided hex file content.
+ * @param String_Image_File The program image file.
+ * @param Hex_File_Hash The hex file content hash.
+ * @return The mapped image (private to this process, so it can be modified without altering the file),
+ * @return NULL if the image does not exist or is outdated.
+ */
+static TProgramMemoryImage *ProgramMemoryMapImageFile(char *String_Image_File, unsigned long long Hex_File_Hash)
 {
-	FILE *Pointer_File;
-	char String_Line[256];
-	int Instructions_Count, i, Return_Value = 1;
-	THexParserInstruction Instructions[HEX_PARSER_MAXIMUM_INSTRUCTIONS_PER_LINE];
-
-	// Try to open the file
-	Pointer_File = fopen(String_Hex_File, "r");
-	if (Pointer_File == NULL)
+	int File_Descriptor;
+	struct stat File_Status;
+	TProgramMemoryImage *Pointer_Image = NULL;
+	
+	File_Descriptor = open(String_Image_File, O_RDONLY);
+	if (File_Descriptor == -1) return NULL;
+	
+	// Make sure the whole image can be accessed before mapping it
+	if ((fstat(File_Descriptor, &File_Status) == -1) || (File_Status.st_size != sizeof(TProgramMemoryImage))) goto Exit;
+	
+	Pointer_Image = mmap(NULL, sizeof(TProgramMemoryImage), PROT_READ | PROT_WRITE, MAP_PRIVATE, File_Descriptor, 0);
+	if (Pointer_Image == MAP_FAILED)
 	{
-		LOG(LOG_LEVEL_ERROR, "ERROR : failed to open the file '%s'.\n", String_Hex_File);
+		Pointer_Image = NULL;
 		goto Exit;
 	}
-	LOG(LOG_LEVEL_DEBUG, "Loading '%s' hex file content...\n", String_Hex_File);
+	
+	// Discard the image if it is not matching the hex file
+	if ((memcmp(Pointer_Image->Magic, PROGRAM_MEMORY_IMAGE_MAGIC, sizeof(Pointer_Image->Magic)) != 0) || (Pointer_Image->Hex_File_Hash != Hex_File_Hash))
+	{
+		munmap(Pointer_Image, sizeof(TProgramMemoryImage));
+		Pointer_Image = NULL;
+	}
+	
+Exit:
+	close(File_Descriptor);
+	return Pointer_Image;
+}
+
+/** Store the program image to a file, the file is atomically replaced so other simulator instances can map it at any time.
+ * @param String_Image_File The program image file.
+ * @param Pointer_Image The image to store.
+ * @return 0 if the file was successfully written,
+ * @return 1 if an error occurred.
+ */
+static int ProgramMemoryStoreImageFile(char *String_Image_File, TProgramMemoryImage *Pointer_Image)
+{
+	char String_Temporary_File[PATH_MAX];
+	int File_Descriptor, Return_Value = 1;
+	
+	// Write the image to a temporary file in the same directory to be able to rename it
+	if (snprintf(String_Temporary_File, sizeof(String_Temporary_File), "%s.XXXXXX", String_Image_File) >= (int) sizeof(String_Temporary_File)) return 1;
+	File_Descriptor = mkstemp(String_Temporary_File);
+	if (File_Descriptor == -1) return 1;
+	
+	if (write(File_Descriptor, Pointer_Image, sizeof(TProgramMemoryImage)) != sizeof(TProgramMemoryImage)) goto Exit;
+	if (fchmod(File_Descriptor, 0644) == -1) goto Exit;
+	if (rename(String_Temporary_File, String_Image_File) == -1) goto Exit;
+	Return_Value = 0;
+	
+Exit:
+	close(File_Descriptor);
+	if (Return_Value != 0) unlink(String_Temporary_File);
+	return Return_Value;
+}
 
-	// Read the file data and convert it to binary instructions
+/** Convert the hex file content to a program image.
+ * @param Pointer_File_Content The hex file content.
+ * @param File_Size The hex file size in bytes.
+ * @param Pointer_Image On output, contain the program memory content and the configuration word.
+ * @return 0 if the file was successfully parsed,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+static int ProgramMemoryParseHexFile(char *Pointer_File_Content, size_t File_Size, TProgramMemoryImage *Pointer_Image)
+{
+	int Instructions_Count, Record_Length, i;
+	size_t Offset = 0;
+	unsigned int Base_Address = 0;
+	THexParserInstruction Instructions[HEX_PARSER_MAXIMUM_INSTRUCTIONS_PER_LINE];
+	
+	// Convert the file data to binary instructions
 	while (1)
 	{
+		// Skip the line endings and the blank characters between records
+		while ((Offset < File_Size) && ((Pointer_File_Content[Offset] == '\n') || (Pointer_File_Content[Offset] == '\r') || (Pointer_File_Content[Offset] == ' ') || (Pointer_File_Content[Offset] == '\t'))) Offset++;
+		
 		// Get the next hex record
-		if (fgets(String_Line, sizeof(String_Line), Pointer_File) == NULL)
+		if (Offset >= File_Size)
 		{
 			LOG(LOG_LEVEL_ERROR, "ERROR : reached the hex file end without finding an end-of-file record.\n");
-			goto Exit;
+			return 1;
 		}
-		LOG(LOG_LEVEL_DEBUG, "Read hex record : %s", String_Line); // No need to append a newline character because the read line already has it
 
 		// Convert it to binary
-		Instructions_Count = HexParserDecodeLine(String_Line, Instructions);
+		Record_Length = HexParserDecodeRecord(&Pointer_File_Content[Offset], File_Size - Offset, &Base_Address, Instructions, &Instructions_Count);
+		if (Record_Length < 0)
+		{
+			LOG(LOG_LEVEL_ERROR, "ERROR : bad hex record at file offset %zu, refusing to load a corrupted program.\n", Offset);
+			return 1;
+		}
+		LOG(LOG_LEVEL_DEBUG, "Read hex record : %.*s\n", Record_Length, &Pointer_File_Content[Offset]);
 		LOG(LOG_LEVEL_DEBUG, "Found %d instructions in record.\n", Instructions_Count);
+		Offset += Record_Length;
 
 		// Process all instructions
 		for (i = 0; i < Instructions_Count; i++)
 		{
 			// Is the end of the file reached ?
-			if (Instructions[i].Is_End_Of_File)
-			{
-				LOG(LOG_LEVEL_DEBUG, "Hex file successfully loaded.\n");
-				Return_Value = 0;
-				goto Exit;
-			}
+			if (Instructions[i].Is_End_Of_File) return 0;
 
 			// Is the instruction valid ?
 			if (!Instructions[i].Is_Instruction_Valid) continue;
 			
-			// Discard the configuration word
-			if (Instructions[i].Address == 0x2007) continue;
+			// Keep the configuration word apart
+			if (Instructions[i].Address == PROGRAM_MEMORY_CONFIGURATION_WORD_ADDRESS)
+			{
+				Pointer_Image->Configuration_Word = Instructions[i].Code;
+				continue;
+			}
 			
 			// Does the instruction address fit in the memory ?
 			if (Instructions[i].Address >= PROGRAM_MEMORY_SIZE)
 			{
 				LOG(LOG_LEVEL_ERROR, "ERROR : the instruction address (0x%04X) is crossing the program memory bounds.\n", Instructions[i].Address);
-				goto Exit;
+				return 1;
 			}
 
 			// Store the instruction in the memory
-			Program_Memory[Instructions[i].Address] = Instructions[i].Code;
+			Pointer_Image->Program_Memory[Instructions[i].Address] = Instructions[i].Code;
 		}
 	}
+}
+
+/** Load an Intel Hex file content to a program image, or map the up-to-date program image file. The program in use is not modified.
+ * @param String_Hex_File The file to load.
+ * @param Pointer_Parsing_Image Where to parse the hex file when no up-to-date program image file can be mapped.
+ * @param Pointer_Pointer_Loaded_Image On output, contain either the mapped program image or Pointer_Parsing_Image.
+ * @param Is_Image_File_Written Set to 1 to store the parsed hex file to the program image file, set to 0 to leave the hex file directory untouched.
+ * @return 0 if the file was successfully loaded,
+ * @return 1 if an error occurred. See logs for more information.
+ */
+static int ProgramMemoryLoadImage(char *String_Hex_File, TProgramMemoryImage *Pointer_Parsing_Image, TProgramMemoryImage **Pointer_Pointer_Loaded_Image, int Is_Image_File_Written)
+{
+	int File_Descriptor, Return_Value = 1;
+	char *Pointer_File_Content = MAP_FAILED, String_Image_File[PATH_MAX];
+	size_t File_Size = 0;
+	struct stat File_Status;
+	unsigned long long Hash;
+	TProgramMemoryImage *Pointer_Image;
+
+	// Try to open the file
+	File_Descriptor = open(String_Hex_File, O_RDONLY);
+	if (File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : failed to open the file '%s' (%s).\n", String_Hex_File, strerror(errno));
+		goto Exit;
+	}
+	LOG(LOG_LEVEL_DEBUG, "Loading '%s' hex file content...\n", String_Hex_File);
+	
+	// Map the whole file to parse it in a single pass without copying it
+	if (fstat(File_Descriptor, &File_Status) == -1)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : failed to retrieve the hex file size (%s).\n", strerror(errno));
+		goto Exit;
+	}
+	File_Size = File_Status.st_size;
+	if (File_Size == 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : the hex file is empty.\n");
+		goto Exit;
+	}
+	Pointer_File_Content = mmap(NULL, File_Size, PROT_READ, MAP_PRIVATE, File_Descriptor, 0);
+	if (Pointer_File_Content == MAP_FAILED)
+	{
+		LOG(LOG_LEVEL_ERROR, "ERROR : failed to map the hex file to memory (%s).\n", strerror(errno));
+		goto Exit;
+	}
+	madvise(Pointer_File_Content, File_Size, MADV_SEQUENTIAL);
+	
+	// Use the program image generated by a previous run if the hex file did not change since
+	Hash = ProgramMemoryComputeHash((unsigned char *) Pointer_File_Content, File_Size);
+	if (snprintf(String_Image_File, sizeof(String_Image_File), "%s" PROGRAM_MEMORY_IMAGE_FILE_EXTENSION, String_Hex_File) >= (int) sizeof(String_Image_File)) String_Image_File[0] = 0; // Do not use a truncated file name
+	if (String_Image_File[0] != 0)
+	{
+		Pointer_Image = ProgramMemoryMapImageFile(String_Image_File, Hash);
+		if (Pointer_Image != NULL)
+		{
+			*Pointer_Pointer_Loaded_Image = Pointer_Image;
+			LOG(LOG_LEVEL_DEBUG, "Mapped up-to-date program image '%s'.\n", String_Image_File);
+			Return_Value = 0;
+			goto Exit;
+		}
+	}
+	
+	// Parse the hex file
+	memset(Pointer_Parsing_Image, 0, sizeof(TProgramMemoryImage));
+	memcpy(Pointer_Parsing_Image->Magic, PROGRAM_MEMORY_IMAGE_MAGIC, sizeof(Pointer_Parsing_Image->Magic));
+	Pointer_Parsing_Image->Hex_File_Hash = Hash;
+	Pointer_Parsing_Image->Configuration_Word = 0x3FFF; // Unprogrammed configuration word
+	if (ProgramMemoryParseHexFile(Pointer_File_Content, File_Size, Pointer_Parsing_Image) != 0) goto Exit;
+	LOG(LOG_LEVEL_DEBUG, "Hex file successfully loaded.\n");
+	
+	// Cache the result for the next runs, this is not mandatory for the simulation so only warn on failure
+	if (Is_Image_File_Written && (String_Image_File[0] != 0) && (ProgramMemoryStoreImageFile(String_Image_File, Pointer_Parsing_Image) != 0)) LOG(LOG_LEVEL_WARNING, "WARNING : could not write the program image file '%s'.\n", String_Image_File);
+	*Pointer_Pointer_Loaded_Image = Pointer_Parsing_Image;
+	Return_Value = 0;
 
 Exit:
-	if (Pointer_File != NULL) fclose(Pointer_File);
+	if (Pointer_File_Content != MAP_FAILED) munmap(Pointer_File_Content, File_Size);
+	if (File_Descriptor != -1) close(File_Descriptor);
 	return Return_Value;
 }
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+unsigned short ProgramMemoryRead(unsigned short Address)
+{
+	if (Address >= PROGRAM_MEMORY_SIZE)
+	{
+		LOG(LOG_LEVEL_WARNING, "WARNING : the requested address (0x%04X) is out of program memory bounds.\n", Address);
+		return 0x3FFF; // Empty flash location
+	}
+	
+	return Pointer_Program_Memory_Image->Program_Memory[Address];
+}
+
+void ProgramMemoryWrite(unsigned short Address, unsigned short Data)
+{
+	if (Address >= PROGRAM_MEMORY_SIZE)
+	{
+		LOG(LOG_LEVEL_WARNING, "WARNING : the requested address (0x%04X) is out of program memory bounds.\n", Address);
+		return;
+	}
+	
+	// The program image is privately mapped, so the program image file is not modified
+	Pointer_Program_Memory_Image->Program_Memory[Address] = Data & 0x3FFF;
+}
+
+void ProgramMemorySaveSnapshot(unsigned short *Pointer_Buffer)
+{
+	memcpy(Pointer_Buffer, Pointer_Program_Memory_Image->Program_Memory, sizeof(Pointer_Program_Memory_Image->Program_Memory));
+}
+
+void ProgramMemoryRestoreSnapshot(const unsigned short *Pointer_Buffer)
+{
+	unsigned short Address;
+	
+	// Self-programming rarely modifies more than a few words, go through the single modification entry point for them
+	for (Address = 0; Address < PROGRAM_MEMORY_SIZE; Address++)
+	{
+		if (Pointer_Program_Memory_Image->Program_Memory[Address] != Pointer_Buffer[Address]) ProgramMemoryWrite(Address, Pointer_Buffer[Address]);
+	}
+}
+
+unsigned short ProgramMemoryGetConfigurationWord(void)
+{
+	return Pointer_Program_Memory_Image->Configuration_Word;
+}
+
+unsigned long long ProgramMemoryGetHexFileHash(void)
+{
+	return Pointer_Program_Memory_Image->Hex_File_Hash;
+}
+
+int ProgramMemoryLoadHexFile(char *String_Hex_File, int Is_Image_File_Written)
+{
+	return ProgramMemoryLoadImage(String_Hex_File, &Program_Memory_Image, &Pointer_Program_Memory_Image, Is_Image_File_Written);
+}
+
+int ProgramMemoryReloadHexFile(char *String_Hex_File)
+{
+	TProgramMemoryImage *Pointer_Image;
+	
+	// Keep executing the current program if the new one can't be loaded
+	if (ProgramMemoryLoadImage(String_Hex_File, &Program_Memory_Reloaded_Image, &Pointer_Image, 1) != 0) return 1;
+	
+	// Release the previous program image
+	if (Pointer_Program_Memory_Image != &Program_Memory_Image) munmap(Pointer_Program_Memory_Image, sizeof(TProgramMemoryImage));
+	
+	// Always parse the next reloaded hex file to an image that is not in use
+	if (Pointer_Image == &Program_Memory_Reloaded_Image)
+	{
+		memcpy(&Program_Memory_Image, &Program_Memory_Reloaded_Image, sizeof(TProgramMemoryImage));
+		Pointer_Image = &Program_Memory_Image;
+	}
+	Pointer_Program_Memory_Image = Pointer_Image;
+	LOG(LOG_LEVEL_DEBUG, "Program memory content replaced by '%s' hex file content.\n", String_Hex_File);
+	return 0;
+}
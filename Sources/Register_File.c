@@ -2,13 +2,19 @@
  * @see Register_File.h for description.
  * @author Adrien RICCIARDI
  */
+#include <Core.h>
+#include <Instrumentation.h>
+#include <Interrupt_Controller.h>
 #include <Log.h>
 #include <Peripheral_ADC.h>
 #include <Peripheral_I2C_EEPROM.h>
+#include <Peripheral_Memory_Access.h>
+#include <Peripheral_Timer.h>
 #include <Peripheral_UART.h>
 #include <pthread.h>
 #include <Register_File.h>
 #include <stdlib.h>
+#include <Watchpoint.h>
 
 //-------------------------------------------------------------------------------------------------
 // Private types
@@ -42,6 +48,11 @@ static TRegisterFileRegister Register_File[REGISTER_FILE_BANKS_COUNT][REGISTER_F
 /** Protect register file content from concurrent accesses. */
 static pthread_mutex_t Register_File_Mutex_Concurrent_Access = PTHREAD_MUTEX_INITIALIZER;
 
+/** Tell which locations accesses must be reported to the watchpoints, one bit per location. The INDF bits are set as soon as a location is hooked, because INDF can reach any location. */
+static unsigned char Register_File_Access_Hooks_Bitmap[REGISTER_FILE_LOCATIONS_COUNT / 8];
+/** How many physical locations are hooked. */
+static unsigned int Register_File_Hooked_Locations_Count = 0;
+
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
@@ -81,48 +92,73 @@ static void RegisterFileRemappedRAMWrite(TRegisterFileRegisterContent *Pointer_C
 	*(Pointer_Content->Pointer_Data) = Data;
 }
 
+/** Get PCL value from the core program counter.
+ * @param Pointer_Content Not used here.
+ * @return The program counter low byte.
+ */
+static unsigned char RegisterFilePCLRead(TRegisterFileRegisterContent __attribute__((unused)) *Pointer_Content)
+{
+	return (unsigned char) CoreGetProgramCounter();
+}
+
 /** Read the register pointed by the FSR register and the IRP bit.
  * @param Pointer_Content Not used here.
  * @return The target register data.
  */
-static unsigned char RegisterFileIndirectRead(TRegisterFileRegisterContent __attribute__((unused)) *Pointer_Content)
+static unsigned char RegisterFileIndirectAccessRead(TRegisterFileRegisterContent __attribute__((unused)) *Pointer_Content)
 {
-	unsigned char Bank, Address;
-	
-	// Get IRP bit value
-	Bank = (Register_File[REGISTER_FILE_REGISTER_BANK_STATUS][REGISTER_FILE_REGISTER_ADDRESS_STATUS].Content.Data & REGISTER_FILE_REGISTER_BIT_STATUS_IRP) >> 6; // Set the bank high bit
-	
-	// Get the register address from FSR
-	Address = Register_File[REGISTER_FILE_REGISTER_BANK_FSR][REGISTER_FILE_REGISTER_ADDRESS_FSR].Content.Data;
-	
-	// The FSR most significant bit is the bank number least significant bit
-	Bank |= (Address >> 7) & 0x01;
-	Address &= 0x7F; // Remove the most significant bit
+	TRegisterFileRegister *Pointer_Register;
 	
-	// Get the pointed register value
-	return Register_File[Bank][Address].Content.Data;
+	// The pointed register is read like a direct access would, so mirrors and peripheral registers behave the same
+	Pointer_Register = &Register_File[0][0] + RegisterFileGetIndirectLocation();
+	if (Pointer_Register->ReadCallback == RegisterFileIndirectAccessRead) return 0; // Reading INDF itself indirectly gives 0
+	return Pointer_Register->ReadCallback(&Pointer_Register->Content);
 }
 
-/** Write data to the register pointed bu FSR register and the IRP bit.
- * @param Pointer_Content The physical register to write data to.
+/** Write data to the register pointed by the FSR register and the IRP bit.
+ * @param Pointer_Content Not used here.
  * @param Data The data to write to the pointed register.
  */
-static void RegisterFileIndirectWrite(TRegisterFileRegisterContent __attribute__((unused)) *Pointer_Content, unsigned char Data)
+static void RegisterFileIndirectAccessWrite(TRegisterFileRegisterContent __attribute__((unused)) *Pointer_Content, unsigned char Data)
 {
-	unsigned char Bank, Address;
-	
-	// Get IRP bit value
-	Bank = (Register_File[REGISTER_FILE_REGISTER_BANK_STATUS][REGISTER_FILE_REGISTER_ADDRESS_STATUS].Content.Data & REGISTER_FILE_REGISTER_BIT_STATUS_IRP) >> 6; // Set the bank high bit
+	TRegisterFileRegister *Pointer_Register;
 	
-	// Get the register address from FSR
-	Address = Register_File[REGISTER_FILE_REGISTER_BANK_FSR][REGISTER_FILE_REGISTER_ADDRESS_FSR].Content.Data;
+	// The pointed register callback takes care of the mirrors, the peripherals and the interrupt registers
+	Pointer_Register = &Register_File[0][0] + RegisterFileGetIndirectLocation();
+	if (Pointer_Register->WriteCallback == RegisterFileIndirectAccessWrite) return; // Writing INDF itself indirectly is a no operation
+	Pointer_Register->WriteCallback(&Pointer_Register->Content, Data);
+}
+
+/** Tell whether a location accesses must be reported.
+ * @param Location The location.
+ * @return 0 if the location is not hooked,
+ * @return 1 if the location is hooked.
+ */
+static inline int RegisterFileIsAccessHooked(unsigned int Location)
+{
+	return (Register_File_Access_Hooks_Bitmap[Location >> 3] >> (Location & 7)) & 1;
+}
+
+/** Report an access to a hooked location to the watchpoints. The register file mutex must be held.
+ * @param Bank The bank the program used.
+ * @param Address The address the program used.
+ * @param Is_Write Set to 1 if the location is written, set to 0 if it is read.
+ * @param Data The read or written data.
+ */
+static void RegisterFileReportAccess(unsigned int Bank, unsigned int Address, int Is_Write, unsigned char Data)
+{
+	unsigned int Location;
 	
-	// The FSR most significant bit is the bank number least significant bit
-	Bank |= (Address >> 7) & 0x01;
-	Address &= 0x7F; // Remove the most significant bit
+	// Find the register INDF points to
+	if (Address == REGISTER_FILE_REGISTER_ADDRESS_INDF)
+	{
+		Location = RegisterFileGetIndirectLocation();
+		Bank = Location / REGISTER_FILE_REGISTERS_IN_BANK_COUNT;
+		Address = Location % REGISTER_FILE_REGISTERS_IN_BANK_COUNT;
+	}
 	
-	// Write data to the pointed register
-	Register_File[Bank][Address].Content.Data = Data;
+	Location = RegisterFileGetPhysicalLocation(Bank, Address);
+	if (RegisterFileIsAccessHooked(Location)) WatchpointRecordAccess(Location, Is_Write, Data);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -149,17 +185,12 @@ void RegisterFileInitialize(void)
 	// Set INDF register special callback
 	for (Bank = 0; Bank < REGISTER_FILE_BANKS_COUNT; Bank++)
 	{
-		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_INDF].ReadCallback = RegisterFileIndirectRead;
-		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_INDF].WriteCallback = RegisterFileIndirectWrite;
+		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_INDF].ReadCallback = RegisterFileIndirectAccessRead;
+		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_INDF].WriteCallback = RegisterFileIndirectAccessWrite;
 	}
 	
-	// Remap PCL register data from bank 1 to 3 to bank 0
-	for (Bank = 1; Bank < REGISTER_FILE_BANKS_COUNT; Bank++)
-	{
-		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_PCL].Content.Pointer_Data = &Register_File[0][REGISTER_FILE_REGISTER_ADDRESS_PCL].Content.Data;
-		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_PCL].ReadCallback = RegisterFileRemappedRAMRead;
-		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_PCL].WriteCallback = RegisterFileRemappedRAMWrite;
-	}
+	// PCL is the program counter low byte, which is owned by the core (the core does not use the register file to access PCL)
+	for (Bank = 0; Bank < REGISTER_FILE_BANKS_COUNT; Bank++) Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_PCL].ReadCallback = RegisterFilePCLRead;
 	
 	// Set STATUS initial value
 	Register_File[0][REGISTER_FILE_REGISTER_ADDRESS_STATUS].Content.Data = 0x18;
@@ -192,9 +223,17 @@ void RegisterFileInitialize(void)
 	{
 		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_INTCON].Content.Pointer_Data = &Register_File[0][REGISTER_FILE_REGISTER_ADDRESS_INTCON].Content.Data;
 		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_INTCON].ReadCallback = RegisterFileRemappedRAMRead;
-		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_INTCON].WriteCallback = RegisterFileRemappedRAMWrite;
+		Register_File[Bank][REGISTER_FILE_REGISTER_ADDRESS_INTCON].WriteCallback = InterruptControllerWriteRemappedRegister;
 	}
 	
+	// Keep the pending interrupts up to date when an interrupt register is modified
+	Register_File[REGISTER_FILE_REGISTER_BANK_INTCON][REGISTER_FILE_REGISTER_ADDRESS_INTCON].WriteCallback = InterruptControllerWriteRegister;
+	Register_File[REGISTER_FILE_REGISTER_BANK_PIE1][REGISTER_FILE_REGISTER_ADDRESS_PIE1].WriteCallback = InterruptControllerWriteRegister;
+	Register_File[REGISTER_FILE_REGISTER_BANK_PIR1][REGISTER_FILE_REGISTER_ADDRESS_PIR1].WriteCallback = InterruptControllerWriteRegister;
+	Register_File[REGISTER_FILE_REGISTER_BANK_PIE2][REGISTER_FILE_REGISTER_ADDRESS_PIE2].WriteCallback = InterruptControllerWriteRegister;
+	Register_File[REGISTER_FILE_REGISTER_BANK_PIR2][REGISTER_FILE_REGISTER_ADDRESS_PIR2].WriteCallback = InterruptControllerWriteRegister;
+	InterruptControllerUpdate();
+	
 	//===============================================
 	// Configure remapped data access located at banks end
 	//===============================================
@@ -224,6 +263,13 @@ void RegisterFileInitialize(void)
 	Register_File[2][REGISTER_FILE_REGISTER_ADDRESS_TMR0].ReadCallback = RegisterFileRemappedRAMRead;
 	Register_File[2][REGISTER_FILE_REGISTER_ADDRESS_TMR0].WriteCallback = RegisterFileRemappedRAMWrite;
 	
+	// Timer 2 Period register is set on reset
+	Register_File[REGISTER_FILE_REGISTER_BANK_PR2][REGISTER_FILE_REGISTER_ADDRESS_PR2].Content.Data = 0xFF;
+	
+	// Writing the timer 2 registers clears its prescaler and postscaler
+	Register_File[REGISTER_FILE_REGISTER_BANK_TMR2][REGISTER_FILE_REGISTER_ADDRESS_TMR2].WriteCallback = PeripheralTimerWriteTMR2;
+	Register_File[REGISTER_FILE_REGISTER_BANK_T2CON][REGISTER_FILE_REGISTER_ADDRESS_T2CON].WriteCallback = PeripheralTimerWriteT2CON;
+	
 	// Remap OPTION_REG from bank 3 to bank 1
 	Register_File[3][REGISTER_FILE_REGISTER_ADDRESS_OPTION_REG].Content.Pointer_Data = &Register_File[1][REGISTER_FILE_REGISTER_ADDRESS_OPTION_REG].Content.Data;
 	Register_File[3][REGISTER_FILE_REGISTER_ADDRESS_OPTION_REG].ReadCallback = RegisterFileRemappedRAMRead;
@@ -238,8 +284,16 @@ void RegisterFileInitialize(void)
 	// Configure external I2C EEPROM registers
 	//===============================================
 	Register_File[REGISTER_FILE_REGISTER_BANK_SSPCON2][REGISTER_FILE_REGISTER_ADDRESS_SSPCON2].WriteCallback = PeripheralI2CEEPROMWriteSSPCON2;
+	Register_File[REGISTER_FILE_REGISTER_BANK_SSPBUF][REGISTER_FILE_REGISTER_ADDRESS_SSPBUF].ReadCallback = PeripheralI2CEEPROMReadSSPBUF;
 	Register_File[REGISTER_FILE_REGISTER_BANK_SSPBUF][REGISTER_FILE_REGISTER_ADDRESS_SSPBUF].WriteCallback = PeripheralI2CEEPROMWriteSSPBUF;
 	
+	//===============================================
+	// Configure data EEPROM and program memory access registers
+	//===============================================
+	Register_File[REGISTER_FILE_REGISTER_BANK_EECON1][REGISTER_FILE_REGISTER_ADDRESS_EECON1].WriteCallback = PeripheralMemoryAccessWriteEECON1;
+	Register_File[REGISTER_FILE_REGISTER_BANK_EECON2][REGISTER_FILE_REGISTER_ADDRESS_EECON2].ReadCallback = PeripheralMemoryAccessReadEECON2;
+	Register_File[REGISTER_FILE_REGISTER_BANK_EECON2][REGISTER_FILE_REGISTER_ADDRESS_EECON2].WriteCallback = PeripheralMemoryAccessWriteEECON2;
+	
 	// TODO fill needed peripheral special registers
 }
 
@@ -255,6 +309,7 @@ unsigned char RegisterFileBankedRead(unsigned int Address)
 		exit(EXIT_FAILURE);
 	}
 
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_REGISTER_FILE);
 	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
 
 	// Get the current bank number from STATUS register
@@ -264,8 +319,11 @@ unsigned char RegisterFileBankedRead(unsigned int Address)
 	Pointer_Register = &Register_File[Current_Bank][Address];
 	// Get the register content
 	Return_Value = Pointer_Register->ReadCallback(&Pointer_Register->Content);
+	// Only the watched locations pay for the watchpoints
+	if (RegisterFileIsAccessHooked(Current_Bank * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + Address)) RegisterFileReportAccess(Current_Bank, Address, 0, Return_Value);
 
 	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
+	INSTRUMENTATION_LEAVE();
 
 	return Return_Value;
 }
@@ -282,6 +340,7 @@ void RegisterFileBankedWrite(unsigned int Address, unsigned char Data)
 		exit(EXIT_FAILURE);
 	}
 
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_REGISTER_FILE);
 	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
 
 	// Get the current bank number from STATUS register
@@ -289,10 +348,66 @@ void RegisterFileBankedWrite(unsigned int Address, unsigned char Data)
 
 	// Get the required register
 	Pointer_Register = &Register_File[Current_Bank][Address];
+	// Report the access before writing, which could modify the register INDF points to
+	if (RegisterFileIsAccessHooked(Current_Bank * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + Address)) RegisterFileReportAccess(Current_Bank, Address, 1, Data);
 	// Set the register content
 	Pointer_Register->WriteCallback(&Pointer_Register->Content, Data);
 
 	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
+	INSTRUMENTATION_LEAVE();
+}
+
+unsigned int RegisterFileGetIndirectLocation(void)
+{
+	// IRP:FSR is a 9-bit address made of the bank number and the register address, so it is directly the location index
+	return ((Register_File[REGISTER_FILE_REGISTER_BANK_STATUS][REGISTER_FILE_REGISTER_ADDRESS_STATUS].Content.Data & REGISTER_FILE_REGISTER_BIT_STATUS_IRP) << 1) | Register_File[REGISTER_FILE_REGISTER_BANK_FSR][REGISTER_FILE_REGISTER_ADDRESS_FSR].Content.Data;
+}
+
+unsigned char RegisterFileIndirectRead(void)
+{
+	unsigned int Location;
+	TRegisterFileRegister *Pointer_Register;
+	unsigned char Data;
+	
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_REGISTER_FILE);
+	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
+	
+	// IRP:FSR can't address a non-existing location, so there is nothing to check
+	Location = RegisterFileGetIndirectLocation();
+	Pointer_Register = &Register_File[0][0] + Location;
+	if (Pointer_Register->ReadCallback == RegisterFileIndirectAccessRead) Data = 0; // Reading INDF itself indirectly gives 0
+	else
+	{
+		Data = Pointer_Register->ReadCallback(&Pointer_Register->Content);
+		if (RegisterFileIsAccessHooked(Location)) RegisterFileReportAccess(Location / REGISTER_FILE_REGISTERS_IN_BANK_COUNT, Location % REGISTER_FILE_REGISTERS_IN_BANK_COUNT, 0, Data);
+	}
+	
+	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
+	INSTRUMENTATION_LEAVE();
+	
+	return Data;
+}
+
+void RegisterFileIndirectWrite(unsigned char Data)
+{
+	unsigned int Location;
+	TRegisterFileRegister *Pointer_Register;
+	
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_REGISTER_FILE);
+	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
+	
+	// Writing INDF itself indirectly is a no operation
+	Location = RegisterFileGetIndirectLocation();
+	Pointer_Register = &Register_File[0][0] + Location;
+	if (Pointer_Register->WriteCallback != RegisterFileIndirectAccessWrite)
+	{
+		// Report the access before writing, like RegisterFileBankedWrite() does
+		if (RegisterFileIsAccessHooked(Location)) RegisterFileReportAccess(Location / REGISTER_FILE_REGISTERS_IN_BANK_COUNT, Location % REGISTER_FILE_REGISTERS_IN_BANK_COUNT, 1, Data);
+		Pointer_Register->WriteCallback(&Pointer_Register->Content, Data);
+	}
+	
+	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
+	INSTRUMENTATION_LEAVE();
 }
 
 unsigned char RegisterFileDirectRead(unsigned int Bank, unsigned int Address)
@@ -313,6 +428,7 @@ unsigned char RegisterFileDirectRead(unsigned int Bank, unsigned int Address)
 		exit(EXIT_FAILURE);
 	}
 
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_REGISTER_FILE);
 	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
 
 	// Get the required register
@@ -321,10 +437,116 @@ unsigned char RegisterFileDirectRead(unsigned int Bank, unsigned int Address)
 	Return_Value = Pointer_Register->ReadCallback(&Pointer_Register->Content);
 
 	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
+	INSTRUMENTATION_LEAVE();
 
 	return Return_Value;
 }
 
+unsigned char RegisterFileDirectPeek(unsigned int Bank, unsigned int Address)
+{
+	TRegisterFileRegister *Pointer_Register;
+	unsigned char Data;
+	
+	if ((Bank >= REGISTER_FILE_BANKS_COUNT) || (Address >= REGISTER_FILE_REGISTERS_IN_BANK_COUNT)) return 0;
+	
+	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
+	
+	// INDF gives the register it points to, which is peeked the same way
+	Pointer_Register = &Register_File[Bank][Address];
+	if (Pointer_Register->ReadCallback == RegisterFileIndirectAccessRead) Pointer_Register = &Register_File[0][0] + RegisterFileGetIndirectLocation();
+	
+	// Only the register file own callbacks are known to have no side effect, peripheral registers give their stored value (INDF pointing to itself stores 0)
+	if ((Pointer_Register->ReadCallback == RegisterFileNormalRAMRead) || (Pointer_Register->ReadCallback == RegisterFileRemappedRAMRead) || (Pointer_Register->ReadCallback == RegisterFilePCLRead)) Data = Pointer_Register->ReadCallback(&Pointer_Register->Content);
+	else Data = Pointer_Register->Content.Data;
+	
+	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
+	
+	return Data;
+}
+
+unsigned int RegisterFileGetPhysicalLocation(unsigned int Bank, unsigned int Address)
+{
+	TRegisterFileRegister *Pointer_Register;
+	
+	// Mirrored registers point to the data of the register they mirror, the mapping does not change after initialization
+	Pointer_Register = &Register_File[Bank][Address];
+	if (Pointer_Register->ReadCallback == RegisterFileRemappedRAMRead) return ((unsigned char *) Pointer_Register->Content.Pointer_Data - &Register_File[0][0].Content.Data) / sizeof(TRegisterFileRegister);
+	return Bank * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + Address;
+}
+
+void RegisterFileHookAccesses(unsigned int Location, int Is_Enabled)
+{
+	unsigned int Bank, Address, Mirror_Location;
+	
+	if (Location >= REGISTER_FILE_LOCATIONS_COUNT) return;
+	
+	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
+	
+	if (Is_Enabled != RegisterFileIsAccessHooked(Location))
+	{
+		if (Is_Enabled) Register_File_Hooked_Locations_Count++;
+		else Register_File_Hooked_Locations_Count--;
+	}
+	
+	// Hook all mirrors of the location
+	for (Bank = 0; Bank < REGISTER_FILE_BANKS_COUNT; Bank++)
+	{
+		for (Address = 0; Address < REGISTER_FILE_REGISTERS_IN_BANK_COUNT; Address++)
+		{
+			if (RegisterFileGetPhysicalLocation(Bank, Address) != Location) continue;
+			
+			Mirror_Location = Bank * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + Address;
+			if (Is_Enabled) Register_File_Access_Hooks_Bitmap[Mirror_Location >> 3] |= 1 << (Mirror_Location & 7);
+			else Register_File_Access_Hooks_Bitmap[Mirror_Location >> 3] &= ~(1 << (Mirror_Location & 7));
+		}
+	}
+	
+	// Any location can be reached through INDF
+	for (Bank = 0; Bank < REGISTER_FILE_BANKS_COUNT; Bank++)
+	{
+		Mirror_Location = Bank * REGISTER_FILE_REGISTERS_IN_BANK_COUNT + REGISTER_FILE_REGISTER_ADDRESS_INDF;
+		if (Register_File_Hooked_Locations_Count > 0) Register_File_Access_Hooks_Bitmap[Mirror_Location >> 3] |= 1 << (Mirror_Location & 7);
+		else Register_File_Access_Hooks_Bitmap[Mirror_Location >> 3] &= ~(1 << (Mirror_Location & 7));
+	}
+	
+	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
+}
+
+void RegisterFileSaveSnapshot(unsigned char *Pointer_Buffer)
+{
+	TRegisterFileRegister *Pointer_Register;
+	unsigned int Location;
+	
+	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
+	
+	// Mirrors hold a pointer instead of data, keep a constant value for them so they never appear in snapshot differences
+	for (Location = 0; Location < REGISTER_FILE_LOCATIONS_COUNT; Location++)
+	{
+		Pointer_Register = &Register_File[0][0] + Location;
+		if (Pointer_Register->ReadCallback == RegisterFileRemappedRAMRead) Pointer_Buffer[Location] = 0;
+		else Pointer_Buffer[Location] = Pointer_Register->Content.Data;
+	}
+	
+	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
+}
+
+void RegisterFileRestoreSnapshot(const unsigned char *Pointer_Buffer)
+{
+	TRegisterFileRegister *Pointer_Register;
+	unsigned int Location;
+	
+	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
+	
+	for (Location = 0; Location < REGISTER_FILE_LOCATIONS_COUNT; Location++)
+	{
+		Pointer_Register = &Register_File[0][0] + Location;
+		if (Pointer_Register->ReadCallback != RegisterFileRemappedRAMRead) Pointer_Register->Content.Data = Pointer_Buffer[Location];
+	}
+	InterruptControllerUpdate();
+	
+	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
+}
+
 void RegisterFileDirectWrite(unsigned int Bank, unsigned int Address, unsigned char Data)
 {
 	TRegisterFileRegister *Pointer_Register;
@@ -342,6 +564,7 @@ void RegisterFileDirectWrite(unsigned int Bank, unsigned int Address, unsigned c
 		exit(EXIT_FAILURE);
 	}
 
+	INSTRUMENTATION_ENTER(INSTRUMENTATION_SUBSYSTEM_REGISTER_FILE);
 	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
 
 	// Get the required register
@@ -350,6 +573,7 @@ void RegisterFileDirectWrite(unsigned int Bank, unsigned int Address, unsigned c
 	Pointer_Register->WriteCallback(&Pointer_Register->Content, Data);
 
 	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
+	INSTRUMENTATION_LEAVE();
 }
 
 unsigned char RegisterFileDirectReadFromCallback(unsigned int Bank, unsigned int Address)
@@ -412,67 +636,3 @@ void RegisterFileDump(void)
 
 	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
 }
-
-int RegisterFileHasInterruptFired(void)
-{
-	unsigned char INTCON_Register, PIE1_Register, PIR1_Register;
-	int Return_Value = 1;
-
-	pthread_mutex_lock(&Register_File_Mutex_Concurrent_Access);
-
-	// Check flags not depending from PIE bit
-	INTCON_Register = Register_File[REGISTER_FILE_REGISTER_BANK_INTCON][REGISTER_FILE_REGISTER_ADDRESS_INTCON].Content.Data;
-	if (!(INTCON_Register & REGISTER_FILE_REGISTER_BIT_INTCON_GIE))
-	{
-		Return_Value = 0; // Interrupts are disabled
-		goto Exit;
-	}
-	// T0I
-	if ((INTCON_Register & REGISTER_FILE_REGISTER_BIT_INTCON_T0IE) && (INTCON_Register & REGISTER_FILE_REGISTER_BIT_INTCON_T0IF))
-	{
-		LOG(LOG_LEVEL_DEBUG, "Timer 0 overflow interrupt.\n");
-		goto Exit;
-	}
-	// INT
-	if ((INTCON_Register & REGISTER_FILE_REGISTER_BIT_INTCON_INTE) && (INTCON_Register & REGISTER_FILE_REGISTER_BIT_INTCON_INTF))
-	{
-		LOG(LOG_LEVEL_DEBUG, "RB0 pin external interrupt.\n");
-		goto Exit;
-	}
-	// RBI
-	if ((INTCON_Register & REGISTER_FILE_REGISTER_BIT_INTCON_RBIE) && (INTCON_Register & REGISTER_FILE_REGISTER_BIT_INTCON_RBIF))
-	{
-		LOG(LOG_LEVEL_DEBUG, "Port B pin change interrupt.\n");
-		goto Exit;
-	}
-
-	// Check peripheral flags
-	if (!(INTCON_Register & REGISTER_FILE_REGISTER_BIT_INTCON_PEIE))
-	{
-		Return_Value = 0;  // Peripheral interrupts are disabled
-		goto Exit;
-	}
-	PIE1_Register = Register_File[REGISTER_FILE_REGISTER_BANK_PIE1][REGISTER_FILE_REGISTER_ADDRESS_PIE1].Content.Data;
-	PIR1_Register = Register_File[REGISTER_FILE_REGISTER_BANK_PIR1][REGISTER_FILE_REGISTER_ADDRESS_PIR1].Content.Data;
-	// RCI
-	if ((PIE1_Register & REGISTER_FILE_REGISTER_BIT_PIE1_RCIE) && (PIR1_Register & REGISTER_FILE_REGISTER_BIT_PIR1_RCIF))
-	{
-		LOG(LOG_LEVEL_DEBUG, "UART reception interrupt.\n");
-		goto Exit;
-	}
-	// TXI
-	if ((PIE1_Register & REGISTER_FILE_REGISTER_BIT_PIE1_TXIE) && (PIR1_Register & REGISTER_FILE_REGISTER_BIT_PIR1_TXIF))
-	{
-		LOG(LOG_LEVEL_DEBUG, "UART transmission interrupt.\n");
-		goto Exit;
-	}
-
-	// TODO implement other needed peripherals
-
-	Return_Value = 0;
-
-Exit:
-	pthread_mutex_unlock(&Register_File_Mutex_Concurrent_Access);
-	return Return_Value;
-}
-
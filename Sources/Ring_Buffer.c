@@ -0,0 +1,70 @@
+/** @file Ring_Buffer.c
+ * @see Ring_Buffer.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Ring_Buffer.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Convert a free-running index to a buffer offset. */
+#define RING_BUFFER_INDEX_MASK (RING_BUFFER_SIZE - 1)
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void RingBufferInitialize(TRingBuffer *Pointer_Ring_Buffer)
+{
+	atomic_init(&Pointer_Ring_Buffer->Read_Index, 0);
+	atomic_init(&Pointer_Ring_Buffer->Write_Index, 0);
+}
+
+int RingBufferWriteByte(TRingBuffer *Pointer_Ring_Buffer, unsigned char Data)
+{
+	unsigned int Read_Index, Write_Index;
+	
+	// Indexes are free-running, so the used space is always their difference
+	Write_Index = atomic_load_explicit(&Pointer_Ring_Buffer->Write_Index, memory_order_relaxed);
+	Read_Index = atomic_load_explicit(&Pointer_Ring_Buffer->Read_Index, memory_order_acquire);
+	if (Write_Index - Read_Index >= RING_BUFFER_SIZE) return 1;
+	
+	// Store the data before publishing it to the consumer
+	Pointer_Ring_Buffer->Buffer[Write_Index & RING_BUFFER_INDEX_MASK] = Data;
+	atomic_store_explicit(&Pointer_Ring_Buffer->Write_Index, Write_Index + 1, memory_order_release);
+	return 0;
+}
+
+int RingBufferReadByte(TRingBuffer *Pointer_Ring_Buffer, unsigned char *Pointer_Data)
+{
+	unsigned int Read_Index, Write_Index;
+	
+	Read_Index = atomic_load_explicit(&Pointer_Ring_Buffer->Read_Index, memory_order_relaxed);
+	Write_Index = atomic_load_explicit(&Pointer_Ring_Buffer->Write_Index, memory_order_acquire);
+	if (Read_Index == Write_Index) return 1;
+	
+	// Retrieve the data before giving the slot back to the producer
+	*Pointer_Data = Pointer_Ring_Buffer->Buffer[Read_Index & RING_BUFFER_INDEX_MASK];
+	atomic_store_explicit(&Pointer_Ring_Buffer->Read_Index, Read_Index + 1, memory_order_release);
+	return 0;
+}
+
+unsigned int RingBufferRead(TRingBuffer *Pointer_Ring_Buffer, unsigned char *Pointer_Buffer, unsigned int Buffer_Size)
+{
+	unsigned int Read_Index, Write_Index, Count, i;
+	
+	Read_Index = atomic_load_explicit(&Pointer_Ring_Buffer->Read_Index, memory_order_relaxed);
+	Write_Index = atomic_load_explicit(&Pointer_Ring_Buffer->Write_Index, memory_order_acquire);
+	
+	// Do not remove more bytes than available
+	Count = Write_Index - Read_Index;
+	if (Count > Buffer_Size) Count = Buffer_Size;
+	
+	for (i = 0; i < Count; i++) Pointer_Buffer[i] = Pointer_Ring_Buffer->Buffer[(Read_Index + i) & RING_BUFFER_INDEX_MASK];
+	atomic_store_explicit(&Pointer_Ring_Buffer->Read_Index, Read_Index + Count, memory_order_release);
+	return Count;
+}
+
+int RingBufferIsEmpty(TRingBuffer *Pointer_Ring_Buffer)
+{
+	return atomic_load_explicit(&Pointer_Ring_Buffer->Read_Index, memory_order_acquire) == atomic_load_explicit(&Pointer_Ring_Buffer->Write_Index, memory_order_acquire);
+}
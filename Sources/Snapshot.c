@@ -0,0 +1,388 @@
+/** @file Snapshot.c
+ * @see Snapshot.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Core.h>
+#include <Log.h>
+#include <Peripheral_ADC.h>
+#include <Peripheral_Data_EEPROM.h>
+#include <Peripheral_I2C_EEPROM.h>
+#include <Peripheral_Memory_Access.h>
+#include <Peripheral_Timer.h>
+#include <Peripheral_UART.h>
+#include <Program_Memory.h>
+#include <Register_File.h>
+#include <Snapshot.h>
+#include <stdlib.h>
+#include <string.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Two modified areas separated by less unmodified bytes than this are stored as a single run, which is smaller than two run headers. */
+#define SNAPSHOT_RUN_MERGING_DISTANCE 8
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** The whole board state. */
+typedef struct
+{
+	TCoreState Core_State; //! The core registers and cycles count.
+	unsigned char Register_File[REGISTER_FILE_LOCATIONS_COUNT]; //! All register file locations.
+	unsigned short Program_Memory[PROGRAM_MEMORY_SIZE]; //! The program memory, which the firmware can modify.
+	TPeripheralTimerSnapshot Timer; //! The timers prescalers.
+	TPeripheralADCSnapshot ADC; //! The ADC conversion state.
+	TPeripheralMemoryAccessSnapshot Memory_Access; //! The EECON registers interface state.
+	TPeripheralDataEEPROMSnapshot Data_EEPROM; //! The data EEPROM content.
+	TPeripheralI2CEEPROMSnapshot I2C_EEPROM; //! The external EEPROM content and protocol state.
+	TPeripheralUARTSnapshot UART; //! The transmitter and receiver timing state.
+} TSnapshotImage;
+
+/** A modified bytes area header, the modified bytes follow it. */
+typedef struct
+{
+	unsigned int Offset; //! The first modified byte offset in the image.
+	unsigned int Size; //! How many bytes are stored.
+} TSnapshotRun;
+
+/** A snapshot ring entry. */
+typedef struct
+{
+	unsigned long long Cycles_Count; //! The cycles count when the snapshot was taken.
+	unsigned char *Pointer_Delta; //! The runs turning the next snapshot image into this snapshot image (NULL for the newest snapshot, its image is fully stored).
+	unsigned int Delta_Size; //! The runs size in bytes.
+} TSnapshot;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The snapshots ring. */
+static TSnapshot *Pointer_Snapshot_Ring;
+/** How many snapshots the ring can hold. */
+static unsigned int Snapshot_Ring_Size;
+/** The oldest snapshot ring index. */
+static unsigned int Snapshot_Oldest_Ring_Index = 0;
+/** How many snapshots are stored. */
+static unsigned int Snapshot_Count = 0;
+
+/** How many cycles separate two snapshots. */
+static unsigned long long Snapshot_Interval;
+/** Take the next snapshot when this cycle is reached. */
+static unsigned long long Snapshot_Next_Cycles_Count = 0;
+/** The furthest cycle the board has executed. */
+static unsigned long long Snapshot_Last_Executed_Cycles_Count = 0;
+
+/** The newest snapshot image. */
+static TSnapshotImage Snapshot_Newest_Image;
+/** The image being taken or restored. */
+static TSnapshotImage Snapshot_Work_Image;
+/** Where the runs are built before being copied to a buffer of the right size. The worst case is a run every SNAPSHOT_RUN_MERGING_DISTANCE + 1 bytes. */
+static unsigned char Snapshot_Delta_Buffer[sizeof(TSnapshotImage) + (sizeof(TSnapshotImage) / (SNAPSHOT_RUN_MERGING_DISTANCE + 1) + 1) * sizeof(TSnapshotRun)];
+
+//-------------------------------------------------------------------------------------------------
+// Public variables
+//-------------------------------------------------------------------------------------------------
+int Snapshot_Is_Enabled = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Get a snapshot from its index.
+ * @param Index The snapshot index (0 is the oldest snapshot).
+ * @return The snapshot.
+ */
+static inline TSnapshot *SnapshotGet(unsigned int Index)
+{
+	return &Pointer_Snapshot_Ring[(Snapshot_Oldest_Ring_Index + Index) % Snapshot_Ring_Size];
+}
+
+/** Compute the runs turning an image into another one.
+ * @param Pointer_Source_Image The image the runs will be applied to.
+ * @param Pointer_Destination_Image The image the runs will produce.
+ * @param Pointer_Delta_Size On output, contain the runs size in bytes.
+ * @return NULL if there was not enough memory,
+ * @return the allocated runs otherwise.
+ */
+static unsigned char *SnapshotComputeDelta(const TSnapshotImage *Pointer_Source_Image, const TSnapshotImage *Pointer_Destination_Image, unsigned int *Pointer_Delta_Size)
+{
+	const unsigned char *Pointer_Source = (const unsigned char *) Pointer_Source_Image, *Pointer_Destination = (const unsigned char *) Pointer_Destination_Image;
+	unsigned int Offset = 0, Run_End_Offset, Unmodified_Bytes_Count, Delta_Size = 0;
+	TSnapshotRun Run;
+	unsigned char *Pointer_Delta;
+	
+	while (Offset < sizeof(TSnapshotImage))
+	{
+		// Find the next modified byte
+		if (Pointer_Source[Offset] == Pointer_Destination[Offset])
+		{
+			Offset++;
+			continue;
+		}
+		
+		// Extend the run until enough unmodified bytes are found
+		Run_End_Offset = Offset + 1;
+		Unmodified_Bytes_Count = 0;
+		while ((Run_End_Offset + Unmodified_Bytes_Count < sizeof(TSnapshotImage)) && (Unmodified_Bytes_Count < SNAPSHOT_RUN_MERGING_DISTANCE))
+		{
+			if (Pointer_Source[Run_End_Offset + Unmodified_Bytes_Count] == Pointer_Destination[Run_End_Offset + Unmodified_Bytes_Count])
+			{
+				Unmodified_Bytes_Count++;
+				continue;
+			}
+			Run_End_Offset += Unmodified_Bytes_Count + 1;
+			Unmodified_Bytes_Count = 0;
+		}
+		
+		Run.Offset = Offset;
+		Run.Size = Run_End_Offset - Offset;
+		memcpy(&Snapshot_Delta_Buffer[Delta_Size], &Run, sizeof(Run));
+		memcpy(&Snapshot_Delta_Buffer[Delta_Size + sizeof(Run)], &Pointer_Destination[Offset], Run.Size);
+		Delta_Size += sizeof(Run) + Run.Size;
+		Offset = Run_End_Offset;
+	}
+	
+	// Two identical snapshots need no runs at all, but a valid pointer is still needed
+	Pointer_Delta = malloc(Delta_Size + 1);
+	if (Pointer_Delta == NULL) return NULL;
+	memcpy(Pointer_Delta, Snapshot_Delta_Buffer, Delta_Size);
+	*Pointer_Delta_Size = Delta_Size;
+	return Pointer_Delta;
+}
+
+/** Apply runs to an image.
+ * @param Pointer_Image The image to modify.
+ * @param Pointer_Snapshot The snapshot holding the runs.
+ */
+static void SnapshotApplyDelta(TSnapshotImage *Pointer_Image, const TSnapshot *Pointer_Snapshot)
+{
+	unsigned int Offset = 0;
+	TSnapshotRun Run;
+	
+	while (Offset < Pointer_Snapshot->Delta_Size)
+	{
+		memcpy(&Run, &Pointer_Snapshot->Pointer_Delta[Offset], sizeof(Run));
+		memcpy((unsigned char *) Pointer_Image + Run.Offset, &Pointer_Snapshot->Pointer_Delta[Offset + sizeof(Run)], Run.Size);
+		Offset += sizeof(Run) + Run.Size;
+	}
+}
+
+/** Rebuild a snapshot image into Snapshot_Work_Image.
+ * @param Index The snapshot index.
+ */
+static void SnapshotBuildImage(unsigned int Index)
+{
+	unsigned int i;
+	
+	// Go back from the newest image one snapshot at a time
+	memcpy(&Snapshot_Work_Image, &Snapshot_Newest_Image, sizeof(TSnapshotImage));
+	for (i = Snapshot_Count - 1; i > Index; i--) SnapshotApplyDelta(&Snapshot_Work_Image, SnapshotGet(i - 1));
+}
+
+/** Remove the oldest snapshot. */
+static void SnapshotDiscardOldest(void)
+{
+	TSnapshot *Pointer_Snapshot;
+	
+	Pointer_Snapshot = SnapshotGet(0);
+	free(Pointer_Snapshot->Pointer_Delta);
+	Pointer_Snapshot->Pointer_Delta = NULL;
+	Snapshot_Oldest_Ring_Index = (Snapshot_Oldest_Ring_Index + 1) % Snapshot_Ring_Size;
+	Snapshot_Count--;
+	
+	// The bytes received before the new oldest snapshot will never be replayed
+	if (Snapshot_Count > 0) PeripheralUARTForgetJournal(SnapshotGet(0)->Cycles_Count);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int SnapshotInitialize(char *String_Parameters)
+{
+	char *Pointer_Character;
+	unsigned long Count = SNAPSHOT_DEFAULT_COUNT;
+	
+	Snapshot_Interval = strtoull(String_Parameters, &Pointer_Character, 0);
+	if ((Pointer_Character == String_Parameters) || (Snapshot_Interval == 0))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : bad snapshots interval in '%s'.\n", String_Parameters);
+		return 1;
+	}
+	if (*Pointer_Character == ':')
+	{
+		String_Parameters = Pointer_Character + 1;
+		Count = strtoul(String_Parameters, &Pointer_Character, 0);
+		if ((Pointer_Character == String_Parameters) || (Count < 2) || (Count > 65536))
+		{
+			LOG(LOG_LEVEL_ERROR, "Error : bad snapshots count in '%s', it must be in range [2; 65536].\n", String_Parameters);
+			return 1;
+		}
+	}
+	if (*Pointer_Character != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : unexpected characters '%s' after the snapshots parameters.\n", Pointer_Character);
+		return 1;
+	}
+	
+	Pointer_Snapshot_Ring = calloc(Count, sizeof(TSnapshot));
+	if (Pointer_Snapshot_Ring == NULL)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to allocate the snapshots ring.\n");
+		return 1;
+	}
+	Snapshot_Ring_Size = Count;
+	
+	// The received bytes can't be taken again from the UART backend
+	PeripheralUARTEnableJournal();
+	Snapshot_Is_Enabled = 1;
+	LOG(LOG_LEVEL_DEBUG, "Taking a snapshot every %llu cycles, keeping %u snapshots.\n", Snapshot_Interval, Snapshot_Ring_Size);
+	return 0;
+}
+
+void SnapshotUpdate(void)
+{
+	unsigned long long Cycles_Count;
+	TSnapshot *Pointer_Snapshot;
+	
+	// Nothing to do most of the time
+	Cycles_Count = CoreGetCyclesCount();
+	if (Cycles_Count < Snapshot_Next_Cycles_Count) return;
+	Snapshot_Next_Cycles_Count = Cycles_Count + Snapshot_Interval;
+	
+	// Gather the board state (padding bytes must not appear as differences)
+	memset(&Snapshot_Work_Image, 0, sizeof(Snapshot_Work_Image));
+	CoreGetState(&Snapshot_Work_Image.Core_State);
+	RegisterFileSaveSnapshot(Snapshot_Work_Image.Register_File);
+	ProgramMemorySaveSnapshot(Snapshot_Work_Image.Program_Memory);
+	PeripheralTimerSaveSnapshot(&Snapshot_Work_Image.Timer);
+	PeripheralADCSaveSnapshot(&Snapshot_Work_Image.ADC);
+	PeripheralMemoryAccessSaveSnapshot(&Snapshot_Work_Image.Memory_Access);
+	PeripheralDataEEPROMSaveSnapshot(&Snapshot_Work_Image.Data_EEPROM);
+	PeripheralI2CEEPROMSaveSnapshot(&Snapshot_Work_Image.I2C_EEPROM);
+	PeripheralUARTSaveSnapshot(&Snapshot_Work_Image.UART);
+	
+	// The previous newest snapshot now only keeps its differences with the new one
+	if (Snapshot_Count > 0)
+	{
+		Pointer_Snapshot = SnapshotGet(Snapshot_Count - 1);
+		Pointer_Snapshot->Pointer_Delta = SnapshotComputeDelta(&Snapshot_Work_Image, &Snapshot_Newest_Image, &Pointer_Snapshot->Delta_Size);
+		if (Pointer_Snapshot->Pointer_Delta == NULL)
+		{
+			// The previous snapshots can't be rebuilt anymore
+			LOG(LOG_LEVEL_WARNING, "WARNING : failed to allocate memory for a snapshot, discarding all previous snapshots.\n");
+			while (Snapshot_Count > 1) SnapshotDiscardOldest();
+			Snapshot_Count = 0;
+		}
+		else if (Snapshot_Count == Snapshot_Ring_Size) SnapshotDiscardOldest();
+	}
+	
+	Pointer_Snapshot = SnapshotGet(Snapshot_Count);
+	Pointer_Snapshot->Cycles_Count = Cycles_Count;
+	Pointer_Snapshot->Pointer_Delta = NULL;
+	Pointer_Snapshot->Delta_Size = 0;
+	Snapshot_Count++;
+	memcpy(&Snapshot_Newest_Image, &Snapshot_Work_Image, sizeof(TSnapshotImage));
+	LOG(LOG_LEVEL_DEBUG, "Took a snapshot at cycle %llu.\n", Cycles_Count);
+}
+
+int SnapshotFind(unsigned long long Cycles_Count)
+{
+	int Index;
+	
+	for (Index = (int) Snapshot_Count - 1; Index >= 0; Index--)
+	{
+		if (SnapshotGet(Index)->Cycles_Count < Cycles_Count) return Index;
+	}
+	return -1;
+}
+
+unsigned long long SnapshotGetCyclesCount(int Index)
+{
+	return SnapshotGet(Index)->Cycles_Count;
+}
+
+void SnapshotRestore(int Index)
+{
+	unsigned long long Cycles_Count;
+	
+	// Remember how far the board went before going back
+	Cycles_Count = CoreGetCyclesCount();
+	if (Cycles_Count > Snapshot_Last_Executed_Cycles_Count) Snapshot_Last_Executed_Cycles_Count = Cycles_Count;
+	
+	SnapshotBuildImage(Index);
+	CoreSetState(&Snapshot_Work_Image.Core_State);
+	RegisterFileRestoreSnapshot(Snapshot_Work_Image.Register_File);
+	ProgramMemoryRestoreSnapshot(Snapshot_Work_Image.Program_Memory);
+	PeripheralTimerRestoreSnapshot(&Snapshot_Work_Image.Timer);
+	PeripheralADCRestoreSnapshot(&Snapshot_Work_Image.ADC);
+	PeripheralMemoryAccessRestoreSnapshot(&Snapshot_Work_Image.Memory_Access);
+	PeripheralDataEEPROMRestoreSnapshot(&Snapshot_Work_Image.Data_EEPROM);
+	PeripheralI2CEEPROMRestoreSnapshot(&Snapshot_Work_Image.I2C_EEPROM);
+	PeripheralUARTRestoreSnapshot(&Snapshot_Work_Image.UART);
+	
+	PeripheralUARTStartReplay(Snapshot_Work_Image.Core_State.Cycles_Count, Snapshot_Last_Executed_Cycles_Count);
+	LOG(LOG_LEVEL_DEBUG, "Restored the snapshot taken at cycle %llu.\n", Snapshot_Work_Image.Core_State.Cycles_Count);
+}
+
+void SnapshotDiscardFuture(void)
+{
+	unsigned long long Cycles_Count;
+	TSnapshot *Pointer_Snapshot = NULL;
+	int Index;
+	
+	// The board has not been set back, there is no future to discard
+	Cycles_Count = CoreGetCyclesCount();
+	if (!Snapshot_Is_Enabled || (Cycles_Count >= Snapshot_Last_Executed_Cycles_Count)) return;
+	Snapshot_Last_Executed_Cycles_Count = Cycles_Count;
+	
+	// Make the newest snapshot still describing the past the fully stored one
+	Index = SnapshotFind(Cycles_Count + 1);
+	if (Index >= 0)
+	{
+		SnapshotBuildImage(Index);
+		memcpy(&Snapshot_Newest_Image, &Snapshot_Work_Image, sizeof(TSnapshotImage));
+	}
+	while (Snapshot_Count > 0)
+	{
+		Pointer_Snapshot = SnapshotGet(Snapshot_Count - 1);
+		free(Pointer_Snapshot->Pointer_Delta);
+		Pointer_Snapshot->Pointer_Delta = NULL;
+		Pointer_Snapshot->Delta_Size = 0;
+		if ((int) Snapshot_Count == Index + 1) break;
+		Snapshot_Count--;
+	}
+	
+	// Take the next snapshot as if the discarded ones had never been taken
+	if (Snapshot_Count > 0) Snapshot_Next_Cycles_Count = Pointer_Snapshot->Cycles_Count + Snapshot_Interval;
+	else Snapshot_Next_Cycles_Count = Cycles_Count;
+	
+	PeripheralUARTTruncateJournal(Cycles_Count);
+	LOG(LOG_LEVEL_DEBUG, "The board state has been modified at cycle %llu, discarded the next snapshots.\n", Cycles_Count);
+}
+
+void SnapshotDiscardAll(void)
+{
+	unsigned long long Cycles_Count;
+	TSnapshot *Pointer_Snapshot;
+	
+	if (!Snapshot_Is_Enabled) return;
+	
+	while (Snapshot_Count > 0)
+	{
+		Pointer_Snapshot = SnapshotGet(Snapshot_Count - 1);
+		free(Pointer_Snapshot->Pointer_Delta);
+		Pointer_Snapshot->Pointer_Delta = NULL;
+		Pointer_Snapshot->Delta_Size = 0;
+		Snapshot_Count--;
+	}
+	
+	// Start a new history right now
+	Cycles_Count = CoreGetCyclesCount();
+	Snapshot_Next_Cycles_Count = Cycles_Count;
+	Snapshot_Last_Executed_Cycles_Count = Cycles_Count;
+	
+	// None of the recorded bytes will be replayed
+	PeripheralUARTTruncateJournal(Cycles_Count);
+	PeripheralUARTForgetJournal(Cycles_Count);
+	LOG(LOG_LEVEL_DEBUG, "Discarded all snapshots at cycle %llu.\n", Cycles_Count);
+}
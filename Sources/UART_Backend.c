@@ -0,0 +1,575 @@
+/** @file UART_Backend.c
+ * @see UART_Backend.h for description.
+ * @author Adrien RICCIARDI
+ */
+#define _GNU_SOURCE // Needed by accept4() and pseudo-terminal functions
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <Log.h>
+#include <pthread.h>
+#include <Ring_Buffer.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <UART_Backend.h>
+#include <unistd.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** How many bytes the I/O thread moves at once between the host channel and the queues. */
+#define UART_BACKEND_TRANSFER_BUFFER_SIZE 256
+
+/** How long the I/O thread waits before retrying to fill a full reception queue (in milliseconds). */
+#define UART_BACKEND_RECEPTION_RETRY_DELAY 10
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The selected host channel. */
+static TUARTBackendType UART_Backend_Type;
+
+/** Bytes transmitted by the PIC, waiting to be sent to the host channel. */
+static TRingBuffer UART_Backend_Transmission_Queue;
+/** Bytes received from the host channel, waiting to be read by the PIC. */
+static TRingBuffer UART_Backend_Reception_Queue;
+
+/** The file descriptor the received bytes are read from (-1 if there is none). */
+static int UART_Backend_Input_File_Descriptor = -1;
+/** The file descriptor the transmitted bytes are written to (-1 if there is none). */
+static int UART_Backend_Output_File_Descriptor = -1;
+/** The Unix socket server file descriptor (-1 if the socket backend is not used). */
+static int UART_Backend_Server_File_Descriptor = -1;
+/** Keep the pseudo-terminal slave side opened, so the master side does not report errors when no terminal emulator is attached (-1 if the pseudo-terminal backend is not used). */
+static int UART_Backend_Pseudo_Terminal_Slave_File_Descriptor = -1;
+/** Wake the I/O thread up when new bytes are transmitted or when the backend is stopping. */
+static int UART_Backend_Event_File_Descriptor = -1;
+/** The I/O thread events multiplexer. */
+static int UART_Backend_Epoll_File_Descriptor = -1;
+
+/** The Unix socket path, needed to remove the socket file on exit. */
+static char UART_Backend_String_Socket_Path[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+
+/** Tell whether the output file descriptor is currently watched for writability. */
+static int UART_Backend_Is_Output_Watched = 0;
+
+/** Tell whether the I/O thread is about to wait for events, so the CPU thread must wake it up when it transmits a byte. */
+static atomic_int UART_Backend_Is_IO_Thread_Sleeping = 0;
+
+/** Tell the I/O thread to terminate. */
+static volatile int UART_Backend_Is_Exiting = 0;
+
+/** How many transmitted bytes were discarded because the transmission queue was full. Only modified by the transmitted bytes producer. */
+static unsigned long long UART_Backend_Discarded_Bytes_Count = 0;
+
+/** The I/O thread ID. */
+static pthread_t UART_Backend_Thread_ID;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Start or stop monitoring a file descriptor for input data.
+ * @param File_Descriptor The file descriptor to monitor.
+ * @return 0 on success,
+ * @return 1 if an error occurred.
+ */
+static int UARTBackendWatchInput(int File_Descriptor)
+{
+	struct epoll_event Event;
+
+	Event.events = EPOLLIN;
+	Event.data.fd = File_Descriptor;
+	if (epoll_ctl(UART_Backend_Epoll_File_Descriptor, EPOLL_CTL_ADD, File_Descriptor, &Event) != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to monitor the file descriptor %d (%s).\n", File_Descriptor, strerror(errno));
+		return 1;
+	}
+	return 0;
+}
+
+/** Tell the I/O thread to wake up when the output file descriptor can accept more data.
+ * @param Is_Enabled Set to 1 to be notified of writability, set to 0 to stop notifications.
+ */
+static void UARTBackendWatchOutput(int Is_Enabled)
+{
+	struct epoll_event Event;
+
+	if (UART_Backend_Is_Output_Watched == Is_Enabled) return;
+	UART_Backend_Is_Output_Watched = Is_Enabled;
+
+	Event.data.fd = UART_Backend_Output_File_Descriptor;
+	// The pseudo-terminal and the socket client use the same file descriptor for input and output, so it is already monitored
+	if (UART_Backend_Output_File_Descriptor == UART_Backend_Input_File_Descriptor)
+	{
+		Event.events = EPOLLIN;
+		if (Is_Enabled) Event.events |= EPOLLOUT;
+		epoll_ctl(UART_Backend_Epoll_File_Descriptor, EPOLL_CTL_MOD, UART_Backend_Output_File_Descriptor, &Event);
+	}
+	else
+	{
+		Event.events = EPOLLOUT;
+		if (Is_Enabled) epoll_ctl(UART_Backend_Epoll_File_Descriptor, EPOLL_CTL_ADD, UART_Backend_Output_File_Descriptor, &Event);
+		else epoll_ctl(UART_Backend_Epoll_File_Descriptor, EPOLL_CTL_DEL, UART_Backend_Output_File_Descriptor, &Event);
+	}
+}
+
+/** Close the connected Unix socket client, if any. */
+static void UARTBackendDisconnectClient(void)
+{
+	if (UART_Backend_Input_File_Descriptor == -1) return;
+
+	UARTBackendWatchOutput(0);
+	epoll_ctl(UART_Backend_Epoll_File_Descriptor, EPOLL_CTL_DEL, UART_Backend_Input_File_Descriptor, NULL);
+	close(UART_Backend_Input_File_Descriptor);
+	UART_Backend_Input_File_Descriptor = -1;
+	UART_Backend_Output_File_Descriptor = -1;
+	LOG(LOG_LEVEL_DEBUG, "UART socket client disconnected.\n");
+}
+
+/** Accept a new Unix socket client, replacing the previous one. */
+static void UARTBackendAcceptClient(void)
+{
+	int File_Descriptor;
+
+	File_Descriptor = accept4(UART_Backend_Server_File_Descriptor, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_WARNING, "WARNING : failed to accept the UART socket client (%s).\n", strerror(errno));
+		return;
+	}
+
+	UARTBackendDisconnectClient();
+	if (UARTBackendWatchInput(File_Descriptor) != 0)
+	{
+		close(File_Descriptor);
+		return;
+	}
+	UART_Backend_Input_File_Descriptor = File_Descriptor;
+	UART_Backend_Output_File_Descriptor = File_Descriptor;
+	LOG(LOG_LEVEL_DEBUG, "UART socket client connected.\n");
+}
+
+/** Send as many queued transmitted bytes as the host channel can accept.
+ * @param Pointer_Pending_Buffer Bytes already removed from the queue but not sent yet.
+ * @param Pointer_Pending_Offset On input, the first unsent byte of the pending buffer. On output, the updated offset.
+ * @param Pointer_Pending_Size On input, how many bytes are in the pending buffer. On output, the updated size.
+ * @return 0 if all bytes were sent,
+ * @return 1 if the host channel is full.
+ */
+static int UARTBackendFlushTransmissionQueue(unsigned char *Pointer_Pending_Buffer, unsigned int *Pointer_Pending_Offset, unsigned int *Pointer_Pending_Size)
+{
+	ssize_t Written_Bytes_Count;
+
+	while (1)
+	{
+		// Refill the pending buffer
+		if (*Pointer_Pending_Offset >= *Pointer_Pending_Size)
+		{
+			*Pointer_Pending_Offset = 0;
+			*Pointer_Pending_Size = RingBufferRead(&UART_Backend_Transmission_Queue, Pointer_Pending_Buffer, UART_BACKEND_TRANSFER_BUFFER_SIZE);
+			if (*Pointer_Pending_Size == 0)
+			{
+				UARTBackendWatchOutput(0);
+				return 0;
+			}
+		}
+
+		// Drop the data if nobody is connected to the socket, like a disconnected wire would do
+		if (UART_Backend_Output_File_Descriptor == -1)
+		{
+			*Pointer_Pending_Size = 0;
+			continue;
+		}
+
+		Written_Bytes_Count = write(UART_Backend_Output_File_Descriptor, Pointer_Pending_Buffer + *Pointer_Pending_Offset, *Pointer_Pending_Size - *Pointer_Pending_Offset);
+		if (Written_Bytes_Count < 0)
+		{
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN)
+			{
+				UARTBackendWatchOutput(1);
+				return 1;
+			}
+
+			LOG(LOG_LEVEL_WARNING, "WARNING : failed to write UART data to the host channel (%s).\n", strerror(errno));
+			if (UART_Backend_Type == UART_BACKEND_TYPE_UNIX_SOCKET) UARTBackendDisconnectClient();
+			*Pointer_Pending_Size = 0;
+			continue;
+		}
+		*Pointer_Pending_Offset += Written_Bytes_Count;
+	}
+}
+
+/** Move bytes from the host channel to the reception queue.
+ * @param Pointer_Pending_Buffer Bytes already read from the host channel but not queued yet.
+ * @param Pointer_Pending_Offset On input, the first unqueued byte of the pending buffer. On output, the updated offset.
+ * @param Pointer_Pending_Size On input, how many bytes are in the pending buffer. On output, the updated size.
+ */
+static void UARTBackendFillReceptionQueue(unsigned char *Pointer_Pending_Buffer, unsigned int *Pointer_Pending_Offset, unsigned int *Pointer_Pending_Size)
+{
+	ssize_t Read_Bytes_Count;
+
+	while (1)
+	{
+		// Queue the bytes read previously
+		while (*Pointer_Pending_Offset < *Pointer_Pending_Size)
+		{
+			if (RingBufferWriteByte(&UART_Backend_Reception_Queue, Pointer_Pending_Buffer[*Pointer_Pending_Offset]) != 0) return; // Wait for the PIC to consume some bytes
+			(*Pointer_Pending_Offset)++;
+		}
+
+		if (UART_Backend_Input_File_Descriptor == -1) return;
+		Read_Bytes_Count = read(UART_Backend_Input_File_Descriptor, Pointer_Pending_Buffer, UART_BACKEND_TRANSFER_BUFFER_SIZE);
+		if (Read_Bytes_Count > 0)
+		{
+			*Pointer_Pending_Offset = 0;
+			*Pointer_Pending_Size = Read_Bytes_Count;
+			continue;
+		}
+		if ((Read_Bytes_Count < 0) && (errno == EINTR)) continue;
+		if ((Read_Bytes_Count < 0) && (errno == EAGAIN)) return;
+
+		// End of file or error, only a socket client can go away
+		if (UART_Backend_Type == UART_BACKEND_TYPE_UNIX_SOCKET) UARTBackendDisconnectClient();
+		else LOG(LOG_LEVEL_WARNING, "WARNING : failed to read UART data from the host channel (%s).\n", Read_Bytes_Count == 0 ? "end of file" : strerror(errno));
+		return;
+	}
+}
+
+/** Exchange data between the queues and the host channel.
+ * @return always NULL.
+ */
+static void *UARTBackendThreadIO(void __attribute__((unused)) *Pointer_Parameters)
+{
+	struct epoll_event Events[4];
+	unsigned char Transmission_Buffer[UART_BACKEND_TRANSFER_BUFFER_SIZE], Reception_Buffer[UART_BACKEND_TRANSFER_BUFFER_SIZE];
+	unsigned int Transmission_Offset = 0, Transmission_Size = 0, Reception_Offset = 0, Reception_Size = 0;
+	int Events_Count, i, Timeout, Is_Output_Full;
+	uint64_t Event_Value;
+
+	LOG(LOG_LEVEL_DEBUG, "Thread started.\n");
+
+	while (1)
+	{
+		Is_Output_Full = UARTBackendFlushTransmissionQueue(Transmission_Buffer, &Transmission_Offset, &Transmission_Size);
+		if (UART_Backend_Is_Exiting)
+		{
+			// Do not wait forever if nobody is reading the host channel
+			if (Is_Output_Full) LOG(LOG_LEVEL_WARNING, "WARNING : the host channel is full, some transmitted UART bytes are lost.\n");
+			break;
+		}
+
+		// Poll the reception queue from time to time if it was full
+		if (Reception_Offset < Reception_Size) Timeout = UART_BACKEND_RECEPTION_RETRY_DELAY;
+		else Timeout = -1;
+
+		// Bytes queued after the transmission queue was found empty but before the CPU thread knows that this thread sleeps would never be notified
+		atomic_store(&UART_Backend_Is_IO_Thread_Sleeping, 1);
+		atomic_thread_fence(memory_order_seq_cst);
+		if (!Is_Output_Full && !RingBufferIsEmpty(&UART_Backend_Transmission_Queue))
+		{
+			atomic_store(&UART_Backend_Is_IO_Thread_Sleeping, 0);
+			continue;
+		}
+
+		Events_Count = epoll_wait(UART_Backend_Epoll_File_Descriptor, Events, sizeof(Events) / sizeof(Events[0]), Timeout);
+		if (Events_Count < 0)
+		{
+			if (errno == EINTR) continue;
+			LOG(LOG_LEVEL_ERROR, "Error : failed to wait for I/O events (%s).\n", strerror(errno));
+			break;
+		}
+
+		for (i = 0; i < Events_Count; i++)
+		{
+			if (Events[i].data.fd == UART_Backend_Event_File_Descriptor)
+			{
+				if (read(UART_Backend_Event_File_Descriptor, &Event_Value, sizeof(Event_Value)) != sizeof(Event_Value)) LOG(LOG_LEVEL_DEBUG, "Spurious event notification.\n");
+			}
+			else if (Events[i].data.fd == UART_Backend_Server_File_Descriptor) UARTBackendAcceptClient();
+			else if ((Events[i].data.fd == UART_Backend_Input_File_Descriptor) && (Events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) UARTBackendFillReceptionQueue(Reception_Buffer, &Reception_Offset, &Reception_Size);
+		}
+
+		// Retry to queue the pending received bytes
+		if (Reception_Offset < Reception_Size) UARTBackendFillReceptionQueue(Reception_Buffer, &Reception_Offset, &Reception_Size);
+	}
+
+	LOG(LOG_LEVEL_DEBUG, "Thread exited.\n");
+	return NULL;
+}
+
+/** Create a pseudo-terminal.
+ * @return 0 on success,
+ * @return 1 if an error occurred.
+ */
+static int UARTBackendOpenPseudoTerminal(void)
+{
+	int File_Descriptor;
+	char *String_Slave_Path;
+	struct termios Terminal_Attributes;
+
+	File_Descriptor = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the pseudo-terminal (%s).\n", strerror(errno));
+		return 1;
+	}
+	UART_Backend_Input_File_Descriptor = File_Descriptor;
+	UART_Backend_Output_File_Descriptor = File_Descriptor;
+
+	if ((grantpt(File_Descriptor) != 0) || (unlockpt(File_Descriptor) != 0) || ((String_Slave_Path = ptsname(File_Descriptor)) == NULL))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to unlock the pseudo-terminal (%s).\n", strerror(errno));
+		return 1;
+	}
+
+	// Keep a slave file descriptor opened for the whole simulator life and make the line raw, so binary data is not altered
+	UART_Backend_Pseudo_Terminal_Slave_File_Descriptor = open(String_Slave_Path, O_RDWR | O_NOCTTY);
+	if (UART_Backend_Pseudo_Terminal_Slave_File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to open the pseudo-terminal slave '%s' (%s).\n", String_Slave_Path, strerror(errno));
+		return 1;
+	}
+	if (tcgetattr(UART_Backend_Pseudo_Terminal_Slave_File_Descriptor, &Terminal_Attributes) == 0)
+	{
+		cfmakeraw(&Terminal_Attributes);
+		tcsetattr(UART_Backend_Pseudo_Terminal_Slave_File_Descriptor, TCSANOW, &Terminal_Attributes);
+	}
+
+	printf("UART is available on %s.\n", String_Slave_Path);
+	fflush(stdout); // The UART output may be written to the same file without buffering
+	LOG(LOG_LEVEL_ERROR, "UART is available on %s.\n", String_Slave_Path);
+	return UARTBackendWatchInput(File_Descriptor);
+}
+
+/** Create the Unix socket server.
+ * @param String_Path Where to create the socket.
+ * @return 0 on success,
+ * @return 1 if an error occurred.
+ */
+static int UARTBackendOpenUnixSocket(char *String_Path)
+{
+	struct sockaddr_un Address;
+
+	if ((String_Path == NULL) || (strlen(String_Path) >= sizeof(Address.sun_path)))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : a valid Unix socket path must be provided.\n");
+		return 1;
+	}
+
+	UART_Backend_Server_File_Descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (UART_Backend_Server_File_Descriptor == -1)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the Unix socket (%s).\n", strerror(errno));
+		return 1;
+	}
+
+	// Remove a stale socket left by a previous run
+	unlink(String_Path);
+	memset(&Address, 0, sizeof(Address));
+	Address.sun_family = AF_UNIX;
+	strcpy(Address.sun_path, String_Path);
+	if ((bind(UART_Backend_Server_File_Descriptor, (struct sockaddr *) &Address, sizeof(Address)) != 0) || (listen(UART_Backend_Server_File_Descriptor, 1) != 0))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to listen on the Unix socket '%s' (%s).\n", String_Path, strerror(errno));
+		return 1;
+	}
+	strcpy(UART_Backend_String_Socket_Path, String_Path);
+
+	LOG(LOG_LEVEL_ERROR, "UART is available on Unix socket '%s'.\n", String_Path);
+	return UARTBackendWatchInput(UART_Backend_Server_File_Descriptor);
+}
+
+/** Open (and create if needed) a named pipe.
+ * @param String_Path The pipe path.
+ * @return The pipe file descriptor on success,
+ * @return -1 if an error occurred.
+ */
+static int UARTBackendOpenNamedPipe(char *String_Path)
+{
+	int File_Descriptor;
+
+	if ((mkfifo(String_Path, 0600) != 0) && (errno != EEXIST))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the named pipe '%s' (%s).\n", String_Path, strerror(errno));
+		return -1;
+	}
+
+	// Opening the pipe for both reading and writing does not block until the other side is opened and never reports an end of file
+	File_Descriptor = open(String_Path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (File_Descriptor == -1) LOG(LOG_LEVEL_ERROR, "Error : failed to open the named pipe '%s' (%s).\n", String_Path, strerror(errno));
+	return File_Descriptor;
+}
+
+/** Open the reception and transmission named pipes.
+ * @param String_Paths The reception pipe path and the transmission pipe path, separated by a comma.
+ * @return 0 on success,
+ * @return 1 if an error occurred.
+ */
+static int UARTBackendOpenPipes(char *String_Paths)
+{
+	char String_Input_Path[PATH_MAX], *Pointer_Separator;
+	size_t Length;
+
+	if ((String_Paths == NULL) || ((Pointer_Separator = strchr(String_Paths, ',')) == NULL))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : the pipe backend needs two paths separated by a comma.\n");
+		return 1;
+	}
+	Length = Pointer_Separator - String_Paths;
+	if (Length >= sizeof(String_Input_Path))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : the reception pipe path is too long.\n");
+		return 1;
+	}
+	memcpy(String_Input_Path, String_Paths, Length);
+	String_Input_Path[Length] = 0;
+
+	UART_Backend_Input_File_Descriptor = UARTBackendOpenNamedPipe(String_Input_Path);
+	if (UART_Backend_Input_File_Descriptor == -1) return 1;
+	UART_Backend_Output_File_Descriptor = UARTBackendOpenNamedPipe(Pointer_Separator + 1);
+	if (UART_Backend_Output_File_Descriptor == -1) return 1;
+
+	return UARTBackendWatchInput(UART_Backend_Input_File_Descriptor);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int UARTBackendInitialize(TUARTBackendType Backend_Type, char *String_Path)
+{
+	int Result;
+
+	UART_Backend_Type = Backend_Type;
+	RingBufferInitialize(&UART_Backend_Transmission_Queue);
+	RingBufferInitialize(&UART_Backend_Reception_Queue);
+
+	UART_Backend_Epoll_File_Descriptor = epoll_create1(EPOLL_CLOEXEC);
+	UART_Backend_Event_File_Descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if ((UART_Backend_Epoll_File_Descriptor == -1) || (UART_Backend_Event_File_Descriptor == -1))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the I/O thread events (%s).\n", strerror(errno));
+		return 1;
+	}
+	if (UARTBackendWatchInput(UART_Backend_Event_File_Descriptor) != 0) return 1;
+
+	// A socket client or a pipe reader going away must not kill the simulator
+	signal(SIGPIPE, SIG_IGN);
+
+	// Open the host channel
+	switch (Backend_Type)
+	{
+		case UART_BACKEND_TYPE_CONSOLE:
+			// Received bytes are directly injected by the user interface
+			UART_Backend_Output_File_Descriptor = STDOUT_FILENO;
+			Result = 0;
+			break;
+
+		case UART_BACKEND_TYPE_PSEUDO_TERMINAL:
+			Result = UARTBackendOpenPseudoTerminal();
+			break;
+
+		case UART_BACKEND_TYPE_UNIX_SOCKET:
+			Result = UARTBackendOpenUnixSocket(String_Path);
+			break;
+
+		case UART_BACKEND_TYPE_PIPE:
+			Result = UARTBackendOpenPipes(String_Path);
+			break;
+
+		case UART_BACKEND_TYPE_NULL:
+			// Keep the I/O thread work so the simulator behaves like with a real host channel
+			UART_Backend_Output_File_Descriptor = open("/dev/null", O_WRONLY | O_CLOEXEC);
+			if (UART_Backend_Output_File_Descriptor == -1)
+			{
+				LOG(LOG_LEVEL_ERROR, "Error : failed to open /dev/null (%s).\n", strerror(errno));
+				Result = 1;
+			}
+			else Result = 0;
+			break;
+
+		default:
+			LOG(LOG_LEVEL_ERROR, "Error : unknown UART backend type (%d).\n", Backend_Type);
+			Result = 1;
+			break;
+	}
+	if (Result != 0) return 1;
+
+	if (pthread_create(&UART_Backend_Thread_ID, NULL, UARTBackendThreadIO, NULL) != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the I/O thread (%s).\n", strerror(errno));
+		return 1;
+	}
+	return 0;
+}
+
+void UARTBackendUninitialize(void)
+{
+	uint64_t Event_Value = 1;
+
+	// Wake the thread up so it sends the last bytes and exits
+	UART_Backend_Is_Exiting = 1;
+	if (write(UART_Backend_Event_File_Descriptor, &Event_Value, sizeof(Event_Value)) != sizeof(Event_Value)) LOG(LOG_LEVEL_WARNING, "WARNING : failed to notify the I/O thread (%s).\n", strerror(errno));
+	if (pthread_join(UART_Backend_Thread_ID, NULL) != 0) LOG(LOG_LEVEL_WARNING, "WARNING : failed to join the I/O thread.\n");
+	if (UART_Backend_Discarded_Bytes_Count > 0) LOG(LOG_LEVEL_WARNING, "WARNING : %llu transmitted UART bytes were discarded because the host channel was full.\n", UART_Backend_Discarded_Bytes_Count);
+
+	// Release the host channel
+	if (UART_Backend_Input_File_Descriptor != -1) close(UART_Backend_Input_File_Descriptor);
+	if ((UART_Backend_Output_File_Descriptor != -1) && (UART_Backend_Output_File_Descriptor != UART_Backend_Input_File_Descriptor) && (UART_Backend_Output_File_Descriptor != STDOUT_FILENO)) close(UART_Backend_Output_File_Descriptor);
+	if (UART_Backend_Pseudo_Terminal_Slave_File_Descriptor != -1) close(UART_Backend_Pseudo_Terminal_Slave_File_Descriptor);
+	if (UART_Backend_Server_File_Descriptor != -1)
+	{
+		close(UART_Backend_Server_File_Descriptor);
+		unlink(UART_Backend_String_Socket_Path);
+	}
+	close(UART_Backend_Event_File_Descriptor);
+	close(UART_Backend_Epoll_File_Descriptor);
+}
+
+void UARTBackendWriteByte(unsigned char Data)
+{
+	uint64_t Event_Value = 1;
+
+	// Never block the caller when nobody reads the host channel, discard the byte like the reception path does
+	if (RingBufferWriteByte(&UART_Backend_Transmission_Queue, Data) != 0)
+	{
+		if (UART_Backend_Discarded_Bytes_Count == 0) LOG(LOG_LEVEL_WARNING, "WARNING : the UART transmission queue is full, discarding the transmitted bytes until the host channel accepts data again.\n");
+		UART_Backend_Discarded_Bytes_Count++;
+		return;
+	}
+
+	// The I/O thread drains the queue until it is empty before going to sleep, so it needs to be woken up only once per sleep
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_exchange(&UART_Backend_Is_IO_Thread_Sleeping, 0))
+	{
+		if (write(UART_Backend_Event_File_Descriptor, &Event_Value, sizeof(Event_Value)) != sizeof(Event_Value)) LOG(LOG_LEVEL_WARNING, "WARNING : failed to notify the I/O thread (%s).\n", strerror(errno));
+	}
+}
+
+int UARTBackendIsReceivedDataAvailable(void)
+{
+	return !RingBufferIsEmpty(&UART_Backend_Reception_Queue);
+}
+
+int UARTBackendReadByte(unsigned char *Pointer_Data)
+{
+	return RingBufferReadByte(&UART_Backend_Reception_Queue, Pointer_Data);
+}
+
+void UARTBackendInjectByte(unsigned char Data)
+{
+	// The I/O thread is the reception queue producer for all other backends
+	if (UART_Backend_Type != UART_BACKEND_TYPE_CONSOLE) return;
+
+	if (RingBufferWriteByte(&UART_Backend_Reception_Queue, Data) != 0) LOG(LOG_LEVEL_WARNING, "WARNING : the UART reception queue is full, discarding byte 0x%02X.\n", Data);
+}
@@ -0,0 +1,767 @@
+/** @file Virtual_Terminal.c
+ * @see Virtual_Terminal.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <errno.h>
+#include <Log.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <UART_Backend.h>
+#include <Virtual_Terminal.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** The character is displayed in bold. */
+#define VIRTUAL_TERMINAL_ATTRIBUTE_BOLD 0x01
+/** The character is underlined. */
+#define VIRTUAL_TERMINAL_ATTRIBUTE_UNDERLINE 0x02
+/** The character blinks. */
+#define VIRTUAL_TERMINAL_ATTRIBUTE_BLINK 0x04
+/** The character foreground and background colors are swapped. */
+#define VIRTUAL_TERMINAL_ATTRIBUTE_REVERSE 0x08
+
+/** The color index meaning that the real terminal default color is used. */
+#define VIRTUAL_TERMINAL_COLOR_DEFAULT 9
+
+/** How many numeric parameters a control sequence can have, the following ones are ignored. */
+#define VIRTUAL_TERMINAL_MAXIMUM_PARAMETERS_COUNT 16
+/** Parameters values are saturated to this value, so a garbage sequence can't overflow them. */
+#define VIRTUAL_TERMINAL_MAXIMUM_PARAMETER_VALUE 9999
+
+/** Unchanged screen locations between two changed ones are sent again instead of moving the cursor when there are at most this amount of them (a cursor position sequence is at least 6 bytes long). */
+#define VIRTUAL_TERMINAL_MAXIMUM_RESENT_CELLS_COUNT 4
+
+/** How many columns separate two tabulation stops. */
+#define VIRTUAL_TERMINAL_TABULATION_SIZE 8
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** All escape sequences parser states. */
+typedef enum
+{
+	VIRTUAL_TERMINAL_PARSER_STATE_TEXT, //! Received characters are displayed.
+	VIRTUAL_TERMINAL_PARSER_STATE_ESCAPE, //! The escape character has been received.
+	VIRTUAL_TERMINAL_PARSER_STATE_CHARACTER_SET, //! A character set selection sequence waits for the character set designator.
+	VIRTUAL_TERMINAL_PARSER_STATE_CONTROL_SEQUENCE //! A control sequence waits for its parameters and its final character.
+} TVirtualTerminalParserState;
+
+/** A screen location content. */
+typedef struct
+{
+	unsigned char Character; //! The displayed character.
+	unsigned char Attributes; //! A combination of VIRTUAL_TERMINAL_ATTRIBUTE_xxx flags.
+	unsigned char Foreground_Color; //! The ANSI color index (VIRTUAL_TERMINAL_COLOR_DEFAULT for the real terminal default color).
+	unsigned char Background_Color; //! The ANSI color index (VIRTUAL_TERMINAL_COLOR_DEFAULT for the real terminal default color).
+} TVirtualTerminalCell;
+
+/** Everything a terminal displays. */
+typedef struct
+{
+	TVirtualTerminalCell Cells[VIRTUAL_TERMINAL_ROWS_COUNT][VIRTUAL_TERMINAL_COLUMNS_COUNT]; //! All screen locations.
+	int Cursor_Row; //! The row the next character will be displayed on.
+	int Cursor_Column; //! The column the next character will be displayed on.
+	int Is_Cursor_Visible; //! Set to 1 when the cursor is shown.
+} TVirtualTerminalScreen;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The screen the PIC draws to. */
+static TVirtualTerminalScreen Virtual_Terminal_Screen;
+/** The attributes and colors given to the next displayed characters (the character is always a space, so this is also the content of the erased locations). */
+static TVirtualTerminalCell Virtual_Terminal_Current_Style;
+/** A character has been displayed on the last column, the next one will be displayed at the beginning of the next row. */
+static int Virtual_Terminal_Is_Wrap_Pending;
+/** Tell whether the screen has been modified since the last frame was rendered. */
+static int Virtual_Terminal_Is_Screen_Modified;
+/** Protect the screen from concurrent accesses between the CPU thread and the threads looking at the screen. */
+static pthread_mutex_t Virtual_Terminal_Mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** The cursor row saved by the "save cursor" sequences. */
+static int Virtual_Terminal_Saved_Cursor_Row;
+/** The cursor column saved by the "save cursor" sequences. */
+static int Virtual_Terminal_Saved_Cursor_Column;
+/** The style saved by the "save cursor" sequences. */
+static TVirtualTerminalCell Virtual_Terminal_Saved_Style;
+
+/** The escape sequences parser state. */
+static TVirtualTerminalParserState Virtual_Terminal_Parser_State = VIRTUAL_TERMINAL_PARSER_STATE_TEXT;
+/** The current control sequence numeric parameters (a missing parameter is 0). */
+static int Virtual_Terminal_Parameters[VIRTUAL_TERMINAL_MAXIMUM_PARAMETERS_COUNT];
+/** How many parameters the current control sequence has. */
+static int Virtual_Terminal_Parameters_Count;
+/** Tell whether the current control sequence is a DEC private one (its parameters start with '?'). */
+static int Virtual_Terminal_Is_Private_Sequence;
+
+/** The screen being rendered, copied from the PIC screen so the CPU thread is not blocked while the frame is sent. */
+static TVirtualTerminalScreen Virtual_Terminal_Rendered_Screen;
+/** What the real terminal currently displays. */
+static TVirtualTerminalScreen Virtual_Terminal_Displayed_Screen;
+/** The style the real terminal currently uses. */
+static TVirtualTerminalCell Virtual_Terminal_Displayed_Style;
+
+/** How long to wait between two frames (in nanoseconds). */
+static long Virtual_Terminal_Frame_Period;
+
+/** Tell the render thread to terminate. */
+static volatile int Virtual_Terminal_Is_Exiting = 0;
+/** The render thread ID. */
+static pthread_t Virtual_Terminal_Thread_ID;
+
+//-------------------------------------------------------------------------------------------------
+// Public variables
+//-------------------------------------------------------------------------------------------------
+int Virtual_Terminal_Is_Enabled = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Erase a part of a row with the current style.
+ * @param Row The row to erase.
+ * @param First_Column The first erased column.
+ * @param Last_Column The last erased column (included).
+ */
+static void VirtualTerminalEraseRow(int Row, int First_Column, int Last_Column)
+{
+	int Column;
+	
+	for (Column = First_Column; Column <= Last_Column; Column++) Virtual_Terminal_Screen.Cells[Row][Column] = Virtual_Terminal_Current_Style;
+}
+
+/** Move all rows one row up and erase the last row. */
+static void VirtualTerminalScrollUp(void)
+{
+	memmove(Virtual_Terminal_Screen.Cells[0], Virtual_Terminal_Screen.Cells[1], sizeof(Virtual_Terminal_Screen.Cells[0]) * (VIRTUAL_TERMINAL_ROWS_COUNT - 1));
+	VirtualTerminalEraseRow(VIRTUAL_TERMINAL_ROWS_COUNT - 1, 0, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+}
+
+/** Move all rows one row down and erase the first row. */
+static void VirtualTerminalScrollDown(void)
+{
+	memmove(Virtual_Terminal_Screen.Cells[1], Virtual_Terminal_Screen.Cells[0], sizeof(Virtual_Terminal_Screen.Cells[0]) * (VIRTUAL_TERMINAL_ROWS_COUNT - 1));
+	VirtualTerminalEraseRow(0, 0, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+}
+
+/** Move the cursor to the next row, scrolling the screen if the cursor is on the last row. */
+static void VirtualTerminalLineFeed(void)
+{
+	if (Virtual_Terminal_Screen.Cursor_Row < VIRTUAL_TERMINAL_ROWS_COUNT - 1) Virtual_Terminal_Screen.Cursor_Row++;
+	else VirtualTerminalScrollUp();
+}
+
+/** Move the cursor to the previous row, scrolling the screen if the cursor is on the first row. */
+static void VirtualTerminalReverseLineFeed(void)
+{
+	if (Virtual_Terminal_Screen.Cursor_Row > 0) Virtual_Terminal_Screen.Cursor_Row--;
+	else VirtualTerminalScrollDown();
+}
+
+/** Erase the whole screen and restore the power-on settings. */
+static void VirtualTerminalReset(void)
+{
+	int Row;
+	
+	Virtual_Terminal_Current_Style.Character = ' ';
+	Virtual_Terminal_Current_Style.Attributes = 0;
+	Virtual_Terminal_Current_Style.Foreground_Color = VIRTUAL_TERMINAL_COLOR_DEFAULT;
+	Virtual_Terminal_Current_Style.Background_Color = VIRTUAL_TERMINAL_COLOR_DEFAULT;
+	for (Row = 0; Row < VIRTUAL_TERMINAL_ROWS_COUNT; Row++) VirtualTerminalEraseRow(Row, 0, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+	
+	Virtual_Terminal_Screen.Cursor_Row = 0;
+	Virtual_Terminal_Screen.Cursor_Column = 0;
+	Virtual_Terminal_Screen.Is_Cursor_Visible = 1;
+	Virtual_Terminal_Is_Wrap_Pending = 0;
+	
+	Virtual_Terminal_Saved_Cursor_Row = 0;
+	Virtual_Terminal_Saved_Cursor_Column = 0;
+	Virtual_Terminal_Saved_Style = Virtual_Terminal_Current_Style;
+}
+
+/** Display a character at the cursor location and move the cursor to the right.
+ * @param Character The character to display.
+ */
+static void VirtualTerminalDisplayCharacter(unsigned char Character)
+{
+	TVirtualTerminalCell *Pointer_Cell;
+	
+	// Automatic wrap is done when the character following the last column one is received, like a real VT100
+	if (Virtual_Terminal_Is_Wrap_Pending)
+	{
+		Virtual_Terminal_Screen.Cursor_Column = 0;
+		VirtualTerminalLineFeed();
+		Virtual_Terminal_Is_Wrap_Pending = 0;
+	}
+	
+	Pointer_Cell = &Virtual_Terminal_Screen.Cells[Virtual_Terminal_Screen.Cursor_Row][Virtual_Terminal_Screen.Cursor_Column];
+	*Pointer_Cell = Virtual_Terminal_Current_Style;
+	Pointer_Cell->Character = Character;
+	
+	if (Virtual_Terminal_Screen.Cursor_Column < VIRTUAL_TERMINAL_COLUMNS_COUNT - 1) Virtual_Terminal_Screen.Cursor_Column++;
+	else Virtual_Terminal_Is_Wrap_Pending = 1;
+}
+
+/** Execute a C0 control character.
+ * @param Character The control character.
+ */
+static void VirtualTerminalExecuteControlCharacter(unsigned char Character)
+{
+	switch (Character)
+	{
+		// Backspace
+		case '\b':
+			if (Virtual_Terminal_Screen.Cursor_Column > 0) Virtual_Terminal_Screen.Cursor_Column--;
+			break;
+		
+		// Horizontal tabulation
+		case '\t':
+			Virtual_Terminal_Screen.Cursor_Column = (Virtual_Terminal_Screen.Cursor_Column / VIRTUAL_TERMINAL_TABULATION_SIZE + 1) * VIRTUAL_TERMINAL_TABULATION_SIZE;
+			if (Virtual_Terminal_Screen.Cursor_Column >= VIRTUAL_TERMINAL_COLUMNS_COUNT) Virtual_Terminal_Screen.Cursor_Column = VIRTUAL_TERMINAL_COLUMNS_COUNT - 1;
+			break;
+		
+		// Line feed, vertical tabulation and form feed all behave the same
+		case '\n':
+		case '\v':
+		case '\f':
+			VirtualTerminalLineFeed();
+			break;
+		
+		// Carriage return
+		case '\r':
+			Virtual_Terminal_Screen.Cursor_Column = 0;
+			break;
+		
+		// Bell and other control characters do not modify the screen
+		default:
+			return;
+	}
+	Virtual_Terminal_Is_Wrap_Pending = 0;
+}
+
+/** Retrieve a control sequence numeric parameter.
+ * @param Index The parameter index.
+ * @param Default_Value The value to use when the parameter is missing or is 0.
+ * @return The parameter value.
+ */
+static int VirtualTerminalGetParameter(int Index, int Default_Value)
+{
+	if ((Index >= Virtual_Terminal_Parameters_Count) || (Virtual_Terminal_Parameters[Index] == 0)) return Default_Value;
+	return Virtual_Terminal_Parameters[Index];
+}
+
+/** Limit a value to a range.
+ * @param Value The value to limit.
+ * @param Maximum_Value The highest allowed value (the lowest one is 0).
+ * @return The limited value.
+ */
+static inline int VirtualTerminalClamp(int Value, int Maximum_Value)
+{
+	if (Value < 0) return 0;
+	if (Value > Maximum_Value) return Maximum_Value;
+	return Value;
+}
+
+/** Change the style of the next displayed characters according to the current "select graphic rendition" sequence parameters. */
+static void VirtualTerminalSelectGraphicRendition(void)
+{
+	int i, Parameter;
+	
+	for (i = 0; i < Virtual_Terminal_Parameters_Count; i++)
+	{
+		Parameter = Virtual_Terminal_Parameters[i];
+		if (Parameter == 0)
+		{
+			Virtual_Terminal_Current_Style.Attributes = 0;
+			Virtual_Terminal_Current_Style.Foreground_Color = VIRTUAL_TERMINAL_COLOR_DEFAULT;
+			Virtual_Terminal_Current_Style.Background_Color = VIRTUAL_TERMINAL_COLOR_DEFAULT;
+		}
+		else if (Parameter == 1) Virtual_Terminal_Current_Style.Attributes |= VIRTUAL_TERMINAL_ATTRIBUTE_BOLD;
+		else if (Parameter == 4) Virtual_Terminal_Current_Style.Attributes |= VIRTUAL_TERMINAL_ATTRIBUTE_UNDERLINE;
+		else if (Parameter == 5) Virtual_Terminal_Current_Style.Attributes |= VIRTUAL_TERMINAL_ATTRIBUTE_BLINK;
+		else if (Parameter == 7) Virtual_Terminal_Current_Style.Attributes |= VIRTUAL_TERMINAL_ATTRIBUTE_REVERSE;
+		else if (Parameter == 22) Virtual_Terminal_Current_Style.Attributes &= ~VIRTUAL_TERMINAL_ATTRIBUTE_BOLD;
+		else if (Parameter == 24) Virtual_Terminal_Current_Style.Attributes &= ~VIRTUAL_TERMINAL_ATTRIBUTE_UNDERLINE;
+		else if (Parameter == 25) Virtual_Terminal_Current_Style.Attributes &= ~VIRTUAL_TERMINAL_ATTRIBUTE_BLINK;
+		else if (Parameter == 27) Virtual_Terminal_Current_Style.Attributes &= ~VIRTUAL_TERMINAL_ATTRIBUTE_REVERSE;
+		else if (((Parameter >= 30) && (Parameter <= 37)) || (Parameter == 39)) Virtual_Terminal_Current_Style.Foreground_Color = Parameter - 30;
+		else if (((Parameter >= 40) && (Parameter <= 47)) || (Parameter == 49)) Virtual_Terminal_Current_Style.Background_Color = Parameter - 40;
+		else LOG(LOG_LEVEL_DEBUG, "Ignoring unsupported graphic rendition %d.\n", Parameter);
+	}
+}
+
+/** Execute the current control sequence.
+ * @param Final_Character The character terminating the sequence, it tells which command to execute.
+ */
+static void VirtualTerminalExecuteControlSequence(unsigned char Final_Character)
+{
+	int Row, Parameter;
+	
+	// DEC private modes, only the cursor visibility changes the screen
+	if (Virtual_Terminal_Is_Private_Sequence)
+	{
+		if (((Final_Character == 'h') || (Final_Character == 'l')) && (VirtualTerminalGetParameter(0, 0) == 25)) Virtual_Terminal_Screen.Is_Cursor_Visible = (Final_Character == 'h');
+		return;
+	}
+	
+	switch (Final_Character)
+	{
+		// Cursor up
+		case 'A':
+			Virtual_Terminal_Screen.Cursor_Row = VirtualTerminalClamp(Virtual_Terminal_Screen.Cursor_Row - VirtualTerminalGetParameter(0, 1), VIRTUAL_TERMINAL_ROWS_COUNT - 1);
+			break;
+		
+		// Cursor down
+		case 'B':
+			Virtual_Terminal_Screen.Cursor_Row = VirtualTerminalClamp(Virtual_Terminal_Screen.Cursor_Row + VirtualTerminalGetParameter(0, 1), VIRTUAL_TERMINAL_ROWS_COUNT - 1);
+			break;
+		
+		// Cursor forward
+		case 'C':
+			Virtual_Terminal_Screen.Cursor_Column = VirtualTerminalClamp(Virtual_Terminal_Screen.Cursor_Column + VirtualTerminalGetParameter(0, 1), VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+			break;
+		
+		// Cursor backward
+		case 'D':
+			Virtual_Terminal_Screen.Cursor_Column = VirtualTerminalClamp(Virtual_Terminal_Screen.Cursor_Column - VirtualTerminalGetParameter(0, 1), VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+			break;
+		
+		// Cursor horizontal absolute
+		case 'G':
+			Virtual_Terminal_Screen.Cursor_Column = VirtualTerminalClamp(VirtualTerminalGetParameter(0, 1) - 1, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+			break;
+		
+		// Line position absolute
+		case 'd':
+			Virtual_Terminal_Screen.Cursor_Row = VirtualTerminalClamp(VirtualTerminalGetParameter(0, 1) - 1, VIRTUAL_TERMINAL_ROWS_COUNT - 1);
+			break;
+		
+		// Cursor position (parameters are 1-based)
+		case 'H':
+		case 'f':
+			Virtual_Terminal_Screen.Cursor_Row = VirtualTerminalClamp(VirtualTerminalGetParameter(0, 1) - 1, VIRTUAL_TERMINAL_ROWS_COUNT - 1);
+			Virtual_Terminal_Screen.Cursor_Column = VirtualTerminalClamp(VirtualTerminalGetParameter(1, 1) - 1, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+			break;
+		
+		// Erase in display
+		case 'J':
+			Parameter = VirtualTerminalGetParameter(0, 0);
+			if (Parameter == 0)
+			{
+				VirtualTerminalEraseRow(Virtual_Terminal_Screen.Cursor_Row, Virtual_Terminal_Screen.Cursor_Column, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+				for (Row = Virtual_Terminal_Screen.Cursor_Row + 1; Row < VIRTUAL_TERMINAL_ROWS_COUNT; Row++) VirtualTerminalEraseRow(Row, 0, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+			}
+			else if (Parameter == 1)
+			{
+				for (Row = 0; Row < Virtual_Terminal_Screen.Cursor_Row; Row++) VirtualTerminalEraseRow(Row, 0, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+				VirtualTerminalEraseRow(Virtual_Terminal_Screen.Cursor_Row, 0, Virtual_Terminal_Screen.Cursor_Column);
+			}
+			else if (Parameter == 2)
+			{
+				for (Row = 0; Row < VIRTUAL_TERMINAL_ROWS_COUNT; Row++) VirtualTerminalEraseRow(Row, 0, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+			}
+			break;
+		
+		// Erase in line
+		case 'K':
+			Parameter = VirtualTerminalGetParameter(0, 0);
+			if (Parameter == 0) VirtualTerminalEraseRow(Virtual_Terminal_Screen.Cursor_Row, Virtual_Terminal_Screen.Cursor_Column, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+			else if (Parameter == 1) VirtualTerminalEraseRow(Virtual_Terminal_Screen.Cursor_Row, 0, Virtual_Terminal_Screen.Cursor_Column);
+			else if (Parameter == 2) VirtualTerminalEraseRow(Virtual_Terminal_Screen.Cursor_Row, 0, VIRTUAL_TERMINAL_COLUMNS_COUNT - 1);
+			break;
+		
+		// Select graphic rendition (the cursor is not moved, so a pending wrap is kept)
+		case 'm':
+			VirtualTerminalSelectGraphicRendition();
+			return;
+		
+		// Save cursor
+		case 's':
+			Virtual_Terminal_Saved_Cursor_Row = Virtual_Terminal_Screen.Cursor_Row;
+			Virtual_Terminal_Saved_Cursor_Column = Virtual_Terminal_Screen.Cursor_Column;
+			break;
+		
+		// Restore cursor
+		case 'u':
+			Virtual_Terminal_Screen.Cursor_Row = Virtual_Terminal_Saved_Cursor_Row;
+			Virtual_Terminal_Screen.Cursor_Column = Virtual_Terminal_Saved_Cursor_Column;
+			break;
+		
+		default:
+			LOG(LOG_LEVEL_DEBUG, "Ignoring unsupported control sequence '%c'.\n", Final_Character);
+			return;
+	}
+	Virtual_Terminal_Is_Wrap_Pending = 0;
+}
+
+/** Execute a two-character escape sequence.
+ * @param Character The character following the escape character.
+ */
+static void VirtualTerminalExecuteEscapeSequence(unsigned char Character)
+{
+	switch (Character)
+	{
+		// Control sequence introducer
+		case '[':
+			Virtual_Terminal_Parameters[0] = 0;
+			Virtual_Terminal_Parameters_Count = 1;
+			Virtual_Terminal_Is_Private_Sequence = 0;
+			Virtual_Terminal_Parser_State = VIRTUAL_TERMINAL_PARSER_STATE_CONTROL_SEQUENCE;
+			return;
+		
+		// Character set selection, all characters are displayed as received
+		case '(':
+		case ')':
+			Virtual_Terminal_Parser_State = VIRTUAL_TERMINAL_PARSER_STATE_CHARACTER_SET;
+			return;
+		
+		// Save cursor and style
+		case '7':
+			Virtual_Terminal_Saved_Cursor_Row = Virtual_Terminal_Screen.Cursor_Row;
+			Virtual_Terminal_Saved_Cursor_Column = Virtual_Terminal_Screen.Cursor_Column;
+			Virtual_Terminal_Saved_Style = Virtual_Terminal_Current_Style;
+			break;
+		
+		// Restore cursor and style
+		case '8':
+			Virtual_Terminal_Screen.Cursor_Row = Virtual_Terminal_Saved_Cursor_Row;
+			Virtual_Terminal_Screen.Cursor_Column = Virtual_Terminal_Saved_Cursor_Column;
+			Virtual_Terminal_Current_Style = Virtual_Terminal_Saved_Style;
+			Virtual_Terminal_Is_Wrap_Pending = 0;
+			break;
+		
+		// Index
+		case 'D':
+			VirtualTerminalLineFeed();
+			Virtual_Terminal_Is_Wrap_Pending = 0;
+			break;
+		
+		// Next line
+		case 'E':
+			Virtual_Terminal_Screen.Cursor_Column = 0;
+			VirtualTerminalLineFeed();
+			Virtual_Terminal_Is_Wrap_Pending = 0;
+			break;
+		
+		// Reverse index
+		case 'M':
+			VirtualTerminalReverseLineFeed();
+			Virtual_Terminal_Is_Wrap_Pending = 0;
+			break;
+		
+		// Reset to initial state
+		case 'c':
+			VirtualTerminalReset();
+			break;
+		
+		default:
+			LOG(LOG_LEVEL_DEBUG, "Ignoring unsupported escape sequence '%c'.\n", Character);
+			break;
+	}
+	Virtual_Terminal_Parser_State = VIRTUAL_TERMINAL_PARSER_STATE_TEXT;
+}
+
+/** Add a control sequence character to the current sequence, executing the sequence when it is complete.
+ * @param Character The received character.
+ */
+static void VirtualTerminalParseControlSequence(unsigned char Character)
+{
+	int *Pointer_Parameter;
+	
+	if ((Character >= '0') && (Character <= '9'))
+	{
+		Pointer_Parameter = &Virtual_Terminal_Parameters[Virtual_Terminal_Parameters_Count - 1];
+		if (*Pointer_Parameter <= (VIRTUAL_TERMINAL_MAXIMUM_PARAMETER_VALUE - 9) / 10) *Pointer_Parameter = *Pointer_Parameter * 10 + Character - '0';
+		else *Pointer_Parameter = VIRTUAL_TERMINAL_MAXIMUM_PARAMETER_VALUE;
+	}
+	else if (Character == ';')
+	{
+		if (Virtual_Terminal_Parameters_Count < VIRTUAL_TERMINAL_MAXIMUM_PARAMETERS_COUNT)
+		{
+			Virtual_Terminal_Parameters[Virtual_Terminal_Parameters_Count] = 0;
+			Virtual_Terminal_Parameters_Count++;
+		}
+	}
+	else if (Character == '?') Virtual_Terminal_Is_Private_Sequence = 1;
+	else if (Character == 0x1B) Virtual_Terminal_Parser_State = VIRTUAL_TERMINAL_PARSER_STATE_ESCAPE; // An escape character cancels the sequence and starts a new one
+	else if ((Character >= 0x40) && (Character <= 0x7E))
+	{
+		VirtualTerminalExecuteControlSequence(Character);
+		Virtual_Terminal_Parser_State = VIRTUAL_TERMINAL_PARSER_STATE_TEXT;
+	}
+	else if (Character < 0x20) VirtualTerminalExecuteControlCharacter(Character); // Control characters are executed even in the middle of a sequence
+	// Intermediate characters are ignored
+}
+
+/** Send a string to the UART backend.
+ * @param String The string to send.
+ */
+static void VirtualTerminalSendString(const char *String)
+{
+	while (*String != 0)
+	{
+		UARTBackendWriteByte((unsigned char) *String);
+		String++;
+	}
+}
+
+/** Tell the real terminal to move its cursor.
+ * @param Row The cursor row.
+ * @param Column The cursor column.
+ */
+static void VirtualTerminalSendCursorPosition(int Row, int Column)
+{
+	char String_Sequence[32];
+	
+	sprintf(String_Sequence, "\x1B[%d;%dH", Row + 1, Column + 1);
+	VirtualTerminalSendString(String_Sequence);
+}
+
+/** Tell the real terminal to use another style.
+ * @param Pointer_Style The attributes and colors to use.
+ */
+static void VirtualTerminalSendStyle(const TVirtualTerminalCell *Pointer_Style)
+{
+	char String_Sequence[32], *Pointer_String;
+	
+	// Start from the default style so no previous attribute needs to be explicitly removed
+	Pointer_String = String_Sequence;
+	Pointer_String += sprintf(Pointer_String, "\x1B[0");
+	if (Pointer_Style->Attributes & VIRTUAL_TERMINAL_ATTRIBUTE_BOLD) Pointer_String += sprintf(Pointer_String, ";1");
+	if (Pointer_Style->Attributes & VIRTUAL_TERMINAL_ATTRIBUTE_UNDERLINE) Pointer_String += sprintf(Pointer_String, ";4");
+	if (Pointer_Style->Attributes & VIRTUAL_TERMINAL_ATTRIBUTE_BLINK) Pointer_String += sprintf(Pointer_String, ";5");
+	if (Pointer_Style->Attributes & VIRTUAL_TERMINAL_ATTRIBUTE_REVERSE) Pointer_String += sprintf(Pointer_String, ";7");
+	if (Pointer_Style->Foreground_Color != VIRTUAL_TERMINAL_COLOR_DEFAULT) Pointer_String += sprintf(Pointer_String, ";%d", 30 + Pointer_Style->Foreground_Color);
+	if (Pointer_Style->Background_Color != VIRTUAL_TERMINAL_COLOR_DEFAULT) Pointer_String += sprintf(Pointer_String, ";%d", 40 + Pointer_Style->Background_Color);
+	strcpy(Pointer_String, "m");
+	VirtualTerminalSendString(String_Sequence);
+}
+
+/** Tell whether two screen locations are displayed with the same attributes and colors.
+ * @param Pointer_First_Cell The first location.
+ * @param Pointer_Second_Cell The second location.
+ * @return 0 if the styles are different,
+ * @return 1 if the styles are the same.
+ */
+static inline int VirtualTerminalIsSameStyle(const TVirtualTerminalCell *Pointer_First_Cell, const TVirtualTerminalCell *Pointer_Second_Cell)
+{
+	return (Pointer_First_Cell->Attributes == Pointer_Second_Cell->Attributes) && (Pointer_First_Cell->Foreground_Color == Pointer_Second_Cell->Foreground_Color) && (Pointer_First_Cell->Background_Color == Pointer_Second_Cell->Background_Color);
+}
+
+/** Send the screen locations that changed since the previous frame to the UART backend. */
+static void VirtualTerminalRenderFrame(void)
+{
+	int Row, Column, Displayed_Cursor_Row, Displayed_Cursor_Column, Is_Cursor_Hidden = 0, Gap_Column;
+	TVirtualTerminalCell *Pointer_Rendered_Cell, *Pointer_Displayed_Cell;
+	
+	// Take a consistent picture of the screen
+	pthread_mutex_lock(&Virtual_Terminal_Mutex);
+	if (!Virtual_Terminal_Is_Screen_Modified)
+	{
+		pthread_mutex_unlock(&Virtual_Terminal_Mutex);
+		return;
+	}
+	Virtual_Terminal_Rendered_Screen = Virtual_Terminal_Screen;
+	Virtual_Terminal_Is_Screen_Modified = 0;
+	pthread_mutex_unlock(&Virtual_Terminal_Mutex);
+	
+	// The real terminal cursor is left after the last sent character, a column equal to the row size means that it is in an unknown state (some terminals wrap immediately, some wait for the next character)
+	Displayed_Cursor_Row = Virtual_Terminal_Displayed_Screen.Cursor_Row;
+	Displayed_Cursor_Column = Virtual_Terminal_Displayed_Screen.Cursor_Column;
+	for (Row = 0; Row < VIRTUAL_TERMINAL_ROWS_COUNT; Row++)
+	{
+		// Most rows do not change between two frames
+		if (memcmp(Virtual_Terminal_Rendered_Screen.Cells[Row], Virtual_Terminal_Displayed_Screen.Cells[Row], sizeof(Virtual_Terminal_Rendered_Screen.Cells[Row])) == 0) continue;
+		
+		for (Column = 0; Column < VIRTUAL_TERMINAL_COLUMNS_COUNT; Column++)
+		{
+			Pointer_Rendered_Cell = &Virtual_Terminal_Rendered_Screen.Cells[Row][Column];
+			Pointer_Displayed_Cell = &Virtual_Terminal_Displayed_Screen.Cells[Row][Column];
+			if (memcmp(Pointer_Rendered_Cell, Pointer_Displayed_Cell, sizeof(TVirtualTerminalCell)) == 0) continue;
+			
+			// Hide the cursor while it jumps across the screen
+			if (!Is_Cursor_Hidden && Virtual_Terminal_Displayed_Screen.Is_Cursor_Visible) VirtualTerminalSendString("\x1B[?25l");
+			Is_Cursor_Hidden = 1;
+			
+			// Sending again a few unchanged characters is shorter than moving the cursor
+			if ((Row == Displayed_Cursor_Row) && (Column > Displayed_Cursor_Column) && (Column - Displayed_Cursor_Column <= VIRTUAL_TERMINAL_MAXIMUM_RESENT_CELLS_COUNT))
+			{
+				for (Gap_Column = Displayed_Cursor_Column; Gap_Column < Column; Gap_Column++)
+				{
+					if (!VirtualTerminalIsSameStyle(&Virtual_Terminal_Displayed_Screen.Cells[Row][Gap_Column], &Virtual_Terminal_Displayed_Style)) break;
+				}
+				if (Gap_Column == Column)
+				{
+					for (Gap_Column = Displayed_Cursor_Column; Gap_Column < Column; Gap_Column++) UARTBackendWriteByte(Virtual_Terminal_Displayed_Screen.Cells[Row][Gap_Column].Character);
+					Displayed_Cursor_Column = Column;
+				}
+			}
+			if ((Row != Displayed_Cursor_Row) || (Column != Displayed_Cursor_Column)) VirtualTerminalSendCursorPosition(Row, Column);
+			
+			if (!VirtualTerminalIsSameStyle(Pointer_Rendered_Cell, &Virtual_Terminal_Displayed_Style))
+			{
+				VirtualTerminalSendStyle(Pointer_Rendered_Cell);
+				Virtual_Terminal_Displayed_Style = *Pointer_Rendered_Cell;
+			}
+			UARTBackendWriteByte(Pointer_Rendered_Cell->Character);
+			
+			*Pointer_Displayed_Cell = *Pointer_Rendered_Cell;
+			Displayed_Cursor_Row = Row;
+			Displayed_Cursor_Column = Column + 1;
+		}
+	}
+	
+	// Put the cursor where the PIC expects it
+	if ((Virtual_Terminal_Rendered_Screen.Cursor_Row != Displayed_Cursor_Row) || (Virtual_Terminal_Rendered_Screen.Cursor_Column != Displayed_Cursor_Column)) VirtualTerminalSendCursorPosition(Virtual_Terminal_Rendered_Screen.Cursor_Row, Virtual_Terminal_Rendered_Screen.Cursor_Column);
+	Virtual_Terminal_Displayed_Screen.Cursor_Row = Virtual_Terminal_Rendered_Screen.Cursor_Row;
+	Virtual_Terminal_Displayed_Screen.Cursor_Column = Virtual_Terminal_Rendered_Screen.Cursor_Column;
+	
+	// Show the cursor again only if the PIC wants it
+	if (Is_Cursor_Hidden) Virtual_Terminal_Displayed_Screen.Is_Cursor_Visible = 0;
+	if (Virtual_Terminal_Rendered_Screen.Is_Cursor_Visible != Virtual_Terminal_Displayed_Screen.Is_Cursor_Visible)
+	{
+		if (Virtual_Terminal_Rendered_Screen.Is_Cursor_Visible) VirtualTerminalSendString("\x1B[?25h");
+		else VirtualTerminalSendString("\x1B[?25l");
+		Virtual_Terminal_Displayed_Screen.Is_Cursor_Visible = Virtual_Terminal_Rendered_Screen.Is_Cursor_Visible;
+	}
+}
+
+/** Render the screen at the selected frame rate.
+ * @return always NULL.
+ */
+static void *VirtualTerminalThreadRender(void __attribute__((unused)) *Pointer_Parameters)
+{
+	struct timespec Frame_Period;
+	
+	LOG(LOG_LEVEL_DEBUG, "Thread started.\n");
+	
+	Frame_Period.tv_sec = Virtual_Terminal_Frame_Period / 1000000000L;
+	Frame_Period.tv_nsec = Virtual_Terminal_Frame_Period % 1000000000L;
+	while (!Virtual_Terminal_Is_Exiting)
+	{
+		// A frame is rendered at most once per period, even if the host channel was too slow to send the previous one in time
+		nanosleep(&Frame_Period, NULL);
+		VirtualTerminalRenderFrame();
+	}
+	
+	LOG(LOG_LEVEL_DEBUG, "Thread exited.\n");
+	return NULL;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int VirtualTerminalInitialize(int Frames_Per_Second)
+{
+	if ((Frames_Per_Second < 0) || (Frames_Per_Second > VIRTUAL_TERMINAL_MAXIMUM_FRAMES_PER_SECOND))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : the virtual terminal frame rate must be between 0 and %d frames per second.\n", VIRTUAL_TERMINAL_MAXIMUM_FRAMES_PER_SECOND);
+		return 1;
+	}
+	
+	VirtualTerminalReset();
+	Virtual_Terminal_Is_Enabled = 1;
+	
+	// Nothing is sent to the UART backend, the screen can only be inspected by the simulator
+	if (Frames_Per_Second == 0)
+	{
+		LOG(LOG_LEVEL_DEBUG, "Virtual terminal enabled without rendering.\n");
+		return 0;
+	}
+	
+	// Start from a known real terminal state, so only differences need to be sent
+	Virtual_Terminal_Displayed_Screen = Virtual_Terminal_Screen;
+	Virtual_Terminal_Displayed_Style = Virtual_Terminal_Current_Style;
+	VirtualTerminalSendString("\x1B[0m\x1B[2J\x1B[H\x1B[?25h");
+	
+	Virtual_Terminal_Frame_Period = 1000000000L / Frames_Per_Second;
+	if (pthread_create(&Virtual_Terminal_Thread_ID, NULL, VirtualTerminalThreadRender, NULL) != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : failed to create the render thread (%s).\n", strerror(errno));
+		return 1;
+	}
+	LOG(LOG_LEVEL_DEBUG, "Virtual terminal enabled at %d frames per second.\n", Frames_Per_Second);
+	return 0;
+}
+
+void VirtualTerminalUninitialize(void)
+{
+	if (Virtual_Terminal_Frame_Period == 0) return;
+	
+	Virtual_Terminal_Is_Exiting = 1;
+	if (pthread_join(Virtual_Terminal_Thread_ID, NULL) != 0) LOG(LOG_LEVEL_WARNING, "WARNING : failed to join the render thread.\n");
+	
+	// The real terminal must display what the PIC drew last
+	VirtualTerminalRenderFrame();
+}
+
+void VirtualTerminalWriteByte(unsigned char Data)
+{
+	pthread_mutex_lock(&Virtual_Terminal_Mutex);
+	
+	switch (Virtual_Terminal_Parser_State)
+	{
+		case VIRTUAL_TERMINAL_PARSER_STATE_TEXT:
+			if (Data == 0x1B) Virtual_Terminal_Parser_State = VIRTUAL_TERMINAL_PARSER_STATE_ESCAPE;
+			else if (Data < 0x20) VirtualTerminalExecuteControlCharacter(Data);
+			else if (Data != 0x7F) VirtualTerminalDisplayCharacter(Data); // The delete character is ignored by terminals
+			break;
+		
+		case VIRTUAL_TERMINAL_PARSER_STATE_ESCAPE:
+			VirtualTerminalExecuteEscapeSequence(Data);
+			break;
+		
+		case VIRTUAL_TERMINAL_PARSER_STATE_CHARACTER_SET:
+			Virtual_Terminal_Parser_State = VIRTUAL_TERMINAL_PARSER_STATE_TEXT;
+			break;
+		
+		case VIRTUAL_TERMINAL_PARSER_STATE_CONTROL_SEQUENCE:
+			VirtualTerminalParseControlSequence(Data);
+			break;
+	}
+	Virtual_Terminal_Is_Screen_Modified = 1;
+	
+	pthread_mutex_unlock(&Virtual_Terminal_Mutex);
+}
+
+void VirtualTerminalReadRow(int Row, char *String_Row)
+{
+	int Column;
+	
+	pthread_mutex_lock(&Virtual_Terminal_Mutex);
+	for (Column = 0; Column < VIRTUAL_TERMINAL_COLUMNS_COUNT; Column++) String_Row[Column] = Virtual_Terminal_Screen.Cells[Row][Column].Character;
+	pthread_mutex_unlock(&Virtual_Terminal_Mutex);
+	String_Row[VIRTUAL_TERMINAL_COLUMNS_COUNT] = 0;
+}
+
+int VirtualTerminalFindText(int Row, const char *String_Text)
+{
+	char String_Row[VIRTUAL_TERMINAL_COLUMNS_COUNT + 1], *Pointer_Text;
+	
+	if ((Row < 0) || (Row >= VIRTUAL_TERMINAL_ROWS_COUNT)) return -1;
+	
+	VirtualTerminalReadRow(Row, String_Row);
+	Pointer_Text = strstr(String_Row, String_Text);
+	if (Pointer_Text == NULL) return -1;
+	return Pointer_Text - String_Row;
+}
+
+void VirtualTerminalDump(void)
+{
+	char String_Row[VIRTUAL_TERMINAL_COLUMNS_COUNT + 1];
+	int Row, Cursor_Row, Cursor_Column;
+	
+	pthread_mutex_lock(&Virtual_Terminal_Mutex);
+	Cursor_Row = Virtual_Terminal_Screen.Cursor_Row;
+	Cursor_Column = Virtual_Terminal_Screen.Cursor_Column;
+	pthread_mutex_unlock(&Virtual_Terminal_Mutex);
+	
+	LOG(LOG_LEVEL_ERROR, "Virtual terminal screen (cursor at row %d, column %d) :\n", Cursor_Row, Cursor_Column);
+	for (Row = 0; Row < VIRTUAL_TERMINAL_ROWS_COUNT; Row++)
+	{
+		VirtualTerminalReadRow(Row, String_Row);
+		LOG(LOG_LEVEL_ERROR, "%02d |%s|\n", Row, String_Row);
+	}
+}
@@ -0,0 +1,166 @@
+/** @file Watchpoint.c
+ * @see Watchpoint.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Core.h>
+#include <Debugger.h>
+#include <Disassembler.h>
+#include <Log.h>
+#include <Register_File.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Watchpoint.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** A location watchpoint. */
+typedef struct
+{
+	int Types; //! The watched accesses (WATCHPOINT_TYPE_XXX bits), 0 if the location is not watched.
+	int Value; //! The value to match or WATCHPOINT_VALUE_ANY.
+	TWatchpointAction Action; //! What to do when an access matches.
+} TWatchpoint;
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The watchpoint of each register file physical location. */
+static TWatchpoint Watchpoint_Table[REGISTER_FILE_LOCATIONS_COUNT];
+
+/** The location accessed by the last watchpoint that halted the board. */
+static unsigned int Watchpoint_Last_Hit_Location;
+/** The type of the last watchpoint that halted the board. */
+static TWatchpointType Watchpoint_Last_Hit_Type;
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+int WatchpointSet(unsigned int Location, TWatchpointType Type, int Value, TWatchpointAction Action)
+{
+	TWatchpoint *Pointer_Watchpoint;
+	
+	if ((Location >= REGISTER_FILE_LOCATIONS_COUNT) || ((Location % REGISTER_FILE_REGISTERS_IN_BANK_COUNT) == REGISTER_FILE_REGISTER_ADDRESS_INDF)) return 1;
+	Pointer_Watchpoint = &Watchpoint_Table[Location];
+	
+	if ((Pointer_Watchpoint->Types != 0) && (Pointer_Watchpoint->Action == Action) && (Pointer_Watchpoint->Value == Value)) Pointer_Watchpoint->Types |= Type;
+	else
+	{
+		Pointer_Watchpoint->Types = Type;
+		Pointer_Watchpoint->Value = Value;
+		Pointer_Watchpoint->Action = Action;
+	}
+	
+	RegisterFileHookAccesses(Location, 1);
+	return 0;
+}
+
+int WatchpointSetFromString(char *String_Description)
+{
+	unsigned long Address;
+	long Value = WATCHPOINT_VALUE_ANY;
+	TWatchpointType Type = WATCHPOINT_TYPE_WRITE;
+	char *Pointer_Character;
+	
+	// Retrieve the address
+	Address = strtoul(String_Description, &Pointer_Character, 0);
+	if ((Pointer_Character == String_Description) || (Address >= REGISTER_FILE_LOCATIONS_COUNT))
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : invalid watchpoint address in '%s'.\n", String_Description);
+		return 1;
+	}
+	
+	// Retrieve the optional access type
+	if (*Pointer_Character == ':')
+	{
+		Pointer_Character++;
+		if (strncmp(Pointer_Character, "rw", 2) == 0)
+		{
+			Type = WATCHPOINT_TYPE_ACCESS;
+			Pointer_Character += 2;
+		}
+		else if (*Pointer_Character == 'r')
+		{
+			Type = WATCHPOINT_TYPE_READ;
+			Pointer_Character++;
+		}
+		else if (*Pointer_Character == 'w') Pointer_Character++;
+		else
+		{
+			LOG(LOG_LEVEL_ERROR, "Error : invalid watchpoint type in '%s'.\n", String_Description);
+			return 1;
+		}
+	}
+	
+	// Retrieve the optional value
+	if (*Pointer_Character == '=')
+	{
+		Value = strtol(Pointer_Character + 1, &Pointer_Character, 0);
+		if ((Value < 0) || (Value > 0xFF))
+		{
+			LOG(LOG_LEVEL_ERROR, "Error : invalid watchpoint value in '%s'.\n", String_Description);
+			return 1;
+		}
+	}
+	if (*Pointer_Character != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : unexpected characters at the end of the watchpoint '%s'.\n", String_Description);
+		return 1;
+	}
+	
+	if (WatchpointSet(RegisterFileGetPhysicalLocation(Address / REGISTER_FILE_REGISTERS_IN_BANK_COUNT, Address % REGISTER_FILE_REGISTERS_IN_BANK_COUNT), Type, Value, WATCHPOINT_ACTION_LOG) != 0)
+	{
+		LOG(LOG_LEVEL_ERROR, "Error : INDF can't be watched, watch the registers it points to instead.\n");
+		return 1;
+	}
+	return 0;
+}
+
+void WatchpointRemove(unsigned int Location, TWatchpointType Type)
+{
+	if (Location >= REGISTER_FILE_LOCATIONS_COUNT) return;
+	
+	Watchpoint_Table[Location].Types &= ~Type;
+	if (Watchpoint_Table[Location].Types == 0) RegisterFileHookAccesses(Location, 0);
+}
+
+void WatchpointRemoveAll(TWatchpointAction Action)
+{
+	unsigned int Location;
+	
+	for (Location = 0; Location < REGISTER_FILE_LOCATIONS_COUNT; Location++)
+	{
+		if ((Watchpoint_Table[Location].Types != 0) && (Watchpoint_Table[Location].Action == Action)) WatchpointRemove(Location, WATCHPOINT_TYPE_ACCESS);
+	}
+}
+
+void WatchpointGetLastHit(unsigned int *Pointer_Location, TWatchpointType *Pointer_Type)
+{
+	*Pointer_Location = Watchpoint_Last_Hit_Location;
+	*Pointer_Type = Watchpoint_Last_Hit_Type;
+}
+
+void WatchpointRecordAccess(unsigned int Location, int Is_Write, unsigned char Data)
+{
+	TWatchpoint *Pointer_Watchpoint;
+	char String_Address[DISASSEMBLER_ADDRESS_STRING_SIZE];
+	
+	// Check whether the access matches
+	Pointer_Watchpoint = &Watchpoint_Table[Location];
+	if (!(Pointer_Watchpoint->Types & (Is_Write ? WATCHPOINT_TYPE_WRITE : WATCHPOINT_TYPE_READ))) return;
+	if ((Pointer_Watchpoint->Value != WATCHPOINT_VALUE_ANY) && (Pointer_Watchpoint->Value != Data)) return;
+	
+	if (Pointer_Watchpoint->Action == WATCHPOINT_ACTION_LOG)
+	{
+		// The program counter still points to the accessing instruction
+		DisassemblerFormatAddress(CoreGetProgramCounter(), String_Address, sizeof(String_Address));
+		LOG(LOG_LEVEL_ERROR, "Watchpoint : location 0x%03X %s 0x%02X by the instruction at %s, cycle %llu.\n", Location, Is_Write ? "written with" : "read as", Data, String_Address, CoreGetCyclesCount());
+	}
+	else
+	{
+		Watchpoint_Last_Hit_Location = Location;
+		if (Pointer_Watchpoint->Types == WATCHPOINT_TYPE_ACCESS) Watchpoint_Last_Hit_Type = WATCHPOINT_TYPE_ACCESS;
+		else Watchpoint_Last_Hit_Type = Is_Write ? WATCHPOINT_TYPE_WRITE : WATCHPOINT_TYPE_READ;
+		DebuggerHaltOnWatchpoint();
+	}
+}